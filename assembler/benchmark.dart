@@ -0,0 +1,81 @@
+import 'src/assembler.dart';
+import 'src/lexer.dart';
+import 'src/parser.dart';
+
+// Generated code in the shape of our program generators: short basic blocks, forward and backward
+// branches, calls, data accesses through labels and a word table per block group
+String synthesize(int lines, List<int> count) {
+  StringBuffer source = new StringBuffer();
+  int tables = lines ~/ 80 + 1;
+  int blocks = (lines - tables - 5) ~/ 10;
+  if (blocks < 1) blocks = 1;
+  int written = 0;
+
+  source.writeln(".data");
+  written++;
+  for (int i = 0; i < tables; i++) {
+    source.writeln("table$i: .word $i, ${i * 3}, 0x${(i * 7919).toRadixString(16)}, -$i");
+    written++;
+  }
+  source.writeln("message: .asciiz \"generated\\n\"");
+  source.writeln(".text");
+  source.writeln("main:");
+  written += 3;
+
+  for (int i = 0; i < blocks; i++) {
+    int next = (i + 1) % blocks;
+    source.writeln("block$i:");
+    source.writeln("    addi \$t0, \$t0, ${i & 0x7FFF} # counter");
+    source.writeln("    lw \$t1, ${(i & 0xFF) * 4}(\$sp)");
+    source.writeln("    la \$a0, table${i ~/ 8}");
+    source.writeln("    lw \$t2, table${i ~/ 8}");
+    source.writeln("    add \$t3, \$t1, \$t2");
+    source.writeln("    li \$t4, 0x${(i * 2654435761 & 0xFFFFFFFF).toRadixString(16)}");
+    source.writeln("    beq \$t3, \$t4, block$next");
+    source.writeln("    jal block${i ~/ 2}");
+    source.writeln("    move \$v0, \$t3");
+    written += 10;
+  }
+  source.writeln("    syscall");
+  written++;
+
+  count[0] = written;
+  return source.toString();
+}
+
+void run(String source, bool optimize, int lines, bool report) {
+  Stopwatch watch = new Stopwatch()..start();
+
+  Lexer lexer = new Lexer(source);
+  Parser parser = new Parser(lexer);
+  parser.parse();
+  int parsed = watch.elapsedMicroseconds;
+
+  Assembler assembler = new Assembler(parser.assembly, optimize: optimize);
+  assembler.assemble();
+  int total = watch.elapsedMicroseconds;
+
+  if (lexer.hadError || parser.hadError) throw new StateError("Synthetic program does not assemble");
+  if (!report) return;
+
+  double rate(int micros) => lines / (micros / 1000000.0);
+  print("Lines          : $lines");
+  print("Output         : ${assembler.offset} bytes");
+  print("Lex and parse  : ${(parsed / 1000).toStringAsFixed(1)} ms (${rate(parsed).toStringAsFixed(0)} lines/s)");
+  print("Assemble       : ${((total - parsed) / 1000).toStringAsFixed(1)} ms (${rate(total - parsed).toStringAsFixed(0)} lines/s)");
+  print("Total          : ${(total / 1000).toStringAsFixed(1)} ms (${rate(total).toStringAsFixed(0)} lines/s)");
+}
+
+// Usage : dart benchmark.dart [-O] [lines]
+void main(List<String> argv) {
+  bool optimize = argv.contains("-O");
+  List<String> rest = argv.where((arg) => arg != "-O").toList();
+  int lines = rest.isNotEmpty ? int.parse(rest[0]) : 1000000;
+
+  List<int> count = [0];
+  String source = synthesize(lines, count);
+
+  // Let the VM compile the hot paths before timing
+  run(synthesize(lines ~/ 10, [0]), optimize, lines ~/ 10, false);
+  run(source, optimize, count[0], true);
+}
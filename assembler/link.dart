@@ -0,0 +1,48 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'src/linker.dart';
+import 'src/object.dart';
+
+void main(List<String> argv) {
+  bool predecode = argv.isNotEmpty && argv[0] == "--predecode";
+  if (predecode) argv = argv.sublist(1);
+
+  int separator = argv.indexOf("-o");
+  if (separator < 1 || separator != argv.length - 2) {
+    print("Usage : llink [--predecode] [object...] -o [output]");
+    exit(1);
+  }
+
+  List<ObjectFile> objects = [];
+  for (String path in argv.sublist(0, separator)) {
+    File file = new File(path);
+    if (!file.existsSync()) {
+      stderr.writeln("Cannot open file '$path'.");
+      exit(1);
+    }
+
+    try {
+      ObjectFile object = ObjectFile.read(file.readAsBytesSync());
+      object.name = path;
+      objects.add(object);
+    } on FormatException catch(e) {
+      stderr.writeln("Linker Error : '$path' : ${e.message}.");
+      exit(1);
+    }
+  }
+
+  Uint8List program;
+  try {
+    program = (new Linker(objects)..predecode = predecode).link();
+  } on LinkerError catch(e) {
+    stderr.writeln("Linker Error : ${e.message}.");
+    exit(1);
+  }
+
+  File out = new File(argv[separator + 1]);
+  out.createSync();
+  out.writeAsBytesSync(program);
+
+  print("Linker : Linking completed successfully.");
+}
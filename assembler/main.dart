@@ -2,46 +2,141 @@ import 'dart:io';
 import 'dart:typed_data';
 
 import 'src/assembler.dart';
+import 'src/assembly.dart';
+import 'src/cache.dart';
+import 'src/layout.dart';
 import 'src/lexer.dart';
+import 'src/linker.dart';
+import 'src/object.dart';
 import 'src/parser.dart';
 
-void main(List<String> argv) {
-  if (argv.length != 3) {
-    print("Usage : lasm [file] -o [output]");
-    exit(1);
-  }
+void usage() {
+  print("Usage : lasm [-O] [--little-endian] [--predecode] [--profile profile] [file] -o [output]");
+  print("        lasm [-O] [--little-endian] -c [file] -o [object]");
+  print("        lasm [-O] [--little-endian] [--predecode] [file...] -o [output]   Assembles changed modules only and links them");
+  exit(1);
+}
+
+Assembly parse(String source) {
+  Lexer lexer = new Lexer(source);
+  Parser parser = new Parser(lexer);
+  parser.parse();
+
+  if (lexer.hadError || parser.hadError) exit(1);
+
+  return parser.assembly;
+}
+
+void reportError(AssemblerError e) {
+  String header = (e.token != null ? "[line ${e.token.line}] " : "") + "Assembler Error";
+  stderr.writeln("$header : ${e.message}.");
+  exit(1);
+}
+
+// Reuses the cached object of every module whose source did not change since it was last assembled
+List<ObjectFile> assembleModules(List<File> files, bool optimize, bool littleEndian, ObjectCache cache) {
+  List<ObjectFile> objects = [];
+  for (File file in files) {
+    String source = file.readAsStringSync();
+    String key = cache.key(source, optimize, littleEndian);
 
-  File file = new File(argv[0]);
-  if (!file.existsSync()) {
-    stderr.writeln("Cannot open file '${argv[0]}'.");
-    exit(1);
+    ObjectFile object = cache.lookup(key);
+    if (object == null) {
+      print("Assembler : Assembling ${file.absolute.path}");
+      try {
+        object = (new Assembler(parse(source), optimize: optimize)..littleEndian = littleEndian).assembleObject();
+      } on AssemblerError catch(e) {
+        stderr.write("${file.path} ");
+        reportError(e);
+      }
+      cache.store(key, object);
+    } else {
+      print("Assembler : ${file.absolute.path} is up to date");
+    }
+
+    object.name = file.path;
+    objects.add(object);
   }
 
-  print("Assembler : Assembling ${file.absolute.path}");
-  Lexer lexer = new Lexer(file.readAsStringSync());
-  lexer.tokenize();
+  return objects;
+}
 
-  if (lexer.hadError) exit(1);
+void main(List<String> argv) {
+  bool optimize = false;
+  bool objectOnly = false;
+  bool predecode = false;
+  bool littleEndian = false;
+  String profilePath;
+  while (argv.isNotEmpty && (argv[0] == "-O" || argv[0] == "-c" || argv[0] == "--predecode" ||
+      argv[0] == "--little-endian" || argv[0] == "--profile")) {
+    if (argv[0] == "--profile") {
+      if (argv.length < 2) usage();
+      profilePath = argv[1];
+      argv = argv.sublist(1);
+    }
+    if (argv[0] == "-O") optimize = true;
+    if (argv[0] == "-c") objectOnly = true;
+    if (argv[0] == "--predecode") predecode = true;
+    if (argv[0] == "--little-endian") littleEndian = true;
+    argv = argv.sublist(1);
+  }
 
-  Parser parser = new Parser(lexer.tokens);
-  parser.parse();
+  int separator = argv.indexOf("-o");
+  if (separator < 1 || separator != argv.length - 2 || (objectOnly && separator != 1)) usage();
+  // Profiles are keyed by text offsets of a whole program assembled on its own
+  if (profilePath != null && (objectOnly || separator != 1)) usage();
 
-  if (parser.hadError) exit(1);
+  BlockProfile profile;
+  if (profilePath != null) {
+    try {
+      profile = BlockProfile.parse(new File(profilePath).readAsStringSync());
+    } on FileSystemException catch (_) {
+      stderr.writeln("Cannot open profile '$profilePath'.");
+      exit(1);
+    } on FormatException catch (e) {
+      stderr.writeln("Invalid profile '$profilePath' : ${e.message}.");
+      exit(1);
+    }
+  }
 
-  Assembler assembler = new Assembler(parser.assembly);
+  List<File> files = [];
+  for (String path in argv.sublist(0, separator)) {
+    File file = new File(path);
+    if (!file.existsSync()) {
+      stderr.writeln("Cannot open file '$path'.");
+      exit(1);
+    }
+    files.add(file);
+  }
 
   Uint8List program;
-  try {
-    program = assembler.assemble();
-  } on AssemblerError catch(e) {
-    String header = (e.token != null ? "[line ${e.token.line}] " : "") + "Assembler Error";
-    stderr.writeln("$header : ${e.message}.");
-    exit(1);
-  }
+  if (files.length > 1) {
+    File out = new File(argv[separator + 1]);
+    ObjectCache cache = new ObjectCache("${out.parent.path}/.lasm-cache");
+
+    try {
+      program = (new Linker(assembleModules(files, optimize, littleEndian, cache))..predecode = predecode).link();
+    } on LinkerError catch(e) {
+      stderr.writeln("Linker Error : ${e.message}.");
+      exit(1);
+    }
+  } else {
+    File file = files[0];
+    print("Assembler : Assembling ${file.absolute.path}");
+    Assembler assembler = new Assembler(parse(file.readAsStringSync()), optimize: optimize, profile: profile);
+    assembler.predecode = predecode;
+    assembler.littleEndian = littleEndian;
 
-  program = program.sublist(0, assembler.offset);
+    try {
+      program = objectOnly ? assembler.assembleObject().write() : assembler.assemble();
+    } on AssemblerError catch(e) {
+      reportError(e);
+    }
+
+    if (!objectOnly) program = program.sublist(0, assembler.offset);
+  }
 
-  File out = new File(argv[2]);
+  File out = new File(argv[separator + 1]);
   out.createSync();
   out.writeAsBytesSync(program);
 
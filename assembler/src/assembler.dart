@@ -1,7 +1,10 @@
 import 'dart:typed_data';
 
 import 'assembly.dart';
+import 'image.dart';
 import 'instruction.dart';
+import 'layout.dart';
+import 'object.dart';
 import 'token.dart';
 
 List<String> registers = [
@@ -39,44 +42,47 @@ List<String> registers = [
   "\$ra"
 ];
 
-int getRegister(String name) {
-  return registers.indexOf(name);
-}
+final Map<String, int> _registerNumbers =
+    new Map<String, int>.fromIterables(registers, new List<int>.generate(registers.length, (i) => i));
 
-class SectionHeader {
-  String name;
-  int type;
-  int offset;
-  int size;
-
-  SectionHeader(this.name, this.type, this.offset);
+int getRegister(String name) {
+  return _registerNumbers[name] ?? -1;
 }
 
-class Assembler {
+class Assembler extends ImageWriter {
   Assembly assembly;
-  Uint8List buffer;
-  int offset = 0;
   int address = 0;
-  List<SectionHeader> headers = [];
-  int entry = 0;
-  int sha = 0;
   int strt  = 0;
   List<int> relocations = [];
-  // CPU dependant
-  final int DATA_TOP = 0x080000;
-
-  Assembler(Assembly program) {
+  bool optimize;
+  // Object mode leaves label references to the linker
+  bool relocatable = false;
+  ObjectFile object;
+  // Execution profile of a previous build of the same source, reorders the text when given
+  BlockProfile profile;
+  Set<String> _layoutLabels = new Set<String>();
+
+  Assembler(Assembly program, {this.optimize = false, this.profile}) {
     this.assembly = program;
-    int size = assembly.instructions.length * 4 + assembly.dataSize;
-    buffer = new Uint8List(size * 10);
-    offset = 15; // File header length
+    // Widest expansion of every instruction, the buffer grows if data segments need more padding
+    int size = assembly.instructions.length * 12 + assembly.dataSize;
+    // Room for the symbol and line tables
+    size += assembly.instructions.length * 8;
+    for (Label label in assembly.labels.values) {
+      size += 6 + label.name.length;
+    }
+    // Text and data start on their own page
+    buffer = new Uint8List(size + 2 * PAGE_SIZE);
+    offset = PAGE_SIZE;
   }
 
   Uint8List assemble() {
+    if (this.optimize) this.peephole();
+    if (this.profile != null) this.layout();
     this.createRelocationTable();
     this.resolveLabels();
 
-    this.entry = this.offset;
+    this.entry = TEXT_TOP;
     if (!this.assembly.labels.containsKey(this.assembly.entryPoint)) {
       throw new AssemblerError(null, "Entry point symbol ${this.assembly.entryPoint} not found in program");
     }
@@ -84,20 +90,99 @@ class Assembler {
     this.entry += this.assembly.labels[this.assembly.entryPoint].address;
 
     this.emitInstructions();
-    this.emitInstructionHeader();
+    this.emitTextSegment();
     this.emitDataSection();
-    this.emitStringTable();
+    this.emitSymbolTable(this.assembly.labels.values.where((label) => !this._layoutLabels.contains(label.name)));
+    this.emitLineTable(this.lineTable());
+    if (this.predecode) this.emitDecodedSection();
+    this.emitSegmentHeaders();
     this.emitSectionHeaders();
     this.emitFileHeader();
+    this.emitChecksum();
 
     return this.buffer;
   }
 
-  void emitInstructionHeader() {
-    SectionHeader header = new SectionHeader(".text", 0x01, 15);
-    header.size = this.offset - 15;
+  // Assembles the module on its own: text and data start at 0 and every label reference but
+  // local branches is written as a relocation
+  ObjectFile assembleObject() {
+    this.relocatable = true;
+    this.offset = 0;
+
+    if (this.optimize) this.peephole();
+    this.createRelocationTable();
+    this.resolveLabels();
+
+    this.object = new ObjectFile(this.assembly.entryPoint)..littleEndian = this.littleEndian;
+    for (Label label in this.assembly.labels.values) {
+      bool global = this.assembly.globals.contains(label.name) || label.name == this.assembly.entryPoint;
+      this.object.define(label, global);
+    }
+
+    this.emitInstructions();
+    this.object.text = this.buffer.sublist(0, this.offset);
+
+    int start = this.offset;
+    this.emitData();
+    this.object.data = this.buffer.sublist(start, this.offset);
+    this.object.lines = this.lineTable();
+
+    return this.object;
+  }
+
+  // Text offset and source line of the first word of each line
+  List<int> lineTable() {
+    List<int> pairs = [];
+    int previous = 0;
+    for (var i = 0; i < this.assembly.instructions.length; ++i) {
+      Instruction instr = this.assembly.instructions[i];
+      if (instr.removed || instr.line == previous) continue;
+
+      pairs.add(this.relocations[i]);
+      pairs.add(instr.line);
+      previous = instr.line;
+    }
+
+    return pairs;
+  }
+
+  // Hands the live instructions to the block layout along with where the profiled build placed them.
+  // The profile has to come from a build of the same source with the same options and no profile.
+  void layout() {
+    List<Instruction> instructions = this.assembly.instructions;
+    List<Instruction> live = [];
+    List<int> indices = [];
+    List<int> offsets = [];
+    List<int> sizes = [];
+    int address = 0;
+    for (var i = 0; i < instructions.length; ++i) {
+      indices.add(live.length);
+      if (instructions[i].removed) continue;
+
+      int size = this.instructionSize(instructions[i]);
+      live.add(instructions[i]);
+      offsets.add(address);
+      sizes.add(size);
+      address += size;
+    }
+    indices.add(live.length);
+
+    for (int offset in this.profile.executions.keys) {
+      if (offset >= address) throw new AssemblerError(null, "Profile does not match the program, offset $offset is past the text");
+    }
+
+    for (Label label in this.assembly.labels.values) {
+      if (label.segment == Segment.SGT_TEXT) label.address = indices[label.address];
+    }
+    this.assembly.instructions = live;
 
-    headers.add(header);
+    CodeLayout layout = new CodeLayout(this.assembly, this.profile, offsets, sizes);
+    try {
+      layout.run();
+    } on FormatException catch (e) {
+      throw new AssemblerError(null, e.message);
+    }
+    this._layoutLabels = layout.synthetic;
   }
 
   void createRelocationTable() {
@@ -105,66 +190,164 @@ class Assembler {
     for (var i = 0; i < this.assembly.instructions.length; ++i) {
       Instruction instr = this.assembly.instructions[i];
       this.relocations.add(address);
-      address += 4;
+      address += this.instructionSize(instr);
+    }
+  }
 
-      switch(instr.name) {
-        case "add":
-        case "addu":
-        case "and":
-        case "nor":
-        case "or":
-        case "sub":
-        case "subu":
-        case "xor":
-        case "slt":
-        case "sltu":
-        case "beq":
-        case "bne": {
-          address += instr.rt.type == TokenType.T_SCALAR ? 4 : 0;
-          break;
-        }
-        case "blez":
-        case "bltz":
-        case "bgtz":
-        case "bgez":
-        case "blt":
-        case "bge":
-        case "bgt":
-        case "ble":
-        case "sge":
-        case "sgt":
-        case "mul":
-        case "rem":
-        case "remu": {
-          address += instr.rt.type == TokenType.T_SCALAR ? 8 : 4;
-          break;
-        }
-        case "lb":
-        case "lbu":
-        case "lh":
-        case "lhu":
-        case "lw":
-        case "sb":
-        case "sh":
-        case "sw": {
-          address += instr.rs == null ? 8 : 0;
-          break;
-        }
-        case "abs": {
-          address += 8;
-          break;
+  // Size in bytes of the expansion emitInstructions produces for an instruction
+  int instructionSize(Instruction instr) {
+    if (instr.removed) return 0;
+
+    switch(instr.name) {
+      case "add":
+      case "addu":
+      case "and":
+      case "nor":
+      case "or":
+      case "sub":
+      case "subu":
+      case "xor":
+      case "slt":
+      case "sltu": {
+        if (this.optimize && this._immediateForm(instr) != null) return 4;
+        return instr.rt.type == TokenType.T_SCALAR ? 8 : 4;
+      }
+      case "beq":
+      case "bne":
+      case "movn":
+      case "movz":
+      case "mul": {
+        return instr.rt.type == TokenType.T_SCALAR ? 8 : 4;
+      }
+      case "blt":
+      case "bge":
+      case "bgt":
+      case "ble":
+      case "sge":
+      case "sgt":
+      case "rem":
+      case "remu": {
+        return instr.rt.type == TokenType.T_SCALAR ? 12 : 8;
+      }
+      case "lb":
+      case "lbu":
+      case "lh":
+      case "lhu":
+      case "lw":
+      case "sb":
+      case "sh":
+      case "sw":
+      case "lwc1":
+      case "swc1":
+      case "ldc1":
+      case "sdc1": {
+        if (instr.rs != null) return 4;
+        return this.optimize ? 8 : 12;
+      }
+      case "abs": {
+        return 12;
+      }
+      case "la": {
+        Label label = this.assembly.labels[instr.immed.value];
+        if (this.relocatable) return 8;
+        if (this.optimize && label != null) return this._loadImmediateSize(DATA_TOP + label.address);
+        return 8;
+      }
+      case "li": {
+        return this.optimize ? this._loadImmediateSize(instr.immed.value) : 8;
+      }
+      default:
+        return 4;
+    }
+  }
+
+  // Drops instructions that cannot change the machine state, run before relocations are computed
+  void peephole() {
+    List<Instruction> instructions = this.assembly.instructions;
+    Set<int> targets = new Set<int>();
+    for (Label label in this.assembly.labels.values) {
+      if (label.segment == Segment.SGT_TEXT) targets.add(label.address);
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      int previous = -1;
+      for (var i = 0; i < instructions.length; ++i) {
+        Instruction instr = instructions[i];
+        if (instr.removed) continue;
+
+        // Another path may reach an instruction some label points at, or at a removed instruction before it
+        bool target = false;
+        for (var j = previous + 1; j <= i; ++j) {
+          target = target || targets.contains(j);
         }
-        case "la":
-        case "li": {
-          address += 4;
-          break;
+
+        if (this._isNoOp(instr) ||
+            this._isJumpToNext(i, instr) ||
+            (!target && previous >= 0 && this._repeatsMove(instructions[previous], instr))) {
+          instr.removed = true;
+          changed = true;
+          continue;
         }
-        default:
-          break;
+
+        previous = i;
       }
     }
   }
 
+  bool _isNoOp(Instruction instr) {
+    switch (instr.name) {
+      case "move":
+        return instr.rs.value == instr.rt.value;
+      case "add":
+      case "addu":
+      case "or":
+      case "xor":
+      case "sub":
+      case "subu":
+        return instr.rt.type == TokenType.T_REGISTER && instr.rd.value == instr.rs.value && instr.rt.value == 0;
+      case "addi":
+      case "addiu":
+      case "ori":
+      case "xori":
+      case "sll":
+      case "srl":
+      case "sra":
+        return instr.rt.value == instr.rs.value && instr.immed.value == 0;
+      default:
+        return false;
+    }
+  }
+
+  bool _isJumpToNext(int index, Instruction instr) {
+    bool plain = instr.name == "j" || instr.name == "b" ||
+        ((instr.name == "beq" || instr.name == "bne") && instr.rt.type == TokenType.T_REGISTER);
+    if (!plain || instr.immed.type != TokenType.T_IDENTIFIER) return false;
+
+    Label label = this.assembly.labels[instr.immed.value];
+    if (label == null || label.segment != Segment.SGT_TEXT) return false;
+
+    return this._nextLive(label.address) == this._nextLive(index + 1);
+  }
+
+  // "move $a, $b" right after "move $b, $a" or an identical move leaves every register as it was
+  bool _repeatsMove(Instruction previous, Instruction instr) {
+    if (previous.name != "move" || instr.name != "move") return false;
+
+    bool same = previous.rs.value == instr.rs.value && previous.rt.value == instr.rt.value;
+    bool swapped = previous.rs.value == instr.rt.value && previous.rt.value == instr.rs.value;
+    return same || swapped;
+  }
+
+  int _nextLive(int index) {
+    while (index < this.assembly.instructions.length && this.assembly.instructions[index].removed) {
+      index++;
+    }
+
+    return index;
+  }
+
   void resolveLabels() {
     for (Label label in assembly.labels.values) {
       if (label.segment == Segment.SGT_TEXT) {
@@ -173,23 +356,17 @@ class Assembler {
     }
   }
 
-  void emitStringTable() {
-    SectionHeader string = new SectionHeader(".string", 0x02, this.offset);
-
-    this.emitByte(0);
-    this.emitByte(0);
-
-    string.size = this.offset - string.offset;
-    headers.add(string);
-  }
-
   void emitDataSection() {
-    SectionHeader data = new SectionHeader(".data", 0x04, this.offset);
+    int start = this.offset;
+    this.emitData();
+    this.emitDataSegments(start);
+  }
 
+  void emitData() {
     Map<String, Function> map = {
       ".byte": this.emitByte,
-      ".half": this.emitHalf,
-      ".word": this.emitWord
+      ".half": this.emitGuestHalf,
+      ".word": this.emitGuestWord
     };
 
     for (Directive directive in this.assembly.directives) {
@@ -206,6 +383,24 @@ class Assembler {
           }
           break;
         }
+        case ".float": {
+          ByteData bits = new ByteData(4);
+          for(int i = 0; i < directive.operands.length; i++) {
+            bits.setFloat32(0, directive.operands[i]);
+            this.emitGuestWord(bits.getUint32(0));
+          }
+          break;
+        }
+        case ".double": {
+          // The high word goes first on a big-endian guest, as ldc1 expects it
+          ByteData bits = new ByteData(8);
+          for(int i = 0; i < directive.operands.length; i++) {
+            bits.setFloat64(0, directive.operands[i]);
+            this.emitGuestWord(bits.getUint32(this.littleEndian ? 4 : 0));
+            this.emitGuestWord(bits.getUint32(this.littleEndian ? 0 : 4));
+          }
+          break;
+        }
         case ".ascii": {
           for(int i = 0; i < directive.operands.length; i++) {
             this.emitBytes(directive.operands[i].toString().codeUnits);
@@ -222,38 +417,12 @@ class Assembler {
 
       this.emitBytes(List.filled(directive.align, 0));
     }
-
-    data.size = this.offset - data.offset;
-
-    headers.add(data);
-  }
-
-  void emitSectionHeaders() {
-    this.sha = this.offset;
-    for(SectionHeader header in this.headers) {
-      this.emitHalf(0);
-      this.emitByte(header.type);
-      this.emitWord(header.offset);
-      this.emitWord(header.size);
-    }
-  }
-
-  void emitFileHeader() {
-    int length = this.offset;
-
-    this.offset = 0;
-    this.emitByte(0x10);
-    this.emitBytes("LEF".codeUnits);
-    this.emitBytes([0x01, 0x00]); // Writes major and minor version;
-    this.emitWord(this.entry);
-    this.emitWord(this.sha);
-    this.emitByte(headers.length);
-
-    this.offset = length;
   }
 
   void emitInstructions() {
     for (Instruction instr in assembly.instructions) {
+      if (instr.removed) continue;
+
       switch (instr.name) {
         case "abs": {
           this.emitSpecial("addu", 0x00, instr.rt.value, instr.rs.value, 0x00);
@@ -271,14 +440,49 @@ class Assembler {
         case "xor":
         case "slt":
         case "sltu": {
+          String immediate = this.optimize ? this._immediateForm(instr) : null;
+          if (immediate != null) {
+            int value = (instr.rt.value as int) & 0xFFFF;
+            this.emitImmediate(immediate, instr.rs.value, instr.rd.value, instr.name.startsWith("sub") ? -value : value);
+            break;
+          }
+
+          int rt = this._getRt(instr.rt);
+          this.emitSpecial(instr.name, instr.rs.value, rt, instr.rd.value, 0x00);
+          break;
+        }
+        case "movn":
+        case "movz": {
           int rt = this._getRt(instr.rt);
           this.emitSpecial(instr.name, instr.rs.value, rt, instr.rd.value, 0x00);
           break;
         }
         case "mul": {
           int rt = this._getRt(instr.rt);
-          this.emitSpecial("mult", instr.rs.value, rt, 0x00, 0x00);
-          this.emitSpecial("mflo", 0x00, 0x00, instr.rd.value, 0x00);
+          this.emitFunction("special2", "mul", instr.rs.value, rt, instr.rd.value, 0x00);
+          break;
+        }
+        case "clo":
+        case "clz": {
+          // MIPS32 wants the destination in both the rd and rt fields
+          this.emitFunction("special2", instr.name, instr.rt.value, instr.rs.value, instr.rs.value, 0x00);
+          break;
+        }
+        case "seb":
+        case "seh": {
+          this.emitFunction("special3", "bshfl", 0x00, instr.rt.value, instr.rs.value, OpCodes[instr.name]);
+          break;
+        }
+        case "ext":
+        case "ins": {
+          int pos = instr.shmt.value;
+          int size = instr.immed.value;
+          if (pos < 0 || pos > 31 || size < 1 || pos + size > 32) {
+            throw new AssemblerError(instr.immed, "Bit field of ${size} bits at ${pos} does not fit in a register.");
+          }
+
+          int msb = instr.name == "ext" ? size - 1 : pos + size - 1;
+          this.emitFunction("special3", instr.name, instr.rs.value, instr.rt.value, msb, pos);
           break;
         }
         case "addi":
@@ -331,6 +535,11 @@ class Assembler {
           break;
         }
         case "li": {
+          if (this.optimize) {
+            this.emitLoadImmediate(instr.rt.value, instr.immed.value);
+            break;
+          }
+
           this.emitImmediate("lui", 0x00, getRegister("\$at"), (instr.immed.value as int) >> 16);
           this.emitImmediate("ori", getRegister("\$at"), instr.rt.value, (instr.immed.value as int));
           break;
@@ -367,13 +576,7 @@ class Assembler {
         }
         case "beqz":
         case "bnez": {
-          int address;
-          Token label = instr.immed;
-          if(!this.assembly.labels.containsKey(label.value)) {
-            throw new AssemblerError(label, "Undefined label '${label.value}'.");
-          }
-
-          address = this.resolveLabelAddr(this.assembly.labels[label.value].address) >> 2;
+          int address = this._getAddress(instr.immed);
 
           this.emitImmediate(instr.name.substring(0, 3), 0x00, instr.rt.value, address);
           break;
@@ -405,13 +608,7 @@ class Assembler {
         }
         case "bgez":
         case "bltz": {
-          int address;
-          Token label = instr.immed;
-          if(!this.assembly.labels.containsKey(label.value)) {
-            throw new AssemblerError(label, "Undefined label '${label.value}'.");
-          }
-
-          address = this.resolveLabelAddr(this.assembly.labels[label.value].address) >> 2;
+          int address = this._getAddress(instr.immed);
 
           this.emitImmediate("rsi", instr.rt.value, OpCodes[instr.name], address);
           break;
@@ -427,11 +624,23 @@ class Assembler {
         case "la": {
           Token label = instr.immed;
           int address;
+          if (this.relocatable) {
+            this._relocate(label, RelocationType.R_HILO);
+            this.emitImmediate("lui", 0x00, getRegister("\$at"), 0);
+            this.emitImmediate("ori", getRegister("\$at"), instr.rt.value, 0);
+            break;
+          }
+
           if(!this.assembly.labels.containsKey(label.value)) {
             throw new AssemblerError(label, "Undefined label '${label.value}'.");
           }
 
           address = DATA_TOP + this.assembly.labels[label.value].address;
+          if (this.optimize) {
+            this.emitLoadImmediate(instr.rt.value, address);
+            break;
+          }
+
           this.emitImmediate("lui", 0x00, getRegister("\$at"), address >> 16);
           this.emitImmediate("ori", getRegister("\$at"), instr.rt.value, address);
           break;
@@ -443,15 +652,30 @@ class Assembler {
         case "lw":
         case "sb":
         case "sh":
-        case "sw": {
+        case "sw":
+        case "lwc1":
+        case "swc1":
+        case "ldc1":
+        case "sdc1": {
+          if (instr.name.endsWith("dc1")) this._checkPaired(instr.rt);
           if (instr.rs == null) { // Then a label has been given as operand
             Token label = instr.immed;
-            int address;
-            if(!this.assembly.labels.containsKey(label.value)) {
+            int address = 0;
+            if (this.relocatable) {
+              // The linker fills both halves, the upper one rounded when the offset is sign extended
+              this._relocate(label, this.optimize ? RelocationType.R_HALO : RelocationType.R_HILO);
+            } else if(!this.assembly.labels.containsKey(label.value)) {
               throw new AssemblerError(label, "Undefined label '${label.value}'.");
+            } else {
+              address = DATA_TOP + this.assembly.labels[label.value].address;
             }
 
-            address = DATA_TOP + this.assembly.labels[label.value].address;
+            if (this.optimize) {
+              // Offsets are sign extended, the upper half absorbs the borrow
+              this.emitImmediate("lui", 0x00, getRegister("\$at"), (address + 0x8000) >> 16);
+              this.emitImmediate(instr.name, getRegister("\$at"), instr.rt.value, address);
+              break;
+            }
 
             this.emitImmediate("lui", 0x00, getRegister("\$at"), address >> 16);
             this.emitImmediate("ori", getRegister("\$at"), getRegister("\$at"), address);
@@ -479,54 +703,169 @@ class Assembler {
           this.emitSpecial("syscall", 0x00, 0x00, 0x00, 0x00);
           break;
         }
+        case "mfc1":
+        case "mtc1": {
+          this.emitCop1(FpuFormats[instr.name.substring(0, 2)], instr.rt.value, instr.rs.value, 0x00, 0x00);
+          break;
+        }
+        case "bc1f":
+        case "bc1t": {
+          int address = this._getAddress(instr.immed);
+          this.emitImmediate("cop1", FpuFormats["bc"], instr.name == "bc1t" ? 1 : 0, address);
+          break;
+        }
         default:
+          if (VectorCodes.containsKey(instr.name.split(".").first)) {
+            this.emitVectorOperation(instr);
+            break;
+          }
+          if (instr.name.contains(".")) {
+            this.emitFloatOperation(instr);
+            break;
+          }
           throw new AssemblerError(null, "Instruction '${instr.name}' is not yet supported.");
       }
     }
   }
 
+  // Shortest sequence loading a 32-bit constant, matching _loadImmediateSize
+  void emitLoadImmediate(int rt, int value) {
+    value &= 0xFFFFFFFF;
+    if (value <= 0x7FFF || value >= 0xFFFF8000) {
+      this.emitImmediate("addiu", 0x00, rt, value);
+    } else if (value <= 0xFFFF) {
+      this.emitImmediate("ori", 0x00, rt, value);
+    } else if ((value & 0xFFFF) == 0) {
+      this.emitImmediate("lui", 0x00, rt, value >> 16);
+    } else {
+      this.emitImmediate("lui", 0x00, rt, value >> 16);
+      this.emitImmediate("ori", rt, rt, value);
+    }
+  }
+
+  int _loadImmediateSize(int value) {
+    value &= 0xFFFFFFFF;
+    bool single = value <= 0xFFFF || value >= 0xFFFF8000 || (value & 0xFFFF) == 0;
+    return single ? 4 : 8;
+  }
+
+  // Immediate instruction computing the same result as an R-type one with a scalar operand, if any.
+  // Scalars go through a zero-extended ori otherwise, so arithmetic forms need them to stay positive.
+  String _immediateForm(Instruction instr) {
+    if (instr.rt.type != TokenType.T_SCALAR) return null;
+
+    int value = (instr.rt.value as int) & 0xFFFF;
+    switch (instr.name) {
+      case "and":
+      case "or":
+      case "xor":
+        return instr.name + "i";
+      case "add":
+      case "slt":
+        return value <= 0x7FFF ? instr.name + "i" : null;
+      case "addu":
+        return value <= 0x7FFF ? "addiu" : null;
+      case "sltu":
+        return value <= 0x7FFF ? "sltiu" : null;
+      case "sub":
+        return value <= 0x8000 ? "addi" : null;
+      case "subu":
+        return value <= 0x8000 ? "addiu" : null;
+      default:
+        return null;
+    }
+  }
+
   void emitJInstruction(int code, int immediate) {
     int instr = (code << 26) | immediate;
-    this.emitWord(instr);
+    this.emitGuestWord(instr);
     this.address += 4;
   }
 
   void emitSpecial(String code, int rs, int rt, int rd, int shmt) {
-    int instr = (0x00 << 26) |
+    this.emitFunction(null, code, rs, rt, rd, shmt);
+  }
+
+  // Register format word of the opcode, SPECIAL when null, selecting the function
+  void emitFunction(String opcode, String code, int rs, int rt, int rd, int shmt) {
+    int instr = ((opcode == null ? 0x00 : OpCodes[opcode]) << 26) |
         (rs << 21) |
         (rt << 16) |
         (rd << 11) |
         (shmt << 6) |
         (OpCodes[code] & 0x3F);
-    this.emitWord(instr);
+    this.emitGuestWord(instr);
     this.address += 4;
   }
 
-  void emitImmediate(String code, int rs, int rt, int immed) {
-    int instr = (OpCodes[code] << 26) | (rs << 21) | (rt << 16) | (immed & 0xFFFF);
-    this.emitWord(instr);
+  void emitCop1(int format, int ft, int fs, int fd, int code) {
+    int instr = (OpCodes["cop1"] << 26) | (format << 21) | (ft << 16) | (fs << 11) | (fd << 6) | code;
+    this.emitGuestWord(instr);
     this.address += 4;
   }
 
-  void emitByte(int byte) {
-    this.buffer[offset++] = byte;
-  }
+  // Arithmetic, compares and conversions, named operation.format with the source format last
+  void emitFloatOperation(Instruction instr) {
+    int split = instr.name.lastIndexOf(".");
+    String operation = instr.name.substring(0, split);
+    String format = instr.name.substring(split + 1);
+
+    if (format == "d") {
+      this._checkPaired(instr.rs);
+      if (instr.rt != null) this._checkPaired(instr.rt);
+    }
+    if (operation == "cvt.d" || (format == "d" && !operation.contains("."))) this._checkPaired(instr.rd);
 
-  void emitBytes(List<int> bytes) {
-    this.buffer.setAll(offset, bytes);
-    offset += bytes.length;
+    this.emitCop1(FpuFormats[format], instr.rt == null ? 0x00 : instr.rt.value, instr.rs.value,
+        instr.rd == null ? 0x00 : instr.rd.value, FpuCodes[operation]);
   }
 
-  void emitHalf(int half) {
-    emitByte(half >> 0x08);
-    emitByte(half);
+  // MSA instructions, named operation.df, in the format their minor opcode selects
+  void emitVectorOperation(Instruction instr) {
+    int split = instr.name.lastIndexOf(".");
+    List<int> code = VectorCodes[instr.name.substring(0, split)];
+    int df = VectorFormats[instr.name.substring(split + 1)];
+    int minor = code[0];
+    int operation = code[1];
+    int fields;
+
+    switch (minor) {
+      case 0x02: // I8, shf
+        this._checkRange(instr.immed, 0, 0xFF, "Lane selectors");
+        fields = (df << 24) | (instr.immed.value << 16) | (instr.rs.value << 11) | (instr.rd.value << 6);
+        break;
+      case 0x19: { // ELM, copy_s and copy_u with the lane size in the leading ones of the lane field
+        this._checkRange(instr.immed, 0, (16 >> df) - 1, "Lane index");
+        int lane = [0x00, 0x20, 0x30][df] | instr.immed.value;
+        fields = (operation << 22) | (lane << 16) | (instr.rs.value << 11) | (instr.rd.value << 6);
+        break;
+      }
+      case 0x1E: // 2R, fill
+        fields = (operation << 18) | (df << 16) | (instr.rs.value << 11) | (instr.rd.value << 6);
+        break;
+      case 0x20:
+      case 0x24: { // MI10, ld and st count their offset in lanes
+        int offset = instr.immed.value;
+        if (offset % (1 << df) != 0) {
+          throw new AssemblerError(instr.immed, "Offset $offset is not a multiple of the lane size.");
+        }
+        this._checkRange(instr.immed, -512 << df, 511 << df, "Offset");
+        fields = (((offset >> df) & 0x3FF) << 16) | (instr.rs.value << 11) | (instr.rd.value << 6) | df;
+        break;
+      }
+      default: // 3R
+        fields = (operation << 23) | (df << 21) | (instr.rt.value << 16) | (instr.rs.value << 11) | (instr.rd.value << 6);
+        break;
+    }
+
+    this.emitGuestWord((OpCodes["msa"] << 26) | fields | minor);
+    this.address += 4;
   }
 
-  void emitWord(int word) {
-    emitByte(word >> 0x18);
-    emitByte(word >> 0x10);
-    emitByte(word >> 0x08);
-    emitByte(word);
+  void emitImmediate(String code, int rs, int rt, int immed) {
+    int instr = (OpCodes[code] << 26) | (rs << 21) | (rt << 16) | (immed & 0xFFFF);
+    this.emitGuestWord(instr);
+    this.address += 4;
   }
 
   int resolveLabelAddr(int label) {
@@ -535,6 +874,12 @@ class Assembler {
 
   int _getAddress(Token label, [bool absolute = false]) {
     if (label.type == TokenType.T_IDENTIFIER) {
+      // Jumps always depend on where the module lands, branches only when they leave it
+      if (this.relocatable && (absolute || !this.assembly.labels.containsKey(label.value))) {
+        this._relocate(label, absolute ? RelocationType.R_JUMP26 : RelocationType.R_BRANCH16);
+        return 0;
+      }
+
       if(!this.assembly.labels.containsKey(label.value)) {
         throw new AssemblerError(label, "Undefined label '${label.value}'.");
       }
@@ -548,6 +893,24 @@ class Assembler {
     return ((label.value as int) >> 2) & 0x03FFFFFF;
   }
 
+  // Records a relocation against a label for the instruction about to be emitted
+  void _relocate(Token label, RelocationType type) {
+    this.object.relocations.add(new Relocation(this.address, type, this.object.symbolIndex(label.value)));
+  }
+
+  // Doubles take an even register and the odd one after it
+  void _checkPaired(Token register) {
+    if ((register.value as int) & 0x01 != 0) {
+      throw new AssemblerError(register, "Double precision operand '\$f${register.value}' is not an even register.");
+    }
+  }
+
+  void _checkRange(Token value, int min, int max, String what) {
+    if ((value.value as int) < min || (value.value as int) > max) {
+      throw new AssemblerError(value, "$what ${value.value} is out of range, expected $min to $max.");
+    }
+  }
+
   int _getRt(Token token) {
     if (token.type == TokenType.T_SCALAR) {
       int rt = getRegister("\$at");
@@ -22,6 +22,8 @@ class Assembly {
   List<Instruction> instructions = [];
   List<Directive> directives = [];
   Map<String, Label> labels = {};
+  Label lastLabel;
+  Set<String> globals = new Set<String>(); // Labels other modules may refer to
   int dataSize = 0;
   String entryPoint = "main";
 
@@ -31,6 +33,7 @@ class Assembly {
 
   void addLabel(Label label) {
     labels[label.name] = label;
+    lastLabel = label;
   }
 
   void addDirective(Directive directive) {
@@ -0,0 +1,45 @@
+import 'dart:io';
+
+import 'object.dart';
+
+// Object files keyed by a hash of their source, so unchanged modules are never reassembled
+class ObjectCache {
+  Directory directory;
+
+  ObjectCache(String path) {
+    this.directory = new Directory(path);
+  }
+
+  // FNV-1a 64 of the source along with everything else the object depends on
+  String key(String source, bool optimize, bool littleEndian) {
+    int hash = 0xCBF29CE484222325;
+    String options = "${optimize ? "-O" : ""}${littleEndian ? "-EL" : ""}";
+    for (int unit in "LOF${ObjectFile.VERSION}$options\n$source".codeUnits) {
+      hash = (hash ^ unit) * 0x100000001B3;
+    }
+
+    String high = ((hash >> 32) & 0xFFFFFFFF).toRadixString(16).padLeft(8, "0");
+    String low = (hash & 0xFFFFFFFF).toRadixString(16).padLeft(8, "0");
+    return high + low;
+  }
+
+  ObjectFile lookup(String key) {
+    File file = new File("${this.directory.path}/$key.lo");
+    if (!file.existsSync()) return null;
+
+    try {
+      return ObjectFile.read(file.readAsBytesSync());
+    } on FormatException catch (_) {
+      return null;
+    }
+  }
+
+  // Written under a temporary name first so concurrent builds never read half an object
+  void store(String key, ObjectFile object) {
+    this.directory.createSync(recursive: true);
+
+    File temporary = new File("${this.directory.path}/$key.lo.$pid");
+    temporary.writeAsBytesSync(object.write());
+    temporary.renameSync("${this.directory.path}/$key.lo");
+  }
+}
@@ -0,0 +1,437 @@
+// Pre-decoded form of the text the VM runs directly, see src/decode.h. The handler order is part of the
+// executable format and matches DecodedOp there.
+enum DecodedOp {
+  DOP_UNKNOWN,
+  DOP_UNKNOWN_SPECIAL,
+  DOP_UNKNOWN_REGIMM,
+  DOP_SLL,
+  DOP_SRL,
+  DOP_SRA,
+  DOP_SLLV,
+  DOP_SRLV,
+  DOP_SRAV,
+  DOP_JR,
+  DOP_JALR,
+  DOP_SYSCALL,
+  DOP_MFHI,
+  DOP_MTHI,
+  DOP_MFLO,
+  DOP_MTLO,
+  DOP_MULT,
+  DOP_MULTU,
+  DOP_DIV,
+  DOP_DIVU,
+  DOP_ADD,
+  DOP_ADDU,
+  DOP_SUB,
+  DOP_SUBU,
+  DOP_AND,
+  DOP_OR,
+  DOP_XOR,
+  DOP_NOR,
+  DOP_SLT,
+  DOP_SLTU,
+  DOP_BLTZ,
+  DOP_BGEZ,
+  DOP_J,
+  DOP_JAL,
+  DOP_BEQ,
+  DOP_BNE,
+  DOP_BLEZ,
+  DOP_BGTZ,
+  DOP_ADDI,
+  DOP_ADDIU,
+  DOP_SLTI,
+  DOP_SLTIU,
+  DOP_ANDI,
+  DOP_ORI,
+  DOP_XORI,
+  DOP_LUI,
+  DOP_LB,
+  DOP_LH,
+  DOP_LW,
+  DOP_LBU,
+  DOP_LHU,
+  DOP_SB,
+  DOP_SH,
+  DOP_SW,
+  DOP_MOVZ,
+  DOP_MOVN,
+  DOP_MUL,
+  DOP_CLZ,
+  DOP_CLO,
+  DOP_SEB,
+  DOP_SEH,
+  DOP_EXT,
+  DOP_INS,
+  DOP_ADD_S,
+  DOP_SUB_S,
+  DOP_MUL_S,
+  DOP_DIV_S,
+  DOP_SQRT_S,
+  DOP_ABS_S,
+  DOP_MOV_S,
+  DOP_NEG_S,
+  DOP_ADD_D,
+  DOP_SUB_D,
+  DOP_MUL_D,
+  DOP_DIV_D,
+  DOP_SQRT_D,
+  DOP_ABS_D,
+  DOP_MOV_D,
+  DOP_NEG_D,
+  DOP_C_EQ_S,
+  DOP_C_LT_S,
+  DOP_C_LE_S,
+  DOP_C_EQ_D,
+  DOP_C_LT_D,
+  DOP_C_LE_D,
+  DOP_CVT_S_D,
+  DOP_CVT_S_W,
+  DOP_CVT_D_S,
+  DOP_CVT_D_W,
+  DOP_CVT_W_S,
+  DOP_CVT_W_D,
+  DOP_TRUNC_W_S,
+  DOP_TRUNC_W_D,
+  DOP_MFC1,
+  DOP_MTC1,
+  DOP_LWC1,
+  DOP_SWC1,
+  DOP_LDC1,
+  DOP_SDC1,
+  DOP_BC1F,
+  DOP_BC1T,
+  DOP_ADDV_B,
+  DOP_ADDV_H,
+  DOP_ADDV_W,
+  DOP_SUBV_B,
+  DOP_SUBV_H,
+  DOP_SUBV_W,
+  DOP_MAX_S_B,
+  DOP_MAX_S_H,
+  DOP_MAX_S_W,
+  DOP_MAX_U_B,
+  DOP_MAX_U_H,
+  DOP_MAX_U_W,
+  DOP_MIN_S_B,
+  DOP_MIN_S_H,
+  DOP_MIN_S_W,
+  DOP_MIN_U_B,
+  DOP_MIN_U_H,
+  DOP_MIN_U_W,
+  DOP_CEQ_B,
+  DOP_CEQ_H,
+  DOP_CEQ_W,
+  DOP_CLT_S_B,
+  DOP_CLT_S_H,
+  DOP_CLT_S_W,
+  DOP_CLT_U_B,
+  DOP_CLT_U_H,
+  DOP_CLT_U_W,
+  DOP_HADD_S_H,
+  DOP_HADD_S_W,
+  DOP_HADD_U_H,
+  DOP_HADD_U_W,
+  DOP_SHF_B,
+  DOP_SHF_H,
+  DOP_SHF_W,
+  DOP_LD_B,
+  DOP_LD_H,
+  DOP_LD_W,
+  DOP_ST_B,
+  DOP_ST_H,
+  DOP_ST_W,
+  DOP_FILL_B,
+  DOP_FILL_H,
+  DOP_FILL_W,
+  DOP_COPY_S_B,
+  DOP_COPY_S_H,
+  DOP_COPY_S_W,
+  DOP_COPY_U_B,
+  DOP_COPY_U_H
+}
+
+const Map<int, DecodedOp> _specialOps = {
+  0x00: DecodedOp.DOP_SLL,
+  0x02: DecodedOp.DOP_SRL,
+  0x03: DecodedOp.DOP_SRA,
+  0x04: DecodedOp.DOP_SLLV,
+  0x06: DecodedOp.DOP_SRLV,
+  0x07: DecodedOp.DOP_SRAV,
+  0x08: DecodedOp.DOP_JR,
+  0x09: DecodedOp.DOP_JALR,
+  0x0A: DecodedOp.DOP_MOVZ,
+  0x0B: DecodedOp.DOP_MOVN,
+  0x0C: DecodedOp.DOP_SYSCALL,
+  0x10: DecodedOp.DOP_MFHI,
+  0x11: DecodedOp.DOP_MTHI,
+  0x12: DecodedOp.DOP_MFLO,
+  0x13: DecodedOp.DOP_MTLO,
+  0x18: DecodedOp.DOP_MULT,
+  0x19: DecodedOp.DOP_MULTU,
+  0x1A: DecodedOp.DOP_DIV,
+  0x1B: DecodedOp.DOP_DIVU,
+  0x20: DecodedOp.DOP_ADD,
+  0x21: DecodedOp.DOP_ADDU,
+  0x22: DecodedOp.DOP_SUB,
+  0x23: DecodedOp.DOP_SUBU,
+  0x24: DecodedOp.DOP_AND,
+  0x25: DecodedOp.DOP_OR,
+  0x26: DecodedOp.DOP_XOR,
+  0x27: DecodedOp.DOP_NOR,
+  0x2A: DecodedOp.DOP_SLT,
+  0x2B: DecodedOp.DOP_SLTU
+};
+
+const Map<int, DecodedOp> _special2Ops = {
+  0x02: DecodedOp.DOP_MUL,
+  0x20: DecodedOp.DOP_CLZ,
+  0x21: DecodedOp.DOP_CLO
+};
+
+const Map<int, DecodedOp> _conversions = {
+  0x1120: DecodedOp.DOP_CVT_S_D,
+  0x1420: DecodedOp.DOP_CVT_S_W,
+  0x1021: DecodedOp.DOP_CVT_D_S,
+  0x1421: DecodedOp.DOP_CVT_D_W,
+  0x1024: DecodedOp.DOP_CVT_W_S,
+  0x1124: DecodedOp.DOP_CVT_W_D,
+  0x100D: DecodedOp.DOP_TRUNC_W_S,
+  0x110D: DecodedOp.DOP_TRUNC_W_D
+};
+
+const Map<int, DecodedOp> _immediateOps = {
+  0x08: DecodedOp.DOP_ADDI,
+  0x09: DecodedOp.DOP_ADDIU,
+  0x0A: DecodedOp.DOP_SLTI,
+  0x0B: DecodedOp.DOP_SLTIU,
+  0x0C: DecodedOp.DOP_ANDI,
+  0x0D: DecodedOp.DOP_ORI,
+  0x0E: DecodedOp.DOP_XORI,
+  0x0F: DecodedOp.DOP_LUI,
+  0x20: DecodedOp.DOP_LB,
+  0x21: DecodedOp.DOP_LH,
+  0x23: DecodedOp.DOP_LW,
+  0x24: DecodedOp.DOP_LBU,
+  0x25: DecodedOp.DOP_LHU,
+  0x28: DecodedOp.DOP_SB,
+  0x29: DecodedOp.DOP_SH,
+  0x2A: DecodedOp.DOP_SW,
+  0x31: DecodedOp.DOP_LWC1,
+  0x35: DecodedOp.DOP_LDC1,
+  0x39: DecodedOp.DOP_SWC1,
+  0x3D: DecodedOp.DOP_SDC1
+};
+
+const Map<int, DecodedOp> _branchOps = {
+  0x02: DecodedOp.DOP_J,
+  0x03: DecodedOp.DOP_JAL,
+  0x04: DecodedOp.DOP_BEQ,
+  0x05: DecodedOp.DOP_BNE,
+  0x06: DecodedOp.DOP_BLEZ,
+  0x07: DecodedOp.DOP_BGTZ
+};
+
+// One record of the section: handler, registers and a 32-bit operand
+class DecodedInstr {
+  DecodedOp op;
+  int rd;
+  int rs;
+  int rt;
+  int immed = 0;
+
+  // Same decoding as decodeInstruction in the VM, ip being the offset of the word in the text
+  DecodedInstr(int ip, int instr) {
+    int code = instr >> 26;
+    this.rs = (instr >> 21) & 0x1F;
+    this.rt = (instr >> 16) & 0x1F;
+    this.rd = (instr >> 11) & 0x1F;
+    int immediate = instr & 0xFFFF;
+
+    if (code == 0x00) {
+      int func = instr & 0x3F;
+      this.op = _specialOps[func] ?? DecodedOp.DOP_UNKNOWN_SPECIAL;
+      if (this.op == DecodedOp.DOP_UNKNOWN_SPECIAL) {
+        this.immed = func;
+      } else if (this.op == DecodedOp.DOP_JALR) {
+        if (this.rd == 0) this.rd = 31;
+      } else {
+        this.immed = (instr >> 6) & 0x1F;
+      }
+    } else if (code == 0x11) {
+      this._decodeCop1(ip, instr);
+      if (!this._pairedRegisters()) this.op = DecodedOp.DOP_UNKNOWN;
+      if (this.op == DecodedOp.DOP_UNKNOWN) this.immed = code;
+    } else if (code == 0x1E) {
+      this._decodeMsa(instr);
+      if (this.op == DecodedOp.DOP_UNKNOWN) this.immed = code;
+    } else if (code == 0x1C) {
+      this.op = _special2Ops[instr & 0x3F] ?? DecodedOp.DOP_UNKNOWN;
+      if (this.op == DecodedOp.DOP_UNKNOWN) this.immed = code;
+    } else if (code == 0x1F) {
+      this._decodeSpecial3(instr);
+      if (this.op == DecodedOp.DOP_UNKNOWN) this.immed = code;
+    } else if (code == 0x01) {
+      this.op = this.rt == 0 ? DecodedOp.DOP_BLTZ : (this.rt == 1 ? DecodedOp.DOP_BGEZ : DecodedOp.DOP_UNKNOWN_REGIMM);
+      this.immed = this.op == DecodedOp.DOP_UNKNOWN_REGIMM ? this.rt : ip + _branchOffset(immediate);
+    } else if (code == 0x02 || code == 0x03) {
+      this.op = _branchOps[code];
+      this.immed = (instr & 0x03FFFFFF) << 2;
+    } else if (_branchOps.containsKey(code)) {
+      this.op = _branchOps[code];
+      this.immed = ip + _branchOffset(immediate);
+    } else if (_immediateOps.containsKey(code)) {
+      this.op = _immediateOps[code];
+      if (this.op == DecodedOp.DOP_LUI) {
+        this.immed = immediate << 16;
+      } else if (this.op == DecodedOp.DOP_ANDI || this.op == DecodedOp.DOP_ORI || this.op == DecodedOp.DOP_XORI) {
+        this.immed = immediate;
+      } else {
+        this.immed = immediate >= 0x8000 ? immediate - 0x10000 : immediate;
+      }
+      if (!this._pairedRegisters()) {
+        this.op = DecodedOp.DOP_UNKNOWN;
+        this.immed = code;
+      }
+    } else {
+      this.op = DecodedOp.DOP_UNKNOWN;
+      this.immed = code;
+    }
+
+    this.immed &= 0xFFFFFFFF;
+  }
+
+  // rd holds fd, rs fs and rt ft, compares on another condition code than 0 are unknown
+  void _decodeCop1(int ip, int instr) {
+    int fmt = this.rs;
+    int func = instr & 0x3F;
+    int fd = (instr >> 6) & 0x1F;
+    this.rs = this.rd;
+    this.rd = fd;
+    this.op = DecodedOp.DOP_UNKNOWN;
+
+    if (fmt == 0x00 || fmt == 0x04) {
+      this.op = fmt == 0x00 ? DecodedOp.DOP_MFC1 : DecodedOp.DOP_MTC1;
+    } else if (fmt == 0x08) {
+      if (this.rt <= 1) this.op = this.rt == 1 ? DecodedOp.DOP_BC1T : DecodedOp.DOP_BC1F;
+      this.immed = ip + _branchOffset(instr & 0xFFFF);
+    } else if ((fmt == 0x10 || fmt == 0x11) && func <= 0x07) {
+      this.op = DecodedOp.values[(fmt == 0x10 ? DecodedOp.DOP_ADD_S : DecodedOp.DOP_ADD_D).index + func];
+    } else if ((fmt == 0x10 || fmt == 0x11) && (func == 0x32 || func == 0x3C || func == 0x3E)) {
+      int base = (fmt == 0x10 ? DecodedOp.DOP_C_EQ_S : DecodedOp.DOP_C_EQ_D).index;
+      if (fd == 0) this.op = DecodedOp.values[base + (func == 0x32 ? 0 : (func == 0x3C ? 1 : 2))];
+    } else {
+      this.op = _conversions[(fmt << 8) | func] ?? DecodedOp.DOP_UNKNOWN;
+    }
+  }
+
+  // Doubles live in even/odd register pairs, the VM rejects records naming an odd one
+  bool _pairedRegisters() {
+    switch (this.op) {
+      case DecodedOp.DOP_ADD_D:
+      case DecodedOp.DOP_SUB_D:
+      case DecodedOp.DOP_MUL_D:
+      case DecodedOp.DOP_DIV_D:
+      case DecodedOp.DOP_SQRT_D:
+      case DecodedOp.DOP_ABS_D:
+      case DecodedOp.DOP_MOV_D:
+      case DecodedOp.DOP_NEG_D:
+      case DecodedOp.DOP_C_EQ_D:
+      case DecodedOp.DOP_C_LT_D:
+      case DecodedOp.DOP_C_LE_D:
+        return (this.rd | this.rs | this.rt) & 0x01 == 0;
+      case DecodedOp.DOP_CVT_D_S:
+      case DecodedOp.DOP_CVT_D_W:
+        return this.rd & 0x01 == 0;
+      case DecodedOp.DOP_CVT_S_D:
+      case DecodedOp.DOP_CVT_W_D:
+      case DecodedOp.DOP_TRUNC_W_D:
+        return this.rs & 0x01 == 0;
+      case DecodedOp.DOP_LDC1:
+      case DecodedOp.DOP_SDC1:
+        return this.rt & 0x01 == 0;
+      default:
+        return true;
+    }
+  }
+
+  // Byte, half and word lanes only. rd holds wd, rs ws and rt wt, ld, st and fill keep their
+  // general-purpose register in rs and copies theirs in rd.
+  void _decodeMsa(int instr) {
+    int minor = instr & 0x3F;
+    this.rs = this.rd;
+    this.rd = (instr >> 6) & 0x1F;
+    this.op = DecodedOp.DOP_UNKNOWN;
+
+    if (minor == 0x02) {
+      int df = (instr >> 24) & 0x03;
+      if (df == 3) return;
+      this.op = DecodedOp.values[DecodedOp.DOP_SHF_B.index + df];
+      this.immed = (instr >> 16) & 0xFF;
+    } else if (minor == 0x0E || minor == 0x0F || minor == 0x15) {
+      int operation = (instr >> 23) & 0x07;
+      int df = (instr >> 21) & 0x03;
+      if (df == 3) return;
+
+      if (minor == 0x0E && operation <= 5) {
+        this.op = DecodedOp.values[DecodedOp.DOP_ADDV_B.index + operation * 3 + df];
+      } else if (minor == 0x0F && operation == 0) {
+        this.op = DecodedOp.values[DecodedOp.DOP_CEQ_B.index + df];
+      } else if (minor == 0x0F && (operation == 2 || operation == 3)) {
+        this.op = DecodedOp.values[DecodedOp.DOP_CLT_S_B.index + (operation - 2) * 3 + df];
+      } else if (minor == 0x15 && (operation == 4 || operation == 5) && df != 0) {
+        this.op = DecodedOp.values[DecodedOp.DOP_HADD_S_H.index + (operation - 4) * 2 + df - 1];
+      }
+    } else if (minor == 0x19) {
+      int operation = (instr >> 22) & 0x0F;
+      int field = (instr >> 16) & 0x3F;
+      int df = (field & 0x30) == 0x00 ? 0 : ((field & 0x38) == 0x20 ? 1 : ((field & 0x3C) == 0x30 ? 2 : 3));
+      if (df == 3) return;
+
+      if (operation == 2) this.op = DecodedOp.values[DecodedOp.DOP_COPY_S_B.index + df];
+      if (operation == 3 && df != 2) this.op = DecodedOp.values[DecodedOp.DOP_COPY_U_B.index + df];
+      this.immed = field & (0x0F >> df);
+    } else if (minor == 0x1E) {
+      int df = (instr >> 16) & 0x03;
+      if (((instr >> 18) & 0xFF) == 0xC0 && df != 3) this.op = DecodedOp.values[DecodedOp.DOP_FILL_B.index + df];
+    } else if ((minor & 0x3C) == 0x20 || (minor & 0x3C) == 0x24) {
+      // Offsets count lanes, they are kept scaled to bytes
+      int df = minor & 0x03;
+      if (df == 3) return;
+
+      int offset = (instr >> 16) & 0x3FF;
+      this.op = DecodedOp.values[((minor & 0x3C) == 0x20 ? DecodedOp.DOP_LD_B : DecodedOp.DOP_ST_B).index + df];
+      this.immed = (offset >= 0x200 ? offset - 0x400 : offset) << df;
+    }
+  }
+
+  // Fields running past bit 31 are reserved encodings, they decode as unknown instructions
+  void _decodeSpecial3(int instr) {
+    int lsb = (instr >> 6) & 0x1F;
+    int msb = this.rd;
+    this.op = DecodedOp.DOP_UNKNOWN;
+
+    if ((instr & 0x3F) == 0x00 && lsb + msb <= 31) {
+      this.op = DecodedOp.DOP_EXT;
+      this.rd = lsb;
+      this.immed = 0xFFFFFFFF >> (31 - msb);
+    } else if ((instr & 0x3F) == 0x04 && msb >= lsb) {
+      this.op = DecodedOp.DOP_INS;
+      this.rd = lsb;
+      this.immed = (0xFFFFFFFF >> (31 - msb + lsb)) << lsb;
+    } else if ((instr & 0x3F) == 0x20 && lsb == 0x10) {
+      this.op = DecodedOp.DOP_SEB;
+    } else if ((instr & 0x3F) == 0x20 && lsb == 0x18) {
+      this.op = DecodedOp.DOP_SEH;
+    }
+  }
+
+  // The VM shifts the offset in 16 bits and sign extends it from bit 13, kept here bit for bit
+  static int _branchOffset(int immediate) {
+    int value = (immediate << 2) & 0xFFFF;
+    if ((value >> 13) & 1 == 1) value |= 0xC000;
+
+    return value >= 0x8000 ? value - 0x10000 : value;
+  }
+}
@@ -0,0 +1,275 @@
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'assembly.dart';
+import 'decoded.dart';
+
+class SectionHeader {
+  String name;
+  int type;
+  int offset;
+  int size;
+
+  SectionHeader(this.name, this.type, this.offset);
+}
+
+class SegmentHeader {
+  int flags;
+  int offset;
+  int address;
+  int fileSize = 0;
+  int memSize = 0;
+
+  SegmentHeader(this.flags, this.offset, this.address);
+}
+
+// Writes a LEF v2 image, the text being laid out from PAGE_SIZE before the segments are described
+abstract class ImageWriter {
+  Uint8List buffer;
+  int offset = 0;
+  List<SectionHeader> headers = [];
+  List<SegmentHeader> segments = [];
+  int entry = 0;
+  // Adds the pre-decoded text section, loading skips decoding when it is there
+  bool predecode = false;
+  // Byte order of the halves and words in the segments, header fields and tables stay big-endian
+  bool littleEndian = false;
+  int sha = 0;
+  int pha = 0;
+  // CPU dependant
+  final int TEXT_TOP = 0x002000;
+  final int DATA_TOP = 0x080000;
+  final int PAGE_SIZE = 0x1000;
+  // Segment permissions
+  final int PF_X = 0x01;
+  final int PF_W = 0x02;
+  final int PF_R = 0x04;
+  // File header flags
+  final int LEF_LITTLE_ENDIAN = 0x0001;
+
+  void emitTextSegment() {
+    SegmentHeader text = new SegmentHeader(PF_R | PF_X, PAGE_SIZE, TEXT_TOP);
+    text.fileSize = this.offset - PAGE_SIZE;
+    text.memSize = text.fileSize;
+
+    segments.add(text);
+  }
+
+  // Lays the data emitted from start out as load segments. Zero runs of a page or more, and
+  // trailing zeros, are not stored: they only extend the memory size of the segment before them.
+  void emitDataSegments(int start) {
+    Uint8List data = this.buffer.sublist(start, this.offset);
+    this.offset = start;
+
+    SegmentHeader segment;
+    int i = 0;
+    while (i < data.length) {
+      int zeros = this._zeroRun(data, i);
+      if (zeros >= PAGE_SIZE || i + zeros == data.length) {
+        if (segment != null) segment.memSize += zeros;
+        segment = null;
+        i += zeros;
+        continue;
+      }
+
+      if (segment == null) {
+        // The file offset has to agree with the load address modulo the page size
+        while (this.offset % PAGE_SIZE != (DATA_TOP + i) % PAGE_SIZE) {
+          this.emitByte(0);
+        }
+        segment = new SegmentHeader(PF_R | PF_W, this.offset, DATA_TOP + i);
+        segments.add(segment);
+      }
+
+      // Short zero runs are stored along with the bytes that follow them
+      int end = i + zeros + 1;
+      while (end < data.length && data[end] != 0) {
+        end++;
+      }
+
+      this.emitBytes(data.sublist(i, end));
+      segment.fileSize += end - i;
+      segment.memSize += end - i;
+      i = end;
+    }
+  }
+
+  int _zeroRun(Uint8List data, int start) {
+    int end = start;
+    while (end < data.length && data[end] == 0) {
+      end++;
+    }
+
+    return end - start;
+  }
+
+  void emitSegmentHeaders() {
+    while (this.offset % 4 != 0) {
+      this.emitByte(0);
+    }
+
+    this.pha = this.offset;
+    for(SegmentHeader segment in this.segments) {
+      this.emitWord(0x01); // Loadable segment
+      this.emitWord(segment.flags);
+      this.emitWord(segment.offset);
+      this.emitWord(segment.address);
+      this.emitWord(segment.fileSize);
+      this.emitWord(segment.memSize);
+    }
+  }
+
+  void emitSectionHeaders() {
+    this.sha = this.offset;
+    for(SectionHeader header in this.headers) {
+      this.emitHalf(0);
+      this.emitHalf(header.type);
+      this.emitWord(header.offset);
+      this.emitWord(header.size);
+    }
+  }
+
+  void emitFileHeader() {
+    int length = this.offset;
+
+    this.offset = 0;
+    this.emitByte(0x10);
+    this.emitBytes("LEF".codeUnits);
+    this.emitBytes([0x02, 0x00]); // Writes major and minor version;
+    this.emitHalf(this.littleEndian ? LEF_LITTLE_ENDIAN : 0); // Flags
+    this.emitWord(this.entry);
+    this.emitWord(this.pha);
+    this.emitHalf(segments.length);
+    this.emitHalf(headers.length);
+    this.emitWord(this.sha);
+    this.emitWord(0); // Checksum, written once the whole file is
+    this.emitWord(0);
+
+    this.offset = length;
+  }
+
+  // FNV-1a of the whole file, taken while the checksum field is still zero
+  void emitChecksum() {
+    int hash = 0x811C9DC5;
+    for (int i = 0; i < this.offset; i++) {
+      hash = ((hash ^ this.buffer[i]) * 0x01000193) & 0xFFFFFFFF;
+    }
+
+    int length = this.offset;
+    this.offset = 24;
+    this.emitWord(hash);
+    this.offset = length;
+  }
+
+  // Label names with their text or data offset, for profilers and trap reports
+  void emitSymbolTable(Iterable<Label> labels) {
+    SectionHeader symbols = new SectionHeader(".symtab", 0x08, this.offset);
+
+    for (Label label in labels) {
+      List<int> name = label.name.codeUnits;
+      if (name.length > 0xFF) name = name.sublist(0, 0xFF);
+
+      this.emitWord(label.address);
+      this.emitByte(label.segment == Segment.SGT_TEXT ? 0x00 : 0x01);
+      this.emitByte(name.length);
+      this.emitBytes(name);
+    }
+
+    symbols.size = this.offset - symbols.offset;
+    headers.add(symbols);
+  }
+
+  // Text offset of the first word of each source line, given as offset and line pairs
+  void emitLineTable(List<int> pairs) {
+    SectionHeader lines = new SectionHeader(".lines", 0x10, this.offset);
+
+    for (int value in pairs) {
+      this.emitWord(value);
+    }
+
+    lines.size = this.offset - lines.offset;
+    headers.add(lines);
+  }
+
+  // Decoded record of every text word, preceded by the text size and its FNV-1a the VM checks it against
+  void emitDecodedSection() {
+    SegmentHeader text = this.segments.firstWhere((segment) => segment.address == TEXT_TOP);
+    SectionHeader decoded = new SectionHeader(".decoded", 0x40, this.offset);
+
+    int hash = 0x811C9DC5;
+    for (int i = 0; i < text.fileSize; i++) {
+      hash = ((hash ^ this.buffer[text.offset + i]) * 0x01000193) & 0xFFFFFFFF;
+    }
+    this.emitWord(text.fileSize);
+    this.emitWord(hash);
+
+    for (int ip = 0; ip + 4 <= text.fileSize; ip += 4) {
+      DecodedInstr instr = new DecodedInstr(ip, this.readGuestWord(text.offset + ip));
+      this.emitBytes([instr.op.index, instr.rd, instr.rs, instr.rt]);
+      this.emitWord(instr.immed);
+    }
+
+    decoded.size = this.offset - decoded.offset;
+    headers.add(decoded);
+  }
+
+  // Grows the buffer geometrically so writing an image stays linear in its size
+  void reserve(int size) {
+    if (this.offset + size <= this.buffer.length) return;
+
+    Uint8List grown = new Uint8List(max(this.buffer.length * 2, this.offset + size));
+    grown.setAll(0, this.buffer);
+    this.buffer = grown;
+  }
+
+  void emitByte(int byte) {
+    if (offset >= this.buffer.length) this.reserve(1);
+    this.buffer[offset++] = byte;
+  }
+
+  void emitBytes(List<int> bytes) {
+    this.reserve(bytes.length);
+    this.buffer.setAll(offset, bytes);
+    offset += bytes.length;
+  }
+
+  void emitHalf(int half) {
+    emitByte(half >> 0x08);
+    emitByte(half);
+  }
+
+  void emitWord(int word) {
+    emitByte(word >> 0x18);
+    emitByte(word >> 0x10);
+    emitByte(word >> 0x08);
+    emitByte(word);
+  }
+
+  // Instructions and data directives, in the byte order of the guest
+  void emitGuestHalf(int half) {
+    if (this.littleEndian) {
+      emitByte(half);
+      emitByte(half >> 0x08);
+    } else {
+      emitHalf(half);
+    }
+  }
+
+  void emitGuestWord(int word) {
+    if (this.littleEndian) {
+      emitByte(word);
+      emitByte(word >> 0x08);
+      emitByte(word >> 0x10);
+      emitByte(word >> 0x18);
+    } else {
+      emitWord(word);
+    }
+  }
+
+  int readGuestWord(int position) {
+    List<int> bytes = this.buffer.sublist(position, position + 4);
+    if (this.littleEndian) bytes = bytes.reversed.toList();
+
+    return (bytes[0] << 0x18) | (bytes[1] << 0x10) | (bytes[2] << 0x08) | bytes[3];
+  }
+}
@@ -17,6 +17,8 @@ class Instruction {
   Token immed;
   List<Token> operands;
   InstructionType type;
+  bool removed = false; // Dropped by the peephole pass, occupies no space in the output
+  int line = 0; // Source line, written to the line table
 
   Instruction(this.name, this.opCount, this.type);
 }
@@ -47,6 +49,13 @@ const Map<String, int> OpCodes = {
   "sb": 0x28,
   "sh": 0x29,
   "sw": 0x2A,
+  "cop1": 0x11,
+  "lwc1": 0x31,
+  "ldc1": 0x35,
+  "swc1": 0x39,
+  "sdc1": 0x3D,
+  "special2": 0x1C,
+  "special3": 0x1F,
 
   // ALU functions
   "sll": 0x00,
@@ -57,6 +66,8 @@ const Map<String, int> OpCodes = {
   "srav": 0x07,
   "jr": 0x08,
   "jarl": 0x09,
+  "movz": 0x0A,
+  "movn": 0x0B,
   "syscall": 0x0C,
   "mfhi": 0x10,
   "mthi": 0x11,
@@ -75,5 +86,74 @@ const Map<String, int> OpCodes = {
   "xor": 0x26,
   "nor": 0x27,
   "slt": 0x2A,
-  "sltu": 0x2B
-};
\ No newline at end of file
+  "sltu": 0x2B,
+
+  // SPECIAL2 and SPECIAL3 functions, seb and seh being told apart by the shift amount field of bshfl
+  "mul": 0x02,
+  "clz": 0x20,
+  "clo": 0x21,
+  "ext": 0x00,
+  "ins": 0x04,
+  "bshfl": 0x20,
+  "seb": 0x10,
+  "seh": 0x18,
+
+  "msa": 0x1E
+};
+
+// CP1 format field, in the rs position
+const Map<String, int> FpuFormats = {
+  "mf": 0x00,
+  "mt": 0x04,
+  "bc": 0x08,
+  "s": 0x10,
+  "d": 0x11,
+  "w": 0x14
+};
+
+// CP1 functions by the name of the instruction without its source format
+const Map<String, int> FpuCodes = {
+  "add": 0x00,
+  "sub": 0x01,
+  "mul": 0x02,
+  "div": 0x03,
+  "sqrt": 0x04,
+  "abs": 0x05,
+  "mov": 0x06,
+  "neg": 0x07,
+  "trunc.w": 0x0D,
+  "cvt.s": 0x20,
+  "cvt.d": 0x21,
+  "cvt.w": 0x24,
+  "c.eq": 0x32,
+  "c.lt": 0x3C,
+  "c.le": 0x3E
+};
+
+// MSA lane sizes, the suffix of the instruction names
+const Map<String, int> VectorFormats = {
+  "b": 0x00,
+  "h": 0x01,
+  "w": 0x02
+};
+
+// MSA minor opcode and operation field by the name of the instruction without its lane size
+const Map<String, List<int>> VectorCodes = {
+  "addv": [0x0E, 0x00],
+  "subv": [0x0E, 0x01],
+  "max_s": [0x0E, 0x02],
+  "max_u": [0x0E, 0x03],
+  "min_s": [0x0E, 0x04],
+  "min_u": [0x0E, 0x05],
+  "ceq": [0x0F, 0x00],
+  "clt_s": [0x0F, 0x02],
+  "clt_u": [0x0F, 0x03],
+  "hadd_s": [0x15, 0x04],
+  "hadd_u": [0x15, 0x05],
+  "shf": [0x02, 0x00],
+  "copy_s": [0x19, 0x02],
+  "copy_u": [0x19, 0x03],
+  "fill": [0x1E, 0xC0],
+  "ld": [0x20, 0x00],
+  "st": [0x24, 0x00]
+};
@@ -0,0 +1,250 @@
+import 'assembly.dart';
+import 'instruction.dart';
+import 'token.dart';
+
+// Counts written by the VM with --profile-out, keyed by the text offset of each executed word
+class BlockProfile {
+  Map<int, int> executions = {};
+  Map<int, int> taken = {}; // Executions that did not fall through to the next word
+
+  // One "offset executions taken" line per word, '#' starts a comment
+  static BlockProfile parse(String text) {
+    BlockProfile profile = new BlockProfile();
+    for (String line in text.split("\n")) {
+      line = line.trim();
+      if (line.isEmpty || line.startsWith("#")) continue;
+
+      List<String> fields = line.split(new RegExp(r"\s+"));
+      if (fields.length != 3) throw new FormatException("Invalid profile line '$line'");
+
+      int offset = int.parse(fields[0]);
+      if (offset < 0 || offset % 4 != 0) throw new FormatException("Invalid profile offset '${fields[0]}'");
+      profile.executions[offset] = int.parse(fields[1]);
+      profile.taken[offset] = int.parse(fields[2]);
+    }
+
+    return profile;
+  }
+
+  int executionsAt(int offset) => this.executions[offset] ?? 0;
+  int takenAt(int offset) => this.taken[offset] ?? 0;
+}
+
+const Map<String, String> _inverted = {
+  "beq": "bne",
+  "bne": "beq",
+  "beqz": "bnez",
+  "bnez": "beqz",
+  "blez": "bgtz",
+  "bgtz": "blez",
+  "bltz": "bgez",
+  "bgez": "bltz",
+  "blt": "bge",
+  "bge": "blt",
+  "bgt": "ble",
+  "ble": "bgt",
+  "bc1t": "bc1f",
+  "bc1f": "bc1t",
+};
+
+class _Block {
+  int index;
+  int start; // First and one past the last instruction
+  int end;
+  int count = 0; // Times the block was entered
+  int takenWeight = 0;
+  int fallWeight = 0;
+  _Block target; // Block a label branch or jump ends in, if any
+
+  _Block(this.index, this.start, this.end);
+}
+
+// Reorders basic blocks along their most executed edges, after the peephole pass and before
+// relocations are computed. Hot chains come first from the hottest block down, so the common path
+// of every function is contiguous and cold code sinks to the end of the text. Conditional branches
+// whose taken side is placed next are inverted and broken fall-throughs get an explicit jump.
+class CodeLayout {
+  Assembly assembly;
+  BlockProfile profile;
+  List<int> offsets; // Text offset of every instruction in the profiled program
+  List<int> sizes;
+  List<_Block> blocks = [];
+  Map<int, _Block> _blockAt = {};
+  Map<int, String> _labelAt = {}; // A label name for every block that has one
+  Set<String> synthetic = new Set<String>(); // Labels added for new jumps, left out of the symbol table
+
+  CodeLayout(this.assembly, this.profile, this.offsets, this.sizes);
+
+  void run() {
+    if (this.assembly.instructions.isEmpty) return;
+
+    this._findBlocks();
+    this._weighBlocks();
+    this._rebuild(this._order());
+  }
+
+  static bool isConditional(Instruction instr) => _inverted.containsKey(instr.name);
+
+  static bool isJump(Instruction instr) => instr.name == "j" || instr.name == "b";
+
+  // Every text label and every instruction after a branch, jump or jr starts a block.
+  // jal and jalr return to the next instruction and stay inside their block.
+  void _findBlocks() {
+    List<Instruction> instructions = this.assembly.instructions;
+    Set<int> leaders = new Set<int>()..add(0);
+    for (Label label in this.assembly.labels.values) {
+      if (label.segment != Segment.SGT_TEXT) continue;
+      leaders.add(label.address);
+      this._labelAt[label.address] = label.name;
+    }
+
+    for (var i = 0; i < instructions.length; ++i) {
+      Instruction instr = instructions[i];
+      if ((isJump(instr) || instr.name == "jal") && instr.immed.type != TokenType.T_IDENTIFIER) {
+        throw new FormatException("Jump to a constant address on line ${instr.line} prevents code layout");
+      }
+      if (isConditional(instr) || isJump(instr) || instr.name == "jr") leaders.add(i + 1);
+    }
+
+    int start = 0;
+    for (var i = 1; i <= instructions.length; ++i) {
+      if (i < instructions.length && !leaders.contains(i)) continue;
+
+      _Block block = new _Block(this.blocks.length, start, i);
+      this.blocks.add(block);
+      this._blockAt[start] = block;
+      start = i;
+    }
+  }
+
+  void _weighBlocks() {
+    for (_Block block in this.blocks) {
+      Instruction last = this.assembly.instructions[block.end - 1];
+      block.count = this.profile.executionsAt(this.offsets[block.start]);
+
+      // Branch expansions end with the branch word itself
+      int word = this.offsets[block.end - 1] + this.sizes[block.end - 1] - 4;
+      if (isConditional(last) || isJump(last)) {
+        Label label = this.assembly.labels[last.immed.value];
+        if (label != null && label.segment == Segment.SGT_TEXT) block.target = this._blockAt[label.address];
+      }
+
+      if (isConditional(last)) {
+        block.takenWeight = this.profile.takenAt(word);
+        block.fallWeight = this.profile.executionsAt(word) - block.takenWeight;
+      } else if (isJump(last)) {
+        block.takenWeight = this.profile.executionsAt(word);
+      } else if (last.name != "jr") {
+        block.fallWeight = this.profile.executionsAt(this.offsets[block.end - 1]);
+      }
+    }
+  }
+
+  bool _fallsThrough(_Block block) {
+    String name = this.assembly.instructions[block.end - 1].name;
+    return name != "jr" && name != "j" && name != "b";
+  }
+
+  _Block _next(_Block block) {
+    return block.index + 1 < this.blocks.length ? this.blocks[block.index + 1] : null;
+  }
+
+  List<_Block> _order() {
+    List<_Block> order = [];
+    Set<_Block> placed = new Set<_Block>();
+
+    // Running off the end of the text has no block to jump to, such a block stays last
+    _Block pinned = this._fallsThrough(this.blocks.last) ? this.blocks.last : null;
+    if (pinned != null) placed.add(pinned);
+
+    List<_Block> seeds = new List<_Block>.from(this.blocks.where((block) => block.count > 0));
+    seeds.sort((a, b) => a.count != b.count ? b.count.compareTo(a.count) : a.index.compareTo(b.index));
+
+    Label entry = this.assembly.labels[this.assembly.entryPoint];
+    if (entry != null && this._blockAt.containsKey(entry.address)) seeds.insert(0, this._blockAt[entry.address]);
+
+    for (_Block seed in seeds) {
+      _Block block = seed;
+      while (block != null && !placed.contains(block)) {
+        order.add(block);
+        placed.add(block);
+
+        _Block fall = this._fallsThrough(block) ? this._next(block) : null;
+        _Block taken = block.target;
+        bool preferTaken = taken != null && !placed.contains(taken) && block.takenWeight > 0 &&
+            (fall == null || placed.contains(fall) || block.takenWeight > block.fallWeight);
+
+        if (preferTaken) {
+          block = taken;
+        } else if (fall != null && block.fallWeight > 0) {
+          block = fall;
+        } else {
+          block = null;
+        }
+      }
+    }
+
+    // Code that never ran keeps its source order
+    for (_Block block in this.blocks) {
+      if (!placed.contains(block)) order.add(block);
+    }
+    if (pinned != null) order.add(pinned);
+
+    return order;
+  }
+
+  void _rebuild(List<_Block> order) {
+    List<Instruction> instructions = this.assembly.instructions;
+    List<Instruction> output = [];
+    Map<_Block, int> starts = {};
+    Map<_Block, String> names = {};
+
+    for (var p = 0; p < order.length; ++p) {
+      _Block block = order[p];
+      _Block next = p + 1 < order.length ? order[p + 1] : null;
+      _Block fall = this._fallsThrough(block) ? this._next(block) : null;
+      Instruction last = instructions[block.end - 1];
+
+      starts[block] = output.length;
+      output.addAll(instructions.sublist(block.start, block.end - 1));
+
+      if (isJump(last) && block.target != null && block.target == next) {
+        // The jump now lands on the next instruction
+      } else if (isConditional(last) && fall != null && fall != next && block.target == next) {
+        last.name = _inverted[last.name];
+        last.immed = new Token(TokenType.T_IDENTIFIER, last.immed.line, this._labelOf(fall, names));
+        output.add(last);
+      } else {
+        output.add(last);
+        if (fall != null && fall != next) {
+          Instruction jump = new Instruction("j", 1, InstructionType.J_TYPE);
+          jump.immed = new Token(TokenType.T_IDENTIFIER, last.line, this._labelOf(fall, names));
+          jump.line = last.line;
+          output.add(jump);
+        }
+      }
+    }
+
+    int end = output.length;
+    for (Label label in this.assembly.labels.values) {
+      if (label.segment != Segment.SGT_TEXT) continue;
+      label.address = label.address < instructions.length ? starts[this._blockAt[label.address]] : end;
+    }
+    for (_Block block in names.keys) {
+      this.assembly.labels[names[block]] = new Label(names[block], Segment.SGT_TEXT, starts[block]);
+    }
+
+    this.assembly.instructions = output;
+  }
+
+  // Name of a label at the start of a block, blocks following a branch may not have any
+  String _labelOf(_Block block, Map<_Block, String> names) {
+    if (this._labelAt.containsKey(block.start)) return this._labelAt[block.start];
+
+    return names.putIfAbsent(block, () {
+      String name = "__layout_${block.start}";
+      this.synthetic.add(name);
+      return name;
+    });
+  }
+}
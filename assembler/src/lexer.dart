@@ -45,8 +45,14 @@ List<String> instructions = [
   "addiu",
   "and",
   "andi",
+  "clo",
+  "clz",
   "div",
   "divu",
+  "ext",
+  "ins",
+  "movn",
+  "movz",
   "mul",
   "mult",
   "multu",
@@ -58,6 +64,8 @@ List<String> instructions = [
   "ori",
   "rem",
   "remu",
+  "seb",
+  "seh",
   "sll",
   "sllv",
   "sra",
@@ -114,6 +122,92 @@ List<String> instructions = [
   "mthi",
   "mtlo",
   "syscall",
+  "add.s",
+  "add.d",
+  "sub.s",
+  "sub.d",
+  "mul.s",
+  "mul.d",
+  "div.s",
+  "div.d",
+  "sqrt.s",
+  "sqrt.d",
+  "abs.s",
+  "abs.d",
+  "mov.s",
+  "mov.d",
+  "neg.s",
+  "neg.d",
+  "c.eq.s",
+  "c.eq.d",
+  "c.lt.s",
+  "c.lt.d",
+  "c.le.s",
+  "c.le.d",
+  "cvt.s.d",
+  "cvt.s.w",
+  "cvt.d.s",
+  "cvt.d.w",
+  "cvt.w.s",
+  "cvt.w.d",
+  "trunc.w.s",
+  "trunc.w.d",
+  "mfc1",
+  "mtc1",
+  "lwc1",
+  "swc1",
+  "ldc1",
+  "sdc1",
+  "bc1t",
+  "bc1f",
+  "addv.b",
+  "addv.h",
+  "addv.w",
+  "subv.b",
+  "subv.h",
+  "subv.w",
+  "max_s.b",
+  "max_s.h",
+  "max_s.w",
+  "max_u.b",
+  "max_u.h",
+  "max_u.w",
+  "min_s.b",
+  "min_s.h",
+  "min_s.w",
+  "min_u.b",
+  "min_u.h",
+  "min_u.w",
+  "ceq.b",
+  "ceq.h",
+  "ceq.w",
+  "clt_s.b",
+  "clt_s.h",
+  "clt_s.w",
+  "clt_u.b",
+  "clt_u.h",
+  "clt_u.w",
+  "hadd_s.h",
+  "hadd_s.w",
+  "hadd_u.h",
+  "hadd_u.w",
+  "shf.b",
+  "shf.h",
+  "shf.w",
+  "ld.b",
+  "ld.h",
+  "ld.w",
+  "st.b",
+  "st.h",
+  "st.w",
+  "fill.b",
+  "fill.h",
+  "fill.w",
+  "copy_s.b",
+  "copy_s.h",
+  "copy_s.w",
+  "copy_u.b",
+  "copy_u.h",
 ];
 
 List<String> directives = [
@@ -125,190 +219,261 @@ List<String> directives = [
   ".byte",
   ".half",
   ".word",
-  ".entry"
+  ".float",
+  ".double",
+  ".entry",
+  ".globl"
 ];
 
+// Hashed views of the tables above, a source line costs a few lookups in them
+final Map<String, int> registerNumbers =
+    new Map<String, int>.fromIterables(registers, new List<int>.generate(registers.length, (i) => i));
+final Set<String> instructionNames = instructions.toSet();
+final Set<String> directiveNames = directives.toSet();
+
+const int _NEWLINE = 0x0A;
+const int _QUOTE = 0x22;
+const int _BACKSLASH = 0x5C;
+const int _UNDERSCORE = 0x5F;
+const int _COLON = 0x3A;
+const int _DOT = 0x2E;
+
+// Scans the program one token at a time, the parser pulls tokens as it needs them
 class Lexer {
   String program;
   int start = 0;
   int position = 0;
   int line = 1;
   List<Token> tokens = [];
-  List<String> _escapers = ['n', 't', 'b', 'r', '\\', '"'];
   bool hadError = false;
 
   Lexer(this.program);
 
+  // Scans the whole program at once, for callers that want every token
   List<Token> tokenize() {
+    Token token;
+    do {
+      token = nextToken();
+      tokens.add(token);
+    } while (token.type != TokenType.T_EOF);
+
+    return tokens;
+  }
+
+  Token nextToken() {
     while (!this.isAtEnd()) {
-      getNextToken();
+      Token token = getNextToken();
+      if (token != null) return token;
     }
 
-    tokens.add(new Token(TokenType.T_EOF, line, null));
-    return tokens;
+    return new Token(TokenType.T_EOF, line, null);
   }
 
   bool isAtEnd() {
     return position >= program.length;
   }
 
-  void getNextToken() {
+  // Next token starting at the current position, null for blanks, comments and errors
+  Token getNextToken() {
     this.start = this.position;
-    String char = advance();
+    int char = advance();
 
     if (isAlpha(char)) return getIdentifier();
     if (isDigit(char)) return getScalar(char);
 
     switch (char) {
-      case "(":
-        return addToken(TokenType.T_LPAREN, char);
-      case ")":
-        return addToken(TokenType.T_RPAREN, char);
-      case ",":
-        return addToken(TokenType.T_COMMA, char);
-      case ".":
+      case 0x28: // (
+        return makeToken(TokenType.T_LPAREN, "(");
+      case 0x29: // )
+        return makeToken(TokenType.T_RPAREN, ")");
+      case 0x2C: // ,
+        return makeToken(TokenType.T_COMMA, ",");
+      case 0x5B: // [
+        return makeToken(TokenType.T_LBRACKET, "[");
+      case 0x5D: // ]
+        return makeToken(TokenType.T_RBRACKET, "]");
+      case 0x2E: // .
         return getDirective();
-      case "\$":
+      case 0x24: // $
         return getRegister();
-      case "\"":
+      case _QUOTE:
         return getString();
-      case "-":
+      case 0x2D: // -
+        if (!isDigit(peek())) break;
         return getScalar(advance(), true);
-      case "#":
+      case 0x23: // #
         {
-          while (peek() != "\n" && !isAtEnd()) advance();
-          break;
+          while (peek() != _NEWLINE && !isAtEnd()) advance();
+          return null;
         }
-      case "\n":
+      case _NEWLINE:
         line++;
-        return;
-      case " ":
-      case "\t":
-      case "\b":
-      case "\r":
-        break;
-      default:
-        reportError("Invalid token");
-        break;
+        return null;
+      case 0x20: // Space
+      case 0x09: // \t
+      case 0x08: // \b
+      case 0x0D: // \r
+        return null;
     }
+
+    reportError("Invalid token");
+    return null;
   }
 
-  void addToken(TokenType type, Object value) {
+  Token makeToken(TokenType type, Object value) {
     Token token = new Token(type, line, value);
     token.lexeme = this.program.substring(this.start, this.position);
-    tokens.add(token);
+    return token;
   }
 
-  void getDirective() {
+  Token getDirective() {
     while (isAlphaNum(peek())) {
       advance();
     }
 
     String directive = this.program.substring(this.start, this.position);
-    if (!directives.contains(directive)) {
+    if (!directiveNames.contains(directive)) {
       reportError("Invalid directive $directive.");
-      return;
+      return null;
     }
 
-    addToken(TokenType.T_DIRECTIVE, directive);
+    return makeToken(TokenType.T_DIRECTIVE, directive);
   }
 
-  void getRegister() {
+  Token getRegister() {
     while (isAlphaNum(peek())) {
       advance();
     }
 
     String register = this.program.substring(this.start, this.position);
+    int number = registerNumbers[register];
+    if (number == null && register.length > 2 && (register.startsWith("\$f") || register.startsWith("\$w"))) {
+      int index = int.tryParse(register.substring(2), radix: 10);
+      TokenType type = register[1] == "f" ? TokenType.T_FREGISTER : TokenType.T_VREGISTER;
+      if (index != null && index < 32 && "${register.substring(0, 2)}$index" == register) return makeToken(type, index);
+    }
 
-    if (!registers.contains(register)) {
+    if (number == null) {
       reportError("Invalid register name : '$register'.");
-      return;
+      return null;
     }
 
-    addToken(TokenType.T_REGISTER, registers.indexOf(register));
+    return makeToken(TokenType.T_REGISTER, number);
   }
 
-  void getString() {
+  Token getString() {
     StringBuffer string = new StringBuffer();
-    while (peek() != '\n' && peek() != '"' && !isAtEnd()) {
-      if (peek() == '\\' && _escapers.contains(peekNext())) {
-        advance();
-        String char;
-        switch (advance()) {
-          case 'n':
-            char = '\n';
-            break;
-          case 't':
-            char = '\t';
+    while (peek() != _NEWLINE && peek() != _QUOTE && !isAtEnd()) {
+      if (peek() == _BACKSLASH) {
+        int escaped;
+        switch (peekNext()) {
+          case 0x6E: // n
+            escaped = _NEWLINE;
             break;
-          case 'b':
-            char = '\b';
+          case 0x74: // t
+            escaped = 0x09;
             break;
-          case 'r':
-            char = '\r';
+          case 0x62: // b
+            escaped = 0x08;
             break;
-          case '\\':
-            char = '\\';
+          case 0x72: // r
+            escaped = 0x0D;
             break;
-          case '"':
-            char = '"';
+          case _BACKSLASH:
+          case _QUOTE:
+            escaped = peekNext();
             break;
         }
-        string.write(char);
-      } else {
-        string.write(advance());
+
+        if (escaped != null) {
+          advance();
+          advance();
+          string.writeCharCode(escaped);
+          continue;
+        }
       }
+
+      string.writeCharCode(advance());
     }
 
-    if (isAtEnd() || peek() == '\n') {
+    if (isAtEnd() || peek() == _NEWLINE) {
       reportError('Unterminated string.');
-      return;
+      return null;
     }
     // Consume '"'
     advance();
 
-    addToken(TokenType.T_STRING, string.toString());
+    return makeToken(TokenType.T_STRING, string.toString());
   }
 
-  void getIdentifier() {
-    while (isAlphaNum(peek())) {
+  // Dots may join words, as in the CP1 and MSA instruction names
+  Token getIdentifier() {
+    while (isAlphaNum(peek()) || (peek() == _DOT && isAlpha(peekNext()))) {
       advance();
     }
 
     TokenType type = TokenType.T_IDENTIFIER;
     String value = this.program.substring(this.start, this.position);
 
-    if (instructions.contains(value)) {
+    if (instructionNames.contains(value)) {
       type = TokenType.T_INSTRUCTION;
-    } else if (peek() == ":") {
+    } else if (peek() == _COLON) {
       type = TokenType.T_LABEL;
       advance();
     }
 
-    addToken(type, value);
+    return makeToken(type, value);
   }
 
-  void getScalar(String first, [bool negative = false]) {
-    num value = 0;
-    if (first == "0" && peek().toUpperCase() == "X") {
+  Token getScalar(int first, [bool negative = false]) {
+    int value = 0;
+    if (first == 0x30 && (peek() | 0x20) == 0x78) { // 0x or 0X
       advance();
+      int digits = this.position;
       // Get hex number;
       while (isHexDigit(peek())) {
         advance();
       }
-      value = int.parse(this.program.substring(this.start + 2, this.position),
-          radix: 16);
+      value = int.parse(this.program.substring(digits, this.position), radix: 16);
+      if (negative) value = -value;
     } else {
       while (isDigit(peek())) advance();
+      if (isFraction()) return getFloat();
       value = int.parse(this.program.substring(this.start, this.position),
           radix: 10);
     }
 
-    addToken(TokenType.T_SCALAR, value);
+    return makeToken(TokenType.T_SCALAR, value);
+  }
+
+  // A decimal point or an exponent after the digits makes a floating-point constant
+  bool isFraction() {
+    if (peek() == _DOT) return isDigit(peekNext());
+    return (peek() | 0x20) == 0x65 && (isDigit(peekNext()) || peekNext() == 0x2D || peekNext() == 0x2B);
+  }
+
+  Token getFloat() {
+    if (peek() == _DOT) {
+      advance();
+      while (isDigit(peek())) advance();
+    }
+    if ((peek() | 0x20) == 0x65) { // e or E
+      advance();
+      if (peek() == 0x2D || peek() == 0x2B) advance();
+      while (isDigit(peek())) advance();
+    }
+
+    double value = double.tryParse(this.program.substring(this.start, this.position));
+    if (value == null) {
+      reportError("Invalid floating-point constant.");
+      return null;
+    }
+
+    return makeToken(TokenType.T_FLOAT, value);
   }
 
-  String advance() {
-    return program[position++];
+  int advance() {
+    return program.codeUnitAt(position++);
   }
 
   void reportError(String error) {
@@ -316,27 +481,27 @@ class Lexer {
     hadError = true;
   }
 
-  String peek() {
-    return isAtEnd() ? '' : program[position];
+  int peek() {
+    return isAtEnd() ? -1 : program.codeUnitAt(position);
   }
 
-  String peekNext() {
-    return isAtEnd() ? '' : program[position + 1];
+  int peekNext() {
+    return position + 1 >= program.length ? -1 : program.codeUnitAt(position + 1);
   }
 
-  bool isAlphaNum(String char) {
-    return char == "_" || isAlpha(char) || isDigit(char);
+  bool isAlphaNum(int char) {
+    return char == _UNDERSCORE || isAlpha(char) || isDigit(char);
   }
 
-  bool isAlpha(String char) {
-    return new RegExp("[a-zA-Z]").hasMatch(char);
+  bool isAlpha(int char) {
+    return (char >= 0x61 && char <= 0x7A) || (char >= 0x41 && char <= 0x5A);
   }
 
-  bool isDigit(String char) {
-    return new RegExp("[0-9]").hasMatch(char);
+  bool isDigit(int char) {
+    return char >= 0x30 && char <= 0x39;
   }
 
-  bool isHexDigit(String char) {
-    return isDigit(char) || new RegExp("[A-Fa-f]").hasMatch(char);
+  bool isHexDigit(int char) {
+    return isDigit(char) || ((char | 0x20) >= 0x61 && (char | 0x20) <= 0x66);
   }
 }
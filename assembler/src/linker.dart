@@ -0,0 +1,195 @@
+import 'dart:typed_data';
+
+import 'assembly.dart';
+import 'image.dart';
+import 'object.dart';
+
+// Lays modules out one after the other, text and data each in command-line order, and patches
+// every relocation once all symbols have their final address
+class Linker extends ImageWriter {
+  List<ObjectFile> objects;
+  List<int> textBases = [];
+  List<int> dataBases = [];
+  Map<String, int> globals = {}; // Final value of every exported symbol
+  Map<String, ObjectFile> owners = {};
+  // Keeps the alignment of data directives across modules
+  final int DATA_ALIGN = 8;
+
+  Linker(this.objects);
+
+  Uint8List link() {
+    int textSize = 0;
+    int dataSize = 0;
+    int tableSize = 0;
+    for (ObjectFile object in this.objects) {
+      this.textBases.add(textSize);
+      textSize += object.text.length;
+
+      dataSize = (dataSize + DATA_ALIGN - 1) & ~(DATA_ALIGN - 1);
+      this.dataBases.add(dataSize);
+      dataSize += object.data.length;
+
+      tableSize += object.lines.length * 4;
+      for (ObjectSymbol symbol in object.symbols) {
+        tableSize += 6 + symbol.name.length;
+      }
+    }
+
+    // Relocations are patched in the byte order the modules were assembled for
+    this.littleEndian = this.objects.isNotEmpty && this.objects.first.littleEndian;
+    for (ObjectFile object in this.objects) {
+      if (object.littleEndian != this.littleEndian) {
+        throw new LinkerError("'${object.name}' and '${this.objects.first.name}' were assembled for different byte orders");
+      }
+    }
+
+    this.collectGlobals();
+
+    String entryPoint = this._entryPoint();
+    if (!this.globals.containsKey(entryPoint)) {
+      throw new LinkerError("Entry point symbol $entryPoint not found in program");
+    }
+    this.entry = TEXT_TOP + this.globals[entryPoint];
+
+    // Data segments are each padded to their page offset at most once
+    this.buffer = new Uint8List(4 * PAGE_SIZE + textSize + 2 * dataSize + tableSize +
+        (dataSize ~/ PAGE_SIZE + 2) * 24 + 2 * 12);
+    this.offset = PAGE_SIZE;
+
+    for (ObjectFile object in this.objects) {
+      this.emitBytes(object.text);
+    }
+    for (int i = 0; i < this.objects.length; i++) {
+      for (Relocation relocation in this.objects[i].relocations) {
+        this.applyRelocation(i, relocation);
+      }
+    }
+    this.emitTextSegment();
+
+    int start = this.offset;
+    for (int i = 0; i < this.objects.length; i++) {
+      this.emitBytes(new List<int>.filled(start + this.dataBases[i] - this.offset, 0));
+      this.emitBytes(this.objects[i].data);
+    }
+    this.emitDataSegments(start);
+
+    this.emitSymbolTable(this._symbols());
+    this.emitLineTable(this._lines());
+    if (this.predecode) this.emitDecodedSection();
+    this.emitSegmentHeaders();
+    this.emitSectionHeaders();
+    this.emitFileHeader();
+    this.emitChecksum();
+
+    return this.buffer.sublist(0, this.offset);
+  }
+
+  void collectGlobals() {
+    for (int i = 0; i < this.objects.length; i++) {
+      ObjectFile object = this.objects[i];
+      for (ObjectSymbol symbol in object.symbols) {
+        if (!symbol.defined || !symbol.global) continue;
+
+        if (this.globals.containsKey(symbol.name)) {
+          throw new LinkerError("Symbol '${symbol.name}' is defined in both '${this.owners[symbol.name].name}' and '${object.name}'");
+        }
+
+        this.globals[symbol.name] = this.value(i, symbol);
+        this.owners[symbol.name] = object;
+      }
+    }
+  }
+
+  // Text symbols resolve to their offset from the text start like labels do, data ones to their address
+  int value(int index, ObjectSymbol symbol) {
+    return symbol.segment == Segment.SGT_TEXT
+        ? this.textBases[index] + symbol.address
+        : DATA_TOP + this.dataBases[index] + symbol.address;
+  }
+
+  int resolve(int index, int symbolIndex) {
+    ObjectSymbol symbol = this.objects[index].symbols[symbolIndex];
+    if (symbol.defined) return this.value(index, symbol);
+
+    if (!this.globals.containsKey(symbol.name)) {
+      throw new LinkerError("Undefined symbol '${symbol.name}' referenced in '${this.objects[index].name}'");
+    }
+
+    return this.globals[symbol.name];
+  }
+
+  void applyRelocation(int index, Relocation relocation) {
+    int target = this.resolve(index, relocation.symbol);
+    int address = this.textBases[index] + relocation.offset;
+    int position = PAGE_SIZE + address;
+
+    switch (relocation.type) {
+      case RelocationType.R_JUMP26:
+        this._patch(position, 0x03FFFFFF, target >> 2);
+        break;
+      case RelocationType.R_BRANCH16:
+        this._patch(position, 0xFFFF, (target - address) >> 2);
+        break;
+      case RelocationType.R_HILO:
+        this._patch(position, 0xFFFF, target >> 16);
+        this._patch(position + 4, 0xFFFF, target);
+        break;
+      case RelocationType.R_HALO:
+        this._patch(position, 0xFFFF, (target + 0x8000) >> 16);
+        this._patch(position + 4, 0xFFFF, target);
+        break;
+    }
+  }
+
+  void _patch(int position, int mask, int value) {
+    int word = this.readGuestWord(position);
+    word = (word & ~mask) | (value & mask);
+
+    int length = this.offset;
+    this.offset = position;
+    this.emitGuestWord(word);
+    this.offset = length;
+  }
+
+  // The first entry point other than the default one wins
+  String _entryPoint() {
+    for (ObjectFile object in this.objects) {
+      if (object.entryPoint != "main") return object.entryPoint;
+    }
+
+    return "main";
+  }
+
+  List<Label> _symbols() {
+    List<Label> labels = [];
+    for (int i = 0; i < this.objects.length; i++) {
+      for (ObjectSymbol symbol in this.objects[i].symbols) {
+        if (!symbol.defined) continue;
+
+        int base = symbol.segment == Segment.SGT_TEXT ? this.textBases[i] : this.dataBases[i];
+        labels.add(new Label(symbol.name, symbol.segment, base + symbol.address));
+      }
+    }
+
+    return labels;
+  }
+
+  List<int> _lines() {
+    List<int> pairs = [];
+    for (int i = 0; i < this.objects.length; i++) {
+      List<int> lines = this.objects[i].lines;
+      for (int j = 0; j + 1 < lines.length; j += 2) {
+        pairs.add(this.textBases[i] + lines[j]);
+        pairs.add(lines[j + 1]);
+      }
+    }
+
+    return pairs;
+  }
+}
+
+class LinkerError {
+  String message;
+
+  LinkerError(this.message);
+}
@@ -0,0 +1,197 @@
+import 'dart:typed_data';
+
+import 'assembly.dart';
+
+enum RelocationType {
+  R_JUMP26, // j/jal target field, from the symbol's text offset
+  R_BRANCH16, // Branch offset relative to the branch itself
+  R_HILO, // lui then ori/addiu, both halves of the address
+  R_HALO // lui then a load or store whose sign extended offset holds the lower half
+}
+
+class ObjectSymbol {
+  String name;
+  Segment segment;
+  int address; // Offset in the module's text or data, unused when undefined
+  bool defined;
+  bool global;
+
+  ObjectSymbol(this.name, this.segment, this.address, this.defined, this.global);
+}
+
+class Relocation {
+  int offset; // Text offset of the first instruction to patch
+  RelocationType type;
+  int symbol; // Index in the module's symbol table
+
+  Relocation(this.offset, this.type, this.symbol);
+}
+
+// A module assembled on its own, linked with others into an executable.
+// Layout, big-endian: magic [0x10, L, O, F], version, flags, entry point name, text, data, symbols,
+// relocations and line table, each prefixed with its 32-bit length or count. Text and data are in
+// the guest byte order given by the flags.
+class ObjectFile {
+  static const int VERSION = 2;
+  static const int LITTLE_ENDIAN = 0x01;
+
+  String name = "";
+  String entryPoint;
+  Uint8List text;
+  Uint8List data;
+  bool littleEndian = false;
+  List<ObjectSymbol> symbols = [];
+  List<Relocation> relocations = [];
+  List<int> lines = []; // Pairs of text offset and source line
+  Map<String, int> _indices = {};
+
+  ObjectFile(this.entryPoint);
+
+  void define(Label label, bool global) {
+    this._indices[label.name] = this.symbols.length;
+    this.symbols.add(new ObjectSymbol(label.name, label.segment, label.address, true, global));
+  }
+
+  // Index of a symbol, referenced symbols defined in another module are added as undefined
+  int symbolIndex(String name) {
+    return this._indices.putIfAbsent(name, () {
+      this.symbols.add(new ObjectSymbol(name, Segment.SGT_TEXT, 0, false, true));
+      return this.symbols.length - 1;
+    });
+  }
+
+  Uint8List write() {
+    _ObjectWriter writer = new _ObjectWriter();
+    writer.bytes([0x10] + "LOF".codeUnits);
+    writer.byte(VERSION);
+    writer.byte(this.littleEndian ? LITTLE_ENDIAN : 0x00);
+    writer.string(this.entryPoint);
+
+    writer.word(this.text.length);
+    writer.bytes(this.text);
+    writer.word(this.data.length);
+    writer.bytes(this.data);
+
+    writer.word(this.symbols.length);
+    for (ObjectSymbol symbol in this.symbols) {
+      writer.byte((symbol.defined ? 0x01 : 0x00) | (symbol.global ? 0x02 : 0x00));
+      writer.byte(symbol.segment == Segment.SGT_TEXT ? 0x00 : 0x01);
+      writer.word(symbol.address);
+      writer.string(symbol.name);
+    }
+
+    writer.word(this.relocations.length);
+    for (Relocation relocation in this.relocations) {
+      writer.word(relocation.offset);
+      writer.byte(relocation.type.index);
+      writer.word(relocation.symbol);
+    }
+
+    writer.word(this.lines.length);
+    for (int value in this.lines) {
+      writer.word(value);
+    }
+
+    return new Uint8List.fromList(writer.output);
+  }
+
+  static ObjectFile read(Uint8List bytes) {
+    _ObjectReader reader = new _ObjectReader(bytes);
+    List<int> magic = reader.bytes(4);
+    if (magic[0] != 0x10 || String.fromCharCodes(magic.sublist(1)) != "LOF") {
+      throw new FormatException("Not an object file");
+    }
+    if (reader.byte() != VERSION) throw new FormatException("Unsupported object file version");
+    int flags = reader.byte();
+    if ((flags & ~LITTLE_ENDIAN) != 0) throw new FormatException("Unsupported object file flags");
+
+    ObjectFile object = new ObjectFile(reader.string());
+    object.littleEndian = (flags & LITTLE_ENDIAN) != 0;
+    object.text = reader.bytes(reader.word());
+    object.data = reader.bytes(reader.word());
+
+    int count = reader.word();
+    for (int i = 0; i < count; i++) {
+      int flags = reader.byte();
+      Segment segment = reader.byte() == 0x00 ? Segment.SGT_TEXT : Segment.SGT_DATA;
+      int address = reader.word();
+      String name = reader.string();
+
+      object._indices[name] = object.symbols.length;
+      object.symbols.add(new ObjectSymbol(name, segment, address, (flags & 0x01) != 0, (flags & 0x02) != 0));
+    }
+
+    count = reader.word();
+    for (int i = 0; i < count; i++) {
+      int offset = reader.word();
+      int type = reader.byte();
+      int symbol = reader.word();
+      int span = type >= RelocationType.R_HILO.index ? 8 : 4;
+      if (type >= RelocationType.values.length || symbol >= object.symbols.length || offset + span > object.text.length) {
+        throw new FormatException("Invalid relocation");
+      }
+
+      object.relocations.add(new Relocation(offset, RelocationType.values[type], symbol));
+    }
+
+    count = reader.word();
+    for (int i = 0; i < count; i++) {
+      object.lines.add(reader.word());
+    }
+
+    return object;
+  }
+}
+
+class _ObjectWriter {
+  List<int> output = [];
+
+  void byte(int value) {
+    output.add(value & 0xFF);
+  }
+
+  void bytes(List<int> values) {
+    output.addAll(values);
+  }
+
+  void word(int value) {
+    byte(value >> 0x18);
+    byte(value >> 0x10);
+    byte(value >> 0x08);
+    byte(value);
+  }
+
+  void string(String value) {
+    List<int> units = value.codeUnits;
+    word(units.length);
+    bytes(units);
+  }
+}
+
+class _ObjectReader {
+  Uint8List input;
+  int offset = 0;
+
+  _ObjectReader(this.input);
+
+  Uint8List bytes(int count) {
+    if (count < 0 || this.offset + count > this.input.length) throw new FormatException("Truncated object file");
+
+    Uint8List values = this.input.sublist(this.offset, this.offset + count);
+    this.offset += count;
+    return values;
+  }
+
+  int byte() {
+    return bytes(1)[0];
+  }
+
+  int word() {
+    Uint8List values = bytes(4);
+    return (values[0] << 0x18) | (values[1] << 0x10) | (values[2] << 0x08) | values[3];
+  }
+
+  String string() {
+    return String.fromCharCodes(bytes(word()));
+  }
+}
@@ -2,17 +2,20 @@ import 'dart:io';
 
 import 'assembly.dart';
 import 'instruction.dart';
+import 'lexer.dart';
 import 'token.dart';
 
 class Parser {
-  List<Token> tokens;
-  int offset = 0;
+  Lexer lexer;
+  Token next; // Lookahead, tokens are scanned as the parser consumes them
   Assembly assembly = new Assembly();
   Segment segment = Segment.SGT_TEXT;
   Token current;
   bool hadError = false;
 
-  Parser(this.tokens);
+  Parser(this.lexer) {
+    this.next = this.lexer.nextToken();
+  }
 
   void parse() {
     while (!isAtEnd()) {
@@ -74,6 +77,13 @@ class Parser {
       return;
     }
 
+    if (this.current.value == ".globl") {
+      do {
+        this.assembly.globals.add(this.expect(TokenType.T_IDENTIFIER, "Expected label as .globl directive's operand.").value);
+      } while (matches(TokenType.T_COMMA));
+      return;
+    }
+
     if (segment != Segment.SGT_DATA) {
       reportError(
           "Cannot put directive ${this.current.lexeme} outside of a .data segment.");
@@ -108,6 +118,16 @@ class Parser {
           getData(".word", 4);
           break;
         }
+      case ".float":
+        {
+          getData(".float", 4);
+          break;
+        }
+      case ".double":
+        {
+          getData(".double", 8);
+          break;
+        }
       case ".ascii":
       case ".asciiz":
         {
@@ -133,9 +153,14 @@ class Parser {
 
   void getInstruction() {
     Token token = expect(TokenType.T_INSTRUCTION, "Expected an instruction.");
+    int count = this.assembly.instructions.length;
 
     switch (token.value) {
       case "abs":
+      case "clo":
+      case "clz":
+      case "seb":
+      case "seh":
       case "div":
       case "divu":
       case "mult":
@@ -163,6 +188,8 @@ class Parser {
       case "add":
       case "addu":
       case "and":
+      case "movn":
+      case "movz":
       case "mul":
       case "nor":
       case "or":
@@ -261,6 +288,32 @@ class Parser {
           instr.rt = dest;
           instr.immed = imm;
 
+          this.assembly.addInstruction(instr);
+          break;
+        }
+      case "ext":
+      case "ins":
+        {
+          Token dest = expect(TokenType.T_REGISTER,
+              "Expected register as '${token.value}' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token src = expect(TokenType.T_REGISTER,
+              "Expected register as '${token.value}' second operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token pos = expect(TokenType.T_SCALAR,
+              "Expected constant scalar as '${token.value}' third operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token size = expect(TokenType.T_SCALAR,
+              "Expected constant scalar as '${token.value}' fourth operand.");
+
+          Instruction instr =
+              new Instruction(token.value, 4, InstructionType.R_TYPE);
+          instr.operands = [dest, src, pos, size];
+          instr.rs = src;
+          instr.rt = dest;
+          instr.shmt = pos;
+          instr.immed = size;
+
           this.assembly.addInstruction(instr);
           break;
         }
@@ -311,9 +364,14 @@ class Parser {
       case "sb":
       case "sh":
       case "sw":
+      case "lwc1":
+      case "swc1":
+      case "ldc1":
+      case "sdc1":
         {
-          Token tgt = expect(TokenType.T_REGISTER,
-              "Expected register as '${token.value}' first operand.");
+          bool float = token.value.toString().endsWith("c1");
+          Token tgt = expect(float ? TokenType.T_FREGISTER : TokenType.T_REGISTER,
+              "Expected ${float ? 'CP1 register' : 'register'} as '${token.value}' first operand.");
           expect(TokenType.T_COMMA, "Expected ',' between operands.");
 
           Instruction instr = new Instruction(token.value, 3, InstructionType.I_TYPE);
@@ -383,15 +441,227 @@ class Parser {
               new Instruction("syscall", 0, InstructionType.J_TYPE));
           break;
         }
+      case "add.s":
+      case "add.d":
+      case "sub.s":
+      case "sub.d":
+      case "mul.s":
+      case "mul.d":
+      case "div.s":
+      case "div.d":
+        {
+          Token dest = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token src = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' second operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token tgt = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' third operand.");
+
+          Instruction instr =
+              new Instruction(token.value, 3, InstructionType.R_TYPE);
+          instr.rd = dest;
+          instr.rs = src;
+          instr.rt = tgt;
+
+          this.assembly.addInstruction(instr);
+          break;
+        }
+      case "sqrt.s":
+      case "sqrt.d":
+      case "abs.s":
+      case "abs.d":
+      case "mov.s":
+      case "mov.d":
+      case "neg.s":
+      case "neg.d":
+      case "cvt.s.d":
+      case "cvt.s.w":
+      case "cvt.d.s":
+      case "cvt.d.w":
+      case "cvt.w.s":
+      case "cvt.w.d":
+      case "trunc.w.s":
+      case "trunc.w.d":
+      case "c.eq.s":
+      case "c.eq.d":
+      case "c.lt.s":
+      case "c.lt.d":
+      case "c.le.s":
+      case "c.le.d":
+        {
+          Token first = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token second = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' second operand.");
+
+          // Compares read both registers, the others write the first one
+          Instruction instr =
+              new Instruction(token.value, 2, InstructionType.R_TYPE);
+          if (token.value.toString().startsWith("c.")) {
+            instr.rs = first;
+            instr.rt = second;
+          } else {
+            instr.rd = first;
+            instr.rs = second;
+          }
+
+          this.assembly.addInstruction(instr);
+          break;
+        }
+      case "mfc1":
+      case "mtc1":
+        {
+          Token rt = expect(TokenType.T_REGISTER,
+              "Expected register as '${token.value}' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token fs = expect(TokenType.T_FREGISTER,
+              "Expected CP1 register as '${token.value}' second operand.");
+
+          Instruction instr =
+              new Instruction(token.value, 2, InstructionType.R_TYPE);
+          instr.rt = rt;
+          instr.rs = fs;
+
+          this.assembly.addInstruction(instr);
+          break;
+        }
+      case "bc1t":
+      case "bc1f":
+        {
+          Token lbl = expect(TokenType.T_IDENTIFIER,
+              "Expected label as '${token.value}' operand.");
+
+          Instruction instr =
+              new Instruction(token.value, 1, InstructionType.I_TYPE);
+          instr.immed = lbl;
+
+          this.assembly.addInstruction(instr);
+          break;
+        }
+      default:
+        if (VectorCodes.containsKey(token.value.toString().split(".").first)) getVectorInstruction(token);
+        break;
+    }
+
+    if (this.assembly.instructions.length > count) {
+      this.assembly.instructions.last.line = token.line;
     }
   }
 
+  // MSA instructions, named operation.df. rd holds wd, rs ws or the general-purpose register, rt wt.
+  void getVectorInstruction(Token token) {
+    String name = token.value;
+    String operation = name.substring(0, name.lastIndexOf("."));
+    Instruction instr;
+
+    switch (operation) {
+      case "ld":
+      case "st":
+        {
+          Token wd = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token offset = new Token(TokenType.T_SCALAR, 0, 0);
+          if (matches(TokenType.T_SCALAR)) {
+            offset = this.current;
+          }
+
+          expect(TokenType.T_LPAREN, "Expected '(' after offset value.");
+          Token src = expect(TokenType.T_REGISTER,
+              "Expected register as '$name' second operand.");
+          expect(TokenType.T_RPAREN, "Expected ')' after register value.");
+
+          instr = new Instruction(name, 3, InstructionType.I_TYPE);
+          instr.rd = wd;
+          instr.rs = src;
+          instr.immed = offset;
+          break;
+        }
+      case "fill":
+        {
+          Token wd = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token rs = expect(TokenType.T_REGISTER,
+              "Expected register as '$name' second operand.");
+
+          instr = new Instruction(name, 2, InstructionType.R_TYPE);
+          instr.rd = wd;
+          instr.rs = rs;
+          break;
+        }
+      case "copy_s":
+      case "copy_u":
+        {
+          Token rd = expect(TokenType.T_REGISTER,
+              "Expected register as '$name' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token ws = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' second operand.");
+          expect(TokenType.T_LBRACKET, "Expected '[' after MSA register.");
+          Token lane = expect(TokenType.T_SCALAR, "Expected lane index between '[' and ']'.");
+          expect(TokenType.T_RBRACKET, "Expected ']' after lane index.");
+
+          instr = new Instruction(name, 2, InstructionType.R_TYPE);
+          instr.rd = rd;
+          instr.rs = ws;
+          instr.immed = lane;
+          break;
+        }
+      case "shf":
+        {
+          Token wd = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token ws = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' second operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token selectors = expect(TokenType.T_SCALAR,
+              "Expected constant scalar as '$name' third operand.");
+
+          instr = new Instruction(name, 3, InstructionType.I_TYPE);
+          instr.rd = wd;
+          instr.rs = ws;
+          instr.immed = selectors;
+          break;
+        }
+      default:
+        {
+          Token wd = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' first operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token ws = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' second operand.");
+          expect(TokenType.T_COMMA, "Expected ',' between operands.");
+          Token wt = expect(TokenType.T_VREGISTER,
+              "Expected MSA register as '$name' third operand.");
+
+          instr = new Instruction(name, 3, InstructionType.R_TYPE);
+          instr.rd = wd;
+          instr.rs = ws;
+          instr.rt = wt;
+          break;
+        }
+    }
+
+    this.assembly.addInstruction(instr);
+  }
+
   void getData(String kind, int size) {
     List<Object> operands = [];
+    bool float = kind == ".float" || kind == ".double";
     do {
+      if (float && matches(TokenType.T_FLOAT)) {
+        operands.add(this.current.value);
+        continue;
+      }
+
       Token operand = expect(
-          TokenType.T_SCALAR, "Expected constant scalar as $kind operand.");
-      operands.add(operand.value);
+          TokenType.T_SCALAR, "Expected constant ${float ? 'number' : 'scalar'} as $kind operand.");
+      operands.add(float ? (operand.value as int).toDouble() : operand.value);
     } while (matches(TokenType.T_COMMA));
 
     Directive directive = new Directive(kind);
@@ -401,10 +671,9 @@ class Parser {
     int mod = this.assembly.dataSize % size;
     if (mod != 0) {
       size -=  mod;
-      List<int> expand = new List(size); expand.fillRange(0, size, 0);
       this.assembly.directives.last.align = size;
       this.assembly.dataSize += size;
-      this.assembly.labels.values.last.address += size;
+      this.assembly.lastLabel.address += size;
     }
 
     this.assembly.addDirective(directive);
@@ -426,15 +695,18 @@ class Parser {
   }
 
   bool isAtEnd() {
-    return this.tokens[this.offset].type == TokenType.T_EOF;
+    return this.next.type == TokenType.T_EOF;
   }
 
   Token peek() {
-    return this.tokens[this.offset];
+    return this.next;
   }
 
   Token advance() {
-    return this.current = this.tokens[this.offset++];
+    this.current = this.next;
+    if (this.current.type != TokenType.T_EOF) this.next = this.lexer.nextToken();
+
+    return this.current;
   }
 
   bool matches(TokenType type) {
@@ -3,16 +3,21 @@ enum TokenType {
   T_LPAREN,
   T_RPAREN,
   T_COMMA,
+  T_LBRACKET,
+  T_RBRACKET,
 
   // Constants
   T_STRING,
   T_SCALAR,
+  T_FLOAT,
 
   // Keywords
   T_IDENTIFIER,
   T_INSTRUCTION,
   T_DIRECTIVE,
   T_REGISTER,
+  T_FREGISTER, // CP1 register, \$f0 to \$f31
+  T_VREGISTER, // MSA register, \$w0 to \$w31
   T_LABEL,
 
   T_EOF
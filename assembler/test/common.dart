@@ -0,0 +1,136 @@
+import 'dart:io';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import '../src/assembly.dart';
+import '../src/lexer.dart';
+import '../src/parser.dart';
+
+// Built by CMake in the repository root, tests running programs are skipped until it is
+const String lmips = "../bin/lmips";
+final dynamic needsVM = new File(lmips).existsSync() ? false : "lmips is not built";
+
+Assembly parse(String source) {
+  Lexer lexer = new Lexer(source);
+  Parser parser = new Parser(lexer);
+  parser.parse();
+
+  expect(lexer.hadError || parser.hadError, isFalse, reason: "Test program does not parse");
+  return parser.assembly;
+}
+
+// Executable lasm writes for the source, cut to its size as main.dart does
+Uint8List assemble(String source, {bool optimize = false, bool littleEndian = false, bool predecode = false}) {
+  Assembler assembler = new Assembler(parse(source), optimize: optimize);
+  assembler.littleEndian = littleEndian;
+  assembler.predecode = predecode;
+
+  Uint8List image = assembler.assemble();
+  return image.sublist(0, assembler.offset);
+}
+
+int readHalf(List<int> bytes, int offset) {
+  return (bytes[offset] << 0x08) | bytes[offset + 1];
+}
+
+int readWord(List<int> bytes, int offset, [bool littleEndian = false]) {
+  if (littleEndian) {
+    return (bytes[offset + 3] << 0x18) | (bytes[offset + 2] << 0x10) | (bytes[offset + 1] << 0x08) | bytes[offset];
+  }
+
+  return (bytes[offset] << 0x18) | (bytes[offset + 1] << 0x10) | (bytes[offset + 2] << 0x08) | bytes[offset + 3];
+}
+
+class LoadSegment {
+  int type;
+  int flags;
+  int offset;
+  int address;
+  int fileSize;
+  int memSize;
+}
+
+// Reads back the LEF v2 header, segment and section tables of an image
+class LefImage {
+  Uint8List bytes;
+
+  LefImage(this.bytes);
+
+  int get major => bytes[4];
+  int get minor => bytes[5];
+  int get flags => readHalf(bytes, 6);
+  int get entry => readWord(bytes, 8);
+  int get checksum => readWord(bytes, 24);
+  bool get littleEndian => (flags & 0x0001) != 0;
+
+  List<LoadSegment> get segments {
+    List<LoadSegment> segments = [];
+    int position = readWord(bytes, 12);
+    for (int i = 0; i < readHalf(bytes, 16); i++) {
+      segments.add(new LoadSegment()
+        ..type = readWord(bytes, position)
+        ..flags = readWord(bytes, position + 4)
+        ..offset = readWord(bytes, position + 8)
+        ..address = readWord(bytes, position + 12)
+        ..fileSize = readWord(bytes, position + 16)
+        ..memSize = readWord(bytes, position + 20));
+      position += 24;
+    }
+
+    return segments;
+  }
+
+  // Contents of the first section of the given type, null if there is none
+  Uint8List section(int type) {
+    int position = readWord(bytes, 20);
+    for (int i = 0; i < readHalf(bytes, 18); i++) {
+      if (readHalf(bytes, position + 2) == type) {
+        int offset = readWord(bytes, position + 4);
+        return bytes.sublist(offset, offset + readWord(bytes, position + 8));
+      }
+      position += 12;
+    }
+
+    return null;
+  }
+
+  // Instruction words of the text segment, in the byte order of the guest
+  List<int> get text {
+    LoadSegment segment = segments.firstWhere((segment) => segment.address == 0x2000);
+    return new List<int>.generate(
+        segment.fileSize ~/ 4, (i) => readWord(bytes, segment.offset + i * 4, littleEndian));
+  }
+
+  // Guest memory the data segments describe, from the start of the data region
+  Uint8List get data {
+    List<LoadSegment> data = segments.where((segment) => segment.address >= 0x080000).toList();
+    int end = data.fold<int>(0, (end, segment) => max(end, segment.address + segment.memSize - 0x080000));
+    Uint8List memory = new Uint8List(end);
+    for (LoadSegment segment in data) {
+      memory.setAll(segment.address - 0x080000, bytes.sublist(segment.offset, segment.offset + segment.fileSize));
+    }
+
+    return memory;
+  }
+}
+
+ProcessResult execute(Uint8List image, {List<String> options = const []}) {
+  Directory directory = Directory.systemTemp.createTempSync("lasm_test");
+  try {
+    File file = new File("${directory.path}/program.bin")..writeAsBytesSync(image);
+    return Process.runSync(lmips, options + [file.path]);
+  } finally {
+    directory.deleteSync(recursive: true);
+  }
+}
+
+// Runs an image in the VM and returns what the guest printed
+String run(Uint8List image, {List<String> options = const []}) {
+  ProcessResult result = execute(image, options: options);
+
+  expect(result.exitCode, 0, reason: result.stderr);
+  return result.stdout;
+}
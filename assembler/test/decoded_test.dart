@@ -0,0 +1,195 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/decoded.dart';
+import 'common.dart';
+
+const int SHT_DECODED = 0x40;
+
+int fnv1a(List<int> bytes) {
+  int hash = 0x811C9DC5;
+  for (int byte in bytes) {
+    hash = ((hash ^ byte) * 0x01000193) & 0xFFFFFFFF;
+  }
+
+  return hash;
+}
+
+// Word, then the handler, rd, rs, rt and operand decodeInstruction in the VM gives it at text offset 0x100
+List<List<dynamic>> records = [
+    [0x00094100, DecodedOp.DOP_SLL, 8, 0, 9, 0x4], // sll $t0, $t1, 4
+    [0x00094102, DecodedOp.DOP_SRL, 8, 0, 9, 0x4], // srl $t0, $t1, 4
+    [0x00094103, DecodedOp.DOP_SRA, 8, 0, 9, 0x4], // sra $t0, $t1, 4
+    [0x01494004, DecodedOp.DOP_SLLV, 8, 10, 9, 0x0], // sllv $t0, $t1, $t2
+    [0x03E00008, DecodedOp.DOP_JR, 0, 31, 0, 0x0], // jr $ra
+    [0x01000009, DecodedOp.DOP_JALR, 31, 8, 0, 0x0], // jalr $zero, $t0
+    [0x01004809, DecodedOp.DOP_JALR, 9, 8, 0, 0x0], // jalr $t1, $t0
+    [0x0000000C, DecodedOp.DOP_SYSCALL, 0, 0, 0, 0x0], // syscall
+    [0x00004010, DecodedOp.DOP_MFHI, 8, 0, 0, 0x0], // mfhi $t0
+    [0x01090018, DecodedOp.DOP_MULT, 0, 8, 9, 0x0], // mult $t0, $t1
+    [0x012A4020, DecodedOp.DOP_ADD, 8, 9, 10, 0x0], // add $t0, $t1, $t2
+    [0x012A402B, DecodedOp.DOP_SLTU, 8, 9, 10, 0x0], // sltu $t0, $t1, $t2
+    [0x012A400A, DecodedOp.DOP_MOVZ, 8, 9, 10, 0x0], // movz $t0, $t1, $t2
+    [0x0000003F, DecodedOp.DOP_UNKNOWN_SPECIAL, 0, 0, 0, 0x3F], // special function 0x3F
+    [0x05000002, DecodedOp.DOP_BLTZ, 0, 8, 0, 0x108], // bltz $t0, 0x002108
+    [0x05010002, DecodedOp.DOP_BGEZ, 0, 8, 1, 0x108], // bgez $t0, 0x002108
+    [0x05020002, DecodedOp.DOP_UNKNOWN_REGIMM, 0, 8, 2, 0x2], // regimm rt 2
+    [0x1000FFFC, DecodedOp.DOP_BEQ, 31, 0, 0, 0xF0], // beq $zero, $zero, 0x0020f0
+    [0x10000800, DecodedOp.DOP_BEQ, 1, 0, 0, 0xFFFFE100], // beq, offset with bit 13 set
+    [0x08000040, DecodedOp.DOP_J, 0, 0, 0, 0x100], // j 0x002100
+    [0x0C000040, DecodedOp.DOP_JAL, 0, 0, 0, 0x100], // jal 0x002100
+    [0x15090003, DecodedOp.DOP_BNE, 0, 8, 9, 0x10C], // bne $t0, $t1, 0x00210c
+    [0x19000003, DecodedOp.DOP_BLEZ, 0, 8, 0, 0x10C], // blez $t0, 0x00210c
+    [0x1D000003, DecodedOp.DOP_BGTZ, 0, 8, 0, 0x10C], // bgtz $t0, 0x00210c
+    [0x2128FFFB, DecodedOp.DOP_ADDI, 31, 9, 8, 0xFFFFFFFB], // addi $t0, $t1, -5
+    [0x25280010, DecodedOp.DOP_ADDIU, 0, 9, 8, 0x10], // addiu $t0, $t1, 16
+    [0x2928FFFF, DecodedOp.DOP_SLTI, 31, 9, 8, 0xFFFFFFFF], // slti $t0, $t1, -1
+    [0x2D28FFFF, DecodedOp.DOP_SLTIU, 31, 9, 8, 0xFFFFFFFF], // sltiu $t0, $t1, -1
+    [0x3128FF00, DecodedOp.DOP_ANDI, 31, 9, 8, 0xFF00], // andi $t0, $t1, 0xff00
+    [0x3528FFFF, DecodedOp.DOP_ORI, 31, 9, 8, 0xFFFF], // ori $t0, $t1, 0xffff
+    [0x3928FFFF, DecodedOp.DOP_XORI, 31, 9, 8, 0xFFFF], // xori $t0, $t1, 0xffff
+    [0x3C08ABCD, DecodedOp.DOP_LUI, 21, 0, 8, 0xABCD0000], // lui $t0, 0xabcd
+    [0x81280004, DecodedOp.DOP_LB, 0, 9, 8, 0x4], // lb $t0, 4($t1)
+    [0x85280004, DecodedOp.DOP_LH, 0, 9, 8, 0x4], // lh $t0, 4($t1)
+    [0x8D28FFFC, DecodedOp.DOP_LW, 31, 9, 8, 0xFFFFFFFC], // lw $t0, -4($t1)
+    [0x91280004, DecodedOp.DOP_LBU, 0, 9, 8, 0x4], // lbu $t0, 4($t1)
+    [0x95280004, DecodedOp.DOP_LHU, 0, 9, 8, 0x4], // lhu $t0, 4($t1)
+    [0xA1280004, DecodedOp.DOP_SB, 0, 9, 8, 0x4], // sb $t0, 4($t1)
+    [0xA5280004, DecodedOp.DOP_SH, 0, 9, 8, 0x4], // sh $t0, 4($t1)
+    [0xA928FFFC, DecodedOp.DOP_SW, 31, 9, 8, 0xFFFFFFFC], // sw $t0, -4($t1)
+    [0xFC000000, DecodedOp.DOP_UNKNOWN, 0, 0, 0, 0x3F], // opcode 0x3F
+    [0xAD280000, DecodedOp.DOP_UNKNOWN, 0, 9, 8, 0x2B], // opcode 0x2B, sw is 0x2A here
+    [0x712A4002, DecodedOp.DOP_MUL, 8, 9, 10, 0x0], // mul $t0, $t1, $t2
+    [0x71284020, DecodedOp.DOP_CLZ, 8, 9, 8, 0x0], // clz $t0, $t1
+    [0x71284021, DecodedOp.DOP_CLO, 8, 9, 8, 0x0], // clo $t0, $t1
+    [0x7000003F, DecodedOp.DOP_UNKNOWN, 0, 0, 0, 0x1C], // special2 function 0x3F
+    [0x7D283900, DecodedOp.DOP_EXT, 4, 9, 8, 0xFF], // ext $t0, $t1, 4, 8
+    [0x7D285904, DecodedOp.DOP_INS, 4, 9, 8, 0xFF0], // ins $t0, $t1, 4, 8
+    [0x7D28F900, DecodedOp.DOP_UNKNOWN, 31, 9, 8, 0x1F], // ext running past bit 31
+    [0x7C094420, DecodedOp.DOP_SEB, 8, 0, 9, 0x0], // seb $t0, $t1
+    [0x7C094620, DecodedOp.DOP_SEH, 8, 0, 9, 0x0], // seh $t0, $t1
+    [0x46020800, DecodedOp.DOP_ADD_S, 0, 1, 2, 0x0], // add.s $f0, $f1, $f2
+    [0x46241000, DecodedOp.DOP_ADD_D, 0, 2, 4, 0x0], // add.d $f0, $f2, $f4
+    [0x46240800, DecodedOp.DOP_UNKNOWN, 0, 1, 4, 0x11], // add.d naming $f1
+    [0x46000804, DecodedOp.DOP_SQRT_S, 0, 1, 0, 0x0], // sqrt.s $f0, $f1
+    [0x4602083C, DecodedOp.DOP_C_LT_S, 0, 1, 2, 0x0], // c.lt.s $f1, $f2
+    [0x462410F2, DecodedOp.DOP_UNKNOWN, 3, 2, 4, 0x11], // c.eq.d on condition code 3
+    [0x460008A1, DecodedOp.DOP_CVT_D_S, 2, 1, 0, 0x0], // cvt.d.s $f2, $f1
+    [0x46201024, DecodedOp.DOP_CVT_W_D, 0, 2, 0, 0x0], // cvt.w.d $f0, $f2
+    [0x4600080D, DecodedOp.DOP_TRUNC_W_S, 0, 1, 0, 0x0], // trunc.w.s $f0, $f1
+    [0x46800820, DecodedOp.DOP_CVT_S_W, 0, 1, 0, 0x0], // cvt.s.w $f0, $f1
+    [0x44080800, DecodedOp.DOP_MFC1, 0, 1, 8, 0x0], // mfc1 $t0, $f1
+    [0x44880800, DecodedOp.DOP_MTC1, 0, 1, 8, 0x0], // mtc1 $t0, $f1
+    [0x45010002, DecodedOp.DOP_BC1T, 0, 0, 1, 0x108], // bc1t 0x002108
+    [0x45000002, DecodedOp.DOP_BC1F, 0, 0, 0, 0x108], // bc1f 0x002108
+    [0x45020002, DecodedOp.DOP_UNKNOWN, 0, 0, 2, 0x11], // bc1 with rt 2
+    [0xC5210004, DecodedOp.DOP_LWC1, 0, 9, 1, 0x4], // lwc1 $f1, 4($t1)
+    [0xD5220008, DecodedOp.DOP_LDC1, 0, 9, 2, 0x8], // ldc1 $f2, 8($t1)
+    [0xD5210008, DecodedOp.DOP_UNKNOWN, 0, 9, 1, 0x35], // ldc1 into $f1
+    [0xE5210004, DecodedOp.DOP_SWC1, 0, 9, 1, 0x4], // swc1 $f1, 4($t1)
+    [0xF5220008, DecodedOp.DOP_SDC1, 0, 9, 2, 0x8], // sdc1 $f2, 8($t1)
+    [0x7843104E, DecodedOp.DOP_ADDV_W, 1, 2, 3, 0x0], // addv.w $w1, $w2, $w3
+    [0x79A3104E, DecodedOp.DOP_MAX_U_H, 1, 2, 3, 0x0], // max_u.h $w1, $w2, $w3
+    [0x7803104F, DecodedOp.DOP_CEQ_B, 1, 2, 3, 0x0], // ceq.b $w1, $w2, $w3
+    [0x79C3104F, DecodedOp.DOP_CLT_U_W, 1, 2, 3, 0x0], // clt_u.w $w1, $w2, $w3
+    [0x7A231055, DecodedOp.DOP_HADD_S_H, 1, 2, 3, 0x0], // hadd_s.h $w1, $w2, $w3
+    [0x7A031055, DecodedOp.DOP_UNKNOWN, 1, 2, 3, 0x1E], // hadd_s.b
+    [0x7A4E0882, DecodedOp.DOP_SHF_W, 2, 1, 14, 0x4E], // shf.w $w2, $w1, 78
+    [0x78B20A19, DecodedOp.DOP_COPY_S_W, 8, 1, 18, 0x2], // copy_s.w $t0, $w1[2]
+    [0x78F20A19, DecodedOp.DOP_UNKNOWN, 8, 1, 18, 0x1E], // copy_u.w
+    [0x78CF0A19, DecodedOp.DOP_COPY_U_B, 8, 1, 15, 0xF], // copy_u.b $t0, $w1[15]
+    [0x7B01405E, DecodedOp.DOP_FILL_H, 1, 8, 1, 0x0], // fill.h $w1, $t0
+    [0x7BFE4062, DecodedOp.DOP_LD_W, 1, 8, 30, 0xFFFFFFF8], // ld.w $w1, -8($t0)
+    [0x78034064, DecodedOp.DOP_ST_B, 1, 8, 3, 0x3], // st.b $w1, 3($t0)
+    [0x7863104E, DecodedOp.DOP_UNKNOWN, 1, 2, 3, 0x1E], // addv.d
+];
+
+void main() {
+  String sum = """
+.data
+newline: .asciiz "\\n"
+table: .word 3, 5, 7, 11
+
+.text
+main:
+    la \$s0, table
+    addi \$s1, \$zero, 4
+    move \$s2, \$zero
+loop:
+    lw \$t0, 0(\$s0)
+    add \$s2, \$s2, \$t0
+    addi \$s0, \$s0, 4
+    addi \$s1, \$s1, -1
+    bgtz \$s1, loop
+    move \$a0, \$s2
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 4
+    la \$a0, newline
+    syscall
+    li \$t0, 0x12345678
+    srl \$a0, \$t0, 16
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+  test("lists handlers in the order of the VM", () {
+    String header = new File("../src/decode.h").readAsStringSync();
+    String body = header.substring(header.indexOf("typedef enum {"), header.indexOf("} DecodedOp;"));
+    List<String> names = new RegExp(r"\bDOP_\w+").allMatches(body).map((match) => match.group(0)).toList();
+
+    expect(DecodedOp.values.map((op) => op.toString().split(".").last), names.where((name) => name != "DOP_COUNT"));
+  });
+
+  test("decodes words as the VM does", () {
+    for (List<dynamic> record in records) {
+      DecodedInstr instr = new DecodedInstr(0x100, record[0]);
+      expect([instr.op, instr.rd, instr.rs, instr.rt, instr.immed], record.sublist(1),
+          reason: record[0].toRadixString(16));
+    }
+  });
+
+  test("describes the text it was built for", () {
+    LefImage image = new LefImage(assemble(sum, predecode: true));
+    Uint8List section = image.section(SHT_DECODED);
+    LoadSegment text = image.segments.firstWhere((segment) => segment.address == 0x2000);
+
+    expect(readWord(section, 0), text.fileSize);
+    expect(readWord(section, 4), fnv1a(image.bytes.sublist(text.offset, text.offset + text.fileSize)));
+    expect(section.length, 8 + text.fileSize * 2);
+
+    for (int ip = 0; ip < text.fileSize; ip += 4) {
+      DecodedInstr instr = new DecodedInstr(ip, image.text[ip ~/ 4]);
+      int position = 8 + ip * 2;
+      expect(section.sublist(position, position + 4), [instr.op.index, instr.rd, instr.rs, instr.rt]);
+      expect(readWord(section, position + 4), instr.immed);
+    }
+  });
+
+  test("is left out unless asked for", () {
+    expect(new LefImage(assemble(sum)).section(SHT_DECODED), isNull);
+  });
+
+  test("runs in the VM, which refuses records no handler could run", () {
+    Uint8List bytes = assemble(sum, predecode: true);
+    expect(run(bytes), "26\n4660");
+
+    // Name a register past the last one in the first record, then reseal the file so only the section is wrong
+    int position = readWord(bytes, 20);
+    while (readHalf(bytes, position + 2) != SHT_DECODED) {
+      position += 12;
+    }
+    bytes[readWord(bytes, position + 4) + 8 + 1] = 32;
+    bytes.setAll(24, [0, 0, 0, 0]);
+    int checksum = fnv1a(bytes);
+    bytes.setAll(24, [checksum >> 24, (checksum >> 16) & 0xFF, (checksum >> 8) & 0xFF, checksum & 0xFF]);
+
+    ProcessResult result = execute(bytes);
+    expect(result.exitCode, isNot(0));
+    expect(result.stderr, contains("is invalid"));
+  }, skip: needsVM);
+}
@@ -0,0 +1,86 @@
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import '../src/linker.dart';
+import '../src/object.dart';
+import 'common.dart';
+
+ObjectFile module(String source, {bool littleEndian = false}) {
+  return (new Assembler(parse(source))..littleEndian = littleEndian).assembleObject();
+}
+
+// Data of a program made of the one directive
+List<int> dataOf(String directive, bool littleEndian) {
+  String source = ".data\nvalue: $directive\n.text\nmain:\n    syscall\n";
+  return new LefImage(assemble(source, littleEndian: littleEndian)).data;
+}
+
+void main() {
+  // The byte load sees the low byte first on a little-endian guest, whole words read the same either way
+  String source = """
+.data
+value: .word 0x01020304
+pair: .half 0x0506
+.text
+main:
+    lb \$a0, value
+    addi \$v0, \$zero, 1
+    syscall
+    lw \$a0, value
+    syscall
+    lh \$a0, pair
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+  group("little-endian images", () {
+    test("are flagged in the header", () {
+      expect(new LefImage(assemble(source)).flags, 0);
+      expect(new LefImage(assemble(source, littleEndian: true)).flags, 0x0001);
+    });
+
+    test("store instructions low byte first", () {
+      LefImage big = new LefImage(assemble(source));
+      LefImage little = new LefImage(assemble(source, littleEndian: true));
+      int text = little.segments.firstWhere((segment) => segment.address == 0x2000).offset;
+
+      expect(little.text, big.text);
+      expect(little.bytes.sublist(text, text + 4), big.bytes.sublist(text, text + 4).reversed.toList());
+    });
+
+    test("store data directives in the order of the guest", () {
+      expect(dataOf(".word 0x11223344", true).sublist(0, 4), [0x44, 0x33, 0x22, 0x11]);
+      expect(dataOf(".half 0x1234, 0x5678", true).sublist(0, 4), [0x34, 0x12, 0x78, 0x56]);
+      expect(dataOf(".half 0x1234, 0x5678", false).sublist(0, 4), [0x12, 0x34, 0x56, 0x78]);
+      expect(dataOf(".byte 1, 2, 3, 4", true).sublist(0, 4), [1, 2, 3, 4]);
+
+      Uint8List bits = new Uint8List(8);
+      new ByteData.view(bits.buffer).setFloat64(0, 1.5, Endian.little);
+      expect(dataOf(".double 1.5", true).sublist(0, 8), bits);
+      new ByteData.view(bits.buffer).setFloat64(0, 1.5, Endian.big);
+      expect(dataOf(".double 1.5", false).sublist(0, 8), bits);
+    });
+
+    test("are linked from little-endian objects", () {
+      String caller = ".data\ncount: .word 7\n.text\nmain:\n    jal helper\n    lw \$a0, count\n";
+      String callee = ".globl helper\n.text\nhelper:\n    jr \$ra\n";
+      ObjectFile object = module(caller, littleEndian: true);
+
+      expect(object.data, [0x07, 0x00, 0x00, 0x00]);
+      expect(object.text.sublist(0, 4), [0x00, 0x00, 0x00, 0x0C]);
+
+      LefImage image = new LefImage(new Linker([object, module(callee, littleEndian: true)]).link());
+      expect(image.littleEndian, isTrue);
+      expect(image.text.sublist(0, 4), [0x0C000004, 0x3C010008, 0x34210000, 0x8C240000]);
+    });
+
+    test("run in the VM", () {
+      expect(run(assemble(source)), "1169090601286");
+      expect(run(assemble(source, littleEndian: true)), "4169090601286");
+      expect(run(assemble(source, littleEndian: true, optimize: true, predecode: true)), "4169090601286");
+    }, skip: needsVM);
+  });
+}
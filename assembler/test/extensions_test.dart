@@ -0,0 +1,64 @@
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import 'common.dart';
+
+List<int> words(String instructions) {
+  return new LefImage(assemble("main:\n$instructions")).text;
+}
+
+void main() {
+  test("encodes conditional moves and the multiply into a register", () {
+    expect(words("    movz \$t0, \$t1, \$t2\n    movn \$t0, \$t1, \$t2\n    mul \$t0, \$t1, \$t2\n"),
+        [0x012A400A, 0x012A400B, 0x712A4002]);
+    expect(words("    mul \$t0, \$t1, 3\n"), [0x34010003, 0x71214002]);
+  });
+
+  test("encodes bit counts with the destination in rd and rt", () {
+    expect(words("    clz \$t0, \$t1\n    clo \$t0, \$t1\n"), [0x71284020, 0x71284021]);
+  });
+
+  test("encodes sign extensions and bit fields", () {
+    expect(words("    seb \$t0, \$t1\n    seh \$t0, \$t1\n"), [0x7C094420, 0x7C094620]);
+    expect(words("    ext \$t0, \$t1, 4, 8\n    ins \$t0, \$t1, 4, 8\n    ext \$t3, \$t1, 2, 16\n"),
+        [0x7D283900, 0x7D285904, 0x7D2B7880]);
+  });
+
+  test("reports bit fields that do not fit in a register", () {
+    expect(() => words("    ext \$t0, \$t1, 30, 4\n"), throwsA(new TypeMatcher<AssemblerError>()));
+    expect(() => words("    ins \$t0, \$t1, 4, 0\n"), throwsA(new TypeMatcher<AssemblerError>()));
+    expect(() => words("    ins \$t0, \$t1, 32, 1\n"), throwsA(new TypeMatcher<AssemblerError>()));
+  });
+
+  // Prints 86, 128, -1, 3, 28, 765 then 305419896
+  test("runs in the VM", () {
+    String source = """
+main:
+    li \$t1, 0x12345678
+    addi \$t2, \$zero, 0xFF
+    addi \$t3, \$zero, -16
+    addi \$v0, \$zero, 1
+    ext \$a0, \$t1, 8, 8
+    syscall
+    move \$a0, \$zero
+    ins \$a0, \$t1, 4, 4
+    syscall
+    seb \$a0, \$t2
+    syscall
+    clz \$a0, \$t1
+    syscall
+    clo \$a0, \$t3
+    syscall
+    mul \$a0, \$t2, 3
+    syscall
+    movz \$a0, \$t1, \$zero
+    movn \$a0, \$t2, \$zero
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+    expect(run(assemble(source)), "86128-1328765305419896");
+    expect(run(assemble(source, optimize: true, predecode: true)), "86128-1328765305419896");
+  }, skip: needsVM);
+}
@@ -0,0 +1,107 @@
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import 'common.dart';
+
+List<int> words(String instructions) {
+  return new LefImage(assemble("main:\n$instructions")).text;
+}
+
+void main() {
+  test("encodes arithmetic with fd, fs and ft in their CP1 fields", () {
+    expect(words("""
+    add.s \$f0, \$f1, \$f2
+    sub.d \$f0, \$f2, \$f4
+    mul.s \$f3, \$f1, \$f2
+    div.d \$f6, \$f2, \$f4
+    sqrt.d \$f0, \$f2
+    abs.s \$f1, \$f3
+    mov.d \$f2, \$f4
+    neg.s \$f1, \$f1
+"""), [0x46020800, 0x46241001, 0x460208C2, 0x46241183, 0x46201004, 0x46001845, 0x46202086, 0x46000847]);
+  });
+
+  test("encodes compares on condition code 0", () {
+    expect(words("    c.eq.s \$f1, \$f2\n    c.lt.d \$f2, \$f4\n    c.le.s \$f1, \$f2\n"),
+        [0x46020832, 0x4624103C, 0x4602083E]);
+  });
+
+  test("encodes conversions in the format of their source", () {
+    expect(words("""
+    cvt.s.d \$f0, \$f2
+    cvt.s.w \$f0, \$f1
+    cvt.d.s \$f2, \$f1
+    cvt.d.w \$f2, \$f1
+    cvt.w.s \$f0, \$f1
+    cvt.w.d \$f0, \$f2
+    trunc.w.s \$f0, \$f1
+    trunc.w.d \$f0, \$f2
+"""), [0x46201020, 0x46800820, 0x460008A1, 0x468008A1, 0x46000824, 0x46201024, 0x4600080D, 0x4620100D]);
+  });
+
+  test("encodes moves, loads, stores and branches", () {
+    expect(words("    mfc1 \$t0, \$f1\n    mtc1 \$t0, \$f1\n"), [0x44080800, 0x44880800]);
+    expect(words("""
+    lwc1 \$f1, 4(\$t1)
+    ldc1 \$f2, 8(\$t1)
+    swc1 \$f1, 4(\$t1)
+    sdc1 \$f2, 8(\$t1)
+"""), [0xC5210004, 0xD5220008, 0xE5210004, 0xF5220008]);
+    expect(words("    bc1t done\n    bc1f done\n    syscall\ndone:\n    syscall\n"),
+        [0x45010003, 0x45000002, 0x0000000C, 0x0000000C]);
+  });
+
+  test("reports doubles in odd registers", () {
+    for (String instruction in [
+      "add.d \$f0, \$f1, \$f2",
+      "mov.d \$f1, \$f2",
+      "cvt.d.s \$f1, \$f0",
+      "cvt.s.d \$f0, \$f3",
+      "c.eq.d \$f2, \$f5",
+      "ldc1 \$f1, 0(\$t0)"
+    ]) {
+      expect(() => words("    $instruction\n"), throwsA(new TypeMatcher<AssemblerError>()), reason: instruction);
+    }
+  });
+
+  test("stores floating-point data with the high word of doubles first", () {
+    String source = ".data\nsingle: .float 1.5\nquarter: .double 0.25\n.text\nmain:\n    syscall\n";
+    List<int> data = new LefImage(assemble(source)).data;
+    expect(readWord(data, 0), 0x3FC00000);
+    expect([readWord(data, 8), readWord(data, 12)], [0x3FD00000, 0x00000000]);
+  });
+
+  // Prints 3, then 0.375 and the 1 truncated from 1.5 once the compare took the branch
+  test("runs in the VM", () {
+    String source = """
+.data
+single: .float 1.5
+quarter: .double 0.25
+.text
+main:
+    lwc1 \$f0, single
+    add.s \$f12, \$f0, \$f0
+    addi \$v0, \$zero, 2
+    syscall
+    ldc1 \$f2, quarter
+    cvt.d.s \$f4, \$f0
+    mul.d \$f12, \$f2, \$f4
+    addi \$v0, \$zero, 3
+    syscall
+    c.lt.d \$f2, \$f4
+    bc1t less
+    addi \$v0, \$zero, 10
+    syscall
+less:
+    trunc.w.s \$f6, \$f0
+    mfc1 \$a0, \$f6
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+    expect(run(assemble(source)), "30.3751");
+    expect(run(assemble(source, littleEndian: true, predecode: true)), "30.3751");
+  }, skip: needsVM);
+}
@@ -0,0 +1,170 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import 'common.dart';
+
+const int SHT_SYMTAB = 0x08;
+const int SHT_LINES = 0x10;
+
+// "name segment address" for every entry of a symbol table
+List<String> symbols(Uint8List table) {
+  List<String> entries = [];
+  for (int i = 0; i < table.length;) {
+    int length = table[i + 5];
+    entries.add("${String.fromCharCodes(table.sublist(i + 6, i + 6 + length))} ${table[i + 4]} ${readWord(table, i)}");
+    i += 6 + length;
+  }
+
+  return entries;
+}
+
+int fnv1a(List<int> bytes) {
+  int hash = 0x811C9DC5;
+  for (int byte in bytes) {
+    hash = ((hash ^ byte) * 0x01000193) & 0xFFFFFFFF;
+  }
+
+  return hash;
+}
+
+List<int> words(Uint8List table) {
+  return new List<int>.generate(table.length ~/ 4, (i) => readWord(table, i * 4));
+}
+
+void main() {
+  group("debug sections", () {
+    String source = """
+.data
+msg: .asciiz "hi"
+.text
+main:
+    addi \$t0, \$zero, 1
+    li \$t1, 2
+
+loop:
+    j loop
+""";
+
+    test("list every label with its segment and offset", () {
+      LefImage image = new LefImage(assemble(source));
+      expect(symbols(image.section(SHT_SYMTAB)), ["msg 1 0", "main 0 0", "loop 0 12"]);
+    });
+
+    test("map the first word of every line to it", () {
+      LefImage image = new LefImage(assemble(source));
+      expect(words(image.section(SHT_LINES)), [0, 5, 4, 6, 12, 9]);
+    });
+
+    test("leave out the lines -O removed", () {
+      String moves = "main:\n    move \$t0, \$t0\n    addi \$t0, \$zero, 1\n";
+      expect(words(new LefImage(assemble(moves)).section(SHT_LINES)), [0, 2, 4, 3]);
+      expect(words(new LefImage(assemble(moves, optimize: true)).section(SHT_LINES)), [0, 3]);
+    });
+
+    test("name labels and lines in the VM disassembly", () {
+      String listing = run(assemble(source), options: ["--disasm"]);
+      expect(listing, contains("main:\n"));
+      expect(listing, contains("loop:\n"));
+      expect(listing, contains("# line 9"));
+    }, skip: needsVM);
+  });
+
+  group("zero data", () {
+    String source = """
+.data
+head: .word 1
+gap: .space 0x2000
+tail: .word 2
+zeros: .space 64
+.text
+main:
+    lw \$a0, tail
+    addi \$v0, \$zero, 1
+    syscall
+    la \$t0, gap
+    lw \$a0, 0x1000(\$t0)
+    syscall
+    lw \$a0, zeros
+    syscall
+    lw \$a0, head
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+    test("is not stored when it spans a page or ends the data", () {
+      LefImage image = new LefImage(assemble(source));
+      List<LoadSegment> data = image.segments.where((segment) => segment.address >= 0x080000).toList();
+
+      expect(data.map((segment) => [segment.flags, segment.address, segment.fileSize, segment.memSize]), [
+        [0x06, 0x080000, 4, 0x2007],
+        [0x06, 0x082007, 1, 65]
+      ]);
+      for (LoadSegment segment in data) {
+        expect(segment.offset % 0x1000, segment.address % 0x1000);
+      }
+      expect(image.bytes.length, lessThan(0x3000));
+    });
+
+    test("reads back as the data it replaces", () {
+      Uint8List memory = new LefImage(assemble(source)).data;
+      expect(memory.length, 0x2048);
+      expect(readWord(memory, 0), 1);
+      expect(readWord(memory, 0x2004), 2);
+      expect(memory.where((byte) => byte != 0).length, 2);
+    });
+
+    test("is zero-filled by the VM", () {
+      expect(run(assemble(source)), "2001");
+    }, skip: needsVM);
+  });
+  group("LEF v2", () {
+    String source = """
+start:
+    addi \$t0, \$zero, 1
+main:
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+    test("header describes the entry point and the tables", () {
+      LefImage image = new LefImage(assemble(source));
+      expect(image.bytes.sublist(0, 4), [0x10, 0x4C, 0x45, 0x46]);
+      expect([image.major, image.minor, image.flags], [2, 0, 0]);
+      expect(image.entry, 0x2004);
+      expect(readWord(image.bytes, 12) % 4, 0);
+      expect(readHalf(image.bytes, 18), 2);
+    });
+
+    test("text is a read-only segment on its own page", () {
+      List<LoadSegment> segments = new LefImage(assemble(source)).segments;
+      expect(segments.length, 1);
+      expect([segments[0].type, segments[0].flags, segments[0].offset, segments[0].address],
+          [0x01, 0x05, 0x1000, 0x2000]);
+      expect([segments[0].fileSize, segments[0].memSize], [12, 12]);
+    });
+
+    test("checksum covers the whole file", () {
+      Uint8List bytes = assemble(source);
+      Uint8List zeroed = new Uint8List.fromList(bytes)..setAll(24, [0, 0, 0, 0]);
+      expect(new LefImage(bytes).checksum, fnv1a(zeroed));
+    });
+
+    test("needs the entry point", () {
+      expect(() => assemble("start:\n    syscall\n"), throwsA(new TypeMatcher<AssemblerError>()));
+    });
+
+    test("is loaded by the VM, and refused once corrupted", () {
+      Uint8List bytes = assemble(source);
+      expect(run(bytes), "");
+
+      bytes[0x1000] ^= 0x01;
+      ProcessResult result = execute(bytes);
+      expect(result.exitCode, isNot(0));
+      expect(result.stderr, contains("checksum mismatch"));
+    }, skip: needsVM);
+  });
+}
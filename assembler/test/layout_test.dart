@@ -0,0 +1,84 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import '../src/layout.dart';
+import 'common.dart';
+
+Uint8List assembleWith(String source, String profile) {
+  Assembler assembler = new Assembler(parse(source), profile: BlockProfile.parse(profile));
+  Uint8List image = assembler.assemble();
+  return image.sublist(0, assembler.offset);
+}
+
+void main() {
+  // The exit path runs once, the loop body a hundred times
+  String source = """
+main:
+    addi \$t0, \$zero, 100
+loop:
+    bne \$t0, \$zero, hot
+    addi \$a0, \$t0, 7
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+hot:
+    addi \$t0, \$t0, -1
+    j loop
+""";
+
+  String profile = """
+# lmips block profile: text offset, executions, taken transfers
+0 1 0
+4 101 100
+8 1 0
+12 1 0
+16 1 0
+20 1 0
+24 1 0
+28 100 0
+32 100 100
+""";
+
+  // Cold code sinks after the loop, the branch is inverted towards it and it jumps back to the loop body
+  List<int> laidOut = [
+    0x20080064, 0x11000003, 0x2108FFFF, 0x08000001,
+    0x21040007, 0x20020001, 0x0000000C, 0x2002000A, 0x0000000C, 0x08000002
+  ];
+
+  test("places the hot path first", () {
+    expect(new LefImage(assemble(source)).text.sublist(0, 2), [0x20080064, 0x15000006]);
+    expect(new LefImage(assembleWith(source, profile)).text, laidOut);
+  });
+
+  test("keeps labels it adds out of the symbol table", () {
+    String symbols = String.fromCharCodes(new LefImage(assembleWith(source, profile)).section(0x08));
+    expect(symbols, contains("hot"));
+    expect(symbols, isNot(contains("__layout_")));
+  });
+
+  test("refuses profiles of another program", () {
+    expect(() => BlockProfile.parse("4 1"), throwsFormatException);
+    expect(() => BlockProfile.parse("6 1 0"), throwsFormatException);
+    expect(() => assembleWith(source, "64 1 0"), throwsA(new TypeMatcher<AssemblerError>()));
+  });
+
+  test("lays programs out from the profile the VM writes", () {
+    Directory directory = Directory.systemTemp.createTempSync("lasm_layout");
+    try {
+      File program = new File("${directory.path}/program.bin")..writeAsBytesSync(assemble(source));
+      String path = "${directory.path}/profile";
+      ProcessResult result = Process.runSync("../bin/lmips_prof", ["--profile-out", path, program.path]);
+      expect(result.exitCode, 0, reason: result.stderr);
+
+      Uint8List image = assembleWith(source, new File(path).readAsStringSync());
+      expect(new LefImage(image).text, laidOut);
+      expect(run(image), "7");
+    } finally {
+      directory.deleteSync(recursive: true);
+    }
+  }, skip: new File("../bin/lmips_prof").existsSync() ? false : "lmips_prof is not built");
+}
@@ -0,0 +1,177 @@
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import '../src/cache.dart';
+import '../src/linker.dart';
+import '../src/object.dart';
+import 'common.dart';
+
+ObjectFile module(String source, {bool optimize = false, bool littleEndian = false}) {
+  return (new Assembler(parse(source), optimize: optimize)..littleEndian = littleEndian).assembleObject();
+}
+
+Uint8List link(List<ObjectFile> objects) {
+  return new Linker(objects).link();
+}
+
+void main() {
+  String caller = """
+.globl count
+.data
+count: .word 3
+.text
+main:
+    jal helper
+    lw \$a0, count
+    addi \$v0, \$zero, 1
+    syscall
+back:
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+  String callee = """
+.globl helper
+.text
+helper:
+    lw \$t0, count
+    addi \$t0, \$t0, 4
+    sw \$t0, count
+back:
+    jr \$ra
+""";
+
+  group("objects", () {
+    test("leave label references to the linker", () {
+      ObjectFile object = module(caller);
+
+      expect(object.symbols.map((symbol) => "${symbol.name} ${symbol.defined} ${symbol.global}"),
+          ["count true true", "main true true", "back true false", "helper false true"]);
+      expect(object.relocations.map((relocation) => [relocation.offset, relocation.type, relocation.symbol]), [
+        [0, RelocationType.R_JUMP26, 3],
+        [4, RelocationType.R_HILO, 0]
+      ]);
+      expect(object.text.sublist(0, 4), [0x0C, 0x00, 0x00, 0x00]);
+      expect(object.data, [0x00, 0x00, 0x00, 0x03]);
+      expect(object.lines, [0, 6, 4, 7, 16, 8, 20, 9, 24, 11, 28, 12]);
+    });
+
+    test("read back as they were written", () {
+      ObjectFile object = module(caller, littleEndian: true);
+      ObjectFile read = ObjectFile.read(object.write());
+
+      expect(read.entryPoint, "main");
+      expect(read.littleEndian, isTrue);
+      expect(read.text, object.text);
+      expect(read.data, object.data);
+      expect(read.lines, object.lines);
+      for (int i = 0; i < object.symbols.length; i++) {
+        ObjectSymbol symbol = read.symbols[i];
+        expect([symbol.name, symbol.segment, symbol.address, symbol.defined, symbol.global], [
+          object.symbols[i].name,
+          object.symbols[i].segment,
+          object.symbols[i].address,
+          object.symbols[i].defined,
+          object.symbols[i].global
+        ]);
+      }
+      for (int i = 0; i < object.relocations.length; i++) {
+        Relocation relocation = read.relocations[i];
+        expect([relocation.offset, relocation.type, relocation.symbol],
+            [object.relocations[i].offset, object.relocations[i].type, object.relocations[i].symbol]);
+      }
+    });
+
+    test("are refused when damaged", () {
+      Uint8List bytes = module(caller).write();
+      expect(() => ObjectFile.read(bytes.sublist(0, bytes.length - 1)), throwsFormatException);
+      expect(() => ObjectFile.read(new Uint8List.fromList(bytes)..[1] = 0x58), throwsFormatException);
+      expect(() => ObjectFile.read(new Uint8List.fromList(bytes)..[4] = ObjectFile.VERSION + 1), throwsFormatException);
+    });
+
+    test("use sign-adjusted relocations for optimized loads", () {
+      ObjectFile object = module(caller, optimize: true);
+      expect(object.relocations[1].type, RelocationType.R_HALO);
+    });
+  });
+
+  group("linker", () {
+    test("lays modules out in order and patches references between them", () {
+      LefImage image = new LefImage(link([module(caller), module(callee)]));
+
+      expect(image.entry, 0x2000);
+      expect(image.text, [
+        0x0C000008, 0x3C010008, 0x34210000, 0x8C240000, 0x20020001, 0x0000000C, 0x2002000A, 0x0000000C,
+        0x3C010008, 0x34210000, 0x8C280000, 0x21080004, 0x3C010008, 0x34210000, 0xA8280000, 0x03E00008
+      ]);
+      expect(image.data, [0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00]);
+    });
+
+    test("rounds the upper half of addresses loads add a negative offset to", () {
+      String far = """
+.data
+pad: .space 0x8000
+value: .word 5
+.text
+main:
+    lw \$a0, value
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+      Uint8List image = link([module(far, optimize: true)]);
+      expect(new LefImage(image).text.sublist(0, 2), [0x3C010009, 0x8C248000]);
+    });
+
+    test("reports symbols defined twice, missing ones and mixed byte orders", () {
+      expect(() => link([module(caller), module(caller)]), throwsA(new TypeMatcher<LinkerError>()));
+      expect(() => link([module(caller)]), throwsA(new TypeMatcher<LinkerError>()));
+      expect(() => link([module(caller), module(callee, littleEndian: true)]), throwsA(new TypeMatcher<LinkerError>()));
+    });
+
+    test("links programs the VM runs", () {
+      expect(run(link([module(caller), module(callee)])), "7");
+      expect(run(link([module(caller, optimize: true), module(callee, optimize: true)])), "7");
+    }, skip: needsVM);
+  });
+
+  group("object cache", () {
+    Directory directory;
+
+    setUp(() {
+      directory = Directory.systemTemp.createTempSync("lasm_cache");
+    });
+
+    tearDown(() {
+      directory.deleteSync(recursive: true);
+    });
+
+    test("keys objects by source and options", () {
+      ObjectCache cache = new ObjectCache(directory.path);
+      String key = cache.key(caller, false, false);
+
+      expect(key.length, 16);
+      expect(cache.key(caller, false, false), key);
+      expect(cache.key(callee, false, false), isNot(key));
+      expect(cache.key(caller, true, false), isNot(key));
+      expect(cache.key(caller, false, true), isNot(key));
+    });
+
+    test("returns what was stored and nothing for damaged entries", () {
+      ObjectCache cache = new ObjectCache("${directory.path}/nested");
+      String key = cache.key(caller, false, false);
+      expect(cache.lookup(key), isNull);
+
+      cache.store(key, module(caller));
+      expect(cache.lookup(key).text, module(caller).text);
+
+      new File("${directory.path}/nested/$key.lo").writeAsBytesSync([0x10, 0x4C]);
+      expect(cache.lookup(key), isNull);
+    });
+  });
+}
@@ -0,0 +1,85 @@
+import 'package:test/test.dart';
+
+import 'common.dart';
+
+void main() {
+  group("-O", () {
+    test("loads constants with the shortest sequence", () {
+      String source = """
+main:
+    li \$t0, 5
+    li \$t0, -1
+    li \$t0, 0xFFFF
+    li \$t0, 0x10000
+    li \$t0, 0x12345678
+""";
+
+      expect(new LefImage(assemble(source, optimize: true)).text,
+          [0x24080005, 0x2408FFFF, 0x3408FFFF, 0x3C080001, 0x3C081234, 0x35085678]);
+      expect(new LefImage(assemble(source)).text.take(2), [0x3C010000, 0x34280005]);
+      expect(new LefImage(assemble(source)).text.length, 10);
+    });
+
+    test("drops no-ops, repeated moves and jumps to the next instruction", () {
+      String source = """
+main:
+    move \$t0, \$t0
+    addi \$t1, \$t1, 0
+    add \$t2, \$t2, \$zero
+    move \$t3, \$t4
+    move \$t4, \$t3
+    j next
+next:
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+      expect(new LefImage(assemble(source, optimize: true)).text, [0x000C5820, 0x2002000A, 0x0000000C]);
+      expect(new LefImage(assemble(source)).text.length, 8);
+    });
+
+    test("keeps instructions another path reaches", () {
+      String source = """
+main:
+    move \$t3, \$t4
+again:
+    move \$t4, \$t3
+    j again
+""";
+
+      expect(new LefImage(assemble(source, optimize: true)).text, [0x000C5820, 0x000B6020, 0x08000001]);
+    });
+
+    test("uses immediate forms for small constants", () {
+      String source = """
+main:
+    add \$t0, \$t1, 5
+    sub \$t0, \$t1, 5
+    and \$t0, \$t1, 0xFF00
+    add \$t0, \$t1, 0x8000
+""";
+
+      expect(new LefImage(assemble(source, optimize: true)).text,
+          [0x21280005, 0x2128FFFB, 0x3128FF00, 0x34018000, 0x01214020]);
+      expect(new LefImage(assemble(source)).text.take(2), [0x34010005, 0x01214020]);
+    });
+
+    test("folds the lower half of label addresses into loads", () {
+      String source = """
+.data
+pad: .space 0x8000
+value: .word 7
+.text
+main:
+    lw \$t0, pad
+    lw \$t0, value
+    la \$a0, pad
+    la \$a0, value
+""";
+
+      expect(new LefImage(assemble(source, optimize: true)).text,
+          [0x3C010008, 0x8C280000, 0x3C010009, 0x8C288000, 0x3C040008, 0x3C040008, 0x34848000]);
+      expect(new LefImage(assemble(source)).text.sublist(3, 6), [0x3C010008, 0x34218000, 0x8C280000]);
+    });
+  });
+}
@@ -0,0 +1,45 @@
+import 'package:test/test.dart';
+
+import 'common.dart';
+
+// Assembles programs and checks what they print when lmips runs them
+void main() {
+  String sum = """
+.data
+newline: .asciiz "\\n"
+table: .word 3, 5, 7, 11
+
+.text
+main:
+    la \$s0, table
+    addi \$s1, \$zero, 4
+    move \$s2, \$zero
+loop:
+    lw \$t0, 0(\$s0)
+    add \$s2, \$s2, \$t0
+    add \$s2, \$s2, \$zero
+    addi \$s0, \$s0, 4
+    addi \$s1, \$s1, -1
+    bgtz \$s1, loop
+    move \$a0, \$s2
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 4
+    la \$a0, newline
+    syscall
+    li \$t0, 0x12345678
+    srl \$a0, \$t0, 16
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+  test("runs the program it assembled", () {
+    expect(run(assemble(sum)), "26\n4660");
+  }, skip: needsVM);
+
+  test("runs the program it optimized", () {
+    expect(run(assemble(sum, optimize: true)), "26\n4660");
+  }, skip: needsVM);
+}
@@ -0,0 +1,62 @@
+import 'package:test/test.dart';
+
+import '../benchmark.dart' show synthesize;
+import '../src/lexer.dart';
+import '../src/parser.dart';
+import 'common.dart';
+
+// Microseconds to assemble the source, the best of a few runs
+int time(String source) {
+  int best;
+  for (int i = 0; i < 3; i++) {
+    Stopwatch watch = new Stopwatch()..start();
+    assemble(source);
+    if (best == null || watch.elapsedMicroseconds < best) best = watch.elapsedMicroseconds;
+  }
+
+  return best;
+}
+
+void main() {
+  test("parses tokens as they are scanned", () {
+    Lexer lexer = new Lexer(synthesize(1000, [0]));
+    Parser parser = new Parser(lexer);
+    parser.parse();
+
+    expect(parser.assembly.instructions, isNotEmpty);
+    expect(lexer.tokens, isEmpty);
+  });
+
+  test("reads negative hexadecimal constants and reports a lone minus", () {
+    expect(new LefImage(assemble("main:\n    li \$t0, -0x10\n", optimize: true)).text, [0x2408FFF0]);
+
+    Lexer lexer = new Lexer("main:\n    li \$t0, - 1\n");
+    new Parser(lexer).parse();
+    expect(lexer.hadError, isTrue);
+  });
+
+  test("grows the image past its first estimate", () {
+    String source = "main:\n" + "    blt \$t0, 5, main\n" * 2000;
+    LefImage image = new LefImage(assemble(source, predecode: true));
+
+    expect(image.text.length, 6000);
+    expect(image.section(0x40).length, 8 + 6000 * 8);
+  });
+
+  test("assembles the benchmark program", () {
+    List<int> count = [0];
+    String source = synthesize(5000, count);
+
+    expect(source.split("\n").length - 1, count[0]);
+    expect(new LefImage(assemble(source)).text, isNotEmpty);
+  });
+
+  // Generous bound, a pass quadratic in the source would take 64 times longer
+  test("takes time linear in the size of the source", () {
+    String small = synthesize(20000, [0]);
+    String large = synthesize(160000, [0]);
+
+    time(small);
+    expect(time(large), lessThan(time(small) * 8 * 3));
+  });
+}
@@ -0,0 +1,97 @@
+import 'package:test/test.dart';
+
+import '../src/assembler.dart';
+import '../src/lexer.dart';
+import '../src/parser.dart';
+import 'common.dart';
+
+List<int> words(String instructions) {
+  return new LefImage(assemble("main:\n$instructions")).text;
+}
+
+void main() {
+  test("encodes three-register operations with the operation above the lane size", () {
+    expect(words("""
+    addv.w \$w1, \$w2, \$w3
+    subv.b \$w1, \$w2, \$w3
+    max_u.h \$w1, \$w2, \$w3
+    min_s.w \$w1, \$w2, \$w3
+    ceq.b \$w1, \$w2, \$w3
+    clt_u.w \$w1, \$w2, \$w3
+    hadd_s.h \$w1, \$w2, \$w3
+    hadd_u.w \$w1, \$w2, \$w3
+"""), [0x7843104E, 0x7883104E, 0x79A3104E, 0x7A43104E, 0x7803104F, 0x79C3104F, 0x7A231055, 0x7AC31055]);
+  });
+
+  test("encodes shuffles, lane copies and fills", () {
+    expect(words("    shf.w \$w2, \$w1, 0x4E\n    shf.b \$w2, \$w1, 0x1B\n"), [0x7A4E0882, 0x781B0882]);
+    expect(words("""
+    copy_s.w \$t0, \$w1[2]
+    copy_s.h \$t0, \$w1[7]
+    copy_u.b \$t0, \$w1[15]
+    copy_u.h \$t0, \$w1[3]
+"""), [0x78B20A19, 0x78A70A19, 0x78CF0A19, 0x78E30A19]);
+    expect(words("    fill.h \$w1, \$t0\n    fill.w \$w1, \$t0\n"), [0x7B01405E, 0x7B02405E]);
+  });
+
+  test("encodes load and store offsets in lanes", () {
+    expect(words("""
+    ld.w \$w1, -8(\$t0)
+    st.b \$w1, 3(\$t0)
+    ld.h \$w1, 6(\$t0)
+    st.w \$w1, 2044(\$t0)
+    ld.b \$w1, -512(\$t0)
+"""), [0x7BFE4062, 0x78034064, 0x78034061, 0x79FF4066, 0x7A004060]);
+  });
+
+  test("reports lanes, selectors and offsets out of range", () {
+    for (String instruction in [
+      "copy_s.w \$t0, \$w1[4]",
+      "copy_u.b \$t0, \$w1[16]",
+      "shf.b \$w2, \$w1, 256",
+      "ld.w \$w1, 6(\$t0)",
+      "ld.w \$w1, 2048(\$t0)",
+      "st.b \$w1, 512(\$t0)"
+    ]) {
+      expect(() => words("    $instruction\n"), throwsA(new TypeMatcher<AssemblerError>()), reason: instruction);
+    }
+  });
+
+  test("has no unsigned copy of whole words", () {
+    Lexer lexer = new Lexer("main:\n    copy_u.w \$t0, \$w1[0]\n");
+    Parser parser = new Parser(lexer);
+    parser.parse();
+    expect(lexer.hadError || parser.hadError, isTrue);
+  });
+
+  // Prints 8, the last word doubled and shuffled into lane 0, then 255, -1 and 6
+  test("runs in the VM", () {
+    String source = """
+.data
+vector: .word 1, 2, 3, 4
+.text
+main:
+    la \$t0, vector
+    ld.w \$w1, 0(\$t0)
+    addv.w \$w2, \$w1, \$w1
+    shf.w \$w3, \$w2, 0x1B
+    copy_s.w \$a0, \$w3[0]
+    addi \$v0, \$zero, 1
+    syscall
+    addi \$t1, \$zero, -1
+    fill.b \$w4, \$t1
+    copy_u.b \$a0, \$w4[5]
+    syscall
+    copy_s.h \$a0, \$w4[2]
+    syscall
+    st.w \$w3, 0(\$t0)
+    lw \$a0, 4(\$t0)
+    syscall
+    addi \$v0, \$zero, 10
+    syscall
+""";
+
+    expect(run(assemble(source)), "8255-16");
+    expect(run(assemble(source, littleEndian: true, predecode: true)), "8255-16");
+  }, skip: needsVM);
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lmips.h"
+#include "lmips_opcodes.h"
+
+// Times a guest writing short messages through one syscall each against the same guest queuing
+// them on a ring and entering it once per batch.
+// Usage : lmips_bench [writes [batch]]
+
+#define MESSAGE "message\n"
+#define MESSAGE_ADDRESS DATA_ADDRESS
+#define RING_ADDRESS (DATA_ADDRESS + 0x1000)
+#define RING_ENTRIES 256
+
+#define I_TYPE(op, rs, rt, immed) ((uint32_t)(op) << 26 | (rs) << 21 | (rt) << 16 | ((immed) & 0xFFFF))
+#define R_TYPE(funct, rs, rt, rd, shift) ((rs) << 21 | (rt) << 16 | (rd) << 11 | (shift) << 6 | (funct))
+
+static void loadProgram(Memory* memory, const uint32_t* program, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        mem_write(memory, PROGRAM_ADDRESS + i * 4, program[i]);
+    }
+}
+
+static double runTimed(LMips* mips, const char* name) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ExecutionResult result = runSimulator(mips);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (result != EXEC_SUCCESS) {
+        fprintf(stderr, "The %s guest failed.\n", name);
+        exit(1);
+    }
+    return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static double runSyscalls(FILE* output, uint32_t writes) {
+    const uint32_t program[] = {
+        I_TYPE(OP_ADDI, $zero, $v0, SYS_PRINT_STRING), // loop:
+        SPE_SYSCALL,
+        I_TYPE(OP_ADDI, $t0, $t0, -1),
+        I_TYPE(OP_BNE, $t0, $zero, -3), // bne $t0, $zero, loop
+        I_TYPE(OP_ADDI, $zero, $v0, SYS_EXIT),
+        SPE_SYSCALL
+    };
+
+    Memory memory;
+    LMips mips;
+    initMemory(&memory);
+    loadProgram(&memory, program, sizeof(program) / sizeof(program[0]));
+    strcpy((char*)&memory.store[MESSAGE_ADDRESS], MESSAGE);
+    initSimulator(&mips, &memory);
+    mips.output = output;
+    mips.regs[$a0] = MESSAGE_ADDRESS;
+    mips.regs[$t0] = writes;
+
+    double elapsed = runTimed(&mips, "syscall");
+    freeSimulator(&mips);
+    freeMemory(&memory);
+    return elapsed;
+}
+
+static double runRing(FILE* output, uint32_t writes, uint32_t batch, RingStats* stats) {
+    // The SQ tail stays in $t2 and is published once per batch, as is $a0 pointing at the ring
+    const uint32_t program[] = {
+        I_TYPE(OP_ANDI, $t2, $t3, RING_ENTRIES - 1), // loop:
+        R_TYPE(SPE_SLL, $zero, $t3, $t3, 4),
+        R_TYPE(SPE_ADD, $t3, $s0, $t3, 0),
+        I_TYPE(OP_SW, $t3, $s3, RING_HEADER_SIZE), // op
+        I_TYPE(OP_SW, $t3, $s1, RING_HEADER_SIZE + 0x04), // address
+        I_TYPE(OP_SW, $t3, $s2, RING_HEADER_SIZE + 0x08), // length
+        I_TYPE(OP_ADDI, $t2, $t2, 1),
+        I_TYPE(OP_ADDI, $t1, $t1, -1),
+        I_TYPE(OP_BNE, $t1, $zero, 7), // bne $t1, $zero, next
+        I_TYPE(OP_SW, $s0, $t2, 0x08),
+        I_TYPE(OP_ADDI, $zero, $v0, SYS_RING_ENTER),
+        SPE_SYSCALL,
+        I_TYPE(OP_LW, $s0, $t4, 0x10), // Reap every completion
+        I_TYPE(OP_SW, $s0, $t4, 0x0C),
+        R_TYPE(SPE_ADD, $s4, $zero, $t1, 0),
+        I_TYPE(OP_ADDI, $t0, $t0, -1), // next:
+        I_TYPE(OP_BNE, $t0, $zero, -16), // bne $t0, $zero, loop
+        I_TYPE(OP_SW, $s0, $t2, 0x08),
+        I_TYPE(OP_ADDI, $zero, $v0, SYS_RING_ENTER),
+        SPE_SYSCALL,
+        I_TYPE(OP_ADDI, $zero, $v0, SYS_EXIT),
+        SPE_SYSCALL
+    };
+
+    Memory memory;
+    LMips mips;
+    initMemory(&memory);
+    loadProgram(&memory, program, sizeof(program) / sizeof(program[0]));
+    strcpy((char*)&memory.store[MESSAGE_ADDRESS], MESSAGE);
+    mem_write(&memory, RING_ADDRESS, RING_ENTRIES);
+    initSimulator(&mips, &memory);
+    mips.output = output;
+    mips.regs[$a0] = RING_ADDRESS;
+    mips.regs[$s0] = RING_ADDRESS;
+    mips.regs[$s1] = MESSAGE_ADDRESS;
+    mips.regs[$s2] = strlen(MESSAGE);
+    mips.regs[$s3] = RING_WRITE;
+    mips.regs[$s4] = batch;
+    mips.regs[$t0] = writes;
+    mips.regs[$t1] = batch;
+
+    double elapsed = runTimed(&mips, "ring");
+    *stats = mips.ring->stats;
+    freeSimulator(&mips);
+    freeMemory(&memory);
+    return elapsed;
+}
+
+int main(int argc, char const *argv[]) {
+    uint32_t writes = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+    uint32_t batch = argc > 2 ? strtoul(argv[2], NULL, 0) : 32;
+    if (writes == 0 || batch == 0 || batch > RING_ENTRIES || batch > INT16_MAX) {
+        printf("Usage : lmips_bench [writes [batch]], batch of 1 to %d\n", RING_ENTRIES);
+        return 1;
+    }
+
+    // Both guests must print the same thing before their timings mean anything
+    char* expected;
+    char* actual;
+    size_t expectedSize, actualSize;
+    RingStats stats;
+    FILE* out = open_memstream(&expected, &expectedSize);
+    runSyscalls(out, 100);
+    fclose(out);
+    out = open_memstream(&actual, &actualSize);
+    runRing(out, 100, batch, &stats);
+    fclose(out);
+    if (expectedSize != actualSize || memcmp(expected, actual, expectedSize) != 0) {
+        fprintf(stderr, "The ring guest printed something else than the syscall guest.\n");
+        return 1;
+    }
+    free(expected);
+    free(actual);
+
+    FILE* sink = fopen("/dev/null", "w");
+    double syscalls = runSyscalls(sink, writes);
+    double ring = runRing(sink, writes, batch, &stats);
+    fclose(sink);
+
+    printf("Ring benchmark (%u writes of %zu bytes)\n", writes, strlen(MESSAGE));
+    printf("  Syscall per write : %8.1f ns/write\n", syscalls / writes);
+    printf("  Ring, batch of %-3u: %8.1f ns/write (%llu enters, %llu flushes)\n", batch, ring / writes,
+           (unsigned long long)stats.enters, (unsigned long long)stats.flushes);
+    printf("  Speedup           : %8.2fx\n", syscalls / ring);
+
+    return 0;
+}
@@ -1,134 +1,528 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include "executable.h"
 #include "lmips.h"
+#include "sampling.h"
+#include "snapshot.h"
+#include "baseline.h"
+#include "fuzz.h"
+#include "annotate.h"
+#include "codecache.h"
+#include "channel.h"
 
-#define HEADER_SIZE (120 / 8)
+// Runs the loaded image once per input file, resetting the machine between runs instead of reloading it
+int runBatch(LMips* mips, const char** inputs, int count) {
+    Baseline baseline;
+    if (!saveBaseline(&baseline, mips)) {
+        printf("Unable to save machine state.\n");
+        exit(1);
+    }
 
-uint32_t read_word(FILE* file) {
-    uint32_t word;
-    fread(&word, sizeof(uint32_t), 1, file);
+    int status = 0;
+    for (int i = 0; i < count; ++i) {
+        if (freopen(inputs[i], "r", stdin) == NULL) {
+            printf("Unable to open input '%s'.\n", inputs[i]);
+            exit(1);
+        }
+
+        if (i > 0 && !resetToBaseline(&baseline, mips)) {
+            printf("Unable to reset machine state.\n");
+            exit(1);
+        }
+        if (runSimulator(mips) != EXEC_SUCCESS) status = 1;
+    }
 
-    return ((word & 0x000000FF) << 24) |
-        ((word & 0x0000FF00) << 8)  |
-        ((word & 0x00FF0000) >> 8) |
-        ((word & 0xFF000000) >> 24);
+    freeBaseline(&baseline);
+    return status;
 }
 
-uint16_t read_half(FILE* file) {
-    uint16_t half;
-    fread(&half, sizeof(uint16_t), 1, file);
+// Decodes the text of a loaded program unless its executable or the code cache already had it
+bool prepareDecodedText(CodeCache* codeCache, LMips* mips, DecodedText* decoded) {
+    uint32_t textSize = mips->textSize;
+    bool littleEndian = mips->memory->littleEndian;
+    if (decoded->count == 0 &&
+        (codeCache->directory == NULL || !lookupCodeCache(codeCache, mips->program, textSize, littleEndian, decoded))) {
+        if (!decodeText(decoded, mips->program, textSize, littleEndian)) return false;
+        if (codeCache->directory != NULL) storeCodeCache(codeCache, mips->program, textSize, littleEndian, decoded);
+    }
 
-    return (half >> 8) | (half << 8);
+    mips->decoded = decoded;
+    return true;
 }
 
-uint8_t read_byte(FILE* file) {
-    uint8_t byte;
-    fread(&byte, sizeof(uint8_t), 1, file);
+typedef struct {
+    Memory memory;
+    LMips mips;
+    DebugInfo debug;
+    DecodedText decoded;
+    pthread_t thread;
+    ExecutionResult result;
+} Stage;
+
+static void* runStage(void* argument) {
+    Stage* stage = argument;
+    stage->result = runSimulator(&stage->mips);
+
+    // Programs after this one see the end of their input, the ones before have their sends cut short
+    if (stage->mips.channelOut != NULL) closeChannelWriter(stage->mips.channelOut);
+    if (stage->mips.channelIn != NULL) closeChannelReader(stage->mips.channelIn);
+    return NULL;
+}
+
+// Runs the loaded image and the given programs side by side, each on its own thread, with what every
+// program sends going to the one after it
+int runPipe(LMips* mips, const char** files, int count, CodeCache* codeCache) {
+    Stage* stages = calloc(count + 1, sizeof(Stage));
+    Channel* channels = calloc(count, sizeof(Channel));
+    if (stages == NULL || channels == NULL) exit(1);
+
+    stages[0].mips = *mips;
+    for (int i = 1; i <= count; ++i) {
+        Stage* stage = &stages[i];
+        initMemory(&stage->memory);
+        initSimulator(&stage->mips, &stage->memory);
+        initDebugInfo(&stage->debug, files[i - 1]);
+        initDecodedText(&stage->decoded);
+        if (!loadExecutable(files[i - 1], &stage->memory, &stage->debug, &stage->decoded, &stage->mips.ip,
+                            &stage->mips.textSize)) {
+            exit(1);
+        }
+        if (!prepareDecodedText(codeCache, &stage->mips, &stage->decoded)) {
+            printf("Unable to allocate decoded text.\n");
+            exit(1);
+        }
+        if (stage->debug.symtabSize != 0 || stage->debug.linesSize != 0) stage->mips.debug = &stage->debug;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!initChannel(&channels[i], CHANNEL_CAPACITY)) {
+            printf("Unable to allocate channel.\n");
+            exit(1);
+        }
+        stages[i].mips.channelOut = &channels[i];
+        stages[i + 1].mips.channelIn = &channels[i];
+    }
+
+    for (int i = 0; i <= count; ++i) {
+        pthread_create(&stages[i].thread, NULL, runStage, &stages[i]);
+    }
+    int status = 0;
+    for (int i = 0; i <= count; ++i) {
+        pthread_join(stages[i].thread, NULL);
+        if (stages[i].result != EXEC_SUCCESS) status = 1;
+    }
 
-    return byte;
+    // The first program goes back to the caller, which still owns what it was loaded with
+    *mips = stages[0].mips;
+    mips->channelOut = NULL;
+    for (int i = 1; i <= count; ++i) {
+        freeSimulator(&stages[i].mips);
+        freeDebugInfo(&stages[i].debug);
+        freeDecodedText(&stages[i].decoded);
+        freeMemory(&stages[i].memory);
+    }
+    for (int i = 0; i < count; ++i) {
+        freeChannel(&channels[i]);
+    }
+    free(channels);
+    free(stages);
+    return status;
 }
 
-FileHeader getHeader(FILE* file, const char* fileName) {
-    FileHeader header;
-    char format[4] = {0x10, 'L', 'E', 'F'};
+#ifdef LMIPS_INSTRUMENT
+// Runs the program in persistent fuzzing mode, serving afl-fuzz when started by it and the given test cases otherwise
+int runFuzz(LMips* mips, Probes* probes, const char** inputs, int count, uint64_t limit) {
+    static const char* outcomes[] = {"ok", "crash", "timeout"};
 
-    fread(header.magic, sizeof(char), 4, file);
-    if (memcmp(header.magic, format, 4) != 0) {
-        printf("File '%s' is not a valid executable file.\n", fileName);
-        fclose(file);
+    FuzzSession session;
+    if (!startFuzzSession(&session, mips, limit)) {
+        printf("Unable to start fuzzing session.\n");
         exit(1);
     }
+    probes->coverage = &session.coverage;
+
+    if (runForkServer(&session, mips)) return 0;
 
-    header.major = read_byte(file);
-    header.minor = read_byte(file);
-    header.entry = read_word(file);
-    header.shAddress = read_word(file);
-    header.shCount = read_byte(file);
+    uint8_t* input = malloc(FUZZ_INPUT_MAX);
+    if (input == NULL) exit(1);
 
-    header.size = HEADER_SIZE;
+    int status = 0;
+    for (int i = 0; i < count || (count == 0 && i == 0); ++i) {
+        FILE* file = count == 0 ? stdin : fopen(inputs[i], "rb");
+        if (file == NULL) {
+            printf("Unable to open input '%s'.\n", inputs[i]);
+            exit(1);
+        }
+        size_t size = fread(input, sizeof(uint8_t), FUZZ_INPUT_MAX, file);
+        if (file != stdin) fclose(file);
+
+        FuzzOutcome outcome = fuzzOne(&session, mips, input, size);
+        fprintf(stderr, "%s : %s\n", count == 0 ? "stdin" : inputs[i], outcomes[outcome]);
+        if (outcome == FUZZ_CRASH) status = 1;
+    }
+    fprintf(stderr, "Edges covered : %u\n", coverageCount(&session.coverage));
+
+    free(input);
+    freeFuzzSession(&session);
+    return status;
+}
+#endif
 
-    return header;
+void usage() {
+    printf("Usage : lms [--record log | --replay log] [--snapshot path [--snapshot-at n]] [file | --restore path] [--batch input... | --pipe file...]\n");
+    printf("        lms --disasm file\n");
+    printf("  --code-cache dir        Keep decoded text in dir between runs\n");
+    printf("  --code-cache-size bytes Size the code cache is trimmed to, least recently used first\n");
+    printf("  --heap-stats            Report what the SYS_MALLOC heap allocator served\n");
+    printf("  --pipe file...          Run the given programs alongside, each receiving what the one before sends\n");
+#ifdef LMIPS_INSTRUMENT
+    printf("Profiling options :\n");
+    printf("  --cache                 Simulate the default cache hierarchy\n");
+    printf("  --l1i, --l1d, --l2 spec Cache level as size:assoc:line[:lru|fifo|random] ('none' disables L2)\n");
+    printf("  --cache-top n           Number of missing instructions to report\n");
+    printf("  --timing predictor      Model the 5-stage pipeline with a static, bimodal or gshare predictor\n");
+    printf("  --simpoint interval     Estimate CPI by timing only representative intervals of that many instructions\n");
+    printf("  --simpoint-k n          Maximum number of representative intervals\n");
+    printf("  --annotate              Disassemble the program with execution, miss and stall counts\n");
+    printf("  --profile-out path      Write the block profile used by lasm --profile for code layout\n");
+    printf("  --heatmap               Count data accesses per line and page, with a working-set curve\n");
+    printf("  --heatmap-interval n    Instructions per working-set sample\n");
+    printf("  --heatmap-top n         Number of hottest pages to report\n");
+    printf("  --fuzz [input...]       Persistent fuzzing from SYS_FUZZ_INPUT, under afl-fuzz or over the given inputs\n");
+    printf("  --fuzz-limit n          Instructions allowed per fuzzing test case\n");
+#endif
+    exit(1);
 }
 
 int main(int argc, char const *argv[]) {
-    if (argc < 2 || argc > 2) {
-        printf("Usage : lms [file]\n");
-        exit(1);
+    const char* fileName = NULL;
+    const char* logName = NULL;
+    ReplayMode logMode = REPLAY_RECORD;
+    const char* snapshotName = NULL;
+    const char* snapshotRestore = NULL;
+    uint64_t snapshotAt = 0;
+    const char** batch = NULL;
+    int batchCount = 0;
+    const char** stages = NULL;
+    int stageCount = 0;
+    bool disasm = false;
+    CodeCache codeCache = {NULL, CODE_CACHE_DEFAULT_LIMIT};
+    bool heapStats = false;
+#ifdef LMIPS_INSTRUMENT
+    Probes probes = {};
+    bool cacheEnabled = false, hasL2 = true;
+    int cacheTop = 10;
+    CacheConfig l1i = defaultCacheConfig(32 * 1024);
+    CacheConfig l1d = defaultCacheConfig(32 * 1024);
+    CacheConfig l2 = defaultCacheConfig(256 * 1024);
+    bool timingEnabled = false;
+    PredictorKind predictor = PREDICT_STATIC;
+    SamplingConfig sampling = {0, 8, PREDICT_STATIC};
+    bool annotate = false;
+    const char* profileName = NULL;
+    bool heatEnabled = false;
+    uint64_t heatInterval = 100000;
+    int heatTop = 10;
+    bool fuzzing = false;
+    uint64_t fuzzLimit = 10000000;
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 || strcmp(argv[i], "--replay") == 0) {
+            if (i + 1 >= argc || logName != NULL) usage();
+            logMode = strcmp(argv[i], "--record") == 0 ? REPLAY_RECORD : REPLAY_PLAY;
+            logName = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot") == 0) {
+            if (i + 1 >= argc) usage();
+            snapshotName = argv[++i];
+        } else if (strcmp(argv[i], "--snapshot-at") == 0) {
+            if (i + 1 >= argc) usage();
+            snapshotAt = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--restore") == 0) {
+            if (i + 1 >= argc) usage();
+            snapshotRestore = argv[++i];
+        } else if (strcmp(argv[i], "--disasm") == 0) {
+            disasm = true;
+        } else if (strcmp(argv[i], "--code-cache") == 0) {
+            if (i + 1 >= argc) usage();
+            codeCache.directory = argv[++i];
+        } else if (strcmp(argv[i], "--code-cache-size") == 0) {
+            if (i + 1 >= argc) usage();
+            codeCache.limit = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--heap-stats") == 0) {
+            heapStats = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            // Every remaining argument is an input file fed to its own run
+            batch = &argv[i + 1];
+            batchCount = argc - i - 1;
+            if (batchCount == 0) usage();
+            break;
+        } else if (strcmp(argv[i], "--pipe") == 0) {
+            // Every remaining argument is a program run on its own thread after the main one
+            stages = &argv[i + 1];
+            stageCount = argc - i - 1;
+            if (stageCount == 0) usage();
+            break;
+#ifdef LMIPS_INSTRUMENT
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            cacheEnabled = true;
+        } else if (strcmp(argv[i], "--l1i") == 0 || strcmp(argv[i], "--l1d") == 0 || strcmp(argv[i], "--l2") == 0) {
+            if (i + 1 >= argc) usage();
+            const char* spec = argv[i + 1];
+            CacheConfig* config = argv[i][4] == 'i' ? &l1i : (argv[i][4] == 'd' ? &l1d : &l2);
+            if (config == &l2 && strcmp(spec, "none") == 0) {
+                hasL2 = false;
+            } else if (!parseCacheConfig(spec, config)) {
+                printf("Invalid cache specification '%s'.\n", spec);
+                exit(1);
+            }
+            cacheEnabled = true;
+            i++;
+        } else if (strcmp(argv[i], "--cache-top") == 0) {
+            if (i + 1 >= argc) usage();
+            cacheTop = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timing") == 0) {
+            if (i + 1 >= argc || !parsePredictorKind(argv[i + 1], &predictor)) usage();
+            timingEnabled = true;
+            i++;
+        } else if (strcmp(argv[i], "--simpoint") == 0) {
+            if (i + 1 >= argc) usage();
+            sampling.interval = strtoull(argv[++i], NULL, 0);
+            if (sampling.interval == 0) usage();
+        } else if (strcmp(argv[i], "--simpoint-k") == 0) {
+            if (i + 1 >= argc) usage();
+            sampling.maxClusters = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--annotate") == 0) {
+            annotate = true;
+        } else if (strcmp(argv[i], "--profile-out") == 0) {
+            if (i + 1 >= argc) usage();
+            profileName = argv[++i];
+        } else if (strcmp(argv[i], "--heatmap") == 0) {
+            heatEnabled = true;
+        } else if (strcmp(argv[i], "--heatmap-interval") == 0) {
+            if (i + 1 >= argc) usage();
+            heatInterval = strtoull(argv[++i], NULL, 0);
+            if (heatInterval == 0) usage();
+            heatEnabled = true;
+        } else if (strcmp(argv[i], "--heatmap-top") == 0) {
+            if (i + 1 >= argc) usage();
+            heatTop = atoi(argv[++i]);
+            heatEnabled = true;
+        } else if (strcmp(argv[i], "--fuzz-limit") == 0) {
+            if (i + 1 >= argc) usage();
+            fuzzLimit = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--fuzz") == 0) {
+            // Remaining arguments are test cases, afl-fuzz passes its own through stdin
+            fuzzing = true;
+            batch = &argv[i + 1];
+            batchCount = argc - i - 1;
+            break;
+#endif
+        } else if (fileName == NULL) {
+            fileName = argv[i];
+        } else {
+            usage();
+        }
     }
 
-    FILE* source;
-    source = fopen(argv[1], "rw+");
-    if (source == NULL) {
-        printf("Unable to open file '%s'.\n", argv[1]);
+    if ((fileName == NULL) == (snapshotRestore == NULL)) usage();
+    if (snapshotAt != 0 && snapshotName == NULL) usage();
+    if (batch != NULL && (logName != NULL || snapshotAt != 0)) usage();
+    if (stages != NULL && (logName != NULL || snapshotAt != 0)) usage();
+#ifdef LMIPS_INSTRUMENT
+    // Sampling records and replays input on its own and only drives the timing model
+    if (sampling.interval != 0 && (logName != NULL || cacheEnabled)) usage();
+    if (fuzzing && (logName != NULL || snapshotAt != 0 || sampling.interval != 0)) usage();
+    if (stages != NULL && (fuzzing || sampling.interval != 0)) usage();
+#endif
+
+    Memory memory = {};
+    LMips mips;
+    DebugInfo debug;
+    initDebugInfo(&debug, fileName);
+    DecodedText decoded;
+    initDecodedText(&decoded);
+    if (snapshotRestore != NULL) {
+        if (!restoreSnapshot(&mips, &memory, snapshotRestore)) {
+            printf("Unable to restore snapshot '%s'.\n", snapshotRestore);
+            exit(1);
+        }
+    } else {
+        initMemory(&memory);
+        initSimulator(&mips, &memory);
+        if (!loadExecutable(fileName, &memory, &debug, &decoded, &mips.ip, &mips.textSize)) exit(1);
+    }
+    // Executables without a decoded section, and snapshots, pay for decoding once here unless an earlier
+    // run left it in the code cache
+    if (!prepareDecodedText(&codeCache, &mips, &decoded)) {
+        printf("Unable to allocate decoded text.\n");
         exit(1);
     }
+    mips.snapshot = snapshotName;
+    if (debug.symtabSize != 0 || debug.linesSize != 0) mips.debug = &debug;
 
-    // Get file header
-    FileHeader header = getHeader(source, argv[1]);
+    if (disasm) {
+        printAnnotation(mips.program, mips.textSize, memory.littleEndian, NULL, NULL, NULL, mips.debug, stdout);
+        freeSimulator(&mips);
+        freeDebugInfo(&debug);
+        freeDecodedText(&decoded);
+        freeMemory(&memory);
+        return 0;
+    }
 
-    // Get section header table
-    SectionHeader sections[header.shCount];
-    fseek(source, header.shAddress, SEEK_SET);
-    for (int i = 0; i < header.shCount; ++i) {
-        SectionHeader section;
-        section.name = read_half(source);
-        section.type = read_byte(source);
-        section.address = read_word(source);
-        section.size = read_word(source);
+    InputLog log;
+    if (logName != NULL) {
+        if (!openInputLog(&log, logName, logMode)) {
+            printf("Unable to open log '%s'.\n", logName);
+            exit(1);
+        }
+        mips.input = &log;
+    }
 
-        sections[i] = section;
+#ifdef LMIPS_INSTRUMENT
+    if (sampling.interval != 0) {
+        sampling.predictor = predictor;
+
+        ExecutionResult result = runSampled(&mips, &sampling, stderr);
+        freeSimulator(&mips);
+        freeDebugInfo(&debug);
+        freeDecodedText(&decoded);
+        freeMemory(&memory);
+        return result == EXEC_SUCCESS ? 0 : 1;
     }
 
-    Memory memory = {};
-    initMemory(&memory);
-    uint32_t programOffset = PROGRAM_ADDRESS;
-    uint32_t dataOffset = DATA_ADDRESS;
-
-    // Start sections reading
-    for (int i = 0; i < header.shCount; ++i) {
-        SectionHeader section = sections[i];
-        fseek(source, section.address, SEEK_SET);
-        switch (section.type) {
-            case SHT_EXEC: {
-                for (int j = 0; j < section.size * 0.25; ++j) {
-                    uint32_t instr = read_word(source);
-                    mem_write(&memory, programOffset, instr);
-                    programOffset += 4;
-                }
-                break;
-            }
-            case SHT_ALLOC: {
-                for (int j = 0; j < section.size; ++j) {
-                    uint8_t buffer = read_byte(source);
-                    mem_write_byte(&memory, dataOffset++, buffer);
-                }
-                break;
+    CacheHierarchy cache;
+    if (cacheEnabled) {
+        if (!initCacheHierarchy(&cache, l1i, l1d, hasL2 ? &l2 : NULL)) {
+            printf("Invalid cache geometry.\n");
+            exit(1);
+        }
+        probes.cache = &cache;
+    }
+
+    Pipeline pipeline;
+    if (timingEnabled) {
+        if (!initPipeline(&pipeline, predictor, defaultPipelineConfig()) || (annotate && !trackStallSites(&pipeline))) {
+            printf("Unable to allocate timing model.\n");
+            exit(1);
+        }
+        probes.pipeline = &pipeline;
+    }
+
+    ExecProfile profile;
+    if (annotate || profileName != NULL) {
+        if (!initExecProfile(&profile)) {
+            printf("Unable to allocate execution profile.\n");
+            exit(1);
+        }
+        probes.profile = &profile;
+    }
+
+    HeatMap heat;
+    if (heatEnabled) {
+        if (!initHeatMap(&heat, heatInterval, mips.heap)) {
+            printf("Unable to allocate heat map.\n");
+            exit(1);
+        }
+        probes.heat = &heat;
+    }
+    mips.probes = &probes;
+
+    if (fuzzing) {
+        int status = runFuzz(&mips, &probes, batch, batchCount, fuzzLimit);
+        freeSimulator(&mips);
+        freeDebugInfo(&debug);
+        freeDecodedText(&decoded);
+        freeMemory(&memory);
+        return status;
+    }
+#endif
+
+    if (stages != NULL) {
+        int status = runPipe(&mips, stages, stageCount, &codeCache);
+        freeSimulator(&mips);
+        freeDebugInfo(&debug);
+        freeDecodedText(&decoded);
+        freeMemory(&memory);
+        return status;
+    }
+
+    if (batch != NULL) {
+        int status = runBatch(&mips, batch, batchCount);
+        freeSimulator(&mips);
+        freeDebugInfo(&debug);
+        freeDecodedText(&decoded);
+        freeMemory(&memory);
+        return status;
+    }
+
+    if (snapshotAt != 0) {
+        mips.limit = snapshotAt;
+    }
+
+    ExecutionResult result = runSimulator(&mips);
+    if (result == EXEC_SUCCESS && !mips.stop && mips.retired == snapshotAt) {
+        if (!saveSnapshot(&mips, snapshotName)) {
+            printf("Unable to write snapshot '%s'.\n", snapshotName);
+            exit(1);
+        }
+
+        mips.limit = UINT64_MAX;
+        result = runSimulator(&mips);
+    }
+    int status = 0;
+
+    if (logName != NULL) {
+        // Runs are checked against each other through a hash of the final machine state
+        uint64_t hash = hashSimulator(&mips);
+        if (logMode == REPLAY_RECORD) {
+            recordHash(&log, hash);
+        } else {
+            uint64_t expected;
+            if (result != EXEC_SUCCESS || !replayHash(&log, &expected) || expected != hash) {
+                fprintf(stderr, "Replay diverged from recorded run (state hash %#018llx).\n", (unsigned long long)hash);
+                status = 1;
             }
-            case SHT_STRTAB: {
-                read_byte(source);
-                for (int j = 0; j < section.size - 2; ++j) {
-                    uint8_t buffer = read_byte(source);
-                    mem_write_byte(&memory, dataOffset++, buffer);
-                }
-                read_byte(source);
-                break;
+        }
+        closeInputLog(&log);
+    }
+
+    if (heapStats) printArenaReport(mips.arena, stderr);
+
+#ifdef LMIPS_INSTRUMENT
+    if (probes.profile != NULL) {
+        if (annotate) printAnnotation(mips.program, mips.textSize, memory.littleEndian, probes.profile, probes.cache, probes.pipeline, mips.debug, stderr);
+        if (profileName != NULL) {
+            FILE* out = fopen(profileName, "w");
+            if (out == NULL || !writeExecProfile(mips.program, mips.textSize, probes.profile, out)) {
+                fprintf(stderr, "Unable to write profile '%s'.\n", profileName);
+                status = 1;
             }
-            case SHT_NULL:
-                break;
+            if (out != NULL) fclose(out);
         }
+        freeExecProfile(probes.profile);
     }
 
-    fclose(source);
+    if (probes.cache != NULL) {
+        printCacheReport(probes.cache, mips.debug, stderr, cacheTop);
+        freeCacheHierarchy(probes.cache);
+    }
 
-    LMips mips;
-    initSimulator(&mips, &memory);
-    mips.ip = header.entry - header.size;
+    if (probes.pipeline != NULL) {
+        printPipelineReport(probes.pipeline, stderr);
+        freePipeline(probes.pipeline);
+    }
 
-    runSimulator(&mips);
+    if (probes.heat != NULL) {
+        printHeatReport(probes.heat, mips.debug, stderr, heatTop);
+        freeHeatMap(probes.heat);
+    }
+#endif
 
     freeSimulator(&mips);
+    freeDebugInfo(&debug);
+    freeDecodedText(&decoded);
     freeMemory(&memory);
-    return 0;
+    return status;
 }
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include "annotate.h"
+#include "disasm.h"
+#include "memory.h"
+
+#define MARK_LEADER 0x01
+#define MARK_LOOP_HEAD 0x02
+#define HOT_SHARE 10.0 // Percentage of executed instructions above which a block is flagged
+
+bool initExecProfile(ExecProfile* profile) {
+    profile->total = 0;
+    profile->counts = calloc(MEMORY_SIZE >> 2, sizeof(uint64_t));
+    profile->taken = calloc(MEMORY_SIZE >> 2, sizeof(uint64_t));
+
+    if (profile->counts == NULL || profile->taken == NULL) {
+        freeExecProfile(profile);
+        return false;
+    }
+    return true;
+}
+
+void freeExecProfile(ExecProfile* profile) {
+    free(profile->counts);
+    free(profile->taken);
+    profile->counts = NULL;
+    profile->taken = NULL;
+}
+
+void profileRetire(ExecProfile* profile, uint32_t ip, uint32_t nextIp) {
+    if (ip < MEMORY_SIZE) {
+        profile->counts[ip >> 2]++;
+        if (nextIp != ip + 4) profile->taken[ip >> 2]++;
+    }
+    profile->total++;
+}
+
+bool writeExecProfile(const uint8_t* program, uint32_t textSize, ExecProfile* profile, FILE* out) {
+    uint32_t count = textSize >> 2;
+
+    fprintf(out, "# lmips block profile: text offset, executions, taken transfers\n");
+    for (uint32_t i = 0; i < count; i++) {
+        if (profile->counts[i] == 0) continue;
+        fprintf(out, "%u %llu %llu\n", i << 2, (unsigned long long)profile->counts[i],
+                (unsigned long long)profile->taken[i]);
+    }
+
+    return !ferror(out);
+}
+
+// Basic blocks start at the entry, at static branch targets and after every control transfer
+static uint8_t* markBlocks(const uint8_t* program, bool littleEndian, uint32_t count) {
+    uint8_t* marks = calloc(count + 1, sizeof(uint8_t));
+    if (marks == NULL) return NULL;
+
+    marks[0] = MARK_LEADER;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t instr = mem_read_instr(program, i << 2, littleEndian);
+        if (!isControlTransfer(instr)) continue;
+
+        marks[i + 1] |= MARK_LEADER;
+
+        uint32_t target;
+        if (branchTarget(i << 2, instr, &target) && (target >> 2) < count) {
+            marks[target >> 2] |= MARK_LEADER;
+            if (target <= i << 2) marks[target >> 2] |= MARK_LOOP_HEAD;
+        }
+    }
+
+    return marks;
+}
+
+static void printColumns(uint32_t ip, ExecProfile* profile, CacheHierarchy* cache, Pipeline* pipeline, FILE* out) {
+    if (profile != NULL) {
+        uint64_t count = profile->counts[ip >> 2];
+        fprintf(out, "%12llu %7.2f%% ", (unsigned long long)count,
+                profile->total == 0 ? 0.0 : 100.0 * count / profile->total);
+    }
+    if (cache != NULL) fprintf(out, "%8u ", cache->missSites[ip >> 2]);
+    if (pipeline != NULL) fprintf(out, "%8u ", pipeline->stallSites[ip >> 2]);
+}
+
+void printAnnotation(const uint8_t* program, uint32_t textSize, bool littleEndian, ExecProfile* profile,
+                     CacheHierarchy* cache, Pipeline* pipeline, DebugInfo* debug, FILE* out) {
+    uint32_t count = textSize >> 2;
+    uint8_t* marks = markBlocks(program, littleEndian, count);
+    if (marks == NULL) return;
+
+    if (pipeline != NULL && pipeline->stallSites == NULL) pipeline = NULL;
+
+    fprintf(out, "Annotated disassembly\n");
+    if (profile != NULL) {
+        fprintf(out, "%12s %8s ", "executions", "share");
+        if (cache != NULL) fprintf(out, "%8s ", "misses");
+        if (pipeline != NULL) fprintf(out, "%8s ", "stalls");
+        fprintf(out, "\n");
+    }
+
+    uint32_t skipped = 0, lastLine = 0;
+    for (uint32_t start = 0; start < count;) {
+        uint32_t end = start + 1;
+        while (end < count && !(marks[end] & MARK_LEADER)) end++;
+
+        uint64_t executed = 0;
+        if (profile != NULL) {
+            for (uint32_t i = start; i < end; i++) executed += profile->counts[i];
+        }
+
+        // Code that never ran is folded away once a profile is available
+        if (profile != NULL && executed == 0) {
+            skipped += end - start;
+            start = end;
+            continue;
+        }
+        if (skipped > 0) {
+            fprintf(out, "  ... %u instructions never executed\n", skipped);
+            skipped = 0;
+        }
+
+        const Symbol* symbol = findSymbol(debug, SYMBOL_TEXT, start << 2);
+        if (symbol != NULL && symbol->address == start << 2) fprintf(out, "%s:\n", symbol->name);
+
+        double share = profile == NULL || profile->total == 0 ? 0.0 : 100.0 * executed / profile->total;
+        fprintf(out, "%#08x: block of %u instructions", PROGRAM_ADDRESS + (start << 2), end - start);
+        if (profile != NULL) {
+            fprintf(out, ", entered %llu times, %.2f%% of instructions",
+                    (unsigned long long)profile->counts[start], share);
+        }
+        if (marks[start] & MARK_LOOP_HEAD) fprintf(out, " [loop head]");
+        if (share >= HOT_SHARE) fprintf(out, " [hot]");
+        fprintf(out, "\n");
+
+        for (uint32_t i = start; i < end; i++) {
+            uint32_t ip = i << 2;
+            uint32_t instr = mem_read_instr(program, ip, littleEndian);
+            char text[64];
+            disassemble(ip, instr, text, sizeof(text));
+
+            // Labels no branch goes to do not start a block, they are still shown in place
+            symbol = i == start ? NULL : findSymbol(debug, SYMBOL_TEXT, ip);
+            if (symbol != NULL && symbol->address == ip) fprintf(out, "%s:\n", symbol->name);
+
+            char notes[96] = "";
+            int length = 0;
+            uint32_t target;
+            if (branchTarget(ip, instr, &target) && target <= ip) {
+                length += snprintf(notes, sizeof(notes), " <- loop back-edge to %#08x", PROGRAM_ADDRESS + target);
+            }
+
+            uint32_t line = findLine(debug, ip);
+            if (line != 0 && line != lastLine) snprintf(notes + length, sizeof(notes) - length, " # line %u", line);
+            lastLine = line;
+
+            printColumns(ip, profile, cache, pipeline, out);
+            if (notes[0] != '\0') {
+                fprintf(out, " %#08x:  %-32s%s\n", PROGRAM_ADDRESS + ip, text, notes);
+            } else {
+                fprintf(out, " %#08x:  %s\n", PROGRAM_ADDRESS + ip, text);
+            }
+        }
+
+        start = end;
+    }
+    if (skipped > 0) fprintf(out, "  ... %u instructions never executed\n", skipped);
+
+    free(marks);
+}
@@ -0,0 +1,27 @@
+#ifndef LMIPS_ANNOTATE
+#define LMIPS_ANNOTATE
+
+#include <stdio.h>
+#include "common.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "debuginfo.h"
+
+typedef struct {
+    uint64_t* counts; // Executions per instruction, indexed by ip >> 2
+    uint64_t* taken; // Executions that did not fall through to the next instruction
+    uint64_t total;
+} ExecProfile;
+
+bool initExecProfile(ExecProfile* profile);
+void freeExecProfile(ExecProfile* profile);
+void profileRetire(ExecProfile* profile, uint32_t ip, uint32_t nextIp);
+
+// Block profile read by lasm --profile, one line per executed instruction of the text section
+bool writeExecProfile(const uint8_t* program, uint32_t textSize, ExecProfile* profile, FILE* out);
+
+// Disassembles the text section block by block, next to whatever counts are available
+void printAnnotation(const uint8_t* program, uint32_t textSize, bool littleEndian, ExecProfile* profile,
+                     CacheHierarchy* cache, Pipeline* pipeline, DebugInfo* debug, FILE* out);
+
+#endif // LMIPS_ANNOTATE
@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define GRANULES_PER_PAGE (MEMORY_PAGE_SIZE / ARENA_GRANULE)
+#define PAGE_GRANULE_WORDS (GRANULES_PER_PAGE / 64)
+#define SMALL_CLASSES 8 // Classes below are 16 bytes apart, the ones above split every power of two in four
+
+#define TEST_BIT(bits, index) (((bits)[(index) / 64] >> ((index) % 64)) & 1)
+#define SET_BIT(bits, index) ((bits)[(index) / 64] |= 1ULL << ((index) % 64))
+#define CLEAR_BIT(bits, index) ((bits)[(index) / 64] &= ~(1ULL << ((index) % 64)))
+
+static const uint16_t classSizes[ARENA_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048
+};
+
+// Smallest class holding size bytes, sizes up to ARENA_SMALL_MAX only
+static inline uint32_t sizeClass(uint32_t size) {
+    if (size <= classSizes[SMALL_CLASSES - 1]) return size == 0 ? 0 : (size - 1) / ARENA_GRANULE;
+
+    uint32_t last = size - 1;
+    uint32_t bit = 31 - __builtin_clz(last);
+    return SMALL_CLASSES + (bit - 7) * 4 + ((last >> (bit - 2)) & 3);
+}
+
+static inline uint32_t pageAddress(uint32_t page) {
+    return HEAP_ADDRESS + page * MEMORY_PAGE_SIZE;
+}
+
+static inline bool isRun(const Arena* arena, uint32_t page) {
+    return arena->pageKind[page] == ARENA_RUN || arena->pageKind[page] == ARENA_RUN_TAIL;
+}
+
+// Lowest set bit of a page bitmap, ARENA_PAGES when there is none
+static uint32_t firstPage(const uint64_t* bits) {
+    for (uint32_t word = 0; word < ARENA_PAGE_WORDS; word++) {
+        if (bits[word] != 0) return word * 64 + __builtin_ctzll(bits[word]);
+    }
+
+    return ARENA_PAGES;
+}
+
+// Run lengths are kept on both its first and last page, so a run being freed finds the one before it
+static void setRun(Arena* arena, uint32_t page, uint32_t length) {
+    arena->pageKind[page] = ARENA_RUN;
+    memset(&arena->pageKind[page + 1], ARENA_RUN_TAIL, length - 1);
+    arena->runPages[page] = length;
+    arena->runPages[page + length - 1] = length;
+}
+
+static bool growHeap(Arena* arena, uint32_t length, uint32_t* heap, uint32_t limit, uint32_t* page) {
+    uint32_t start = (*heap + MEMORY_PAGE_SIZE - 1) & ~(MEMORY_PAGE_SIZE - 1);
+    if (start < HEAP_ADDRESS) start = HEAP_ADDRESS;
+    if (start > limit || (limit - start) / MEMORY_PAGE_SIZE < length) return false;
+
+    *page = (start - HEAP_ADDRESS) / MEMORY_PAGE_SIZE;
+    *heap = start + length * MEMORY_PAGE_SIZE;
+    arena->stats.pages += length;
+    return true;
+}
+
+// First fit over the free runs, taking the lowest one that is long enough before growing the heap
+static bool takeRun(Arena* arena, uint32_t length, uint32_t* heap, uint32_t limit, uint32_t* page) {
+    for (uint32_t word = 0; word < ARENA_PAGE_WORDS; word++) {
+        uint64_t bits = arena->freeRuns[word];
+        while (bits != 0) {
+            uint32_t start = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            uint32_t available = arena->runPages[start];
+            if (available < length) continue;
+
+            CLEAR_BIT(arena->freeRuns, start);
+            if (available > length) {
+                setRun(arena, start + length, available - length);
+                SET_BIT(arena->freeRuns, start + length);
+            }
+            setRun(arena, start, length);
+            *page = start;
+            return true;
+        }
+    }
+
+    if (!growHeap(arena, length, heap, limit, page)) return false;
+    setRun(arena, *page, length);
+    return true;
+}
+
+// Merges the pages with the free runs around them, a run ending at the heap break gives its pages back
+static void releaseRun(Arena* arena, uint32_t page, uint32_t length, uint32_t* heap) {
+    uint32_t next = page + length;
+    if (next < ARENA_PAGES && TEST_BIT(arena->freeRuns, next)) {
+        CLEAR_BIT(arena->freeRuns, next);
+        length += arena->runPages[next];
+    }
+    if (page > 0 && isRun(arena, page - 1)) {
+        uint32_t previous = page - arena->runPages[page - 1];
+        if (TEST_BIT(arena->freeRuns, previous)) {
+            CLEAR_BIT(arena->freeRuns, previous);
+            length += page - previous;
+            page = previous;
+        }
+    }
+
+    if (*heap == pageAddress(page + length)) {
+        memset(&arena->pageKind[page], 0, length);
+        *heap = pageAddress(page);
+        arena->stats.pages -= length;
+        return;
+    }
+
+    setRun(arena, page, length);
+    SET_BIT(arena->freeRuns, page);
+}
+
+static uint32_t allocSmall(Arena* arena, uint32_t class, uint32_t* heap, uint32_t limit) {
+    uint32_t page = firstPage(arena->partial[class]);
+    if (page == ARENA_PAGES) {
+        if (!takeRun(arena, 1, heap, limit, &page)) return 0;
+
+        arena->pageKind[page] = class + 1;
+        uint32_t step = classSizes[class] / ARENA_GRANULE;
+        for (uint32_t granule = 0; granule + step <= GRANULES_PER_PAGE; granule += step) {
+            SET_BIT(arena->freeSlots, page * GRANULES_PER_PAGE + granule);
+        }
+        SET_BIT(arena->partial[class], page);
+    }
+
+    uint64_t* slots = &arena->freeSlots[page * PAGE_GRANULE_WORDS];
+    uint32_t word = 0;
+    while (slots[word] == 0) word++;
+    uint32_t granule = page * GRANULES_PER_PAGE + word * 64 + __builtin_ctzll(slots[word]);
+
+    CLEAR_BIT(arena->freeSlots, granule);
+    SET_BIT(arena->used, granule);
+    bool full = true;
+    for (uint32_t i = 0; i < PAGE_GRANULE_WORDS; i++) {
+        if (slots[i] != 0) full = false;
+    }
+    if (full) CLEAR_BIT(arena->partial[class], page);
+
+    return HEAP_ADDRESS + granule * ARENA_GRANULE;
+}
+
+static void freeSmall(Arena* arena, uint32_t granule, uint32_t* heap) {
+    uint32_t page = granule / GRANULES_PER_PAGE;
+    uint32_t class = arena->pageKind[page] - 1;
+
+    CLEAR_BIT(arena->used, granule);
+    SET_BIT(arena->freeSlots, granule);
+    SET_BIT(arena->partial[class], page);
+
+    const uint64_t* used = &arena->used[page * PAGE_GRANULE_WORDS];
+    for (uint32_t i = 0; i < PAGE_GRANULE_WORDS; i++) {
+        if (used[i] != 0) return;
+    }
+
+    // Empty pages go back to the runs, so memory freed by one size class can serve the others
+    memset(&arena->freeSlots[page * PAGE_GRANULE_WORDS], 0, PAGE_GRANULE_WORDS * sizeof(uint64_t));
+    CLEAR_BIT(arena->partial[class], page);
+    releaseRun(arena, page, 1, heap);
+}
+
+static uint32_t allocBlock(Arena* arena, uint32_t size, uint32_t* heap, uint32_t limit) {
+    uint32_t address;
+    uint32_t usable;
+
+    if (size <= ARENA_SMALL_MAX) {
+        uint32_t class = sizeClass(size);
+        address = allocSmall(arena, class, heap, limit);
+        usable = classSizes[class];
+    } else {
+        if (size > ARENA_PAGES * MEMORY_PAGE_SIZE) return 0;
+
+        uint32_t length = (size + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE;
+        uint32_t page;
+        if (!takeRun(arena, length, heap, limit, &page)) return 0;
+
+        address = pageAddress(page);
+        SET_BIT(arena->used, page * GRANULES_PER_PAGE);
+        usable = length * MEMORY_PAGE_SIZE;
+    }
+    if (address == 0) return 0;
+
+    arena->stats.blocks++;
+    arena->stats.inUse += usable;
+    if (arena->stats.inUse > arena->stats.peakInUse) arena->stats.peakInUse = arena->stats.inUse;
+    return address;
+}
+
+static void freeBlock(Arena* arena, uint32_t address, uint32_t* heap) {
+    uint32_t granule = (address - HEAP_ADDRESS) / ARENA_GRANULE;
+    uint32_t page = granule / GRANULES_PER_PAGE;
+
+    arena->stats.blocks--;
+    arena->stats.inUse -= arenaBlockSize(arena, address);
+
+    if (arena->pageKind[page] == ARENA_RUN) {
+        CLEAR_BIT(arena->used, granule);
+        releaseRun(arena, page, arena->runPages[page], heap);
+    } else {
+        freeSmall(arena, granule, heap);
+    }
+}
+
+// Resizes a run where it is, trimming its tail or taking the free run or heap right after it
+static bool resizeRun(Arena* arena, uint32_t page, uint32_t length, uint32_t* heap, uint32_t limit) {
+    uint32_t current = arena->runPages[page];
+
+    if (length < current) {
+        setRun(arena, page, length);
+        releaseRun(arena, page + length, current - length, heap);
+    } else if (length > current) {
+        uint32_t next = page + current;
+        uint32_t missing = length - current;
+
+        if (next < ARENA_PAGES && TEST_BIT(arena->freeRuns, next) && arena->runPages[next] >= missing) {
+            uint32_t available = arena->runPages[next];
+            CLEAR_BIT(arena->freeRuns, next);
+            if (available > missing) {
+                setRun(arena, next + missing, available - missing);
+                SET_BIT(arena->freeRuns, next + missing);
+            }
+        } else {
+            uint32_t grown;
+            if (*heap != pageAddress(next) || !growHeap(arena, missing, heap, limit, &grown)) return false;
+        }
+        setRun(arena, page, length);
+    }
+
+    arena->stats.inUse += ((int64_t)length - current) * MEMORY_PAGE_SIZE;
+    if (arena->stats.inUse > arena->stats.peakInUse) arena->stats.peakInUse = arena->stats.inUse;
+    return true;
+}
+
+void initArena(Arena* arena) {
+    memset(arena, 0, sizeof(Arena));
+}
+
+Arena* copyArena(const Arena* arena) {
+    if (arena == NULL) return NULL;
+
+    Arena* copy = malloc(sizeof(Arena));
+    if (copy != NULL) memcpy(copy, arena, sizeof(Arena));
+    return copy;
+}
+
+uint32_t arenaMalloc(Arena* arena, uint32_t size, uint32_t* heap, uint32_t limit) {
+    uint32_t address = allocBlock(arena, size, heap, limit);
+    arena->stats.allocations++;
+    if (address == 0) arena->stats.failures++;
+
+    return address;
+}
+
+bool arenaFree(Arena* arena, uint32_t address, uint32_t* heap) {
+    if (address == 0) return true;
+    if (arenaBlockSize(arena, address) == 0) return false;
+
+    freeBlock(arena, address, heap);
+    arena->stats.frees++;
+    return true;
+}
+
+uint32_t arenaRealloc(Arena* arena, Memory* memory, uint32_t address, uint32_t size, uint32_t* heap, uint32_t limit,
+                      bool* valid) {
+    *valid = true;
+    if (address == 0) return arenaMalloc(arena, size, heap, limit);
+
+    uint32_t usable = arenaBlockSize(arena, address);
+    if (usable == 0) {
+        *valid = false;
+        return 0;
+    }
+    if (size == 0) {
+        arenaFree(arena, address, heap);
+        return 0;
+    }
+
+    arena->stats.reallocs++;
+    uint32_t page = (address - HEAP_ADDRESS) / MEMORY_PAGE_SIZE;
+    if (arena->pageKind[page] == ARENA_RUN) {
+        if (size > ARENA_SMALL_MAX && size <= ARENA_PAGES * MEMORY_PAGE_SIZE &&
+            resizeRun(arena, page, (size + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE, heap, limit)) {
+            return address;
+        }
+    } else if (size <= ARENA_SMALL_MAX && sizeClass(size) == (uint32_t)arena->pageKind[page] - 1) {
+        return address;
+    }
+
+    uint32_t moved = allocBlock(arena, size, heap, limit);
+    if (moved == 0) {
+        arena->stats.failures++;
+        return 0;
+    }
+
+    uint32_t copied = usable < size ? usable : size;
+    memmove(&memory->store[moved], &memory->store[address], copied);
+    markDirtyPages(memory, moved, copied);
+    freeBlock(arena, address, heap);
+    return moved;
+}
+
+// Granules of a page that may have a bit set in the used and free slot bitmaps
+static bool validSlots(const Arena* arena, uint32_t page) {
+    uint8_t kind = arena->pageKind[page];
+    uint32_t step = kind >= 1 && kind <= ARENA_CLASSES ? classSizes[kind - 1] / ARENA_GRANULE : 0;
+
+    for (uint32_t granule = 0; granule < GRANULES_PER_PAGE; granule++) {
+        uint32_t index = page * GRANULES_PER_PAGE + granule;
+        bool used = TEST_BIT(arena->used, index);
+        bool free = TEST_BIT(arena->freeSlots, index);
+
+        if (step != 0) {
+            bool slot = granule % step == 0 && granule + step <= GRANULES_PER_PAGE;
+            if ((used || free) && (!slot || (used && free))) return false;
+        } else if (free || (used && (kind != ARENA_RUN || granule != 0))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool validArena(const Arena* arena, uint32_t heap) {
+    if (heap > MEMORY_SIZE) return false;
+
+    for (uint32_t page = 0; page < ARENA_PAGES;) {
+        uint8_t kind = arena->pageKind[page];
+        uint32_t length = 1;
+
+        if (kind == ARENA_RUN) {
+            length = arena->runPages[page];
+            if (length == 0 || length > ARENA_PAGES - page || arena->runPages[page + length - 1] != length) return false;
+            for (uint32_t i = 1; i < length; i++) {
+                if (arena->pageKind[page + i] != ARENA_RUN_TAIL) return false;
+            }
+        } else if (kind > ARENA_CLASSES) {
+            return false; // Unknown kind, or a run tail without the first page of its run
+        }
+
+        if (kind != 0 && pageAddress(page + length) > heap) return false;
+        if (TEST_BIT(arena->freeRuns, page) && (kind != ARENA_RUN || TEST_BIT(arena->used, page * GRANULES_PER_PAGE))) {
+            return false;
+        }
+        for (uint32_t i = 0; i < length; i++) {
+            if (!validSlots(arena, page + i) || (i > 0 && TEST_BIT(arena->freeRuns, page + i))) return false;
+            for (uint32_t class = 0; class < ARENA_CLASSES; class++) {
+                if (TEST_BIT(arena->partial[class], page + i) && arena->pageKind[page + i] != class + 1) return false;
+            }
+        }
+
+        page += length;
+    }
+
+    // Bitmap bits past the last page would send lookups outside the tables
+    for (uint32_t page = ARENA_PAGES; page < ARENA_PAGE_WORDS * 64; page++) {
+        if (TEST_BIT(arena->freeRuns, page)) return false;
+        for (uint32_t class = 0; class < ARENA_CLASSES; class++) {
+            if (TEST_BIT(arena->partial[class], page)) return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t arenaBlockSize(const Arena* arena, uint32_t address) {
+    if (address < HEAP_ADDRESS || address - HEAP_ADDRESS >= ARENA_PAGES * MEMORY_PAGE_SIZE ||
+        address % ARENA_GRANULE != 0) {
+        return 0;
+    }
+
+    uint32_t granule = (address - HEAP_ADDRESS) / ARENA_GRANULE;
+    if (!TEST_BIT(arena->used, granule)) return 0;
+
+    uint32_t page = granule / GRANULES_PER_PAGE;
+    return arena->pageKind[page] == ARENA_RUN ? arena->runPages[page] * MEMORY_PAGE_SIZE
+                                              : classSizes[arena->pageKind[page] - 1];
+}
+
+void printArenaReport(const Arena* arena, FILE* out) {
+    static const ArenaStats none;
+    const ArenaStats* stats = arena == NULL ? &none : &arena->stats;
+    uint64_t footprint = (uint64_t)stats->pages * MEMORY_PAGE_SIZE;
+
+    fprintf(out, "Heap allocator report\n");
+    fprintf(out, "  Allocations : %llu (%llu failed)\n",
+            (unsigned long long)stats->allocations, (unsigned long long)stats->failures);
+    fprintf(out, "  Frees       : %llu\n", (unsigned long long)stats->frees);
+    fprintf(out, "  Reallocs    : %llu\n", (unsigned long long)stats->reallocs);
+    fprintf(out, "  Live blocks : %llu\n", (unsigned long long)stats->blocks);
+    fprintf(out, "  In use      : %llu bytes (peak %llu)\n",
+            (unsigned long long)stats->inUse, (unsigned long long)stats->peakInUse);
+    fprintf(out, "  Footprint   : %llu bytes in %u pages (%.2f%% in use)\n",
+            (unsigned long long)footprint, stats->pages, footprint == 0 ? 0 : 100.0 * stats->inUse / footprint);
+}
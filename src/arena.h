@@ -0,0 +1,65 @@
+#ifndef LMIPS_ARENA
+#define LMIPS_ARENA
+
+#include <stdio.h>
+#include "common.h"
+#include "memory.h"
+
+#define ARENA_PAGES ((MEMORY_SIZE - HEAP_ADDRESS) / MEMORY_PAGE_SIZE) // Heap pages above HEAP_ADDRESS
+#define ARENA_PAGE_WORDS ((ARENA_PAGES + 63) / 64)
+#define ARENA_GRANULE 16 // Alignment and size of the smallest block
+#define ARENA_GRANULE_WORDS (ARENA_PAGES * (MEMORY_PAGE_SIZE / ARENA_GRANULE) / 64)
+#define ARENA_CLASSES 24
+#define ARENA_SMALL_MAX 2048 // Larger blocks take runs of whole pages
+#define ARENA_RUN 0xFE // Page kinds past the size classes, first page of a run and the ones after it
+#define ARENA_RUN_TAIL 0xFF
+
+typedef struct {
+    uint64_t allocations;
+    uint64_t failures; // Allocations the heap could not grow for
+    uint64_t frees;
+    uint64_t reallocs;
+    uint64_t blocks; // Live blocks
+    uint64_t inUse; // Bytes of the live blocks, rounded to their size class
+    uint64_t peakInUse;
+    uint32_t pages; // Pages taken from the heap break
+} ArenaStats;
+
+// Size-class allocator serving SYS_MALLOC, SYS_FREE and SYS_REALLOC from the guest heap. Every
+// block small enough lives in a page holding blocks of one size class only, larger ones take runs
+// of whole pages, and both are handed out lowest address first. All of its bookkeeping lives in the
+// tables below rather than in guest memory, so a stray guest store cannot corrupt it, and since the
+// tables hold no pointer, snapshots and baselines copy them as they are.
+typedef struct {
+    uint8_t pageKind[ARENA_PAGES]; // 0 outside the arena, size class + 1, ARENA_RUN or ARENA_RUN_TAIL
+    uint16_t runPages[ARENA_PAGES]; // Length of the run starting at the page
+    uint64_t used[ARENA_GRANULE_WORDS]; // Bit per granule, set where a live block starts
+    uint64_t freeSlots[ARENA_GRANULE_WORDS]; // Bit per granule, set where a free block of a size class starts
+    uint64_t partial[ARENA_CLASSES][ARENA_PAGE_WORDS]; // Pages of a size class with a free block
+    uint64_t freeRuns[ARENA_PAGE_WORDS]; // First pages of free runs
+    ArenaStats stats;
+} Arena;
+
+void initArena(Arena* arena);
+// Copy owned by the caller, NULL when arena is NULL or the copy cannot be allocated
+Arena* copyArena(const Arena* arena);
+// Address of a block of at least size bytes, 0 when the heap cannot grow for it. New pages are
+// taken from the heap break, which is never moved past limit.
+uint32_t arenaMalloc(Arena* arena, uint32_t size, uint32_t* heap, uint32_t limit);
+// False when address is not the start of a live block. Pages freed at the top of the heap move the
+// break back down.
+bool arenaFree(Arena* arena, uint32_t address, uint32_t* heap);
+// Moves the block when it no longer fits its size class, its content is copied in memory. Returns
+// 0 with the block left in place when the heap cannot grow, and sets valid to false when address
+// is not the start of a live block.
+uint32_t arenaRealloc(Arena* arena, Memory* memory, uint32_t address, uint32_t size, uint32_t* heap, uint32_t limit,
+                      bool* valid);
+// Whether tables read from a file are consistent with each other and with the heap break, so that no
+// later call can index outside them
+bool validArena(const Arena* arena, uint32_t heap);
+// Bytes the block starting at address can hold, 0 when it is not a live block
+uint32_t arenaBlockSize(const Arena* arena, uint32_t address);
+// Arena may be NULL for a guest that never allocated
+void printArenaReport(const Arena* arena, FILE* out);
+
+#endif // LMIPS_ARENA
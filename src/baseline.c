@@ -0,0 +1,67 @@
+#include <stdlib.h>
+#include <string.h>
+#include "baseline.h"
+
+bool saveBaseline(Baseline* baseline, LMips* mips) {
+    baseline->state = *mips;
+    baseline->state.arena = copyArena(mips->arena);
+    baseline->store = malloc(MEMORY_MAPPED_SIZE);
+    if (baseline->store == NULL || (mips->arena != NULL && baseline->state.arena == NULL)) {
+        freeBaseline(baseline);
+        return false;
+    }
+
+    memcpy(baseline->store, mips->memory->store, MEMORY_MAPPED_SIZE);
+    clearDirtyPages(mips->memory);
+
+    return true;
+}
+
+bool resetToBaseline(Baseline* baseline, LMips* mips) {
+    Memory* memory = mips->memory;
+    if (baseline->state.arena != NULL && mips->arena == NULL) {
+        mips->arena = malloc(sizeof(Arena));
+        if (mips->arena == NULL) return false;
+    }
+
+    for (uint32_t word = 0; word < DIRTY_WORDS; word++) {
+        uint64_t bits = memory->dirty[word];
+        while (bits != 0) {
+            uint32_t page = word * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            if (page * MEMORY_PAGE_SIZE < MEMORY_MAPPED_SIZE) {
+                size_t offset = page * MEMORY_PAGE_SIZE;
+                memcpy(&memory->store[offset], &baseline->store[offset], MEMORY_PAGE_SIZE);
+            }
+        }
+    }
+    clearDirtyPages(memory);
+
+    // Architectural state only, the host-side attachments of the simulator are kept
+    memcpy(mips->regs, baseline->state.regs, sizeof(mips->regs));
+    mips->ip = baseline->state.ip;
+    mips->hi = baseline->state.hi;
+    mips->lo = baseline->state.lo;
+    memcpy(mips->fregs, baseline->state.fregs, sizeof(mips->fregs));
+    mips->fcc = baseline->state.fcc;
+    memcpy(mips->vregs, baseline->state.vregs, sizeof(mips->vregs));
+    mips->heap = baseline->state.heap;
+    if (baseline->state.arena == NULL) {
+        free(mips->arena);
+        mips->arena = NULL;
+    } else {
+        memcpy(mips->arena, baseline->state.arena, sizeof(Arena));
+    }
+    mips->retired = baseline->state.retired;
+    mips->stop = false;
+
+    return true;
+}
+
+void freeBaseline(Baseline* baseline) {
+    free(baseline->store);
+    free(baseline->state.arena);
+    baseline->store = NULL;
+    baseline->state.arena = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef LMIPS_BASELINE
+#define LMIPS_BASELINE
+
+#include "lmips.h"
+
+// Saved machine state that a simulator can be brought back to, copying only the pages written since
+typedef struct {
+    LMips state;
+    uint8_t* store;
+} Baseline;
+
+bool saveBaseline(Baseline* baseline, LMips* mips);
+// False when the heap allocator state cannot be allocated, the machine is then left untouched
+bool resetToBaseline(Baseline* baseline, LMips* mips);
+void freeBaseline(Baseline* baseline);
+
+#endif // LMIPS_BASELINE
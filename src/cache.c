@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+#include "memory.h"
+
+static bool isPowerOfTwo(uint32_t x) {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+static bool parseSize(const char* text, char** end, uint32_t* size) {
+    unsigned long value = strtoul(text, end, 0);
+    if (*end == text) return false;
+
+    if (**end == 'k' || **end == 'K') {
+        value <<= 10;
+        (*end)++;
+    } else if (**end == 'm' || **end == 'M') {
+        value <<= 20;
+        (*end)++;
+    }
+
+    *size = value;
+    return true;
+}
+
+CacheConfig defaultCacheConfig(uint32_t size) {
+    CacheConfig config = {size, 8, 64, REPLACE_LRU};
+    return config;
+}
+
+// Parses a "size:assoc:line:policy" specification, e.g. "32k:8:64:lru"
+bool parseCacheConfig(const char* spec, CacheConfig* config) {
+    char* end;
+    if (!parseSize(spec, &end, &config->size) || *end++ != ':') return false;
+    if (!parseSize(end, &end, &config->assoc) || *end++ != ':') return false;
+    if (!parseSize(end, &end, &config->lineSize)) return false;
+
+    config->policy = REPLACE_LRU;
+    if (*end == '\0') return true;
+    if (*end++ != ':') return false;
+
+    if (strcmp(end, "lru") == 0) {
+        config->policy = REPLACE_LRU;
+    } else if (strcmp(end, "fifo") == 0) {
+        config->policy = REPLACE_FIFO;
+    } else if (strcmp(end, "random") == 0) {
+        config->policy = REPLACE_RANDOM;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool initCacheLevel(CacheLevel* level, const char* name, CacheConfig config) {
+    memset(level, 0, sizeof(CacheLevel));
+    if (!isPowerOfTwo(config.lineSize) || config.assoc == 0 || config.size % (config.assoc * config.lineSize) != 0) {
+        return false;
+    }
+
+    level->name = name;
+    level->config = config;
+    level->sets = config.size / (config.assoc * config.lineSize);
+    if (!isPowerOfTwo(level->sets)) return false;
+
+    while ((1u << level->lineBits) < config.lineSize) level->lineBits++;
+
+    level->tags = calloc(level->sets * config.assoc, sizeof(uint32_t));
+    level->stamps = calloc(level->sets * config.assoc, sizeof(uint64_t));
+    level->seed = 0x9E3779B9;
+
+    return level->tags != NULL && level->stamps != NULL;
+}
+
+void freeCacheLevel(CacheLevel* level) {
+    free(level->tags);
+    free(level->stamps);
+    level->tags = NULL;
+    level->stamps = NULL;
+}
+
+bool cacheAccess(CacheLevel* level, uint32_t address) {
+    uint32_t line = address >> level->lineBits;
+    uint32_t tag = line + 1;
+    uint32_t assoc = level->config.assoc;
+    uint32_t* tags = &level->tags[(line & (level->sets - 1)) * assoc];
+    uint64_t* stamps = &level->stamps[(line & (level->sets - 1)) * assoc];
+
+    level->clock++;
+
+    uint32_t victim = 0;
+    for (uint32_t way = 0; way < assoc; way++) {
+        if (tags[way] == tag) {
+            if (level->config.policy == REPLACE_LRU) stamps[way] = level->clock;
+            level->hits++;
+            return true;
+        }
+
+        if (tags[way] == 0 || (tags[victim] != 0 && stamps[way] < stamps[victim])) {
+            victim = way;
+        }
+    }
+
+    if (tags[victim] != 0 && level->config.policy == REPLACE_RANDOM) {
+        level->seed ^= level->seed << 13;
+        level->seed ^= level->seed >> 17;
+        level->seed ^= level->seed << 5;
+        victim = level->seed % assoc;
+    }
+
+    tags[victim] = tag;
+    stamps[victim] = level->clock;
+    level->misses++;
+    return false;
+}
+
+bool initCacheHierarchy(CacheHierarchy* cache, CacheConfig l1i, CacheConfig l1d, CacheConfig* l2) {
+    memset(cache, 0, sizeof(CacheHierarchy));
+    if (!initCacheLevel(&cache->l1i, "L1I", l1i) || !initCacheLevel(&cache->l1d, "L1D", l1d)) {
+        return false;
+    }
+
+    cache->hasL2 = l2 != NULL;
+    if (cache->hasL2 && !initCacheLevel(&cache->l2, "L2", *l2)) {
+        return false;
+    }
+
+    cache->missSites = calloc(MEMORY_SIZE >> 2, sizeof(uint32_t));
+    return cache->missSites != NULL;
+}
+
+void freeCacheHierarchy(CacheHierarchy* cache) {
+    freeCacheLevel(&cache->l1i);
+    freeCacheLevel(&cache->l1d);
+    freeCacheLevel(&cache->l2);
+    free(cache->missSites);
+    cache->missSites = NULL;
+}
+
+static void cacheMiss(CacheHierarchy* cache, uint32_t ip, uint32_t address) {
+    if (ip < MEMORY_SIZE) cache->missSites[ip >> 2]++;
+    if (cache->hasL2) cacheAccess(&cache->l2, address);
+}
+
+void cacheFetch(CacheHierarchy* cache, uint32_t ip) {
+    uint32_t address = PROGRAM_ADDRESS + ip;
+    if (!cacheAccess(&cache->l1i, address)) cacheMiss(cache, ip, address);
+}
+
+void cacheData(CacheHierarchy* cache, uint32_t ip, uint32_t address) {
+    if (!cacheAccess(&cache->l1d, address)) cacheMiss(cache, ip, address);
+}
+
+typedef struct {
+    uint32_t ip;
+    uint32_t misses;
+} MissSite;
+
+static int compareMissSites(const void* a, const void* b) {
+    uint32_t first = ((const MissSite*)a)->misses;
+    uint32_t second = ((const MissSite*)b)->misses;
+
+    return first < second ? 1 : (first > second ? -1 : 0);
+}
+
+static void printLevel(CacheLevel* level, FILE* out) {
+    static const char* policies[] = {"lru", "fifo", "random"};
+    uint64_t accesses = level->hits + level->misses;
+
+    fprintf(out, "  %-3s %8uB %2u-way %3uB %-6s : %llu accesses, %llu hits, %llu misses (%.2f%% miss rate)\n",
+            level->name, level->config.size, level->config.assoc, level->config.lineSize,
+            policies[level->config.policy], (unsigned long long)accesses,
+            (unsigned long long)level->hits, (unsigned long long)level->misses,
+            accesses == 0 ? 0.0 : 100.0 * level->misses / accesses);
+}
+
+void printCacheReport(CacheHierarchy* cache, DebugInfo* debug, FILE* out, int top) {
+    fprintf(out, "Cache simulation report\n");
+    printLevel(&cache->l1i, out);
+    printLevel(&cache->l1d, out);
+    if (cache->hasL2) printLevel(&cache->l2, out);
+
+    if (top <= 0) return;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < (MEMORY_SIZE >> 2); i++) {
+        if (cache->missSites[i] != 0) count++;
+    }
+
+    MissSite* sites = malloc(count * sizeof(MissSite));
+    if (sites == NULL) return;
+
+    count = 0;
+    for (uint32_t i = 0; i < (MEMORY_SIZE >> 2); i++) {
+        if (cache->missSites[i] != 0) {
+            MissSite site = {i << 2, cache->missSites[i]};
+            sites[count++] = site;
+        }
+    }
+    qsort(sites, count, sizeof(MissSite), compareMissSites);
+
+    fprintf(out, "Top %d missing instructions\n", top);
+    for (uint32_t i = 0; i < count && i < (uint32_t)top; i++) {
+        if (debug != NULL) {
+            char location[128];
+            formatLocation(debug, sites[i].ip, location, sizeof(location));
+            fprintf(out, "  [%#08x] %u misses in %s\n", PROGRAM_ADDRESS + sites[i].ip, sites[i].misses, location);
+        } else {
+            fprintf(out, "  [%#08x] %u misses\n", PROGRAM_ADDRESS + sites[i].ip, sites[i].misses);
+        }
+    }
+
+    free(sites);
+}
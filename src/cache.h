@@ -0,0 +1,55 @@
+#ifndef LMIPS_CACHE
+#define LMIPS_CACHE
+
+#include <stdio.h>
+#include "common.h"
+#include "debuginfo.h"
+
+typedef enum {
+    REPLACE_LRU,
+    REPLACE_FIFO,
+    REPLACE_RANDOM
+} ReplacementPolicy;
+
+typedef struct {
+    uint32_t size;
+    uint32_t assoc;
+    uint32_t lineSize;
+    ReplacementPolicy policy;
+} CacheConfig;
+
+typedef struct {
+    const char* name;
+    CacheConfig config;
+    uint32_t sets;
+    uint8_t lineBits;
+    uint32_t* tags; // sets * assoc entries, 0 meaning invalid
+    uint64_t* stamps; // Last use (LRU) or fill time (FIFO) of each way
+    uint64_t clock;
+    uint32_t seed;
+    uint64_t hits;
+    uint64_t misses;
+} CacheLevel;
+
+typedef struct {
+    CacheLevel l1i;
+    CacheLevel l1d;
+    CacheLevel l2;
+    bool hasL2;
+    uint32_t* missSites; // L1 misses per instruction, indexed by ip >> 2
+} CacheHierarchy;
+
+bool parseCacheConfig(const char* spec, CacheConfig* config);
+CacheConfig defaultCacheConfig(uint32_t size);
+
+bool initCacheLevel(CacheLevel* level, const char* name, CacheConfig config);
+void freeCacheLevel(CacheLevel* level);
+bool cacheAccess(CacheLevel* level, uint32_t address);
+
+bool initCacheHierarchy(CacheHierarchy* cache, CacheConfig l1i, CacheConfig l1d, CacheConfig* l2);
+void freeCacheHierarchy(CacheHierarchy* cache);
+void cacheFetch(CacheHierarchy* cache, uint32_t ip);
+void cacheData(CacheHierarchy* cache, uint32_t ip, uint32_t address);
+void printCacheReport(CacheHierarchy* cache, DebugInfo* debug, FILE* out, int top);
+
+#endif // LMIPS_CACHE
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+#include "channel.h"
+
+bool initChannel(Channel* channel, uint32_t capacity) {
+    atomic_init(&channel->head, 0);
+    atomic_init(&channel->tail, 0);
+    atomic_init(&channel->sleepers, 0);
+    atomic_init(&channel->writerClosed, false);
+    atomic_init(&channel->readerClosed, false);
+    channel->capacity = capacity;
+    channel->data = malloc(capacity);
+    pthread_mutex_init(&channel->lock, NULL);
+    pthread_cond_init(&channel->moved, NULL);
+
+    return channel->data != NULL;
+}
+
+void freeChannel(Channel* channel) {
+    pthread_mutex_destroy(&channel->lock);
+    pthread_cond_destroy(&channel->moved);
+    free(channel->data);
+    channel->data = NULL;
+}
+
+// Sleepers are counted before they check the position again, and movers store the position before
+// they look at the count, so with both sequentially consistent one of them always sees the other.
+static void waitForMove(Channel* channel, _Atomic uint32_t* position, uint32_t seen, _Atomic bool* closed) {
+    for (int i = 0; i < CHANNEL_SPINS; i++) {
+        if (atomic_load(position) != seen || atomic_load(closed)) return;
+    }
+
+    pthread_mutex_lock(&channel->lock);
+    atomic_fetch_add(&channel->sleepers, 1);
+    while (atomic_load(position) == seen && !atomic_load(closed)) {
+        pthread_cond_wait(&channel->moved, &channel->lock);
+    }
+    atomic_fetch_sub(&channel->sleepers, 1);
+    pthread_mutex_unlock(&channel->lock);
+}
+
+static void wakeSleepers(Channel* channel) {
+    if (atomic_load(&channel->sleepers) == 0) return;
+
+    pthread_mutex_lock(&channel->lock);
+    pthread_cond_broadcast(&channel->moved);
+    pthread_mutex_unlock(&channel->lock);
+}
+
+uint32_t channelSend(Channel* channel, const uint8_t* data, uint32_t size) {
+    uint32_t mask = channel->capacity - 1;
+    uint32_t tail = atomic_load_explicit(&channel->tail, memory_order_relaxed);
+    uint32_t sent = 0;
+
+    while (sent < size && !atomic_load(&channel->readerClosed)) {
+        uint32_t head = atomic_load_explicit(&channel->head, memory_order_acquire);
+        uint32_t room = channel->capacity - (tail - head);
+        if (room == 0) {
+            waitForMove(channel, &channel->head, head, &channel->readerClosed);
+            continue;
+        }
+
+        uint32_t count = size - sent < room ? size - sent : room;
+        uint32_t offset = tail & mask;
+        uint32_t first = count < channel->capacity - offset ? count : channel->capacity - offset;
+        memcpy(&channel->data[offset], &data[sent], first);
+        memcpy(channel->data, &data[sent + first], count - first);
+
+        tail += count;
+        sent += count;
+        atomic_store(&channel->tail, tail);
+        wakeSleepers(channel);
+    }
+
+    return sent;
+}
+
+uint32_t channelReceive(Channel* channel, uint8_t* buffer, uint32_t size) {
+    if (size == 0) return 0;
+
+    uint32_t mask = channel->capacity - 1;
+    uint32_t head = atomic_load_explicit(&channel->head, memory_order_relaxed);
+
+    while (true) {
+        uint32_t tail = atomic_load_explicit(&channel->tail, memory_order_acquire);
+        if (tail == head) {
+            // The writer stores its last bytes before closing, so the ring is looked at once more
+            if (atomic_load(&channel->writerClosed)) {
+                if (atomic_load(&channel->tail) == head) return 0;
+                continue;
+            }
+
+            waitForMove(channel, &channel->tail, tail, &channel->writerClosed);
+            continue;
+        }
+
+        uint32_t count = tail - head < size ? tail - head : size;
+        uint32_t offset = head & mask;
+        uint32_t first = count < channel->capacity - offset ? count : channel->capacity - offset;
+        memcpy(buffer, &channel->data[offset], first);
+        memcpy(&buffer[first], channel->data, count - first);
+
+        atomic_store(&channel->head, head + count);
+        wakeSleepers(channel);
+        return count;
+    }
+}
+
+static void closeSide(Channel* channel, _Atomic bool* closed) {
+    atomic_store(closed, true);
+
+    pthread_mutex_lock(&channel->lock);
+    pthread_cond_broadcast(&channel->moved);
+    pthread_mutex_unlock(&channel->lock);
+}
+
+void closeChannelWriter(Channel* channel) {
+    closeSide(channel, &channel->writerClosed);
+}
+
+void closeChannelReader(Channel* channel) {
+    closeSide(channel, &channel->readerClosed);
+}
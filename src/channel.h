@@ -0,0 +1,37 @@
+#ifndef LMIPS_CHANNEL
+#define LMIPS_CHANNEL
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "common.h"
+
+#define CHANNEL_CAPACITY (1 << 16) // Power of two
+#define CHANNEL_SPINS 256 // Checks made before a blocked side sleeps
+
+// Byte stream from one simulator to another running on its own thread. Both sides copy straight
+// between their guest memory and the ring, and only touch the position of the other side, so
+// neither takes a lock while the stream flows. A side that finds the ring full or empty spins a
+// little and then sleeps until the other one moves.
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head; // Bytes taken by the reader, only it writes this line
+    _Alignas(64) _Atomic uint32_t tail; // Bytes written by the writer
+    _Alignas(64) _Atomic uint32_t sleepers;
+    _Atomic bool writerClosed;
+    _Atomic bool readerClosed;
+    uint32_t capacity;
+    uint8_t* data;
+    pthread_mutex_t lock; // Only taken to sleep and to wake a sleeper
+    pthread_cond_t moved;
+} Channel;
+
+bool initChannel(Channel* channel, uint32_t capacity);
+void freeChannel(Channel* channel);
+
+// Returns once every byte is in the ring, with fewer sent only when the reader has closed
+uint32_t channelSend(Channel* channel, const uint8_t* data, uint32_t size);
+// Waits for at least one byte, returns 0 once the writer has closed and the ring is drained
+uint32_t channelReceive(Channel* channel, uint8_t* buffer, uint32_t size);
+void closeChannelWriter(Channel* channel);
+void closeChannelReader(Channel* channel);
+
+#endif // LMIPS_CHANNEL
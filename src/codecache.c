@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "codecache.h"
+
+#define FNV64_OFFSET 0xCBF29CE484222325ULL
+#define FNV64_PRIME 0x100000001B3ULL
+#define BYTE_ORDER_MARK 0x01020304u
+#define CACHE_SUFFIX ".ldc"
+
+static const char magic[4] = {0x10, 'L', 'D', 'C'};
+
+typedef struct {
+    char name[64];
+    struct timespec used;
+    off_t size;
+} CacheEntry;
+
+uint64_t codeCacheKey(const uint8_t* program, uint32_t size, bool littleEndian) {
+    uint64_t hash = FNV64_OFFSET;
+    uint32_t version = DECODE_VERSION;
+    for (int shift = 0; shift < 32; shift += 8) {
+        hash = (hash ^ ((version >> shift) & 0xFF)) * FNV64_PRIME;
+    }
+    hash = (hash ^ (littleEndian ? CODE_CACHE_LITTLE_ENDIAN : 0)) * FNV64_PRIME;
+    for (uint32_t i = 0; i < size; i++) {
+        hash = (hash ^ program[i]) * FNV64_PRIME;
+    }
+
+    return hash;
+}
+
+static void entryPath(CodeCache* cache, uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx" CACHE_SUFFIX, cache->directory, (unsigned long long)key);
+}
+
+static size_t fileSize(uint32_t count) {
+    return sizeof(CodeCacheHeader) + (size_t)count * sizeof(DecodedInstr);
+}
+
+bool lookupCodeCache(CodeCache* cache, const uint8_t* program, uint32_t size, bool littleEndian, DecodedText* text) {
+    initDecodedText(text);
+
+    char path[4096];
+    uint64_t key = codeCacheKey(program, size, littleEndian);
+    entryPath(cache, key, path, sizeof(path));
+
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    uint32_t count = size >> 2;
+    if (fstat(file, &status) != 0 || (size_t)status.st_size != fileSize(count)) {
+        close(file);
+        return false;
+    }
+
+    uint8_t* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+        close(file);
+        return false;
+    }
+
+    uint32_t flags = littleEndian ? CODE_CACHE_LITTLE_ENDIAN : 0;
+    CodeCacheHeader* header = (CodeCacheHeader*)mapping;
+    DecodedInstr* instrs = (DecodedInstr*)&mapping[sizeof(CodeCacheHeader)];
+    bool valid = memcmp(header->magic, magic, 4) == 0 && header->version == DECODE_VERSION &&
+                 header->key == key && header->textSize == size && header->count == count &&
+                 header->byteOrder == BYTE_ORDER_MARK && header->flags == flags;
+
+    if (!valid) {
+        munmap(mapping, status.st_size);
+        close(file);
+        return false;
+    }
+
+    // The key covers the text, the records are used as they were stored. The modification time orders
+    // entries for eviction.
+    futimens(file, NULL);
+    close(file);
+
+    text->instrs = instrs;
+    text->count = count;
+    text->mapping = mapping;
+    text->mappingSize = status.st_size;
+    return true;
+}
+
+bool storeCodeCache(CodeCache* cache, const uint8_t* program, uint32_t size, bool littleEndian,
+                    const DecodedText* text) {
+    if (text->count != size >> 2) return false;
+
+    mkdir(cache->directory, 0755);
+
+    char path[4096], temporary[4096 + 16];
+    uint64_t key = codeCacheKey(program, size, littleEndian);
+    entryPath(cache, key, path, sizeof(path));
+    snprintf(temporary, sizeof(temporary), "%s.%d", path, (int)getpid());
+
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL) return false;
+
+    CodeCacheHeader header = {};
+    memcpy(header.magic, magic, 4);
+    header.version = DECODE_VERSION;
+    header.key = key;
+    header.textSize = size;
+    header.count = text->count;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.flags = littleEndian ? CODE_CACHE_LITTLE_ENDIAN : 0;
+
+    fwrite(&header, sizeof(CodeCacheHeader), 1, file);
+    fwrite(text->instrs, sizeof(DecodedInstr), text->count, file);
+
+    bool written = !ferror(file);
+    if (fclose(file) != 0 || !written || rename(temporary, path) != 0) {
+        unlink(temporary);
+        return false;
+    }
+
+    evictCodeCache(cache);
+    return true;
+}
+
+static int compareUse(const void* a, const void* b) {
+    const CacheEntry* left = a;
+    const CacheEntry* right = b;
+    if (left->used.tv_sec != right->used.tv_sec) return left->used.tv_sec < right->used.tv_sec ? -1 : 1;
+    if (left->used.tv_nsec != right->used.tv_nsec) return left->used.tv_nsec < right->used.tv_nsec ? -1 : 1;
+    return strcmp(left->name, right->name);
+}
+
+// Removes the least recently used entries until the cache fits its limit. Entries other runs remove
+// at the same time are simply skipped, and mapped files stay readable until unmapped.
+void evictCodeCache(CodeCache* cache) {
+    DIR* directory = opendir(cache->directory);
+    if (directory == NULL) return;
+
+    size_t capacity = 16, count = 0;
+    CacheEntry* entries = malloc(capacity * sizeof(CacheEntry));
+    off_t total = 0;
+    char path[4096];
+
+    struct dirent* entry;
+    while (entries != NULL && (entry = readdir(directory)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        size_t suffix = strlen(CACHE_SUFFIX);
+        if (length <= suffix || length >= sizeof(entries[0].name) ||
+            strcmp(&entry->d_name[length - suffix], CACHE_SUFFIX) != 0) {
+            continue;
+        }
+
+        struct stat status;
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entry->d_name);
+        if (stat(path, &status) != 0) continue;
+
+        if (count == capacity) {
+            capacity *= 2;
+            CacheEntry* grown = realloc(entries, capacity * sizeof(CacheEntry));
+            if (grown == NULL) break;
+            entries = grown;
+        }
+
+        strcpy(entries[count].name, entry->d_name);
+        entries[count].used = status.st_mtim;
+        entries[count].size = status.st_size;
+        total += status.st_size;
+        count++;
+    }
+    closedir(directory);
+    if (entries == NULL) return;
+
+    qsort(entries, count, sizeof(CacheEntry), compareUse);
+    for (size_t i = 0; i < count && (size_t)total > cache->limit; i++) {
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, entries[i].name);
+        unlink(path);
+        total -= entries[i].size;
+    }
+
+    free(entries);
+}
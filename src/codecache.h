@@ -0,0 +1,39 @@
+#ifndef LMIPS_CODECACHE
+#define LMIPS_CODECACHE
+
+#include <stddef.h>
+#include "decode.h"
+
+#define CODE_CACHE_DEFAULT_LIMIT (64 * 1024 * 1024)
+#define CODE_CACHE_LITTLE_ENDIAN 0x01 // The text was decoded as little-endian words
+
+// Decoded text kept on disk between runs, one file per text named after its key.
+// Cache file layout, in host byte order and mapped as is :
+// - CodeCacheHeader
+// - The decoded instructions, count x DecodedInstr
+typedef struct {
+    char magic[4];
+    uint32_t version; // DECODE_VERSION the records were decoded with
+    uint64_t key;
+    uint32_t textSize;
+    uint32_t count;
+    uint32_t byteOrder; // 0x01020304 as written by the host, files from another byte order are ignored
+    uint32_t flags;
+} CodeCacheHeader;
+
+typedef struct {
+    const char* directory;
+    size_t limit; // Bytes of cache files kept, the least recently used ones are evicted past it
+} CodeCache;
+
+// FNV-1a 64 of the decoder version, the guest byte order and the text, size being the one the loader gave
+uint64_t codeCacheKey(const uint8_t* program, uint32_t size, bool littleEndian);
+
+// Maps the cached decoding of the text, marking it as recently used
+bool lookupCodeCache(CodeCache* cache, const uint8_t* program, uint32_t size, bool littleEndian, DecodedText* text);
+// Writes a decoding aside and renames it in place, so concurrent runs only ever see whole files
+bool storeCodeCache(CodeCache* cache, const uint8_t* program, uint32_t size, bool littleEndian,
+                    const DecodedText* text);
+void evictCodeCache(CodeCache* cache);
+
+#endif // LMIPS_CODECACHE
@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include <sys/shm.h>
+#include "coverage.h"
+#include "lmips_opcodes.h"
+
+bool initCoverage(Coverage* coverage) {
+    coverage->previous = 0;
+    coverage->shared = false;
+
+    const char* id = getenv("__AFL_SHM_ID");
+    if (id != NULL) {
+        coverage->map = shmat(atoi(id), NULL, 0);
+        if (coverage->map == (void*)-1) return false;
+        coverage->shared = true;
+        return true;
+    }
+
+    coverage->map = calloc(COVERAGE_MAP_SIZE, sizeof(uint8_t));
+    return coverage->map != NULL;
+}
+
+void freeCoverage(Coverage* coverage) {
+    if (coverage->shared) {
+        shmdt(coverage->map);
+    } else {
+        free(coverage->map);
+    }
+    coverage->map = NULL;
+}
+
+void coverageEdge(Coverage* coverage, uint32_t target) {
+    // Targets are hashed instead of assigned random ids, the shift keeps A->B and B->A apart
+    uint32_t location = ((target >> 2) * 2654435761u) >> (32 - COVERAGE_MAP_BITS);
+    coverage->map[location ^ coverage->previous]++;
+    coverage->previous = location >> 1;
+}
+
+void coverageRetire(Coverage* coverage, uint32_t instr, uint32_t nextIp) {
+    uint8_t op = instr >> 0x1A;
+    uint8_t func = instr & 0x3F;
+
+    // Both outcomes of a branch start a new block, taken or not, bc1t and bc1f included
+    bool transfer = (op >= OP_SRI && op <= OP_BGTZ) || (op == OP_SPECIAL && (func == SPE_JR || func == SPE_JALR)) ||
+                    (op == OP_COP1 && ((instr >> 0x15) & 0x1F) == FMT_BC);
+    if (transfer) coverageEdge(coverage, nextIp);
+}
+
+uint32_t coverageCount(Coverage* coverage) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < COVERAGE_MAP_SIZE; i++) {
+        if (coverage->map[i] != 0) count++;
+    }
+
+    return count;
+}
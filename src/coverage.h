@@ -0,0 +1,22 @@
+#ifndef LMIPS_COVERAGE
+#define LMIPS_COVERAGE
+
+#include "common.h"
+
+#define COVERAGE_MAP_BITS 16
+#define COVERAGE_MAP_SIZE (1 << COVERAGE_MAP_BITS)
+
+// AFL-compatible edge coverage : one hit counter per (previous, current) pair of control-flow targets
+typedef struct {
+    uint8_t* map;
+    uint32_t previous;
+    bool shared; // Map attached from the shared memory segment named by __AFL_SHM_ID
+} Coverage;
+
+bool initCoverage(Coverage* coverage);
+void freeCoverage(Coverage* coverage);
+void coverageEdge(Coverage* coverage, uint32_t target);
+void coverageRetire(Coverage* coverage, uint32_t instr, uint32_t nextIp);
+uint32_t coverageCount(Coverage* coverage);
+
+#endif // LMIPS_COVERAGE
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debuginfo.h"
+#include "memory.h"
+
+static bool readWord(FILE* file, uint32_t* word) {
+    uint8_t bytes[4];
+    if (fread(bytes, sizeof(uint8_t), 4, file) != 4) return false;
+
+    *word = (bytes[0] << 0x18) | (bytes[1] << 0x10) | (bytes[2] << 0x08) | bytes[3];
+    return true;
+}
+
+static int compareSymbols(const void* a, const void* b) {
+    uint32_t first = ((const Symbol*)a)->address;
+    uint32_t second = ((const Symbol*)b)->address;
+
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+static int compareLines(const void* a, const void* b) {
+    uint32_t first = ((const LineEntry*)a)->ip;
+    uint32_t second = ((const LineEntry*)b)->ip;
+
+    return first < second ? -1 : (first > second ? 1 : 0);
+}
+
+void initDebugInfo(DebugInfo* debug, const char* path) {
+    memset(debug, 0, sizeof(DebugInfo));
+    debug->path = path;
+}
+
+void freeDebugInfo(DebugInfo* debug) {
+    for (int segment = SYMBOL_TEXT; segment <= SYMBOL_DATA; segment++) {
+        for (uint32_t i = 0; i < debug->symbolCount[segment]; i++) {
+            free(debug->symbols[segment][i].name);
+        }
+        free(debug->symbols[segment]);
+        debug->symbols[segment] = NULL;
+        debug->symbolCount[segment] = 0;
+    }
+
+    free(debug->lines);
+    debug->lines = NULL;
+    debug->lineCount = 0;
+    debug->loaded = false;
+}
+
+// Entries are an address word, a segment byte, a length byte and the name
+static bool readSymbols(DebugInfo* debug, FILE* file) {
+    if (fseek(file, debug->symtabOffset, SEEK_SET) != 0) return false;
+
+    uint32_t capacity[2] = {0, 0};
+    long end = (long)debug->symtabOffset + debug->symtabSize;
+    while (ftell(file) < end) {
+        uint32_t address;
+        int segment, length;
+        if (!readWord(file, &address) || (segment = fgetc(file)) == EOF || (length = fgetc(file)) == EOF) return false;
+        if (segment != SYMBOL_TEXT && segment != SYMBOL_DATA) return false;
+
+        char* name = malloc(length + 1);
+        if (name == NULL || fread(name, sizeof(char), length, file) != (size_t)length) {
+            free(name);
+            return false;
+        }
+        name[length] = '\0';
+
+        if (debug->symbolCount[segment] == capacity[segment]) {
+            capacity[segment] = capacity[segment] < 8 ? 8 : capacity[segment] * 2;
+            debug->symbols[segment] = realloc(debug->symbols[segment], capacity[segment] * sizeof(Symbol));
+        }
+
+        Symbol symbol = {segment == SYMBOL_DATA ? DATA_ADDRESS + address : address, name};
+        debug->symbols[segment][debug->symbolCount[segment]++] = symbol;
+    }
+
+    for (int segment = SYMBOL_TEXT; segment <= SYMBOL_DATA; segment++) {
+        qsort(debug->symbols[segment], debug->symbolCount[segment], sizeof(Symbol), compareSymbols);
+    }
+
+    return true;
+}
+
+static bool readLines(DebugInfo* debug, FILE* file) {
+    if (fseek(file, debug->linesOffset, SEEK_SET) != 0) return false;
+
+    debug->lineCount = debug->linesSize / 8;
+    debug->lines = malloc(debug->lineCount * sizeof(LineEntry));
+    if (debug->lines == NULL) return false;
+
+    for (uint32_t i = 0; i < debug->lineCount; i++) {
+        if (!readWord(file, &debug->lines[i].ip) || !readWord(file, &debug->lines[i].line)) return false;
+    }
+    qsort(debug->lines, debug->lineCount, sizeof(LineEntry), compareLines);
+
+    return true;
+}
+
+bool loadDebugInfo(DebugInfo* debug) {
+    if (debug->loaded) return true;
+    debug->loaded = true;
+
+    if (debug->symtabSize == 0 && debug->linesSize == 0) return true;
+
+    FILE* file = fopen(debug->path, "rb");
+    if (file == NULL) return false;
+
+    bool ok = (debug->symtabSize == 0 || readSymbols(debug, file)) && (debug->linesSize == 0 || readLines(debug, file));
+    fclose(file);
+
+    // A damaged section is treated as absent rather than failing the report that needed it
+    if (!ok) {
+        freeDebugInfo(debug);
+        debug->loaded = true;
+    }
+
+    return ok;
+}
+
+const Symbol* findSymbol(DebugInfo* debug, SymbolSegment segment, uint32_t address) {
+    if (debug == NULL || !loadDebugInfo(debug)) return NULL;
+
+    // Closest symbol at or below the address
+    const Symbol* symbols = debug->symbols[segment];
+    uint32_t low = 0, high = debug->symbolCount[segment];
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (symbols[middle].address <= address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low == 0 ? NULL : &symbols[low - 1];
+}
+
+uint32_t findLine(DebugInfo* debug, uint32_t ip) {
+    if (debug == NULL || !loadDebugInfo(debug)) return 0;
+
+    uint32_t low = 0, high = debug->lineCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (debug->lines[middle].ip <= ip) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low == 0 ? 0 : debug->lines[low - 1].line;
+}
+
+// Writes "symbol+offset (line n)" for an ip, or as much of it as the executable describes
+void formatLocation(DebugInfo* debug, uint32_t ip, char* buffer, size_t size) {
+    const Symbol* symbol = findSymbol(debug, SYMBOL_TEXT, ip);
+    uint32_t line = findLine(debug, ip);
+
+    int length = 0;
+    if (symbol != NULL) {
+        length = ip == symbol->address
+            ? snprintf(buffer, size, "%s", symbol->name)
+            : snprintf(buffer, size, "%s+%#x", symbol->name, ip - symbol->address);
+    } else {
+        length = snprintf(buffer, size, "%#08x", PROGRAM_ADDRESS + ip);
+    }
+
+    if (line != 0 && length >= 0 && (size_t)length < size) {
+        snprintf(buffer + length, size - length, " (line %u)", line);
+    }
+}
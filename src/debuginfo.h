@@ -0,0 +1,43 @@
+#ifndef LMIPS_DEBUGINFO
+#define LMIPS_DEBUGINFO
+
+#include <stddef.h>
+#include "common.h"
+
+typedef enum {
+    SYMBOL_TEXT,
+    SYMBOL_DATA
+} SymbolSegment;
+
+typedef struct {
+    uint32_t address; // ip for text symbols, memory address for data symbols
+    char* name;
+} Symbol;
+
+typedef struct {
+    uint32_t ip;
+    uint32_t line;
+} LineEntry;
+
+// Symbol and line sections of an executable. The loader only notes where they are,
+// they are read from the file the first time a report asks for a name or a line.
+typedef struct {
+    const char* path;
+    uint32_t symtabOffset, symtabSize;
+    uint32_t linesOffset, linesSize;
+    bool loaded;
+    Symbol* symbols[2];
+    uint32_t symbolCount[2];
+    LineEntry* lines;
+    uint32_t lineCount;
+} DebugInfo;
+
+void initDebugInfo(DebugInfo* debug, const char* path);
+void freeDebugInfo(DebugInfo* debug);
+bool loadDebugInfo(DebugInfo* debug);
+
+const Symbol* findSymbol(DebugInfo* debug, SymbolSegment segment, uint32_t address);
+uint32_t findLine(DebugInfo* debug, uint32_t ip);
+void formatLocation(DebugInfo* debug, uint32_t ip, char* buffer, size_t size);
+
+#endif // LMIPS_DEBUGINFO
@@ -0,0 +1,449 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include "decode.h"
+#include "lmips_opcodes.h"
+#include "lmips_registers.h"
+#include "memory.h"
+
+#define FNV32_OFFSET 0x811C9DC5u
+#define FNV32_PRIME 0x01000193u
+
+#define GET_OP(instr) (instr >> 0x1A)
+#define GET_RS(instr) ((instr >> 0x15) & 0x1F)
+#define GET_RT(instr) ((instr >> 0x10) & 0x1F)
+#define GET_RD(instr) ((instr >> 0x0B) & 0x1F)
+#define GET_SA(instr) ((instr >> 0x06) & 0x1F)
+#define GET_FUNC(instr) (instr & 0x3F)
+#define GET_IMMED(instr) (instr & 0xFFFF)
+#define GET_JT(instr) (instr & 0x3FFFFFF)
+
+static uint8_t decodeSpecial(uint8_t func) {
+    switch (func) {
+        case SPE_SLL: return DOP_SLL;
+        case SPE_SRL: return DOP_SRL;
+        case SPE_SRA: return DOP_SRA;
+        case SPE_SLLV: return DOP_SLLV;
+        case SPE_SRLV: return DOP_SRLV;
+        case SPE_SRAV: return DOP_SRAV;
+        case SPE_JR: return DOP_JR;
+        case SPE_JALR: return DOP_JALR;
+        case SPE_MOVZ: return DOP_MOVZ;
+        case SPE_MOVN: return DOP_MOVN;
+        case SPE_SYSCALL: return DOP_SYSCALL;
+        case SPE_MFHI: return DOP_MFHI;
+        case SPE_MTHI: return DOP_MTHI;
+        case SPE_MFLO: return DOP_MFLO;
+        case SPE_MTLO: return DOP_MTLO;
+        case SPE_MULT: return DOP_MULT;
+        case SPE_MULTU: return DOP_MULTU;
+        case SPE_DIV: return DOP_DIV;
+        case SPE_DIVU: return DOP_DIVU;
+        case SPE_ADD: return DOP_ADD;
+        case SPE_ADDU: return DOP_ADDU;
+        case SPE_SUB: return DOP_SUB;
+        case SPE_SUBU: return DOP_SUBU;
+        case SPE_AND: return DOP_AND;
+        case SPE_OR: return DOP_OR;
+        case SPE_XOR: return DOP_XOR;
+        case SPE_NOR: return DOP_NOR;
+        case SPE_SLT: return DOP_SLT;
+        case SPE_SLTU: return DOP_SLTU;
+        default: return DOP_UNKNOWN_SPECIAL;
+    }
+}
+
+static uint8_t decodeSpecial2(uint8_t func) {
+    switch (func) {
+        case SP2_MUL: return DOP_MUL;
+        case SP2_CLZ: return DOP_CLZ;
+        case SP2_CLO: return DOP_CLO;
+        default: return DOP_UNKNOWN;
+    }
+}
+
+// Fields running past bit 31 are reserved encodings, they decode as unknown instructions
+static void decodeSpecial3(uint32_t instr, DecodedInstr* decoded) {
+    uint8_t lsb = GET_SA(instr);
+    uint8_t msb = GET_RD(instr);
+    decoded->op = DOP_UNKNOWN;
+
+    switch (GET_FUNC(instr)) {
+        case SP3_EXT:
+            if (lsb + msb > 31) return;
+            decoded->op = DOP_EXT;
+            decoded->rd = lsb;
+            decoded->immed = 0xFFFFFFFFu >> (31 - msb);
+            return;
+        case SP3_INS:
+            if (msb < lsb) return;
+            decoded->op = DOP_INS;
+            decoded->rd = lsb;
+            decoded->immed = (0xFFFFFFFFu >> (31 - msb + lsb)) << lsb;
+            return;
+        case SP3_BSHFL:
+            if (lsb == BSHFL_SEB) decoded->op = DOP_SEB;
+            if (lsb == BSHFL_SEH) decoded->op = DOP_SEH;
+            return;
+    }
+}
+
+static uint8_t decodeCop1Format(uint8_t fmt, uint8_t func, uint8_t fd) {
+    uint8_t base = fmt == FMT_S ? DOP_ADD_S : DOP_ADD_D;
+    uint8_t compares = fmt == FMT_S ? DOP_C_EQ_S : DOP_C_EQ_D;
+
+    if (func <= FPU_NEG) return base + func;
+    switch (func) {
+        // Only the first condition code is there, compares naming another one are unknown
+        case FPU_C_EQ: return fd == 0 ? compares : DOP_UNKNOWN;
+        case FPU_C_LT: return fd == 0 ? compares + 1 : DOP_UNKNOWN;
+        case FPU_C_LE: return fd == 0 ? compares + 2 : DOP_UNKNOWN;
+        case FPU_CVT_S: return fmt == FMT_D ? DOP_CVT_S_D : DOP_UNKNOWN;
+        case FPU_CVT_D: return fmt == FMT_S ? DOP_CVT_D_S : DOP_UNKNOWN;
+        case FPU_CVT_W: return fmt == FMT_S ? DOP_CVT_W_S : DOP_CVT_W_D;
+        case FPU_TRUNC_W: return fmt == FMT_S ? DOP_TRUNC_W_S : DOP_TRUNC_W_D;
+        default: return DOP_UNKNOWN;
+    }
+}
+
+static void decodeCop1(uint32_t ip, uint32_t instr, DecodedInstr* decoded) {
+    uint8_t fmt = GET_RS(instr);
+    decoded->rd = GET_SA(instr);
+    decoded->rs = GET_RD(instr);
+
+    switch (fmt) {
+        case FMT_MF: decoded->op = DOP_MFC1; break;
+        case FMT_MT: decoded->op = DOP_MTC1; break;
+        case FMT_BC: {
+            // Condition code 0 only and no likely forms, tf is the low bit of rt
+            uint8_t rt = GET_RT(instr);
+            decoded->op = rt == 0 ? DOP_BC1F : (rt == 1 ? DOP_BC1T : DOP_UNKNOWN);
+            decoded->immed = ip + sign_extend(GET_IMMED(instr) << 2, 14);
+            break;
+        }
+        case FMT_S:
+        case FMT_D:
+            decoded->op = decodeCop1Format(fmt, GET_FUNC(instr), decoded->rd);
+            break;
+        case FMT_W:
+            decoded->op = GET_FUNC(instr) == FPU_CVT_S ? DOP_CVT_S_W :
+                          (GET_FUNC(instr) == FPU_CVT_D ? DOP_CVT_D_W : DOP_UNKNOWN);
+            break;
+        default:
+            decoded->op = DOP_UNKNOWN;
+            break;
+    }
+}
+
+// Doubles live in even/odd register pairs, an odd register there would reach past the register file
+static bool pairedRegisters(const DecodedInstr* decoded) {
+    switch (decoded->op) {
+        case DOP_ADD_D:
+        case DOP_SUB_D:
+        case DOP_MUL_D:
+        case DOP_DIV_D:
+        case DOP_SQRT_D:
+        case DOP_ABS_D:
+        case DOP_MOV_D:
+        case DOP_NEG_D:
+        case DOP_C_EQ_D:
+        case DOP_C_LT_D:
+        case DOP_C_LE_D:
+            return ((decoded->rd | decoded->rs | decoded->rt) & 0x01) == 0;
+        case DOP_CVT_D_S:
+        case DOP_CVT_D_W:
+            return (decoded->rd & 0x01) == 0;
+        case DOP_CVT_S_D:
+        case DOP_CVT_W_D:
+        case DOP_TRUNC_W_D:
+            return (decoded->rs & 0x01) == 0;
+        case DOP_LDC1:
+        case DOP_SDC1:
+            return (decoded->rt & 0x01) == 0;
+        default:
+            return true;
+    }
+}
+
+// Only byte, half and word lanes are there, doubleword formats decode as unknown instructions
+static void decodeMsa(uint32_t instr, DecodedInstr* decoded) {
+    uint8_t minor = GET_FUNC(instr);
+    decoded->op = DOP_UNKNOWN;
+    decoded->rd = GET_SA(instr);
+    decoded->rs = GET_RD(instr);
+
+    switch (minor) {
+        case MSA_SHF: {
+            uint8_t df = (instr >> 0x18) & 0x03;
+            if (df == DF_D) return;
+            decoded->op = DOP_SHF_B + df;
+            decoded->immed = (instr >> 0x10) & 0xFF;
+            return;
+        }
+        case MSA_ARITH:
+        case MSA_COMPARE:
+        case MSA_HORIZONTAL: {
+            uint8_t operation = (instr >> 0x17) & 0x07;
+            uint8_t df = (instr >> 0x15) & 0x03;
+            if (df == DF_D) return;
+
+            if (minor == MSA_ARITH && operation <= MSA_MIN_U) {
+                decoded->op = DOP_ADDV_B + operation * 3 + df;
+            } else if (minor == MSA_COMPARE && operation == MSA_CEQ) {
+                decoded->op = DOP_CEQ_B + df;
+            } else if (minor == MSA_COMPARE && (operation == MSA_CLT_S || operation == MSA_CLT_U)) {
+                decoded->op = DOP_CLT_S_B + (operation - MSA_CLT_S) * 3 + df;
+            } else if (minor == MSA_HORIZONTAL && (operation == MSA_HADD_S || operation == MSA_HADD_U) && df != DF_B) {
+                // Widening adds, the lanes of wd are twice as wide as the ones they sum
+                decoded->op = DOP_HADD_S_H + (operation - MSA_HADD_S) * 2 + df - DF_H;
+            }
+            return;
+        }
+        case MSA_ELM: {
+            // The lane size is encoded by the leading ones of the df/n field, the lane index follows
+            uint8_t operation = (instr >> 0x16) & 0x0F;
+            uint8_t field = (instr >> 0x10) & 0x3F;
+            uint8_t df = (field & 0x30) == 0x00 ? DF_B : ((field & 0x38) == 0x20 ? DF_H : ((field & 0x3C) == 0x30 ? DF_W : DF_D));
+            if (df == DF_D) return;
+
+            // copy_u.w only exists with 64-bit registers
+            if (operation == MSA_COPY_S) decoded->op = DOP_COPY_S_B + df;
+            if (operation == MSA_COPY_U && df != DF_W) decoded->op = DOP_COPY_U_B + df;
+            decoded->immed = field & (0x0F >> df);
+            return;
+        }
+        case MSA_2R: {
+            uint8_t df = (instr >> 0x10) & 0x03;
+            if (((instr >> 0x12) & 0xFF) == MSA_FILL && df != DF_D) decoded->op = DOP_FILL_B + df;
+            return;
+        }
+        default: {
+            // ld and st offsets count lanes, they are kept scaled to bytes
+            uint8_t df = minor & 0x03;
+            if ((minor & 0x3C) != MSA_LD && (minor & 0x3C) != MSA_ST) return;
+            if (df == DF_D) return;
+
+            decoded->op = ((minor & 0x3C) == MSA_LD ? DOP_LD_B : DOP_ST_B) + df;
+            decoded->immed = sign_extend((instr >> 0x10) & 0x3FF, 10) * (1 << df);
+            return;
+        }
+    }
+}
+
+// copy_s and copy_u read a single lane, the index has to stay within the register
+// Shifting a word by 32 or more is undefined in C, the field of a real instruction never holds that much
+static bool shiftInRange(const DecodedInstr* decoded) {
+    switch (decoded->op) {
+        case DOP_SLL:
+        case DOP_SRL:
+        case DOP_SRA:
+            return decoded->immed < 32;
+        default:
+            return true;
+    }
+}
+
+static bool laneInRange(const DecodedInstr* decoded) {
+    switch (decoded->op) {
+        case DOP_COPY_S_B:
+        case DOP_COPY_U_B:
+            return decoded->immed < 16;
+        case DOP_COPY_S_H:
+        case DOP_COPY_U_H:
+            return decoded->immed < 8;
+        case DOP_COPY_S_W:
+            return decoded->immed < 4;
+        default:
+            return true;
+    }
+}
+
+void decodeInstruction(uint32_t ip, uint32_t instr, DecodedInstr* decoded) {
+    uint8_t op = GET_OP(instr);
+    decoded->rd = GET_RD(instr);
+    decoded->rs = GET_RS(instr);
+    decoded->rt = GET_RT(instr);
+    decoded->immed = 0;
+
+    switch (op) {
+        case OP_SPECIAL: {
+            decoded->op = decodeSpecial(GET_FUNC(instr));
+            if (decoded->op == DOP_UNKNOWN_SPECIAL) {
+                decoded->immed = GET_FUNC(instr);
+            } else if (decoded->op == DOP_JALR) {
+                decoded->rd = decoded->rd <= 0 ? $ra : decoded->rd;
+            } else {
+                decoded->immed = GET_SA(instr);
+            }
+            return;
+        }
+        case OP_SPECIAL2:
+            decoded->op = decodeSpecial2(GET_FUNC(instr));
+            if (decoded->op == DOP_UNKNOWN) decoded->immed = op;
+            return;
+        case OP_SPECIAL3:
+            decodeSpecial3(instr, decoded);
+            if (decoded->op == DOP_UNKNOWN) decoded->immed = op;
+            return;
+        case OP_MSA:
+            decodeMsa(instr, decoded);
+            if (decoded->op == DOP_UNKNOWN) decoded->immed = op;
+            return;
+        case OP_COP1:
+            decodeCop1(ip, instr, decoded);
+            if (!pairedRegisters(decoded)) decoded->op = DOP_UNKNOWN;
+            if (decoded->op == DOP_UNKNOWN) decoded->immed = op;
+            return;
+        case OP_SRI: {
+            uint8_t rt = GET_RT(instr);
+            decoded->op = rt == SR_BLTZ ? DOP_BLTZ : (rt == SR_BGEZ ? DOP_BGEZ : DOP_UNKNOWN_REGIMM);
+            decoded->immed = decoded->op == DOP_UNKNOWN_REGIMM ? rt : ip + sign_extend(GET_IMMED(instr) << 2, 14);
+            return;
+        }
+        case OP_J:
+        case OP_JAL:
+            decoded->op = op == OP_J ? DOP_J : DOP_JAL;
+            decoded->immed = GET_JT(instr) << 2;
+            return;
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_BLEZ:
+        case OP_BGTZ:
+            decoded->op = DOP_BEQ + (op - OP_BEQ);
+            // Branch offsets are relative to the branch itself
+            decoded->immed = ip + sign_extend(GET_IMMED(instr) << 2, 14);
+            return;
+        case OP_ADDI:
+        case OP_ADDIU:
+        case OP_SLTI:
+        case OP_SLTIU:
+            decoded->op = DOP_ADDI + (op - OP_ADDI);
+            decoded->immed = sign_extend(GET_IMMED(instr), 16);
+            return;
+        case OP_ANDI:
+        case OP_ORI:
+        case OP_XORI:
+            decoded->op = DOP_ANDI + (op - OP_ANDI);
+            decoded->immed = zero_extend(GET_IMMED(instr), 16);
+            return;
+        case OP_LUI:
+            decoded->op = DOP_LUI;
+            decoded->immed = GET_IMMED(instr) << 16;
+            return;
+        case OP_LB: decoded->op = DOP_LB; break;
+        case OP_LH: decoded->op = DOP_LH; break;
+        case OP_LW: decoded->op = DOP_LW; break;
+        case OP_LBU: decoded->op = DOP_LBU; break;
+        case OP_LHU: decoded->op = DOP_LHU; break;
+        case OP_SB: decoded->op = DOP_SB; break;
+        case OP_SH: decoded->op = DOP_SH; break;
+        case OP_SW: decoded->op = DOP_SW; break;
+        case OP_LWC1: decoded->op = DOP_LWC1; break;
+        case OP_SWC1: decoded->op = DOP_SWC1; break;
+        case OP_LDC1:
+        case OP_SDC1:
+            decoded->op = op == OP_LDC1 ? DOP_LDC1 : DOP_SDC1;
+            if (pairedRegisters(decoded)) break;
+            decoded->op = DOP_UNKNOWN;
+            decoded->immed = op;
+            return;
+        default:
+            decoded->op = DOP_UNKNOWN;
+            decoded->immed = op;
+            return;
+    }
+
+    // Loads and stores keep the sign extended offset
+    decoded->immed = (int16_t)GET_IMMED(instr);
+}
+
+void initDecodedText(DecodedText* text) {
+    text->instrs = NULL;
+    text->count = 0;
+    text->mapping = NULL;
+    text->mappingSize = 0;
+}
+
+bool decodeText(DecodedText* text, const uint8_t* program, uint32_t size, bool littleEndian) {
+    initDecodedText(text);
+    text->count = size >> 2;
+    text->instrs = malloc((text->count > 0 ? text->count : 1) * sizeof(DecodedInstr));
+    if (text->instrs == NULL) {
+        text->count = 0;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < text->count; i++) {
+        decodeInstruction(i << 2, mem_read_instr(program, i << 2, littleEndian), &text->instrs[i]);
+    }
+
+    return true;
+}
+
+uint32_t textHash(const uint8_t* program, uint32_t size) {
+    uint32_t hash = FNV32_OFFSET;
+    for (uint32_t i = 0; i < size; i++) {
+        hash = (hash ^ program[i]) * FNV32_PRIME;
+    }
+
+    return hash;
+}
+
+static uint32_t readWord(const uint8_t* bytes) {
+    return ((uint32_t)bytes[0] << 0x18) | (bytes[1] << 0x10) | (bytes[2] << 0x08) | bytes[3];
+}
+
+bool validDecodedInstr(const DecodedInstr* decoded) {
+    return decoded->op < DOP_COUNT && decoded->rd < REG_COUNT && decoded->rs < REG_COUNT && decoded->rt < REG_COUNT &&
+           pairedRegisters(decoded) && shiftInRange(decoded) && laneInRange(decoded);
+}
+
+// Once the size and hash tie the section to the loaded text its records are used as they are, re-decoding
+// them would cost more than decodeText. Only the bounds the handlers rely on are checked.
+bool readDecodedText(DecodedText* text, const uint8_t* section, uint32_t size, const uint8_t* program,
+                     uint32_t textSize) {
+    if (size < DECODED_HEADER_SIZE || (size - DECODED_HEADER_SIZE) % DECODED_INSTR_SIZE != 0 ||
+        readWord(section) != textSize || (size - DECODED_HEADER_SIZE) / DECODED_INSTR_SIZE != textSize >> 2) {
+        fprintf(stderr, "Decoded section does not cover the text segment.\n");
+        return false;
+    }
+    if (readWord(&section[4]) != textHash(program, textSize)) {
+        fprintf(stderr, "Decoded section was built for another text segment.\n");
+        return false;
+    }
+
+    initDecodedText(text);
+    text->count = textSize >> 2;
+    text->instrs = malloc((text->count > 0 ? text->count : 1) * sizeof(DecodedInstr));
+    if (text->instrs == NULL) {
+        text->count = 0;
+        return false;
+    }
+
+    const uint8_t* record = &section[DECODED_HEADER_SIZE];
+    for (uint32_t i = 0; i < text->count; i++, record += DECODED_INSTR_SIZE) {
+        DecodedInstr* decoded = &text->instrs[i];
+        decoded->op = record[0];
+        decoded->rd = record[1];
+        decoded->rs = record[2];
+        decoded->rt = record[3];
+        decoded->immed = readWord(&record[4]);
+
+        if (!validDecodedInstr(decoded)) {
+            fprintf(stderr, "Decoded instruction at %#08x is invalid.\n", PROGRAM_ADDRESS + (i << 2));
+            freeDecodedText(text);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void freeDecodedText(DecodedText* text) {
+    if (text->mapping != NULL) {
+        munmap(text->mapping, text->mappingSize);
+    } else {
+        free(text->instrs);
+    }
+    initDecodedText(text);
+}
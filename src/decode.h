@@ -0,0 +1,200 @@
+#ifndef LMIPS_DECODE
+#define LMIPS_DECODE
+
+#include "common.h"
+
+#define DECODED_INSTR_SIZE 8 // Bytes per instruction in the SHT_DECODED section
+#define DECODED_HEADER_SIZE 8 // Text size and text hash ahead of the instructions
+#define DECODE_VERSION 4 // Bumped whenever a word decodes differently, it invalidates cached decodings
+
+// Handler of a decoded instruction. The values are part of the executable format, lasm writes them
+// too (assembler/src/decoded.dart), new handlers only ever go at the end.
+typedef enum {
+    DOP_UNKNOWN, // Unknown opcode, immed holds it
+    DOP_UNKNOWN_SPECIAL, // Unknown special function, immed holds it
+    DOP_UNKNOWN_REGIMM, // Unknown regimm code, immed holds it
+    DOP_SLL,
+    DOP_SRL,
+    DOP_SRA,
+    DOP_SLLV,
+    DOP_SRLV,
+    DOP_SRAV,
+    DOP_JR,
+    DOP_JALR,
+    DOP_SYSCALL,
+    DOP_MFHI,
+    DOP_MTHI,
+    DOP_MFLO,
+    DOP_MTLO,
+    DOP_MULT,
+    DOP_MULTU,
+    DOP_DIV,
+    DOP_DIVU,
+    DOP_ADD,
+    DOP_ADDU,
+    DOP_SUB,
+    DOP_SUBU,
+    DOP_AND,
+    DOP_OR,
+    DOP_XOR,
+    DOP_NOR,
+    DOP_SLT,
+    DOP_SLTU,
+    DOP_BLTZ,
+    DOP_BGEZ,
+    DOP_J,
+    DOP_JAL,
+    DOP_BEQ,
+    DOP_BNE,
+    DOP_BLEZ,
+    DOP_BGTZ,
+    DOP_ADDI,
+    DOP_ADDIU,
+    DOP_SLTI,
+    DOP_SLTIU,
+    DOP_ANDI,
+    DOP_ORI,
+    DOP_XORI,
+    DOP_LUI,
+    DOP_LB,
+    DOP_LH,
+    DOP_LW,
+    DOP_LBU,
+    DOP_LHU,
+    DOP_SB,
+    DOP_SH,
+    DOP_SW,
+    DOP_MOVZ,
+    DOP_MOVN,
+    DOP_MUL,
+    DOP_CLZ,
+    DOP_CLO,
+    DOP_SEB,
+    DOP_SEH,
+    DOP_EXT, // rd holds the position of the field, immed the mask of its width
+    DOP_INS, // rd holds the position of the field, immed its mask in place
+    // CP1 arithmetic, rd holds fd, rs fs and rt ft. The eight operations of each format follow the
+    // order of their function codes.
+    DOP_ADD_S,
+    DOP_SUB_S,
+    DOP_MUL_S,
+    DOP_DIV_S,
+    DOP_SQRT_S,
+    DOP_ABS_S,
+    DOP_MOV_S,
+    DOP_NEG_S,
+    DOP_ADD_D,
+    DOP_SUB_D,
+    DOP_MUL_D,
+    DOP_DIV_D,
+    DOP_SQRT_D,
+    DOP_ABS_D,
+    DOP_MOV_D,
+    DOP_NEG_D,
+    DOP_C_EQ_S,
+    DOP_C_LT_S,
+    DOP_C_LE_S,
+    DOP_C_EQ_D,
+    DOP_C_LT_D,
+    DOP_C_LE_D,
+    DOP_CVT_S_D,
+    DOP_CVT_S_W,
+    DOP_CVT_D_S,
+    DOP_CVT_D_W,
+    DOP_CVT_W_S,
+    DOP_CVT_W_D,
+    DOP_TRUNC_W_S,
+    DOP_TRUNC_W_D,
+    DOP_MFC1, // rt holds the general-purpose register, rs the CP1 one
+    DOP_MTC1,
+    DOP_LWC1, // rt holds the CP1 register
+    DOP_SWC1,
+    DOP_LDC1,
+    DOP_SDC1,
+    DOP_BC1F,
+    DOP_BC1T,
+    // MSA, rd holds wd, rs ws and rt wt. Each operation comes in byte, half and word lanes, and the
+    // arithmetic ones follow the order of their operation field.
+    DOP_ADDV_B,
+    DOP_ADDV_H,
+    DOP_ADDV_W,
+    DOP_SUBV_B,
+    DOP_SUBV_H,
+    DOP_SUBV_W,
+    DOP_MAX_S_B,
+    DOP_MAX_S_H,
+    DOP_MAX_S_W,
+    DOP_MAX_U_B,
+    DOP_MAX_U_H,
+    DOP_MAX_U_W,
+    DOP_MIN_S_B,
+    DOP_MIN_S_H,
+    DOP_MIN_S_W,
+    DOP_MIN_U_B,
+    DOP_MIN_U_H,
+    DOP_MIN_U_W,
+    DOP_CEQ_B,
+    DOP_CEQ_H,
+    DOP_CEQ_W,
+    DOP_CLT_S_B,
+    DOP_CLT_S_H,
+    DOP_CLT_S_W,
+    DOP_CLT_U_B,
+    DOP_CLT_U_H,
+    DOP_CLT_U_W,
+    DOP_HADD_S_H,
+    DOP_HADD_S_W,
+    DOP_HADD_U_H,
+    DOP_HADD_U_W,
+    DOP_SHF_B, // immed holds the lane selectors
+    DOP_SHF_H,
+    DOP_SHF_W,
+    DOP_LD_B, // rs holds the base register, immed the scaled offset
+    DOP_LD_H,
+    DOP_LD_W,
+    DOP_ST_B,
+    DOP_ST_H,
+    DOP_ST_W,
+    DOP_FILL_B, // rs holds the general-purpose register
+    DOP_FILL_H,
+    DOP_FILL_W,
+    DOP_COPY_S_B, // rd holds the general-purpose register, immed the lane
+    DOP_COPY_S_H,
+    DOP_COPY_S_W,
+    DOP_COPY_U_B,
+    DOP_COPY_U_H,
+    DOP_COUNT
+} DecodedOp;
+
+// Everything the interpreter extracts from an instruction word. immed is the shift amount of
+// R-type shifts, the extended immediate of I-type instructions, the absolute ip a branch or
+// jump goes to, and the jalr link register is resolved in rd.
+typedef struct {
+    uint8_t op;
+    uint8_t rd;
+    uint8_t rs;
+    uint8_t rt;
+    uint32_t immed;
+} DecodedInstr;
+
+typedef struct {
+    DecodedInstr* instrs; // Indexed by ip >> 2
+    uint32_t count;
+    void* mapping; // Cache file instrs points into, they are owned by the text otherwise
+    size_t mappingSize;
+} DecodedText;
+
+void decodeInstruction(uint32_t ip, uint32_t instr, DecodedInstr* decoded);
+// Whether running a record can only touch the machine state, records read from files are checked with it
+bool validDecodedInstr(const DecodedInstr* decoded);
+
+void initDecodedText(DecodedText* text);
+bool decodeText(DecodedText* text, const uint8_t* program, uint32_t size, bool littleEndian);
+// Reads an SHT_DECODED section, it is rejected unless its size and hash match the text loaded at program
+bool readDecodedText(DecodedText* text, const uint8_t* section, uint32_t size, const uint8_t* program,
+                     uint32_t textSize);
+void freeDecodedText(DecodedText* text);
+
+uint32_t textHash(const uint8_t* program, uint32_t size);
+
+#endif // LMIPS_DECODE
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include "disasm.h"
+#include "decode.h"
+#include "memory.h"
+#include "lmips_opcodes.h"
+#include "lmips_registers.h"
+
+#define GET_OP(instr) (instr >> 0x1A)
+#define GET_RS(instr) ((instr >> 0x15) & 0x1F)
+#define GET_RT(instr) ((instr >> 0x10) & 0x1F)
+#define GET_RD(instr) ((instr >> 0x0B) & 0x1F)
+#define GET_SA(instr) ((instr >> 0x06) & 0x1F)
+#define GET_FUNC(instr) (instr & 0x3F)
+#define GET_IMMED(instr) (instr & 0xFFFF)
+#define GET_JT(instr) (instr & 0x3FFFFFF)
+
+static const char* registerNames[REG_COUNT] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+};
+
+const char* registerName(uint8_t reg) {
+    return registerNames[reg & 0x1F];
+}
+
+static bool disassembleSpecial(uint32_t instr, char* buffer, size_t size) {
+    const char* rs = registerName(GET_RS(instr));
+    const char* rt = registerName(GET_RT(instr));
+    const char* rd = registerName(GET_RD(instr));
+
+    switch (GET_FUNC(instr)) {
+        case SPE_SLL: snprintf(buffer, size, "sll %s, %s, %u", rd, rt, GET_SA(instr)); break;
+        case SPE_SRL: snprintf(buffer, size, "srl %s, %s, %u", rd, rt, GET_SA(instr)); break;
+        case SPE_SRA: snprintf(buffer, size, "sra %s, %s, %u", rd, rt, GET_SA(instr)); break;
+        case SPE_SLLV: snprintf(buffer, size, "sllv %s, %s, %s", rd, rt, rs); break;
+        case SPE_SRLV: snprintf(buffer, size, "srlv %s, %s, %s", rd, rt, rs); break;
+        case SPE_SRAV: snprintf(buffer, size, "srav %s, %s, %s", rd, rt, rs); break;
+        case SPE_JR: snprintf(buffer, size, "jr %s", rs); break;
+        case SPE_JALR: snprintf(buffer, size, "jalr %s, %s", rd, rs); break;
+        case SPE_MOVZ: snprintf(buffer, size, "movz %s, %s, %s", rd, rs, rt); break;
+        case SPE_MOVN: snprintf(buffer, size, "movn %s, %s, %s", rd, rs, rt); break;
+        case SPE_SYSCALL: snprintf(buffer, size, "syscall"); break;
+        case SPE_MFHI: snprintf(buffer, size, "mfhi %s", rd); break;
+        case SPE_MTHI: snprintf(buffer, size, "mthi %s", rs); break;
+        case SPE_MFLO: snprintf(buffer, size, "mflo %s", rd); break;
+        case SPE_MTLO: snprintf(buffer, size, "mtlo %s", rs); break;
+        case SPE_MULT: snprintf(buffer, size, "mult %s, %s", rs, rt); break;
+        case SPE_MULTU: snprintf(buffer, size, "multu %s, %s", rs, rt); break;
+        case SPE_DIV: snprintf(buffer, size, "div %s, %s", rs, rt); break;
+        case SPE_DIVU: snprintf(buffer, size, "divu %s, %s", rs, rt); break;
+        case SPE_ADD: snprintf(buffer, size, "add %s, %s, %s", rd, rs, rt); break;
+        case SPE_ADDU: snprintf(buffer, size, "addu %s, %s, %s", rd, rs, rt); break;
+        case SPE_SUB: snprintf(buffer, size, "sub %s, %s, %s", rd, rs, rt); break;
+        case SPE_SUBU: snprintf(buffer, size, "subu %s, %s, %s", rd, rs, rt); break;
+        case SPE_AND: snprintf(buffer, size, "and %s, %s, %s", rd, rs, rt); break;
+        case SPE_OR: snprintf(buffer, size, "or %s, %s, %s", rd, rs, rt); break;
+        case SPE_XOR: snprintf(buffer, size, "xor %s, %s, %s", rd, rs, rt); break;
+        case SPE_NOR: snprintf(buffer, size, "nor %s, %s, %s", rd, rs, rt); break;
+        case SPE_SLT: snprintf(buffer, size, "slt %s, %s, %s", rd, rs, rt); break;
+        case SPE_SLTU: snprintf(buffer, size, "sltu %s, %s, %s", rd, rs, rt); break;
+        default: return false;
+    }
+
+    return true;
+}
+
+static bool disassembleSpecial2(uint32_t instr, char* buffer, size_t size) {
+    const char* rs = registerName(GET_RS(instr));
+    const char* rt = registerName(GET_RT(instr));
+    const char* rd = registerName(GET_RD(instr));
+
+    switch (GET_FUNC(instr)) {
+        case SP2_MUL: snprintf(buffer, size, "mul %s, %s, %s", rd, rs, rt); break;
+        case SP2_CLZ: snprintf(buffer, size, "clz %s, %s", rd, rs); break;
+        case SP2_CLO: snprintf(buffer, size, "clo %s, %s", rd, rs); break;
+        default: return false;
+    }
+
+    return true;
+}
+
+// Field positions and sizes are printed the way they are written, not the way they are encoded
+static bool disassembleSpecial3(uint32_t instr, char* buffer, size_t size) {
+    const char* rs = registerName(GET_RS(instr));
+    const char* rt = registerName(GET_RT(instr));
+    const char* rd = registerName(GET_RD(instr));
+    uint8_t lsb = GET_SA(instr);
+    uint8_t msb = GET_RD(instr);
+
+    switch (GET_FUNC(instr)) {
+        case SP3_EXT:
+            if (lsb + msb > 31) return false;
+            snprintf(buffer, size, "ext %s, %s, %u, %u", rt, rs, lsb, msb + 1);
+            break;
+        case SP3_INS:
+            if (msb < lsb) return false;
+            snprintf(buffer, size, "ins %s, %s, %u, %u", rt, rs, lsb, msb - lsb + 1);
+            break;
+        case SP3_BSHFL:
+            if (lsb != BSHFL_SEB && lsb != BSHFL_SEH) return false;
+            snprintf(buffer, size, "%s %s, %s", lsb == BSHFL_SEB ? "seb" : "seh", rd, rt);
+            break;
+        default: return false;
+    }
+
+    return true;
+}
+
+static bool isFloatBranch(uint32_t instr) {
+    return GET_OP(instr) == OP_COP1 && GET_RS(instr) == FMT_BC && GET_RT(instr) <= 1;
+}
+
+// Same acceptance rules as the decoder: compares on condition code 0 and doubles in even registers
+static bool disassembleCop1(uint32_t instr, uint32_t target, char* buffer, size_t size) {
+    static const char* arithmetic[] = {"add", "sub", "mul", "div", "sqrt", "abs", "mov", "neg"};
+    uint8_t fmt = GET_RS(instr);
+    uint8_t func = GET_FUNC(instr);
+    uint8_t ft = GET_RT(instr), fs = GET_RD(instr), fd = GET_SA(instr);
+    char suffix = fmt == FMT_S ? 's' : (fmt == FMT_D ? 'd' : 'w');
+    bool paired = fmt != FMT_D || ((ft | fs | fd) & 0x01) == 0;
+
+    switch (fmt) {
+        case FMT_MF: snprintf(buffer, size, "mfc1 %s, $f%u", registerName(ft), fs); return true;
+        case FMT_MT: snprintf(buffer, size, "mtc1 %s, $f%u", registerName(ft), fs); return true;
+        case FMT_BC:
+            if (!isFloatBranch(instr)) return false;
+            snprintf(buffer, size, "%s %#08x", ft == 1 ? "bc1t" : "bc1f", target);
+            return true;
+        case FMT_S:
+        case FMT_D:
+            if (func < FPU_SQRT && paired) {
+                snprintf(buffer, size, "%s.%c $f%u, $f%u, $f%u", arithmetic[func], suffix, fd, fs, ft);
+                return true;
+            }
+            if (func <= FPU_NEG && paired) {
+                snprintf(buffer, size, "%s.%c $f%u, $f%u", arithmetic[func], suffix, fd, fs);
+                return true;
+            }
+            if ((func == FPU_C_EQ || func == FPU_C_LT || func == FPU_C_LE) && fd == 0 && paired) {
+                const char* cond = func == FPU_C_EQ ? "eq" : (func == FPU_C_LT ? "lt" : "le");
+                snprintf(buffer, size, "c.%s.%c $f%u, $f%u", cond, suffix, fs, ft);
+                return true;
+            }
+            break;
+        case FMT_W:
+            break;
+        default:
+            return false;
+    }
+
+    // Conversions, the destination format is in the function and the source one in fmt
+    char to;
+    switch (func) {
+        case FPU_CVT_S: to = 's'; break;
+        case FPU_CVT_D: to = 'd'; break;
+        case FPU_CVT_W: to = 'w'; break;
+        case FPU_TRUNC_W: to = 'w'; break;
+        default: return false;
+    }
+    if (to == suffix || (fmt == FMT_W && to == 'w') || (to == 'd' && (fd & 0x01)) || (fmt == FMT_D && (fs & 0x01))) {
+        return false;
+    }
+
+    snprintf(buffer, size, "%s.%c.%c $f%u, $f%u", func == FPU_TRUNC_W ? "trunc" : "cvt", to, suffix, fd, fs);
+    return true;
+}
+
+// Goes through the decoder so that both accept the same subset of MSA
+static bool disassembleMsa(uint32_t instr, char* buffer, size_t size) {
+    static const char* arithmetic[] = {"addv", "subv", "max_s", "max_u", "min_s", "min_u", "ceq", "clt_s", "clt_u"};
+    static const char formats[] = "bhw";
+    DecodedInstr decoded;
+    decodeInstruction(0, instr, &decoded);
+    uint8_t op = decoded.op;
+    uint8_t wd = decoded.rd, ws = decoded.rs, wt = decoded.rt;
+
+    if (op >= DOP_ADDV_B && op <= DOP_CLT_U_W) {
+        uint8_t index = op - DOP_ADDV_B;
+        snprintf(buffer, size, "%s.%c $w%u, $w%u, $w%u", arithmetic[index / 3], formats[index % 3], wd, ws, wt);
+    } else if (op >= DOP_HADD_S_H && op <= DOP_HADD_U_W) {
+        uint8_t index = op - DOP_HADD_S_H;
+        snprintf(buffer, size, "%s.%c $w%u, $w%u, $w%u", index < 2 ? "hadd_s" : "hadd_u", formats[index % 2 + 1], wd, ws, wt);
+    } else if (op >= DOP_SHF_B && op <= DOP_SHF_W) {
+        snprintf(buffer, size, "shf.%c $w%u, $w%u, %u", formats[op - DOP_SHF_B], wd, ws, decoded.immed);
+    } else if (op >= DOP_LD_B && op <= DOP_ST_W) {
+        uint8_t index = op - DOP_LD_B;
+        snprintf(buffer, size, "%s.%c $w%u, %d(%s)", index < 3 ? "ld" : "st", formats[index % 3], wd,
+                 (int32_t)decoded.immed, registerName(decoded.rs));
+    } else if (op >= DOP_FILL_B && op <= DOP_FILL_W) {
+        snprintf(buffer, size, "fill.%c $w%u, %s", formats[op - DOP_FILL_B], wd, registerName(decoded.rs));
+    } else if (op >= DOP_COPY_S_B && op <= DOP_COPY_U_H) {
+        uint8_t index = op - DOP_COPY_S_B;
+        snprintf(buffer, size, "%s.%c %s, $w%u[%u]", index < 3 ? "copy_s" : "copy_u", formats[index % 3],
+                 registerName(decoded.rd), ws, decoded.immed);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool disassemble(uint32_t ip, uint32_t instr, char* buffer, size_t size) {
+    static const char* loads[] = {"lb", "lh", NULL, "lw", "lbu", "lhu", NULL, NULL, "sb", "sh", "sw"};
+    const char* rs = registerName(GET_RS(instr));
+    const char* rt = registerName(GET_RT(instr));
+    int16_t immed = GET_IMMED(instr);
+    uint32_t target;
+    branchTarget(ip, instr, &target);
+    target += PROGRAM_ADDRESS;
+
+    bool known = true;
+    switch (GET_OP(instr)) {
+        case OP_SPECIAL: known = disassembleSpecial(instr, buffer, size); break;
+        case OP_SPECIAL2: known = disassembleSpecial2(instr, buffer, size); break;
+        case OP_SPECIAL3: known = disassembleSpecial3(instr, buffer, size); break;
+        case OP_COP1: known = disassembleCop1(instr, target, buffer, size); break;
+        case OP_MSA: known = disassembleMsa(instr, buffer, size); break;
+        case OP_SRI: {
+            if (GET_RT(instr) == SR_BLTZ) {
+                snprintf(buffer, size, "bltz %s, %#08x", rs, target);
+            } else if (GET_RT(instr) == SR_BGEZ) {
+                snprintf(buffer, size, "bgez %s, %#08x", rs, target);
+            } else {
+                known = false;
+            }
+            break;
+        }
+        case OP_J: snprintf(buffer, size, "j %#08x", target); break;
+        case OP_JAL: snprintf(buffer, size, "jal %#08x", target); break;
+        case OP_BEQ: snprintf(buffer, size, "beq %s, %s, %#08x", rs, rt, target); break;
+        case OP_BNE: snprintf(buffer, size, "bne %s, %s, %#08x", rs, rt, target); break;
+        case OP_BLEZ: snprintf(buffer, size, "blez %s, %#08x", rs, target); break;
+        case OP_BGTZ: snprintf(buffer, size, "bgtz %s, %#08x", rs, target); break;
+        case OP_ADDI: snprintf(buffer, size, "addi %s, %s, %d", rt, rs, immed); break;
+        case OP_ADDIU: snprintf(buffer, size, "addiu %s, %s, %d", rt, rs, immed); break;
+        case OP_SLTI: snprintf(buffer, size, "slti %s, %s, %d", rt, rs, immed); break;
+        case OP_SLTIU: snprintf(buffer, size, "sltiu %s, %s, %d", rt, rs, immed); break;
+        case OP_ANDI: snprintf(buffer, size, "andi %s, %s, %#x", rt, rs, GET_IMMED(instr)); break;
+        case OP_ORI: snprintf(buffer, size, "ori %s, %s, %#x", rt, rs, GET_IMMED(instr)); break;
+        case OP_XORI: snprintf(buffer, size, "xori %s, %s, %#x", rt, rs, GET_IMMED(instr)); break;
+        case OP_LUI: snprintf(buffer, size, "lui %s, %#x", rt, GET_IMMED(instr)); break;
+        case OP_LB:
+        case OP_LH:
+        case OP_LW:
+        case OP_LBU:
+        case OP_LHU:
+        case OP_SB:
+        case OP_SH:
+        case OP_SW:
+            snprintf(buffer, size, "%s %s, %d(%s)", loads[GET_OP(instr) - OP_LB], rt, immed, rs);
+            break;
+        case OP_LWC1:
+        case OP_SWC1:
+            snprintf(buffer, size, "%s $f%u, %d(%s)", GET_OP(instr) == OP_LWC1 ? "lwc1" : "swc1", GET_RT(instr), immed, rs);
+            break;
+        case OP_LDC1:
+        case OP_SDC1:
+            if (GET_RT(instr) & 0x01) {
+                known = false;
+                break;
+            }
+            snprintf(buffer, size, "%s $f%u, %d(%s)", GET_OP(instr) == OP_LDC1 ? "ldc1" : "sdc1", GET_RT(instr), immed, rs);
+            break;
+        default: known = false; break;
+    }
+
+    if (!known) snprintf(buffer, size, ".word %#010x", instr);
+    return known;
+}
+
+bool isControlTransfer(uint32_t instr) {
+    uint8_t op = GET_OP(instr);
+    if (op == OP_SPECIAL) return GET_FUNC(instr) == SPE_JR || GET_FUNC(instr) == SPE_JALR;
+
+    return (op >= OP_SRI && op <= OP_BGTZ) || isFloatBranch(instr);
+}
+
+// Resolves the static target of a branch or immediate jump, register jumps have none
+bool branchTarget(uint32_t ip, uint32_t instr, uint32_t* target) {
+    uint8_t op = GET_OP(instr);
+    *target = 0;
+
+    if (op == OP_J || op == OP_JAL) {
+        *target = GET_JT(instr) << 2;
+        return true;
+    }
+
+    if ((op == OP_SRI && GET_RT(instr) <= SR_BGEZ) || (op >= OP_BEQ && op <= OP_BGTZ) || isFloatBranch(instr)) {
+        // Same offset arithmetic as the interpreter, relative to the branch itself
+        *target = ip + sign_extend(GET_IMMED(instr) << 2, 14);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,14 @@
+#ifndef LMIPS_DISASM
+#define LMIPS_DISASM
+
+#include <stddef.h>
+#include "common.h"
+
+const char* registerName(uint8_t reg);
+
+// Writes the assembly text of the instruction found at ip, unknown encodings are shown as a .word
+bool disassemble(uint32_t ip, uint32_t instr, char* buffer, size_t size);
+bool isControlTransfer(uint32_t instr);
+bool branchTarget(uint32_t ip, uint32_t instr, uint32_t* target);
+
+#endif // LMIPS_DISASM
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "executable.h"
+
+#define FNV32_OFFSET 0x811C9DC5u
+#define FNV32_PRIME 0x01000193u
+#define LEF_V1_SECTION_SIZE 11
+
+static uint32_t readWord(const uint8_t* bytes) {
+    return ((uint32_t)bytes[0] << 0x18) | (bytes[1] << 0x10) | (bytes[2] << 0x08) | bytes[3];
+}
+
+static uint16_t readHalf(const uint8_t* bytes) {
+    return (bytes[0] << 0x08) | bytes[1];
+}
+
+static bool inImage(size_t size, uint64_t offset, uint64_t length) {
+    return offset <= size && length <= size - offset;
+}
+
+// Copies bytes of the image to guest memory, anything beyond them is left to the zeroed mapping
+static bool copyToMemory(Memory* memory, uint32_t address, const uint8_t* bytes, uint32_t length) {
+    if ((uint64_t)address + length > MEMORY_SIZE) {
+        fprintf(stderr, "Executable section does not fit in guest memory.\n");
+        return false;
+    }
+
+    memcpy(&memory->store[address], bytes, length);
+    markDirtyPages(memory, address, length);
+    return true;
+}
+
+uint32_t lefChecksum(const uint8_t* image, size_t size) {
+    uint32_t hash = FNV32_OFFSET;
+    for (size_t i = 0; i < size; i++) {
+        bool field = i >= LEF_V2_CHECKSUM_OFFSET && i < LEF_V2_CHECKSUM_OFFSET + 4;
+        hash = (hash ^ (field ? 0 : image[i])) * FNV32_PRIME;
+    }
+
+    return hash;
+}
+
+// v1 sections are packed back to back and loaded in table order, text after text and data after data
+static bool loadV1(const uint8_t* image, size_t size, FileHeader* header, Memory* memory, DebugInfo* debug,
+                   uint32_t* entry, uint32_t* textSize) {
+    header->size = LEF_V1_HEADER_SIZE;
+    if (size < header->size) return false;
+
+    header->entry = readWord(&image[6]);
+    header->shAddress = readWord(&image[10]);
+    header->shCount = image[14];
+    if (!inImage(size, header->shAddress, (uint64_t)header->shCount * LEF_V1_SECTION_SIZE)) {
+        fprintf(stderr, "Executable section header table is truncated.\n");
+        return false;
+    }
+
+    uint32_t programOffset = PROGRAM_ADDRESS;
+    uint32_t dataOffset = DATA_ADDRESS;
+
+    for (int i = 0; i < header->shCount; ++i) {
+        const uint8_t* entryBytes = &image[header->shAddress + i * LEF_V1_SECTION_SIZE];
+        SectionHeader section;
+        section.name = readHalf(entryBytes);
+        section.type = entryBytes[2];
+        section.address = readWord(&entryBytes[3]);
+        section.size = readWord(&entryBytes[7]);
+
+        if (section.type != SHT_ZERO && section.type != SHT_NULL && !inImage(size, section.address, section.size)) {
+            fprintf(stderr, "Executable section %d is truncated.\n", i);
+            return false;
+        }
+
+        switch (section.type) {
+            case SHT_EXEC: {
+                if (!copyToMemory(memory, programOffset, &image[section.address], section.size)) return false;
+                programOffset += section.size;
+                break;
+            }
+            case SHT_ALLOC: {
+                if (!copyToMemory(memory, dataOffset, &image[section.address], section.size)) return false;
+                dataOffset += section.size;
+                break;
+            }
+            case SHT_ZERO: {
+                // Guest memory starts out zeroed, untouched pages are never even materialised
+                if ((uint64_t)dataOffset + section.size > MEMORY_SIZE) {
+                    fprintf(stderr, "Executable section does not fit in guest memory.\n");
+                    return false;
+                }
+                dataOffset += section.size;
+                break;
+            }
+            case SHT_STRTAB: {
+                // Strings are stored between two null bytes which are not loaded
+                if (section.size < 2) break;
+                if (!copyToMemory(memory, dataOffset, &image[section.address + 1], section.size - 2)) return false;
+                dataOffset += section.size - 2;
+                break;
+            }
+            case SHT_SYMTAB: {
+                debug->symtabOffset = section.address;
+                debug->symtabSize = section.size;
+                break;
+            }
+            case SHT_LINES: {
+                debug->linesOffset = section.address;
+                debug->linesSize = section.size;
+                break;
+            }
+            case SHT_DECODED: // Only v2 images are checked against their decoded text, v1 ones get decoded
+            case SHT_NULL:
+                break;
+        }
+    }
+
+    *entry = header->entry - header->size;
+    *textSize = programOffset - PROGRAM_ADDRESS;
+    return true;
+}
+
+static bool loadSegment(const uint8_t* image, size_t size, SegmentHeader* segment, Memory* memory) {
+    if (segment->fileSize > segment->memSize || !inImage(size, segment->offset, segment->fileSize) ||
+        (uint64_t)segment->address + segment->memSize > MEMORY_SIZE) {
+        fprintf(stderr, "Executable segment at %#08x is out of bounds.\n", segment->address);
+        return false;
+    }
+
+    if (segment->offset % MEMORY_PAGE_SIZE != segment->address % MEMORY_PAGE_SIZE) {
+        fprintf(stderr, "Executable segment at %#08x is not page aligned in the file.\n", segment->address);
+        return false;
+    }
+
+    // Text is shared with whoever maps the same image, it can never be written
+    if ((segment->flags & PF_X) && ((segment->flags & PF_W) || segment->address < PROGRAM_ADDRESS ||
+                                    (uint64_t)segment->address + segment->memSize > DATA_ADDRESS)) {
+        fprintf(stderr, "Executable segment at %#08x must be read-only and inside the text region.\n",
+                segment->address);
+        return false;
+    }
+
+    // Everything else is data, which may not reach under the text it could then overwrite
+    if (!(segment->flags & PF_X) && segment->address < DATA_ADDRESS) {
+        fprintf(stderr, "Executable data segment at %#08x must be inside the data region.\n", segment->address);
+        return false;
+    }
+
+    return copyToMemory(memory, segment->address, &image[segment->offset], segment->fileSize);
+}
+
+// v2 images are described by their load segments, sections only locate the debug tables
+static bool loadV2(const uint8_t* image, size_t size, FileHeader* header, Memory* memory, DebugInfo* debug,
+                   DecodedText* decoded, uint32_t* entry, uint32_t* textSize) {
+    header->size = LEF_V2_HEADER_SIZE;
+    if (size < header->size) return false;
+
+    header->flags = readHalf(&image[6]);
+    header->entry = readWord(&image[8]);
+    header->phAddress = readWord(&image[12]);
+    header->phCount = readHalf(&image[16]);
+    header->shCount = readHalf(&image[18]);
+    header->shAddress = readWord(&image[20]);
+    header->checksum = readWord(&image[LEF_V2_CHECKSUM_OFFSET]);
+
+    if (lefChecksum(image, size) != header->checksum) {
+        fprintf(stderr, "Executable checksum mismatch, the file is corrupted.\n");
+        return false;
+    }
+
+    if ((header->flags & ~LEF_LITTLE_ENDIAN) != 0) {
+        fprintf(stderr, "Executable requires unsupported features (flags %#06x).\n", header->flags);
+        return false;
+    }
+    memory->littleEndian = (header->flags & LEF_LITTLE_ENDIAN) != 0;
+
+    if (!inImage(size, header->phAddress, (uint64_t)header->phCount * LEF_V2_SEGMENT_SIZE) ||
+        !inImage(size, header->shAddress, (uint64_t)header->shCount * LEF_V2_SECTION_SIZE)) {
+        fprintf(stderr, "Executable header tables are truncated.\n");
+        return false;
+    }
+
+    bool entryMapped = false;
+    int64_t text = -1; // Size of the text segment, none has been seen while negative
+    for (int i = 0; i < header->phCount; ++i) {
+        const uint8_t* entryBytes = &image[header->phAddress + i * LEF_V2_SEGMENT_SIZE];
+        SegmentHeader segment;
+        segment.type = readWord(entryBytes);
+        segment.flags = readWord(&entryBytes[4]);
+        segment.offset = readWord(&entryBytes[8]);
+        segment.address = readWord(&entryBytes[12]);
+        segment.fileSize = readWord(&entryBytes[16]);
+        segment.memSize = readWord(&entryBytes[20]);
+
+        if (segment.type == PT_NULL) continue;
+        if (segment.type != PT_LOAD) {
+            fprintf(stderr, "Executable segment %d has unknown type %u.\n", i, segment.type);
+            return false;
+        }
+
+        if (!loadSegment(image, size, &segment, memory)) return false;
+        if ((segment.flags & PF_X) && segment.address == PROGRAM_ADDRESS) text = segment.fileSize;
+
+        if ((segment.flags & PF_X) && header->entry >= segment.address &&
+            header->entry - segment.address < segment.memSize) {
+            entryMapped = true;
+        }
+    }
+
+    if (!entryMapped || header->entry % 4 != 0) {
+        fprintf(stderr, "Executable entry point %#08x is not in a text segment.\n", header->entry);
+        return false;
+    }
+
+    for (int i = 0; i < header->shCount; ++i) {
+        const uint8_t* entryBytes = &image[header->shAddress + i * LEF_V2_SECTION_SIZE];
+        SectionHeader section;
+        section.name = readHalf(entryBytes);
+        section.type = readHalf(&entryBytes[2]);
+        section.address = readWord(&entryBytes[4]);
+        section.size = readWord(&entryBytes[8]);
+
+        if (!inImage(size, section.address, section.size)) {
+            fprintf(stderr, "Executable section %d is truncated.\n", i);
+            return false;
+        }
+
+        if (section.type == SHT_SYMTAB) {
+            debug->symtabOffset = section.address;
+            debug->symtabSize = section.size;
+        } else if (section.type == SHT_LINES) {
+            debug->linesOffset = section.address;
+            debug->linesSize = section.size;
+        } else if (section.type == SHT_DECODED && decoded != NULL) {
+            if (text < 0) {
+                fprintf(stderr, "Executable decoded section %d has no text segment to describe.\n", i);
+                return false;
+            }
+
+            freeDecodedText(decoded);
+            if (!readDecodedText(decoded, &image[section.address], section.size, &memory->store[PROGRAM_ADDRESS],
+                                 text)) {
+                return false;
+            }
+        }
+    }
+
+    *entry = header->entry - PROGRAM_ADDRESS;
+    *textSize = text < 0 ? 0 : text;
+    return true;
+}
+
+// Loads an executable image into guest memory and sets the entry point ip and the size of the text
+// loaded at PROGRAM_ADDRESS, taken from the v2 text segment or the v1 program sections.
+// Symbol and line sections are only located, they are read when a report needs them.
+// The decoded text is filled when the image carries one, it is left empty otherwise.
+bool loadExecutableImage(const uint8_t* image, size_t size, Memory* memory, DebugInfo* debug, DecodedText* decoded,
+                         uint32_t* entry, uint32_t* textSize) {
+    FileHeader header;
+    char format[4] = {0x10, 'L', 'E', 'F'};
+    if (decoded != NULL) initDecodedText(decoded);
+
+    if (size < 6 || memcmp(image, format, 4) != 0) {
+        fprintf(stderr, "Not a valid executable file.\n");
+        return false;
+    }
+
+    memcpy(header.magic, image, 4);
+    header.major = image[4];
+    header.minor = image[5];
+    memory->littleEndian = false;
+
+    switch (header.major) {
+        case 1:
+            return loadV1(image, size, &header, memory, debug, entry, textSize);
+        case 2:
+            return loadV2(image, size, &header, memory, debug, decoded, entry, textSize);
+        default:
+            fprintf(stderr, "Unsupported executable version %u.%u.\n", header.major, header.minor);
+            return false;
+    }
+}
+
+bool loadExecutable(const char* fileName, Memory* memory, DebugInfo* debug, DecodedText* decoded, uint32_t* entry,
+                    uint32_t* textSize) {
+    if (decoded != NULL) initDecodedText(decoded);
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open file '%s'.\n", fileName);
+        return false;
+    }
+
+    // The image is read straight from the page cache, segments are then copied once into guest memory
+    struct stat status;
+    size_t size = fstat(fd, &status) == 0 && status.st_size > 0 ? status.st_size : 0;
+    uint8_t* image = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    bool read = image != MAP_FAILED;
+    bool loaded = read && loadExecutableImage(image, size, memory, debug, decoded, entry, textSize);
+    if (read && !loaded) fprintf(stderr, "Unable to load '%s'.\n", fileName);
+    if (!read) fprintf(stderr, "Unable to read file '%s'.\n", fileName);
+
+    if (read) munmap(image, size);
+    return loaded;
+}
@@ -2,14 +2,32 @@
 #define LMIPS_EXECUTABLE_H
 
 #include "common.h"
+#include "memory.h"
+#include "debuginfo.h"
+#include "decode.h"
+
+#define LEF_V1_HEADER_SIZE 15
+#define LEF_V2_HEADER_SIZE 32
+#define LEF_V2_SEGMENT_SIZE 24
+#define LEF_V2_SECTION_SIZE 12
+#define LEF_V2_CHECKSUM_OFFSET 24
+
+// v2 file header flags
+typedef enum {
+    LEF_LITTLE_ENDIAN = 0x0001 // Halves and words in the segments are little-endian, header fields never are
+} FileFlags;
 
 typedef struct {
     char magic[4];
     uint8_t major;
     uint8_t minor;
-    uint32_t entry;
+    uint16_t flags; // v2 only
+    uint32_t entry; // File offset of the entry point in v1, guest address in v2
+    uint32_t phAddress; // v2 only
+    uint16_t phCount; // v2 only
+    uint16_t shCount;
     uint32_t shAddress;
-    uint8_t shCount;
+    uint32_t checksum; // v2 only, FNV-1a of the whole file with this field zeroed
     uint8_t size;
 } FileHeader;
 
@@ -17,7 +35,11 @@ typedef enum {
     SHT_NULL,
     SHT_EXEC,
     SHT_STRTAB,
-    SHT_ALLOC = 0x04
+    SHT_ALLOC = 0x04,
+    SHT_SYMTAB = 0x08,
+    SHT_LINES = 0x10,
+    SHT_ZERO = 0x20, // Zero-filled data, only the size is stored
+    SHT_DECODED = 0x40 // Pre-decoded text, see decode.h
 } SectionType;
 
 typedef struct {
@@ -27,4 +49,32 @@ typedef struct {
     uint32_t size;
 } SectionHeader;
 
+typedef enum {
+    PT_NULL,
+    PT_LOAD
+} SegmentType;
+
+typedef enum {
+    PF_X = 0x01,
+    PF_W = 0x02,
+    PF_R = 0x04
+} SegmentFlags;
+
+// v2 program header. The file offset and the guest address agree modulo the page size
+// and memSize past fileSize is zero-filled.
+typedef struct {
+    SegmentType type;
+    uint32_t flags;
+    uint32_t offset;
+    uint32_t address;
+    uint32_t fileSize;
+    uint32_t memSize;
+} SegmentHeader;
+
+uint32_t lefChecksum(const uint8_t* image, size_t size);
+bool loadExecutableImage(const uint8_t* image, size_t size, Memory* memory, DebugInfo* debug, DecodedText* decoded,
+                         uint32_t* entry, uint32_t* textSize);
+bool loadExecutable(const char* fileName, Memory* memory, DebugInfo* debug, DecodedText* decoded, uint32_t* entry,
+                    uint32_t* textSize);
+
 #endif //LMIPS_EXECUTABLE_H
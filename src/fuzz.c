@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "fuzz.h"
+
+#ifdef LMIPS_INSTRUMENT
+
+// File descriptors afl-fuzz hands to its fork server
+#define FORKSRV_FD 198
+// Test cases run by one forked child before it is replaced, bounding state leaked across runs
+#define PERSISTENT_RUNS 1000
+
+bool takeFuzzInput(FuzzSession* session, uint8_t* buffer, uint32_t size, uint32_t* length) {
+    if (!session->pending) {
+        session->waiting = true;
+        return false;
+    }
+
+    *length = session->inputSize < size ? session->inputSize : size;
+    memcpy(buffer, session->input, *length);
+    session->pending = false;
+    return true;
+}
+
+bool startFuzzSession(FuzzSession* session, LMips* mips, uint64_t limit) {
+    memset(session, 0, sizeof(FuzzSession));
+    session->limit = limit;
+    if (!initCoverage(&session->coverage)) return false;
+
+    // Run the start-up code once, up to the first request for input
+    mips->fuzz = session;
+    if (runSimulator(mips) != EXEC_SUCCESS || !session->waiting) {
+        fprintf(stderr, "Program exited without requesting fuzz input.\n");
+        return false;
+    }
+
+    return saveBaseline(&session->baseline, mips);
+}
+
+FuzzOutcome fuzzOne(FuzzSession* session, LMips* mips, const uint8_t* input, uint32_t size) {
+    if (!resetToBaseline(&session->baseline, mips)) {
+        fprintf(stderr, "Unable to reset machine state.\n");
+        exit(1);
+    }
+    session->input = input;
+    session->inputSize = size;
+    session->pending = true;
+    session->waiting = false;
+    session->coverage.previous = 0;
+
+    mips->limit = mips->retired + session->limit;
+
+    // A test case ends when the guest exits or comes back for the next one
+    if (runSimulator(mips) != EXEC_SUCCESS) return FUZZ_CRASH;
+    return mips->stop ? FUZZ_OK : FUZZ_TIMEOUT;
+}
+
+static void runPersistentChild(FuzzSession* session, LMips* mips) {
+    uint8_t* input = malloc(FUZZ_INPUT_MAX);
+    if (input == NULL) exit(1);
+
+    for (int run = 0; run < PERSISTENT_RUNS; run++) {
+        // Stopping tells the fork server this test case is done, it resumes us for the next one
+        if (run > 0) raise(SIGSTOP);
+
+        // afl-fuzz rewrites the same file behind stdin for every test case
+        lseek(STDIN_FILENO, 0, SEEK_SET);
+        ssize_t size = read(STDIN_FILENO, input, FUZZ_INPUT_MAX);
+        if (size < 0) size = 0;
+
+        // Instruction-limit timeouts are left to the afl-fuzz watchdog
+        if (fuzzOne(session, mips, input, size) == FUZZ_CRASH) abort();
+    }
+
+    free(input);
+    exit(0);
+}
+
+bool runForkServer(FuzzSession* session, LMips* mips) {
+    uint32_t message = 0;
+    if (write(FORKSRV_FD + 1, &message, 4) != 4) return false;
+
+    pid_t child = -1;
+    bool stopped = false;
+    while (true) {
+        uint32_t killed;
+        if (read(FORKSRV_FD, &killed, 4) != 4) exit(0);
+
+        // A stopped child killed by the fuzzer's timeout still has to be reaped
+        if (stopped && killed) {
+            int status;
+            waitpid(child, &status, 0);
+            stopped = false;
+        }
+
+        if (stopped) {
+            kill(child, SIGCONT);
+            stopped = false;
+        } else {
+            child = fork();
+            if (child < 0) exit(1);
+            if (child == 0) {
+                close(FORKSRV_FD);
+                close(FORKSRV_FD + 1);
+                runPersistentChild(session, mips);
+            }
+        }
+
+        int status;
+        if (write(FORKSRV_FD + 1, &child, 4) != 4) exit(1);
+        if (waitpid(child, &status, WUNTRACED) < 0) exit(1);
+        stopped = WIFSTOPPED(status);
+        if (write(FORKSRV_FD + 1, &status, 4) != 4) exit(1);
+    }
+}
+
+void freeFuzzSession(FuzzSession* session) {
+    freeBaseline(&session->baseline);
+    freeCoverage(&session->coverage);
+}
+
+#endif // LMIPS_INSTRUMENT
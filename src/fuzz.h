@@ -0,0 +1,35 @@
+#ifndef LMIPS_FUZZ
+#define LMIPS_FUZZ
+
+#include "common.h"
+#include "coverage.h"
+#include "baseline.h"
+
+#define FUZZ_INPUT_MAX (1 << 20)
+
+typedef enum {
+    FUZZ_OK,
+    FUZZ_CRASH,
+    FUZZ_TIMEOUT
+} FuzzOutcome;
+
+// Persistent mode : the guest asks for each test case through SYS_FUZZ_INPUT and the machine
+// is reset to the state saved at its first call between test cases instead of being reloaded
+typedef struct fs {
+    Coverage coverage;
+    Baseline baseline;
+    const uint8_t* input;
+    uint32_t inputSize;
+    bool pending;
+    bool waiting; // The guest is blocked in SYS_FUZZ_INPUT for the next test case
+    uint64_t limit; // Instructions allowed per test case
+} FuzzSession;
+
+bool takeFuzzInput(FuzzSession* session, uint8_t* buffer, uint32_t size, uint32_t* length);
+
+bool startFuzzSession(FuzzSession* session, LMips* mips, uint64_t limit);
+FuzzOutcome fuzzOne(FuzzSession* session, LMips* mips, const uint8_t* input, uint32_t size);
+bool runForkServer(FuzzSession* session, LMips* mips);
+void freeFuzzSession(FuzzSession* session);
+
+#endif // LMIPS_FUZZ
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include "heatmap.h"
+
+#define CURVE_ROWS 32
+#define CURVE_WIDTH 50
+
+static const char* regionNames[] = {"data", "heap", "stack"};
+
+bool initHeatMap(HeatMap* heat, uint64_t interval, uint32_t heap) {
+    memset(heat, 0, sizeof(HeatMap));
+    heat->interval = interval;
+    heat->heapPeak = heap;
+    heat->stackLow = STACK_ADDRESS + 1;
+
+    heat->lines = calloc(HEAT_LINES, sizeof(AccessCount));
+    return heat->lines != NULL && interval > 0;
+}
+
+void freeHeatMap(HeatMap* heat) {
+    free(heat->lines);
+    free(heat->workingSet);
+    heat->lines = NULL;
+    heat->workingSet = NULL;
+}
+
+MemoryRegion heatRegion(HeatMap* heat, uint32_t address) {
+    if (address < HEAP_ADDRESS) return REGION_DATA;
+
+    // Nothing is allocated between the break and the stack, accesses there are stack growth
+    return address < heat->heapPeak ? REGION_HEAP : REGION_STACK;
+}
+
+void heatAccess(HeatMap* heat, uint32_t address, bool write) {
+    uint32_t page = address / MEMORY_PAGE_SIZE;
+    AccessCount* line = &heat->lines[address >> HEAT_LINE_BITS];
+
+    if (write) {
+        line->writes++;
+        heat->pages[page].writes++;
+    } else {
+        line->reads++;
+        heat->pages[page].reads++;
+    }
+
+    heat->touched[page / 64] |= 1ull << (page % 64);
+    if (address >= heat->heapPeak && address < heat->stackLow) heat->stackLow = address;
+}
+
+void heatBreak(HeatMap* heat, uint32_t heap) {
+    if (heap > heat->heapPeak) heat->heapPeak = heap;
+}
+
+static void endInterval(HeatMap* heat) {
+    if (heat->intervals == heat->capacity) {
+        heat->capacity = heat->capacity < 8 ? 8 : heat->capacity * 2;
+        heat->workingSet = realloc(heat->workingSet, heat->capacity * sizeof(uint32_t));
+    }
+
+    uint32_t pages = 0;
+    for (uint32_t i = 0; i < MEMORY_PAGES / 64; i++) {
+        pages += __builtin_popcountll(heat->touched[i]);
+    }
+    heat->workingSet[heat->intervals++] = pages;
+
+    memset(heat->touched, 0, sizeof(heat->touched));
+    heat->count = 0;
+}
+
+void heatRetire(HeatMap* heat) {
+    if (++heat->count == heat->interval) endInterval(heat);
+}
+
+void heatFlush(HeatMap* heat) {
+    if (heat->count > 0) endInterval(heat);
+}
+
+static int comparePages(const void* a, const void* b) {
+    const AccessCount* first = *(const AccessCount* const*)a;
+    const AccessCount* second = *(const AccessCount* const*)b;
+    uint64_t x = (uint64_t)first->reads + first->writes;
+    uint64_t y = (uint64_t)second->reads + second->writes;
+
+    return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+static void printCurve(HeatMap* heat, FILE* out) {
+    // Long runs are folded into at most CURVE_ROWS rows, each showing the largest working set it covers
+    uint32_t step = (heat->intervals + CURVE_ROWS - 1) / CURVE_ROWS;
+    uint32_t peak = 0;
+    for (uint32_t i = 0; i < heat->intervals; i++) {
+        if (heat->workingSet[i] > peak) peak = heat->workingSet[i];
+    }
+
+    fprintf(out, "Working set over time (pages touched per %llu instructions)\n", (unsigned long long)heat->interval);
+    for (uint32_t row = 0; row < heat->intervals; row += step) {
+        uint32_t pages = 0;
+        for (uint32_t i = row; i < row + step && i < heat->intervals; i++) {
+            if (heat->workingSet[i] > pages) pages = heat->workingSet[i];
+        }
+
+        int width = peak == 0 ? 0 : (int)((uint64_t)pages * CURVE_WIDTH / peak);
+        fprintf(out, "  %12llu %5u pages %7uKB |%.*s\n", (unsigned long long)row * heat->interval, pages,
+                pages * (MEMORY_PAGE_SIZE >> 10), width, "##################################################");
+    }
+}
+
+void printHeatReport(HeatMap* heat, DebugInfo* debug, FILE* out, int top) {
+    uint64_t reads[REGIONS] = {0}, writes[REGIONS] = {0};
+    uint32_t pages[REGIONS] = {0}, lines[REGIONS] = {0};
+
+    for (uint32_t page = 0; page < MEMORY_PAGES; page++) {
+        AccessCount* count = &heat->pages[page];
+        if (count->reads == 0 && count->writes == 0) continue;
+
+        MemoryRegion region = heatRegion(heat, page * MEMORY_PAGE_SIZE);
+        reads[region] += count->reads;
+        writes[region] += count->writes;
+        pages[region]++;
+
+        for (uint32_t line = page * (MEMORY_PAGE_SIZE >> HEAT_LINE_BITS); line < (page + 1) * (MEMORY_PAGE_SIZE >> HEAT_LINE_BITS); line++) {
+            if (heat->lines[line].reads != 0 || heat->lines[line].writes != 0) lines[region]++;
+        }
+    }
+
+    fprintf(out, "Memory access report\n");
+    for (int region = 0; region < REGIONS; region++) {
+        fprintf(out, "  %-5s : %llu reads, %llu writes, %u pages (%uKB), %u lines touched\n", regionNames[region],
+                (unsigned long long)reads[region], (unsigned long long)writes[region],
+                pages[region], pages[region] * (MEMORY_PAGE_SIZE >> 10), lines[region]);
+    }
+    fprintf(out, "  Peak heap break      : %#08x (%u bytes allocated)\n", heat->heapPeak, heat->heapPeak - HEAP_ADDRESS);
+    fprintf(out, "  Stack high-water mark: %#08x (%u bytes)\n", heat->stackLow, STACK_ADDRESS + 1 - heat->stackLow);
+
+    heatFlush(heat);
+    if (heat->intervals > 0) printCurve(heat, out);
+
+    if (top <= 0) return;
+
+    AccessCount* sorted[MEMORY_PAGES];
+    uint32_t count = 0;
+    for (uint32_t page = 0; page < MEMORY_PAGES; page++) {
+        if (heat->pages[page].reads != 0 || heat->pages[page].writes != 0) sorted[count++] = &heat->pages[page];
+    }
+    qsort(sorted, count, sizeof(AccessCount*), comparePages);
+
+    fprintf(out, "Top %d pages\n", top);
+    for (uint32_t i = 0; i < count && i < (uint32_t)top; i++) {
+        uint32_t page = sorted[i] - heat->pages;
+
+        // Point at the hottest line of the page as well
+        uint32_t first = page * (MEMORY_PAGE_SIZE >> HEAT_LINE_BITS), hottest = first;
+        for (uint32_t line = first; line < first + (MEMORY_PAGE_SIZE >> HEAT_LINE_BITS); line++) {
+            AccessCount* a = &heat->lines[line];
+            AccessCount* b = &heat->lines[hottest];
+            if ((uint64_t)a->reads + a->writes > (uint64_t)b->reads + b->writes) hottest = line;
+        }
+
+        fprintf(out, "  [%#08x] %-5s %u reads, %u writes, hottest line %#08x (%u accesses)",
+                page * MEMORY_PAGE_SIZE, regionNames[heatRegion(heat, page * MEMORY_PAGE_SIZE)],
+                sorted[i]->reads, sorted[i]->writes, hottest << HEAT_LINE_BITS,
+                heat->lines[hottest].reads + heat->lines[hottest].writes);
+
+        const Symbol* symbol = findSymbol(debug, SYMBOL_DATA, hottest << HEAT_LINE_BITS);
+        if (symbol != NULL) fprintf(out, " in %s+%#x", symbol->name, (hottest << HEAT_LINE_BITS) - symbol->address);
+        fprintf(out, "\n");
+    }
+}
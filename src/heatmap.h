@@ -0,0 +1,48 @@
+#ifndef LMIPS_HEATMAP
+#define LMIPS_HEATMAP
+
+#include <stdio.h>
+#include "common.h"
+#include "memory.h"
+#include "debuginfo.h"
+
+#define HEAT_LINE_BITS 6
+#define HEAT_LINES (MEMORY_SIZE >> HEAT_LINE_BITS)
+
+typedef enum {
+    REGION_DATA,
+    REGION_HEAP,
+    REGION_STACK,
+    REGIONS
+} MemoryRegion;
+
+typedef struct {
+    uint32_t reads;
+    uint32_t writes;
+} AccessCount;
+
+// Guest data accesses counted per 64-byte line and per page, with the pages
+// touched over fixed-size instruction intervals kept as a working-set curve
+typedef struct {
+    AccessCount* lines;
+    AccessCount pages[MEMORY_PAGES];
+    uint32_t heapPeak;
+    uint32_t stackLow; // Lowest address accessed above the heap break
+    uint64_t interval;
+    uint64_t count;
+    uint64_t touched[MEMORY_PAGES / 64]; // Pages accessed during the current interval
+    uint32_t* workingSet; // Pages touched per interval
+    uint32_t intervals;
+    uint32_t capacity;
+} HeatMap;
+
+bool initHeatMap(HeatMap* heat, uint64_t interval, uint32_t heap);
+void freeHeatMap(HeatMap* heat);
+void heatAccess(HeatMap* heat, uint32_t address, bool write);
+void heatBreak(HeatMap* heat, uint32_t heap);
+void heatRetire(HeatMap* heat);
+void heatFlush(HeatMap* heat);
+MemoryRegion heatRegion(HeatMap* heat, uint32_t address);
+void printHeatReport(HeatMap* heat, DebugInfo* debug, FILE* out, int top);
+
+#endif // LMIPS_HEATMAP
@@ -1,23 +1,45 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "lmips.h"
 #include "lmips_opcodes.h"
+#include "snapshot.h"
+#include "fuzz.h"
 
 void resetSimulator(LMips* mips) {
     mips->ip = 0;
     mips->hi = 0;
     mips->lo = 0;
+    mips->fcc = false;
     mips->heap = 0;
+    mips->arena = NULL;
     mips->stop = false;
     mips->program = NULL;
+    mips->textSize = 0;
+    mips->decoded = NULL;
     mips->memory = NULL;
+    mips->input = NULL;
+    mips->output = stdout;
+    mips->ring = NULL;
+    mips->channelIn = NULL;
+    mips->channelOut = NULL;
+    mips->snapshot = NULL;
+    mips->debug = NULL;
+    mips->retired = 0;
+    mips->limit = UINT64_MAX;
+#ifdef LMIPS_INSTRUMENT
+    mips->probes = NULL;
+    mips->fuzz = NULL;
+#endif
 
     // Init all registers to 0
     for (size_t i = 0; i < REG_COUNT; i++) {
         mips->regs[i] = 0;
     }
+    memset(mips->fregs, 0, sizeof(mips->fregs));
+    memset(mips->vregs, 0, sizeof(mips->vregs));
 }
 
 void initTestSimulator(LMips* mips, uint8_t* program) {
@@ -39,32 +61,108 @@ void initSimulator(LMips* mips, Memory* memory) {
 }
 
 void freeSimulator(LMips* mips) {
+    if (mips->ring != NULL) {
+        freeRing(mips->ring);
+        free(mips->ring);
+    }
+    free(mips->arena);
     resetSimulator(mips);
 }
 
-ExecutionResult runSimulator(LMips* mips) {
+// CP1 registers hold raw words, the accessors below compile down to plain SSE2 moves
+static inline float getSingle(const uint32_t* fregs, uint8_t reg) {
+    float value;
+    memcpy(&value, &fregs[reg], sizeof(value));
+    return value;
+}
+
+static inline void setSingle(uint32_t* fregs, uint8_t reg, float value) {
+    memcpy(&fregs[reg], &value, sizeof(value));
+}
+
+static inline double getDouble(const uint32_t* fregs, uint8_t reg) {
+    uint64_t bits = fregs[reg] | (uint64_t)fregs[reg + 1] << 0x20;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline void setDouble(uint32_t* fregs, uint8_t reg, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    fregs[reg] = (uint32_t)bits;
+    fregs[reg + 1] = bits >> 0x20;
+}
+
+// NaN and values out of range give the MIPS default result rather than the host's
+static int32_t convertWord(double value, bool truncate) {
+    if (!(fabs(value) < 4294967296.0)) return INT32_MAX;
+
+    int64_t word = truncate ? (int64_t)value : llrint(value);
+    return word > INT32_MAX || word < INT32_MIN ? INT32_MAX : (int32_t)word;
+}
+
+static Arena* getArena(LMips* mips) {
+    if (mips->arena == NULL) {
+        mips->arena = malloc(sizeof(Arena));
+        if (mips->arena != NULL) initArena(mips->arena);
+    }
+
+    return mips->arena;
+}
+
+static Ring* getRing(LMips* mips) {
+    if (mips->ring == NULL) {
+        mips->ring = malloc(sizeof(Ring));
+        if (mips->ring != NULL && !initRing(mips->ring)) {
+            free(mips->ring);
+            mips->ring = NULL;
+        }
+    }
+
+    return mips->ring;
+}
+
+// Output written straight by a syscall has to come after what the ring worker was given before it
+static inline void syncOutput(LMips* mips) {
+    if (mips->ring != NULL) drainRing(mips->ring);
+}
+
+// Reads up to size raw bytes from stdin into guest memory, or from the log when replaying, and
+// stores their count in read. False when the log does not hold the read.
+static bool readInput(LMips* mips, uint32_t address, uint32_t size, uint32_t* read) {
+    uint8_t* buffer = &mips->memory->store[address];
+    InputLog* input = mips->input;
+
+    if (input != NULL && input->mode == REPLAY_PLAY) {
+        if (!replayInt(input, read) || *read > size || !replayString(input, buffer, *read)) return false;
+    } else {
+        *read = fread(buffer, sizeof(uint8_t), size, stdin);
+        if (input != NULL) {
+            recordInt(input, *read);
+            recordString(input, buffer, *read);
+        }
+    }
+
+    markDirtyPages(mips->memory, address, *read);
+    return true;
+}
+
+// Traps return straight out of the interpreter loop, runSimulator reports them
+static ExecutionResult interpret(LMips* mips) {
     if (mips->program == NULL) {
         fprintf(stderr, "Invalid program provided.\n");
         return EXEC_FAILURE;
     }
 
     ExecutionResult result = EXEC_SUCCESS;
+    bool littleEndian = mips->memory != NULL && mips->memory->littleEndian;
 
-    while (!mips->stop && result == EXEC_SUCCESS) {
-#define GET_INSTR(ip) \
-    ((mips->program[ip] << 0x18) | \
-        (mips->program[ip + 1] << 0x10) | \
-        (mips->program[ip + 2] << 0x08) | \
-        (mips->program[ip + 3]) \
-    )
-#define GET_OP(instr) (instr >> 0x1A)
-#define GET_RS(instr) ((instr >> 0x15) & 0x1F)
-#define GET_RT(instr) ((instr >> 0x10) & 0x1F)
-#define GET_RD(instr) ((instr >> 0x0B) & 0x1F)
-#define GET_SA(instr) ((instr >> 0x06) & 0x1F)
-#define GET_FUNC(instr) (instr & 0x3F)
-#define GET_IMMED(instr) (instr & 0xFFFF)
-#define GET_JT(instr) (instr & 0x3FFFFFF)
+    while (!mips->stop && result == EXEC_SUCCESS && mips->retired < mips->limit) {
+#define GET_INSTR(ip) mem_read_instr(mips->program, ip, littleEndian)
+#define RS (mips->regs[decoded->rs])
+#define RT (mips->regs[decoded->rt])
+#define RD (mips->regs[decoded->rd])
 #define CHECK_OVERFLOW(x, y, op) \
     do { \
         int64_t res = (int64_t)x op y;\
@@ -74,367 +172,729 @@ ExecutionResult runSimulator(LMips* mips) {
     } while(false)
 #define BIN_OP(op) \
     do { \
-        int32_t rs = mips->regs[GET_RS(instr)]; \
-        int32_t rt = mips->regs[GET_RT(instr)]; \
+        int32_t rs = RS; \
+        int32_t rt = RT; \
         CHECK_OVERFLOW(rs, rt, op); \
 \
-        uint8_t rd = GET_RD(instr); \
-        mips->regs[rd] = rs op rt;\
+        RD = rs op rt;\
     } while(false)
-#define BINU_OP(op) (mips->regs[GET_RD(instr)] = mips->regs[GET_RS(instr)] op mips->regs[GET_RT(instr)])
+#define BINU_OP(op) (RD = RS op RT)
 #define CHECK_MEM_ADDR(offset, align, address) \
     if ((offset % align != 0) || address >= MEMORY_SIZE || address < DATA_ADDRESS) return EXEC_ERR_MEMORY_ADDR
 #define COMP_OP(op) \
-    if ((int32_t)(mips->regs[GET_RS(instr)]) op 0) { \
-        int32_t offset = sign_extend(GET_IMMED(instr) << 2, 14); \
-        mips->ip += (offset - 4); \
+    if ((int32_t)RS op 0) { \
+        mips->ip = decoded->immed; \
     }
+#define FS_S getSingle(mips->fregs, decoded->rs)
+#define FT_S getSingle(mips->fregs, decoded->rt)
+#define FD_S(value) setSingle(mips->fregs, decoded->rd, value)
+#define FS_D getDouble(mips->fregs, decoded->rs)
+#define FT_D getDouble(mips->fregs, decoded->rt)
+#define FD_D(value) setDouble(mips->fregs, decoded->rd, value)
+#define WD (&mips->vregs[decoded->rd])
+#define WS (&mips->vregs[decoded->rs])
+#define WT (&mips->vregs[decoded->rt])
+#define VECTOR_LOAD(df) \
+    do { \
+        int32_t offset = decoded->immed; \
+        uint32_t address = RS + offset; \
+        CHECK_MEM_ADDR(offset, (1 << df), address); \
+        PROBE_LOAD(mips, ip, address, VECTOR_SIZE); \
+\
+        vectorLoad(WD, &mips->memory->store[address], df, littleEndian); \
+    } while(false)
+#define VECTOR_STORE(df) \
+    do { \
+        int32_t offset = decoded->immed; \
+        uint32_t address = RS + offset; \
+        CHECK_MEM_ADDR(offset, (1 << df), address); \
+        PROBE_STORE(mips, ip, address, VECTOR_SIZE); \
+\
+        markDirtyPages(mips->memory, address, VECTOR_SIZE); \
+        vectorStore(&mips->memory->store[address], WD, df, littleEndian); \
+    } while(false)
 
         uint32_t ip = mips->ip;
+        PROBE_FETCH(mips, ip);
+#ifdef LMIPS_INSTRUMENT
         uint32_t instr = GET_INSTR(ip);
-        uint8_t op = GET_OP(instr);
+#endif
+        // Words outside the decoded text, jumped to at an odd address or without one, are decoded on the spot
+        const DecodedInstr* decoded;
+        DecodedInstr fetched;
+        if (mips->decoded != NULL && (ip >> 2) < mips->decoded->count && (ip & 0x03) == 0) {
+            decoded = &mips->decoded->instrs[ip >> 2];
+        } else {
+            decodeInstruction(ip, GET_INSTR(ip), &fetched);
+            decoded = &fetched;
+        }
         mips->ip += 4;
+        mips->retired++;
 
-        switch (op) {
-            case OP_SPECIAL: {
-                uint8_t func = GET_FUNC(instr);
-                switch (func) {
-                    case SPE_SLL: {
-                        mips->regs[GET_RD(instr)] = mips->regs[GET_RT(instr)] << GET_SA(instr);
-                        break;
-                    }
-                    case SPE_SRL: {
-                        mips->regs[GET_RD(instr)] = mips->regs[GET_RT(instr)] >> GET_SA(instr);
-                        break;
-                    }
-                    case SPE_SRA: {
-                        mips->regs[GET_RD(instr)] = (int32_t)mips->regs[GET_RT(instr)] >> GET_SA(instr);
+        switch (decoded->op) {
+            case DOP_SLL: {
+                RD = RT << decoded->immed;
+                break;
+            }
+            case DOP_SRL: {
+                RD = RT >> decoded->immed;
+                break;
+            }
+            case DOP_SRA: {
+                RD = (int32_t)RT >> decoded->immed;
+                break;
+            }
+            case DOP_SLLV: {
+                uint8_t amount = RS & 0x1F;
+                RD = RT << amount;
+                break;
+            }
+            case DOP_SRLV:
+            case DOP_SRAV: {
+                uint8_t amount = RS & 0x1F;
+                RD = RT >> amount;
+                break;
+            }
+            case DOP_JR: {
+                mips->ip = RS;
+                break;
+            }
+            case DOP_JALR: {
+                RD = mips->ip;
+                mips->ip = RS;
+                break;
+            }
+            case DOP_SYSCALL: {
+                switch (mips->regs[$v0]) {
+                    case SYS_PRINT_INT: {
+                        syncOutput(mips);
+                        fprintf(mips->output, "%d", mips->regs[$a0]);
                         break;
                     }
-                    case SPE_SLLV: {
-                        uint8_t amount = mips->regs[GET_RS(instr)] & 0x1F;
-                        mips->regs[GET_RD(instr)] = mips->regs[GET_RT(instr)] << amount;
+                    case SYS_PRINT_FLOAT: {
+                        syncOutput(mips);
+                        fprintf(mips->output, "%.7g", getSingle(mips->fregs, $f12));
                         break;
                     }
-                    case SPE_SRLV:
-                    case SPE_SRAV: {
-                        uint8_t amount = mips->regs[GET_RS(instr)] & 0x1F;
-                        mips->regs[GET_RD(instr)] = mips->regs[GET_RT(instr)] >> amount;
+                    case SYS_PRINT_DOUBLE: {
+                        syncOutput(mips);
+                        fprintf(mips->output, "%.16g", getDouble(mips->fregs, $f12));
                         break;
                     }
-                    case SPE_JR: {
-                        uint32_t rs = mips->regs[GET_RS(instr)];
-                        mips->ip = rs;
+                    case SYS_PRINT_STRING: {
+                        syncOutput(mips);
+                        CHECK_MEM_ADDR(0, 1, mips->regs[$a0]);
+                        const char* string = (const char*)&mips->memory->store[mips->regs[$a0]];
+                        fprintf(mips->output, "%s", string);
+                        fflush(mips->output);
                         break;
                     }
-                    case SPE_JALR: {
-                        uint8_t rd = GET_RD(instr);
-                        mips->regs[rd <= 0 ? $ra : rd] = mips->ip;
-                        mips->ip = mips->regs[GET_RS(instr)];
+                    case SYS_READ_INT: {
+                        InputLog* input = mips->input;
+                        if (input != NULL && input->mode == REPLAY_PLAY) {
+                            if (!replayInt(input, &mips->regs[$v0])) result = EXEC_FAILURE;
+                            break;
+                        }
+
+                        char buffer[12];
+                        fgets(buffer, 11, stdin);
+                        buffer[strlen(buffer)] = '\0';
+                        mips->regs[$v0] = strtoul(buffer, NULL, 0);
+
+                        if (input != NULL) recordInt(input, mips->regs[$v0]);
                         break;
                     }
-                    case SPE_SYSCALL: {
-                        switch (mips->regs[$v0]) {
-                            case SYS_PRINT_INT: {
-                                printf("%d", mips->regs[$a0]);
-                                break;
-                            }
-                            case SYS_PRINT_STRING: {
-                                CHECK_MEM_ADDR(0, 1, mips->regs[$a0]);
-                                const char* string = (const char*)&mips->memory->store[mips->regs[$a0]];
-                                printf("%s", string);
-                                fflush(stdout);
-                                break;
-                            }
-                            case SYS_READ_INT: {
-                                char buffer[12];
-                                fgets(buffer, 11, stdin);
-                                buffer[strlen(buffer)] = '\0';
-                                mips->regs[$v0] = strtoul(buffer, NULL, 0);
-                                break;
-                            }
-                            case SYS_READ_STRING: {
-                                uint32_t address = mips->regs[$a0];
-                                CHECK_MEM_ADDR(0, 1, address);
-                                fgets((char*)&mips->memory->store[address], mips->regs[$a1], stdin);
-                                mips->memory->store[address + strlen((char*)&mips->memory->store[address]) - 1] = '\0';
-                                break;
-                            }
-                            case SYS_SBRK: {
-                                mips->regs[$v0] = mips->heap;
-                                mips->heap += mips->regs[$a0];
-                                CHECK_MEM_ADDR(0, 1, mips->heap);
-                                break;
-                            }
-                            case SYS_EXIT: {
-                                mips->stop = true;
-                                break;
-                            }
-                            default: {
-                                fprintf(stderr, "Unknown syscall instruction %d\n", mips->regs[$v0]);
+                    case SYS_READ_FLOAT:
+                    case SYS_READ_DOUBLE: {
+                        // Logged as the raw register words, so replays get the same bits back
+                        bool single = mips->regs[$v0] == SYS_READ_FLOAT;
+                        InputLog* input = mips->input;
+                        if (input != NULL && input->mode == REPLAY_PLAY) {
+                            if (!replayInt(input, &mips->fregs[$f0]) ||
+                                (!single && !replayInt(input, &mips->fregs[$f1]))) {
                                 result = EXEC_FAILURE;
-                                break;
                             }
+                            break;
                         }
-                        break;
-                    }
-                    case SPE_MFHI: {
-                        mips->regs[GET_RD(instr)] = mips->hi;
-                        break;
-                    }
-                    case SPE_MTHI: {
-                        mips->hi = mips->regs[GET_RS(instr)];
-                        break;
-                    }
-                    case SPE_MFLO: {
-                        mips->regs[GET_RD(instr)] = mips->lo;
-                        break;
-                    }
-                    case SPE_MTLO: {
-                        mips->hi = mips->regs[GET_RS(instr)];
-                        break;
-                    }
-                    case SPE_MULT:
-                    case SPE_MULTU: {
-                        int64_t res = mips->regs[GET_RS(instr)] * mips->regs[GET_RT(instr)];
-                        mips->hi = res >> 0x20;
-                        mips->lo = (int32_t)res;
-                        break;
-                    }
-                    case SPE_DIV:
-                    case SPE_DIVU: {
-                        int32_t rs = mips->regs[GET_RS(instr)];
-                        int32_t rt = mips->regs[GET_RT(instr)];
-
-                        if (rt != 0) {
-                            mips->lo = rs / rt;
-                            mips->hi = rs - (mips->lo * rt);
+
+                        char buffer[64];
+                        if (fgets(buffer, sizeof(buffer), stdin) == NULL) buffer[0] = '\0';
+                        if (single) {
+                            setSingle(mips->fregs, $f0, strtof(buffer, NULL));
+                        } else {
+                            setDouble(mips->fregs, $f0, strtod(buffer, NULL));
                         }
 
+                        if (input != NULL) {
+                            recordInt(input, mips->fregs[$f0]);
+                            if (!single) recordInt(input, mips->fregs[$f1]);
+                        }
                         break;
                     }
-                    case SPE_ADD: {
-                        BIN_OP(+);
+                    case SYS_READ_STRING: {
+                        uint32_t address = mips->regs[$a0];
+                        CHECK_MEM_ADDR(0, 1, address);
+                        uint8_t* string = &mips->memory->store[address];
+                        InputLog* input = mips->input;
+                        if (input != NULL && input->mode == REPLAY_PLAY) {
+                            if (!replayString(input, string, mips->regs[$a1])) result = EXEC_FAILURE;
+                            markDirtyPages(mips->memory, address, mips->regs[$a1]);
+                            break;
+                        }
+
+                        fgets((char*)string, mips->regs[$a1], stdin);
+                        string[strlen((char*)string) - 1] = '\0';
+                        markDirtyPages(mips->memory, address, strlen((char*)string) + 1);
+
+                        if (input != NULL) recordString(input, string, strlen((char*)string) + 1);
                         break;
                     }
-                    case SPE_ADDU: {
-                        BINU_OP(+);
+                    case SYS_SBRK: {
+                        mips->regs[$v0] = mips->heap;
+                        mips->heap += mips->regs[$a0];
+                        CHECK_MEM_ADDR(0, 1, mips->heap);
+                        PROBE_BREAK(mips);
                         break;
                     }
-                    case SPE_SUB: {
-                        BIN_OP(-);
+                    case SYS_MALLOC:
+                    case SYS_FREE:
+                    case SYS_REALLOC: {
+                        Arena* arena = getArena(mips);
+                        if (arena == NULL) {
+                            fprintf(stderr, "Unable to allocate the heap allocator.\n");
+                            result = EXEC_FAILURE;
+                            break;
+                        }
+
+                        // The heap is never grown into the page holding the stack pointer
+                        uint32_t limit = mips->regs[$sp] & ~(MEMORY_PAGE_SIZE - 1);
+                        uint32_t address = mips->regs[$a0];
+                        bool valid = true;
+                        if (mips->regs[$v0] == SYS_MALLOC) {
+                            mips->regs[$v0] = arenaMalloc(arena, mips->regs[$a0], &mips->heap, limit);
+                        } else if (mips->regs[$v0] == SYS_FREE) {
+                            valid = arenaFree(arena, address, &mips->heap);
+                        } else {
+                            mips->regs[$v0] = arenaRealloc(arena, mips->memory, address, mips->regs[$a1], &mips->heap,
+                                                           limit, &valid);
+                        }
+
+                        if (!valid) {
+                            fprintf(stderr, "Invalid heap block %#x at %#x.\n", address, ip);
+                            result = EXEC_FAILURE;
+                            break;
+                        }
+                        PROBE_BREAK(mips);
                         break;
                     }
-                    case SPE_SUBU: {
-                        BINU_OP(-);
+                    case SYS_RING_ENTER: {
+                        Ring* ring = getRing(mips);
+                        if (ring == NULL) {
+                            fprintf(stderr, "Unable to start the ring worker.\n");
+                            result = EXEC_FAILURE;
+                            break;
+                        }
+                        if (!enterRing(ring, mips->memory, mips->regs[$a0], mips->output, &mips->regs[$v0])) {
+                            fprintf(stderr, "Invalid ring at %#x.\n", mips->regs[$a0]);
+                            result = EXEC_FAILURE;
+                        }
                         break;
                     }
-                    case SPE_AND: {
-                        BINU_OP(&);
+                    case SYS_SEND: {
+                        uint32_t address = mips->regs[$a0];
+                        CHECK_MEM_ADDR(0, 1, address);
+                        const uint8_t* buffer = &mips->memory->store[address];
+                        uint32_t size = mips->regs[$a1];
+                        if (size > MEMORY_SIZE - address) size = MEMORY_SIZE - address;
+
+                        if (mips->channelOut != NULL) {
+                            mips->regs[$v0] = channelSend(mips->channelOut, buffer, size);
+                            break;
+                        }
+                        syncOutput(mips);
+                        mips->regs[$v0] = fwrite(buffer, sizeof(uint8_t), size, mips->output);
                         break;
                     }
-                    case SPE_OR: {
-                        BINU_OP(|);
+                    case SYS_RECV: {
+                        uint32_t address = mips->regs[$a0];
+                        CHECK_MEM_ADDR(0, 1, address);
+                        uint8_t* buffer = &mips->memory->store[address];
+                        uint32_t size = mips->regs[$a1];
+                        if (size > MEMORY_SIZE - address) size = MEMORY_SIZE - address;
+
+                        // Streams between simulators are not logged, runs connected to others cannot be replayed
+                        if (mips->channelIn != NULL) {
+                            mips->regs[$v0] = channelReceive(mips->channelIn, buffer, size);
+                            markDirtyPages(mips->memory, address, mips->regs[$v0]);
+                            break;
+                        }
+                        if (!readInput(mips, address, size, &mips->regs[$v0])) result = EXEC_FAILURE;
                         break;
                     }
-                    case SPE_XOR: {
-                        BINU_OP(^);
+                    case SYS_EXIT: {
+                        mips->stop = true;
                         break;
                     }
-                    case SPE_NOR: {
-                        mips->regs[GET_RD(instr)] = ~(mips->regs[GET_RS(instr)] | mips->regs[GET_RT(instr)]);
+                    case SYS_SNAPSHOT: {
+                        if (mips->snapshot != NULL && !saveSnapshot(mips, mips->snapshot)) {
+                            fprintf(stderr, "Unable to write snapshot '%s'.\n", mips->snapshot);
+                            result = EXEC_FAILURE;
+                        }
                         break;
                     }
-                    case SPE_SLT:
-                    case SPE_SLTU: {
-                        mips->regs[GET_RD(instr)] = ((int32_t)mips->regs[GET_RS(instr)] < (int32_t)mips->regs[GET_RT(instr)]);
+                    case SYS_FUZZ_INPUT: {
+                        uint32_t address = mips->regs[$a0];
+                        CHECK_MEM_ADDR(0, 1, address);
+                        uint32_t size = mips->regs[$a1];
+                        if (size > MEMORY_SIZE - address) size = MEMORY_SIZE - address;
+#ifdef LMIPS_INSTRUMENT
+                        if (mips->fuzz != NULL) {
+                            if (!takeFuzzInput(mips->fuzz, &mips->memory->store[address], size, &mips->regs[$v0])) {
+                                // Hand control back to the fuzzing loop, the syscall runs again once resumed
+                                mips->ip = ip;
+                                mips->stop = true;
+                                break;
+                            }
+                            markDirtyPages(mips->memory, address, mips->regs[$v0]);
+                            break;
+                        }
+#endif
+                        if (!readInput(mips, address, size, &mips->regs[$v0])) result = EXEC_FAILURE;
                         break;
                     }
-                    default:
-                        fprintf(stderr, "Unknown special instruction %d\n", func);
+                    default: {
+                        fprintf(stderr, "Unknown syscall instruction %d\n", mips->regs[$v0]);
                         result = EXEC_FAILURE;
                         break;
+                    }
                 }
-
                 break;
             }
-            case OP_SRI: {
-                uint8_t rt = GET_RT(instr);
-                switch (rt) {
-                    case SR_BLTZ: {
-                        COMP_OP(<)
-                        break;
-                    }
-                    case SR_BGEZ: {
-                        COMP_OP(>=)
-                        break;
-                    }
-                    default: {
-                        fprintf(stderr, "Unknown regimm instruction %d.", rt);
-                        result = EXEC_FAILURE;
-                        break;
-                    }
+            case DOP_MFHI: {
+                RD = mips->hi;
+                break;
+            }
+            case DOP_MTHI: {
+                mips->hi = RS;
+                break;
+            }
+            case DOP_MFLO: {
+                RD = mips->lo;
+                break;
+            }
+            case DOP_MTLO: {
+                mips->hi = RS;
+                break;
+            }
+            case DOP_MULT:
+            case DOP_MULTU: {
+                int64_t res = RS * RT;
+                mips->hi = res >> 0x20;
+                mips->lo = (int32_t)res;
+                break;
+            }
+            case DOP_DIV:
+            case DOP_DIVU: {
+                int32_t rs = RS;
+                int32_t rt = RT;
+
+                if (rt != 0) {
+                    mips->lo = rs / rt;
+                    mips->hi = rs - (mips->lo * rt);
                 }
+
+                break;
+            }
+            case DOP_ADD: {
+                BIN_OP(+);
+                break;
+            }
+            case DOP_ADDU: {
+                BINU_OP(+);
+                break;
+            }
+            case DOP_SUB: {
+                BIN_OP(-);
+                break;
             }
-            case OP_J: {
-                int32_t jt = GET_JT(instr);
-                mips->ip = jt << 2;
+            case DOP_SUBU: {
+                BINU_OP(-);
                 break;
             }
-            case OP_JAL: {
-                int32_t jt = GET_JT(instr);
+            case DOP_AND: {
+                BINU_OP(&);
+                break;
+            }
+            case DOP_OR: {
+                BINU_OP(|);
+                break;
+            }
+            case DOP_XOR: {
+                BINU_OP(^);
+                break;
+            }
+            case DOP_NOR: {
+                RD = ~(RS | RT);
+                break;
+            }
+            case DOP_SLT:
+            case DOP_SLTU: {
+                RD = ((int32_t)RS < (int32_t)RT);
+                break;
+            }
+            case DOP_BLTZ: {
+                COMP_OP(<)
+                break;
+            }
+            case DOP_BGEZ: {
+                COMP_OP(>=)
+                break;
+            }
+            case DOP_J: {
+                mips->ip = decoded->immed;
+                break;
+            }
+            case DOP_JAL: {
                 mips->regs[$ra] = mips->ip;
-                mips->ip = jt << 2;
+                mips->ip = decoded->immed;
                 break;
             }
-            case OP_BEQ: {
-                if (mips->regs[GET_RS(instr)] == mips->regs[GET_RT(instr)]) {
-                    int32_t offset = sign_extend(GET_IMMED(instr) << 2, 14);
-                    mips->ip += (offset - 4);
-                }
+            case DOP_BEQ: {
+                if (RS == RT) mips->ip = decoded->immed;
                 break;
             }
-            case OP_BNE: {
-                if (mips->regs[GET_RS(instr)] != mips->regs[GET_RT(instr)]) {
-                    int32_t offset = sign_extend(GET_IMMED(instr) << 2, 14);
-                    mips->ip += (offset - 4);
-                }
+            case DOP_BNE: {
+                if (RS != RT) mips->ip = decoded->immed;
                 break;
             }
-            case OP_BLEZ: {
+            case DOP_BLEZ: {
                 COMP_OP(<=)
                 break;
             }
-            case OP_BGTZ: {
+            case DOP_BGTZ: {
                 COMP_OP(>)
                 break;
             }
-            case OP_ADDI: {
-                int32_t immed = sign_extend(GET_IMMED(instr), 16);
-                int32_t rs = mips->regs[GET_RS(instr)];
+            case DOP_ADDI: {
+                int32_t immed = decoded->immed;
+                int32_t rs = RS;
                 CHECK_OVERFLOW(rs, immed, +);
 
-                mips->regs[GET_RT(instr)] = rs + immed;
+                RT = rs + immed;
                 break;
             }
-            case OP_ADDIU: {
-                int32_t immed = sign_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = (int32_t)(mips->regs[GET_RS(instr)]) + immed;
+            case DOP_ADDIU: {
+                RT = (int32_t)RS + (int32_t)decoded->immed;
                 break;
             }
-            case OP_SLTI: {
-                int32_t immed = sign_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = (int32_t)(mips->regs[GET_RS(instr)]) < immed;
+            case DOP_SLTI: {
+                RT = (int32_t)RS < (int32_t)decoded->immed;
                 break;
             }
-            case OP_SLTIU: {
-                uint32_t immed = sign_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = (int32_t)(mips->regs[GET_RS(instr)]) < immed;
+            case DOP_SLTIU: {
+                RT = (uint32_t)RS < decoded->immed;
                 break;
             }
-            case OP_ANDI: {
-                uint32_t immed = zero_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = mips->regs[GET_RS(instr)] & immed;
+            case DOP_ANDI: {
+                RT = RS & decoded->immed;
                 break;
             }
-            case OP_ORI: {
-                uint32_t immed = zero_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = mips->regs[GET_RS(instr)] | immed;
+            case DOP_ORI: {
+                RT = RS | decoded->immed;
                 break;
             }
-            case OP_XORI: {
-                uint32_t immed = zero_extend(GET_IMMED(instr), 16);
-
-                mips->regs[GET_RT(instr)] = mips->regs[GET_RS(instr)] ^ immed;
+            case DOP_XORI: {
+                RT = RS ^ decoded->immed;
                 break;
             }
-            case OP_LUI: {
-                uint32_t immed = (GET_IMMED(instr) << 16) | 0x00;
-                mips->regs[GET_RT(instr)] = immed;
+            case DOP_LUI: {
+                RT = decoded->immed;
                 break;
             }
-            case OP_LB: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_LB: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 1, address);
+                PROBE_LOAD(mips, ip, address, 1);
                 int8_t byte = mem_read_byte(mips->memory, address);
 
-                mips->regs[GET_RT(instr)] = sign_extend(byte, 16);
+                RT = sign_extend(byte, 16);
                 break;
             }
-            case OP_LH: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_LH: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 2, address);
+                PROBE_LOAD(mips, ip, address, 2);
                 int16_t half = mem_read_half(mips->memory, address);
 
-                mips->regs[GET_RT(instr)] = sign_extend(half, 16);
+                RT = sign_extend(half, 16);
                 break;
             }
-            case OP_LW: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_LW: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 4, address);
+                PROBE_LOAD(mips, ip, address, 4);
 
-                mips->regs[GET_RT(instr)] = (int32_t)mem_read(mips->memory, address);
+                RT = (int32_t)mem_read(mips->memory, address);
                 break;
             }
-            case OP_LBU: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_LBU: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 1, address);
+                PROBE_LOAD(mips, ip, address, 1);
                 uint8_t byte = mem_read_byte(mips->memory, address);
 
-                mips->regs[GET_RT(instr)] = zero_extend(byte, 16);
+                RT = zero_extend(byte, 16);
                 break;
             }
-            case OP_LHU: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_LHU: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 2, address);
+                PROBE_LOAD(mips, ip, address, 2);
 
-                mips->regs[GET_RT(instr)] = mem_read_half(mips->memory, address);
+                RT = mem_read_half(mips->memory, address);
                 break;
             }
-            case OP_SB: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_SB: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 1, address);
+                PROBE_STORE(mips, ip, address, 1);
 
-                mem_write_byte(mips->memory, address, (uint8_t)mips->regs[GET_RT(instr)]);
+                mem_write_byte(mips->memory, address, (uint8_t)RT);
 
                 break;
             }
-            case OP_SH: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_SH: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 1, address);
+                PROBE_STORE(mips, ip, address, 2);
 
-                mem_write_half(mips->memory, address, mips->regs[GET_RT(instr)]);
+                mem_write_half(mips->memory, address, RT);
 
                 break;
             }
-            case OP_SW: {
-                int16_t offset = GET_IMMED(instr);
-                uint32_t address = mips->regs[GET_RS(instr)] + offset;
+            case DOP_SW: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
                 CHECK_MEM_ADDR(offset, 1, address);
+                PROBE_STORE(mips, ip, address, 4);
 
-                mem_write(mips->memory, address, mips->regs[GET_RT(instr)]);
+                mem_write(mips->memory, address, RT);
 
                 break;
             }
+            case DOP_MOVZ: {
+                if (RT == 0) RD = RS;
+                break;
+            }
+            case DOP_MOVN: {
+                if (RT != 0) RD = RS;
+                break;
+            }
+            case DOP_MUL: {
+                // Low word of the product, hi and lo are left alone
+                RD = RS * RT;
+                break;
+            }
+            case DOP_CLZ: {
+                RD = RS == 0 ? 32 : __builtin_clz(RS);
+                break;
+            }
+            case DOP_CLO: {
+                RD = ~RS == 0 ? 32 : __builtin_clz(~RS);
+                break;
+            }
+            case DOP_SEB: {
+                RD = (int32_t)(int8_t)RT;
+                break;
+            }
+            case DOP_SEH: {
+                RD = (int32_t)(int16_t)RT;
+                break;
+            }
+            case DOP_EXT: {
+                RT = (RS >> decoded->rd) & decoded->immed;
+                break;
+            }
+            case DOP_INS: {
+                RT = (RT & ~decoded->immed) | ((RS << decoded->rd) & decoded->immed);
+                break;
+            }
+            case DOP_ADD_S: FD_S(FS_S + FT_S); break;
+            case DOP_SUB_S: FD_S(FS_S - FT_S); break;
+            case DOP_MUL_S: FD_S(FS_S * FT_S); break;
+            case DOP_DIV_S: FD_S(FS_S / FT_S); break;
+            case DOP_SQRT_S: FD_S(sqrtf(FS_S)); break;
+            case DOP_ABS_S: FD_S(fabsf(FS_S)); break;
+            case DOP_MOV_S: mips->fregs[decoded->rd] = mips->fregs[decoded->rs]; break;
+            case DOP_NEG_S: FD_S(-FS_S); break;
+            case DOP_ADD_D: FD_D(FS_D + FT_D); break;
+            case DOP_SUB_D: FD_D(FS_D - FT_D); break;
+            case DOP_MUL_D: FD_D(FS_D * FT_D); break;
+            case DOP_DIV_D: FD_D(FS_D / FT_D); break;
+            case DOP_SQRT_D: FD_D(sqrt(FS_D)); break;
+            case DOP_ABS_D: FD_D(fabs(FS_D)); break;
+            case DOP_MOV_D: {
+                mips->fregs[decoded->rd] = mips->fregs[decoded->rs];
+                mips->fregs[decoded->rd + 1] = mips->fregs[decoded->rs + 1];
+                break;
+            }
+            case DOP_NEG_D: FD_D(-FS_D); break;
+            // Ordered compares, NaN operands leave the flag clear
+            case DOP_C_EQ_S: mips->fcc = FS_S == FT_S; break;
+            case DOP_C_LT_S: mips->fcc = FS_S < FT_S; break;
+            case DOP_C_LE_S: mips->fcc = FS_S <= FT_S; break;
+            case DOP_C_EQ_D: mips->fcc = FS_D == FT_D; break;
+            case DOP_C_LT_D: mips->fcc = FS_D < FT_D; break;
+            case DOP_C_LE_D: mips->fcc = FS_D <= FT_D; break;
+            case DOP_CVT_S_D: FD_S((float)FS_D); break;
+            case DOP_CVT_S_W: FD_S((float)(int32_t)mips->fregs[decoded->rs]); break;
+            case DOP_CVT_D_S: FD_D(FS_S); break;
+            case DOP_CVT_D_W: FD_D((int32_t)mips->fregs[decoded->rs]); break;
+            case DOP_CVT_W_S: mips->fregs[decoded->rd] = convertWord(FS_S, false); break;
+            case DOP_CVT_W_D: mips->fregs[decoded->rd] = convertWord(FS_D, false); break;
+            case DOP_TRUNC_W_S: mips->fregs[decoded->rd] = convertWord(FS_S, true); break;
+            case DOP_TRUNC_W_D: mips->fregs[decoded->rd] = convertWord(FS_D, true); break;
+            case DOP_MFC1: {
+                RT = mips->fregs[decoded->rs];
+                break;
+            }
+            case DOP_MTC1: {
+                mips->fregs[decoded->rs] = RT;
+                break;
+            }
+            case DOP_LWC1: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
+                CHECK_MEM_ADDR(offset, 4, address);
+                PROBE_LOAD(mips, ip, address, 4);
+
+                mips->fregs[decoded->rt] = mem_read(mips->memory, address);
+                break;
+            }
+            case DOP_SWC1: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
+                CHECK_MEM_ADDR(offset, 4, address);
+                PROBE_STORE(mips, ip, address, 4);
+
+                mem_write(mips->memory, address, mips->fregs[decoded->rt]);
+                break;
+            }
+            case DOP_LDC1: {
+                // The word at the lower address is the high one on a big-endian guest
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
+                CHECK_MEM_ADDR(offset, 8, address);
+                CHECK_MEM_ADDR(offset, 8, address + 4);
+                PROBE_LOAD(mips, ip, address, 8);
+
+                uint32_t first = mem_read(mips->memory, address);
+                uint32_t second = mem_read(mips->memory, address + 4);
+                mips->fregs[decoded->rt] = littleEndian ? first : second;
+                mips->fregs[decoded->rt + 1] = littleEndian ? second : first;
+                break;
+            }
+            case DOP_SDC1: {
+                int16_t offset = decoded->immed;
+                uint32_t address = RS + offset;
+                CHECK_MEM_ADDR(offset, 8, address);
+                CHECK_MEM_ADDR(offset, 8, address + 4);
+                PROBE_STORE(mips, ip, address, 8);
+
+                uint32_t low = mips->fregs[decoded->rt];
+                uint32_t high = mips->fregs[decoded->rt + 1];
+                mem_write(mips->memory, address, littleEndian ? low : high);
+                mem_write(mips->memory, address + 4, littleEndian ? high : low);
+                break;
+            }
+            case DOP_BC1F: {
+                if (!mips->fcc) mips->ip = decoded->immed;
+                break;
+            }
+            case DOP_BC1T: {
+                if (mips->fcc) mips->ip = decoded->immed;
+                break;
+            }
+            case DOP_ADDV_B: vectorAdd(WD, WS, WT, DF_B); break;
+            case DOP_ADDV_H: vectorAdd(WD, WS, WT, DF_H); break;
+            case DOP_ADDV_W: vectorAdd(WD, WS, WT, DF_W); break;
+            case DOP_SUBV_B: vectorSub(WD, WS, WT, DF_B); break;
+            case DOP_SUBV_H: vectorSub(WD, WS, WT, DF_H); break;
+            case DOP_SUBV_W: vectorSub(WD, WS, WT, DF_W); break;
+            case DOP_MAX_S_B: vectorMaxS(WD, WS, WT, DF_B); break;
+            case DOP_MAX_S_H: vectorMaxS(WD, WS, WT, DF_H); break;
+            case DOP_MAX_S_W: vectorMaxS(WD, WS, WT, DF_W); break;
+            case DOP_MAX_U_B: vectorMaxU(WD, WS, WT, DF_B); break;
+            case DOP_MAX_U_H: vectorMaxU(WD, WS, WT, DF_H); break;
+            case DOP_MAX_U_W: vectorMaxU(WD, WS, WT, DF_W); break;
+            case DOP_MIN_S_B: vectorMinS(WD, WS, WT, DF_B); break;
+            case DOP_MIN_S_H: vectorMinS(WD, WS, WT, DF_H); break;
+            case DOP_MIN_S_W: vectorMinS(WD, WS, WT, DF_W); break;
+            case DOP_MIN_U_B: vectorMinU(WD, WS, WT, DF_B); break;
+            case DOP_MIN_U_H: vectorMinU(WD, WS, WT, DF_H); break;
+            case DOP_MIN_U_W: vectorMinU(WD, WS, WT, DF_W); break;
+            case DOP_CEQ_B: vectorCeq(WD, WS, WT, DF_B); break;
+            case DOP_CEQ_H: vectorCeq(WD, WS, WT, DF_H); break;
+            case DOP_CEQ_W: vectorCeq(WD, WS, WT, DF_W); break;
+            case DOP_CLT_S_B: vectorCltS(WD, WS, WT, DF_B); break;
+            case DOP_CLT_S_H: vectorCltS(WD, WS, WT, DF_H); break;
+            case DOP_CLT_S_W: vectorCltS(WD, WS, WT, DF_W); break;
+            case DOP_CLT_U_B: vectorCltU(WD, WS, WT, DF_B); break;
+            case DOP_CLT_U_H: vectorCltU(WD, WS, WT, DF_H); break;
+            case DOP_CLT_U_W: vectorCltU(WD, WS, WT, DF_W); break;
+            case DOP_HADD_S_H: vectorHadd(WD, WS, WT, DF_H, true); break;
+            case DOP_HADD_S_W: vectorHadd(WD, WS, WT, DF_W, true); break;
+            case DOP_HADD_U_H: vectorHadd(WD, WS, WT, DF_H, false); break;
+            case DOP_HADD_U_W: vectorHadd(WD, WS, WT, DF_W, false); break;
+            case DOP_SHF_B: vectorShuffle(WD, WS, decoded->immed, DF_B); break;
+            case DOP_SHF_H: vectorShuffle(WD, WS, decoded->immed, DF_H); break;
+            case DOP_SHF_W: vectorShuffle(WD, WS, decoded->immed, DF_W); break;
+            case DOP_LD_B: VECTOR_LOAD(DF_B); break;
+            case DOP_LD_H: VECTOR_LOAD(DF_H); break;
+            case DOP_LD_W: VECTOR_LOAD(DF_W); break;
+            case DOP_ST_B: VECTOR_STORE(DF_B); break;
+            case DOP_ST_H: VECTOR_STORE(DF_H); break;
+            case DOP_ST_W: VECTOR_STORE(DF_W); break;
+            case DOP_FILL_B: vectorFill(WD, RS, DF_B); break;
+            case DOP_FILL_H: vectorFill(WD, RS, DF_H); break;
+            case DOP_FILL_W: vectorFill(WD, RS, DF_W); break;
+            case DOP_COPY_S_B: RD = (int32_t)(int8_t)WS->b[decoded->immed]; break;
+            case DOP_COPY_S_H: RD = (int32_t)(int16_t)WS->h[decoded->immed]; break;
+            case DOP_COPY_S_W: RD = WS->w[decoded->immed]; break;
+            case DOP_COPY_U_B: RD = WS->b[decoded->immed]; break;
+            case DOP_COPY_U_H: RD = WS->h[decoded->immed]; break;
+            case DOP_UNKNOWN_SPECIAL:
+                fprintf(stderr, "Unknown special instruction %u\n", decoded->immed);
+                result = EXEC_FAILURE;
+                break;
+            case DOP_UNKNOWN_REGIMM:
+                fprintf(stderr, "Unknown regimm instruction %u.", decoded->immed);
+                result = EXEC_FAILURE;
+                break;
             default:
-                fprintf(stderr, "Unknown instruction %d\n", op);
+                fprintf(stderr, "Unknown instruction %u\n", decoded->immed);
                 result = EXEC_FAILURE;
                 break;
         }
+
+        if (result == EXEC_SUCCESS) {
+            PROBE_RETIRE(mips, ip, instr);
+        }
     }
 
+    return result;
+}
+
+ExecutionResult runSimulator(LMips* mips) {
+    ExecutionResult result = interpret(mips);
+    syncOutput(mips);
     if (result != EXEC_SUCCESS) {
         handleException(result, mips);
     }
@@ -443,9 +903,48 @@ ExecutionResult runSimulator(LMips* mips) {
 }
 
 void handleException(ExecutionResult exc, LMips* mips) {
+    // The trapping instruction is the one before ip, traps never come from control transfers
+    char location[128];
+    formatLocation(mips->debug, mips->ip - 4, location, sizeof(location));
+
     if (exc == EXEC_ERR_INT_OVERFLOW) {
-        fprintf(stderr, "[%#08x] Integer overflow exception.\n", PROGRAM_ADDRESS + mips->ip);
+        fprintf(stderr, "[%s] Integer overflow exception.\n", location);
     } else if (exc == EXEC_ERR_MEMORY_ADDR) {
-        fprintf(stderr, "[%#08x] Invalid memory address.\n", PROGRAM_ADDRESS + mips->ip);
+        fprintf(stderr, "[%s] Invalid memory address.\n", location);
     }
 }
+
+uint64_t hashSimulator(LMips* mips) {
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+#define HASH_WORD(hash, word) \
+    for (int shift = 0; shift < 32; shift += 8) { \
+        hash = (hash ^ (((word) >> shift) & 0xFF)) * FNV_PRIME; \
+    }
+
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < REG_COUNT; i++) {
+        HASH_WORD(hash, mips->regs[i]);
+    }
+    HASH_WORD(hash, mips->hi);
+    HASH_WORD(hash, mips->lo);
+    for (size_t i = 0; i < FREG_COUNT; i++) {
+        HASH_WORD(hash, mips->fregs[i]);
+    }
+    HASH_WORD(hash, (uint32_t)mips->fcc);
+    for (size_t i = 0; i < VREG_COUNT; i++) {
+        for (size_t lane = 0; lane < VECTOR_SIZE / 4; lane++) {
+            HASH_WORD(hash, mips->vregs[i].w[lane]);
+        }
+    }
+    HASH_WORD(hash, mips->ip);
+    HASH_WORD(hash, mips->heap);
+
+    if (mips->memory != NULL) {
+        for (uint32_t i = 0; i < MEMORY_SIZE; i++) {
+            hash = (hash ^ mips->memory->store[i]) * FNV_PRIME;
+        }
+    }
+
+    return hash;
+}
@@ -1,17 +1,45 @@
 #ifndef LMIPS_MIPS
 #define LMIPS_MIPS
 
+#include <stdio.h>
 #include "common.h"
 #include "memory.h"
 #include "lmips_registers.h"
+#include "replay.h"
+#include "probes.h"
+#include "debuginfo.h"
+#include "decode.h"
+#include "vector.h"
+#include "arena.h"
+#include "ring.h"
+#include "channel.h"
 
 struct lm {
     uint8_t* program;
+    uint32_t textSize; // Bytes of text the executable loaded at program
+    const DecodedText* decoded; // Instructions outside of it are decoded as they are fetched
     uint32_t regs[REG_COUNT];
     uint32_t ip;
     uint32_t hi, lo;
+    uint32_t fregs[FREG_COUNT]; // CP1 registers, a double keeps its low word in the even register
+    bool fcc; // CP1 condition flag, set by compares and tested by bc1t/bc1f
+    VectorReg vregs[VREG_COUNT]; // MSA registers, kept apart from the CP1 ones
     uint32_t heap;
+    Arena* arena; // Heap allocator behind SYS_MALLOC, created by the first call and owned by the simulator
     Memory* memory;
+    InputLog* input;
+    FILE* output;
+    Ring* ring; // Output worker behind SYS_RING_ENTER, created by the first call
+    Channel* channelIn; // Stream SYS_RECV reads from the simulator before this one, stdin when not set
+    Channel* channelOut; // Stream SYS_SEND writes to the simulator after this one, output when not set
+    const char* snapshot; // Written by SYS_SNAPSHOT, the syscall is ignored when not set
+    DebugInfo* debug; // Names trap locations when the executable carries symbols
+    uint64_t retired;
+    uint64_t limit; // runSimulator returns once this many instructions have been retired
+#ifdef LMIPS_INSTRUMENT
+    Probes* probes;
+    struct fs* fuzz; // Persistent fuzzing session feeding SYS_FUZZ_INPUT, stdin is read when not set
+#endif
     bool stop;
 };
 
@@ -31,5 +59,6 @@ ExecutionResult runSimulator(LMips* mips);
 ExecutionResult execInstruction(LMips* mips);
 
 void handleException(ExecutionResult, LMips*);
+uint64_t hashSimulator(LMips* mips);
 
 #endif // LMIPS_MIPS
@@ -18,6 +18,10 @@ enum OpCodes {
     OP_ORI,
     OP_XORI,
     OP_LUI,
+    OP_COP1 = 0x11,
+    OP_SPECIAL2 = 0x1C,
+    OP_MSA = 0x1E,
+    OP_SPECIAL3 = 0x1F,
     OP_LB = 0x20,
     OP_LH,
     OP_LW = 0x23,
@@ -25,7 +29,11 @@ enum OpCodes {
     OP_LHU,
     OP_SB = 0x28,
     OP_SH,
-    OP_SW
+    OP_SW,
+    OP_LWC1 = 0x31,
+    OP_LDC1 = 0x35,
+    OP_SWC1 = 0x39,
+    OP_SDC1 = 0x3D
 };
 
 enum SpecialCodes {
@@ -37,7 +45,9 @@ enum SpecialCodes {
     SPE_SRAV,
     SPE_JR,
     SPE_JALR,
-    SPE_SYSCALL = 0x0C,
+    SPE_MOVZ = 0x0A,
+    SPE_MOVN,
+    SPE_SYSCALL,
     SPE_MFHI = 0x10,
     SPE_MTHI,
     SPE_MFLO,
@@ -58,13 +68,107 @@ enum SpecialCodes {
     SPE_SLTU
 };
 
+enum Special2Codes {
+    SP2_MUL = 0x02,
+    SP2_CLZ = 0x20,
+    SP2_CLO
+};
+
+enum Special3Codes {
+    SP3_EXT,
+    SP3_INS = 0x04,
+    SP3_BSHFL = 0x20 // Byte shuffles, told apart by the shift amount field
+};
+
+enum BshflCodes {
+    BSHFL_SEB = 0x10,
+    BSHFL_SEH = 0x18
+};
+
+// Format field of COP1 instructions, in the rs position
+enum Cop1Formats {
+    FMT_MF = 0x00,
+    FMT_MT = 0x04,
+    FMT_BC = 0x08,
+    FMT_S = 0x10,
+    FMT_D,
+    FMT_W = 0x14
+};
+
+enum Cop1Codes {
+    FPU_ADD,
+    FPU_SUB,
+    FPU_MUL,
+    FPU_DIV,
+    FPU_SQRT,
+    FPU_ABS,
+    FPU_MOV,
+    FPU_NEG,
+    FPU_TRUNC_W = 0x0D,
+    FPU_CVT_S = 0x20,
+    FPU_CVT_D,
+    FPU_CVT_W = 0x24,
+    FPU_C_EQ = 0x32,
+    FPU_C_LT = 0x3C,
+    FPU_C_LE = 0x3E
+};
+
+// Minor opcode of MSA instructions, in the function position. It also tells apart their formats.
+enum MsaMinorCodes {
+    MSA_SHF = 0x02, // I8 format, df in bits 25-24
+    MSA_ARITH = 0x0E, // 3R formats, the operation in bits 25-23 and df in bits 22-21
+    MSA_COMPARE = 0x0F,
+    MSA_HORIZONTAL = 0x15,
+    MSA_ELM = 0x19, // Operation in bits 25-22, df and lane in bits 21-16
+    MSA_2R = 0x1E, // Operation in bits 25-18, df in bits 17-16
+    MSA_LD = 0x20, // MI10 format, df in the low two bits of the minor opcode
+    MSA_ST = 0x24
+};
+
+enum MsaOperations {
+    MSA_ADDV = 0x00,
+    MSA_SUBV,
+    MSA_MAX_S,
+    MSA_MAX_U,
+    MSA_MIN_S,
+    MSA_MIN_U,
+    MSA_CEQ = 0x00,
+    MSA_CLT_S = 0x02,
+    MSA_CLT_U,
+    MSA_HADD_S = 0x04,
+    MSA_HADD_U,
+    MSA_COPY_S = 0x02,
+    MSA_COPY_U,
+    MSA_FILL = 0xC0
+};
+
+// Lane size of MSA instructions
+enum MsaFormats {
+    DF_B,
+    DF_H,
+    DF_W,
+    DF_D
+};
+
 enum SysCallCodes {
     SYS_PRINT_INT = 0x01,
-    SYS_PRINT_STRING = 0x04,
+    SYS_PRINT_FLOAT,
+    SYS_PRINT_DOUBLE,
+    SYS_PRINT_STRING,
     SYS_READ_INT,
     SYS_READ_STRING,
+    SYS_READ_DOUBLE,
+    SYS_READ_FLOAT, // 6 was taken by read_string before the FPU came in
     SYS_SBRK = 0x09,
-    SYS_EXIT
+    SYS_EXIT,
+    SYS_SNAPSHOT = 0x20,
+    SYS_FUZZ_INPUT,
+    SYS_MALLOC,
+    SYS_FREE,
+    SYS_REALLOC,
+    SYS_RING_ENTER,
+    SYS_SEND,
+    SYS_RECV
 };
 
 enum SriCodes {
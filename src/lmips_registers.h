@@ -37,4 +37,77 @@ enum Registers {
     REG_COUNT
 };
 
+// CP1 registers, a double takes an even register and the odd one after it
+enum FloatRegisters {
+    $f0,
+    $f1,
+    $f2,
+    $f3,
+    $f4,
+    $f5,
+    $f6,
+    $f7,
+    $f8,
+    $f9,
+    $f10,
+    $f11,
+    $f12,
+    $f13,
+    $f14,
+    $f15,
+    $f16,
+    $f17,
+    $f18,
+    $f19,
+    $f20,
+    $f21,
+    $f22,
+    $f23,
+    $f24,
+    $f25,
+    $f26,
+    $f27,
+    $f28,
+    $f29,
+    $f30,
+    $f31,
+    FREG_COUNT
+};
+
+enum VectorRegisters {
+    $w0,
+    $w1,
+    $w2,
+    $w3,
+    $w4,
+    $w5,
+    $w6,
+    $w7,
+    $w8,
+    $w9,
+    $w10,
+    $w11,
+    $w12,
+    $w13,
+    $w14,
+    $w15,
+    $w16,
+    $w17,
+    $w18,
+    $w19,
+    $w20,
+    $w21,
+    $w22,
+    $w23,
+    $w24,
+    $w25,
+    $w26,
+    $w27,
+    $w28,
+    $w29,
+    $w30,
+    $w31,
+    VREG_COUNT
+};
+
 #endif // LMIPS_REGISTERS
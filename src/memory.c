@@ -1,16 +1,48 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "memory.h"
 
+#define MARK_DIRTY(memory, address) ((memory)->dirty[(address) >> 18] |= 1ULL << (((address) >> 12) & 0x3F))
+
+// Little-endian guests are accessed with single native loads and stores, only big-endian hosts swap them
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LITTLE_WORD(value) __builtin_bswap32(value)
+#define LITTLE_HALF(value) __builtin_bswap16(value)
+#else
+#define LITTLE_WORD(value) (value)
+#define LITTLE_HALF(value) (value)
+#endif
+
 void initMemory(Memory* memory) {
-    memory->store = realloc(NULL, MEMORY_SIZE * sizeof(uint8_t));
+    // Anonymous mappings start zeroed and pages are only materialised once touched.
+    // Snapshots rely on it to map their pages over the store.
+    memory->store = mmap(NULL, MEMORY_MAPPED_SIZE * sizeof(uint8_t), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory->store == MAP_FAILED) {
+        fprintf(stderr, "Unable to allocate guest memory.\n");
+        exit(1);
+    }
+
+    memory->littleEndian = false;
+    clearDirtyPages(memory);
 }
 
 void freeMemory(Memory* memory) {
-    memory->store = realloc(memory->store, 0);
+    if (memory->store != NULL) {
+        munmap(memory->store, MEMORY_MAPPED_SIZE * sizeof(uint8_t));
+        memory->store = NULL;
+    }
 }
 
 int32_t mem_read(Memory* memory, uint32_t address) {
+    if (memory->littleEndian) {
+        uint32_t value;
+        memcpy(&value, &memory->store[address], sizeof(value));
+        return LITTLE_WORD(value);
+    }
+
     return memory->store[address + 3] |
            (memory->store[address + 2] << 0x08) |
            (memory->store[address + 1] << 0x10) |
@@ -22,10 +54,24 @@ uint8_t mem_read_byte(Memory* memory, uint32_t address) {
 }
 
 uint16_t mem_read_half(Memory* memory, uint32_t address) {
+    if (memory->littleEndian) {
+        uint16_t value;
+        memcpy(&value, &memory->store[address], sizeof(value));
+        return LITTLE_HALF(value);
+    }
+
     return memory->store[address + 1] | (memory->store[address] << 0x08);
 }
 
 void mem_write(Memory* memory, uint32_t address, uint32_t value) {
+    MARK_DIRTY(memory, address);
+    MARK_DIRTY(memory, address + 3);
+    if (memory->littleEndian) {
+        value = LITTLE_WORD(value);
+        memcpy(&memory->store[address], &value, sizeof(value));
+        return;
+    }
+
     memory->store[address + 3] = value;
     memory->store[address + 2] = (uint8_t)(value >> 0x08);
     memory->store[address + 1] = (uint8_t)(value >> 0x10);
@@ -33,10 +79,40 @@ void mem_write(Memory* memory, uint32_t address, uint32_t value) {
 }
 
 void mem_write_byte(Memory* memory, uint32_t address, uint8_t value) {
+    MARK_DIRTY(memory, address);
     memory->store[address] = value;
 }
 
 void mem_write_half(Memory* memory, uint32_t address, uint16_t value) {
+    MARK_DIRTY(memory, address);
+    MARK_DIRTY(memory, address + 1);
+    if (memory->littleEndian) {
+        value = LITTLE_HALF(value);
+        memcpy(&memory->store[address], &value, sizeof(value));
+        return;
+    }
+
     memory->store[address + 1] = value;
     memory->store[address] = (uint8_t)(value >> 0x08);
-}
\ No newline at end of file
+}
+
+uint32_t mem_read_instr(const uint8_t* program, uint32_t ip, bool littleEndian) {
+    if (littleEndian) {
+        uint32_t value;
+        memcpy(&value, &program[ip], sizeof(value));
+        return LITTLE_WORD(value);
+    }
+
+    return ((uint32_t)program[ip] << 0x18) | (program[ip + 1] << 0x10) | (program[ip + 2] << 0x08) | program[ip + 3];
+}
+
+void markDirtyPages(Memory* memory, uint32_t address, uint32_t size) {
+    uint32_t end = address + size > MEMORY_SIZE ? MEMORY_SIZE : address + size;
+    for (uint32_t page = address & ~(MEMORY_PAGE_SIZE - 1); page < end; page += MEMORY_PAGE_SIZE) {
+        MARK_DIRTY(memory, page);
+    }
+}
+
+void clearDirtyPages(Memory* memory) {
+    memset(memory->dirty, 0, sizeof(memory->dirty));
+}
@@ -8,9 +8,17 @@
 #define DATA_ADDRESS 0x080000
 #define HEAP_ADDRESS 0x101000
 #define STACK_ADDRESS 0x3FFFFF
+#define MEMORY_PAGE_SIZE 0x1000
+#define MEMORY_PAGES (MEMORY_SIZE / MEMORY_PAGE_SIZE)
+// Half and word accesses are only bounds-checked on their first byte and may run past the
+// top of the stack, so an extra page is kept mapped above the guest memory.
+#define MEMORY_MAPPED_SIZE (MEMORY_SIZE + MEMORY_PAGE_SIZE)
+#define DIRTY_WORDS (MEMORY_PAGES / 64 + 1) // Last word covers stores spilling past the top of memory
 
 typedef struct {
     uint8_t* store;
+    bool littleEndian; // Byte order of guest halves and words, set by the loader from the executable
+    uint64_t dirty[DIRTY_WORDS]; // One bit per page written since the last clearDirtyPages
 } Memory;
 
 void initMemory(Memory* memory);
@@ -24,4 +32,10 @@ void mem_write(Memory* memory, uint32_t address, uint32_t value);
 void mem_write_byte(Memory* memory, uint32_t address, uint8_t value);
 void mem_write_half(Memory* memory, uint32_t address, uint16_t value);
 
+// Instruction word at ip in the text, in the guest byte order
+uint32_t mem_read_instr(const uint8_t* program, uint32_t ip, bool littleEndian);
+
+void markDirtyPages(Memory* memory, uint32_t address, uint32_t size);
+void clearDirtyPages(Memory* memory);
+
 #endif //LMIPS_MEMORY
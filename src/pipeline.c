@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+#include "memory.h"
+#include "lmips_opcodes.h"
+#include "lmips_registers.h"
+
+#define PIPELINE_DEPTH 5
+#define PREDICTOR_BITS 12
+
+static const char* predictorNames[] = {"static", "bimodal", "gshare"};
+static const char* stallNames[] = {"load-use", "branch", "jump", "hi/lo"};
+
+bool parsePredictorKind(const char* name, PredictorKind* kind) {
+    for (int i = PREDICT_STATIC; i <= PREDICT_GSHARE; i++) {
+        if (strcmp(name, predictorNames[i]) == 0) {
+            *kind = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+PipelineConfig defaultPipelineConfig() {
+    PipelineConfig config = {4, 32, 2, 1};
+    return config;
+}
+
+bool initPipeline(Pipeline* pipeline, PredictorKind kind, PipelineConfig config) {
+    memset(pipeline, 0, sizeof(Pipeline));
+    pipeline->config = config;
+    pipeline->predictor.kind = kind;
+    pipeline->predictor.mask = (1u << PREDICTOR_BITS) - 1;
+
+    if (kind == PREDICT_STATIC) return true;
+
+    // Start every counter as weakly not taken
+    pipeline->predictor.counters = malloc(1u << PREDICTOR_BITS);
+    if (pipeline->predictor.counters == NULL) return false;
+    memset(pipeline->predictor.counters, 1, 1u << PREDICTOR_BITS);
+
+    return true;
+}
+
+void freePipeline(Pipeline* pipeline) {
+    free(pipeline->predictor.counters);
+    free(pipeline->stallSites);
+    pipeline->predictor.counters = NULL;
+    pipeline->stallSites = NULL;
+}
+
+bool trackStallSites(Pipeline* pipeline) {
+    pipeline->stallSites = calloc(MEMORY_SIZE >> 2, sizeof(uint32_t));
+    return pipeline->stallSites != NULL;
+}
+
+// Returns whether the prediction was right and trains the predictor with the actual outcome
+static bool predictBranch(BranchPredictor* predictor, uint32_t ip, uint32_t instr, bool taken) {
+    if (predictor->kind == PREDICT_STATIC) {
+        bool backward = (int16_t)(instr & 0xFFFF) < 0;
+        return backward == taken;
+    }
+
+    uint32_t index = ip >> 2;
+    if (predictor->kind == PREDICT_GSHARE) {
+        index ^= predictor->history;
+        predictor->history = ((predictor->history << 1) | taken) & predictor->mask;
+    }
+
+    uint8_t* counter = &predictor->counters[index & predictor->mask];
+    bool predicted = *counter >= 2;
+
+    if (taken && *counter < 3) (*counter)++;
+    if (!taken && *counter > 0) (*counter)--;
+
+    return predicted == taken;
+}
+
+// Bitmask of the registers an instruction reads in ID/EX, per register file
+static void sourceRegisters(uint32_t instr, uint32_t sources[REGISTER_FILES]) {
+    uint8_t op = instr >> 0x1A;
+    uint32_t rs = 1u << ((instr >> 0x15) & 0x1F);
+    uint32_t rt = 1u << ((instr >> 0x10) & 0x1F);
+    uint32_t mask;
+
+    sources[REGS_FPR] = 0;
+    sources[REGS_MSA] = 0;
+
+    switch (op) {
+        case OP_SPECIAL: {
+            switch (instr & 0x3F) {
+                case SPE_SLL:
+                case SPE_SRL:
+                case SPE_SRA:
+                    mask = rt;
+                    break;
+                case SPE_JR:
+                case SPE_JALR:
+                case SPE_MTHI:
+                case SPE_MTLO:
+                    mask = rs;
+                    break;
+                case SPE_SYSCALL:
+                    mask = (1u << $v0) | (1u << $a0) | (1u << $a1);
+                    break;
+                case SPE_MFHI:
+                case SPE_MFLO:
+                    mask = 0;
+                    break;
+                default:
+                    mask = rs | rt;
+                    break;
+            }
+            break;
+        }
+        case OP_SPECIAL2:
+            // clz and clo repeat their destination in rt
+            mask = (instr & 0x3F) == SP2_MUL ? rs | rt : rs;
+            break;
+        case OP_SPECIAL3:
+            // ins merges into rt, seb and seh only read it
+            mask = (instr & 0x3F) == SP3_INS ? rs | rt : ((instr & 0x3F) == SP3_BSHFL ? rt : rs);
+            break;
+        case OP_MSA: {
+            uint32_t ws = 1u << ((instr >> 0x0B) & 0x1F);
+            uint32_t wt = 1u << ((instr >> 0x10) & 0x1F);
+            uint32_t wd = 1u << ((instr >> 0x06) & 0x1F);
+            uint8_t minor = instr & 0x3F;
+
+            // ld, st and fill take a general-purpose register in the ws position, st also reads wd
+            mask = 0;
+            if ((minor & 0x38) == MSA_LD || minor == MSA_2R) {
+                mask = ws;
+                if ((minor & 0x3C) == MSA_ST) sources[REGS_MSA] = wd;
+            } else if (minor == MSA_ARITH || minor == MSA_COMPARE || minor == MSA_HORIZONTAL) {
+                sources[REGS_MSA] = ws | wt;
+            } else {
+                sources[REGS_MSA] = ws;
+            }
+            break;
+        }
+        case OP_COP1: {
+            uint8_t fmt = (instr >> 0x15) & 0x1F;
+            uint8_t func = instr & 0x3F;
+            // Doubles are read from an even/odd pair
+            uint32_t width = fmt == FMT_D ? 3u : 1u;
+            uint32_t fs = width << ((instr >> 0x0B) & 0x1F);
+            uint32_t ft = width << ((instr >> 0x10) & 0x1F);
+
+            mask = fmt == FMT_MT ? rt : 0;
+            if (fmt == FMT_MF) {
+                sources[REGS_FPR] = 1u << ((instr >> 0x0B) & 0x1F);
+            } else if (fmt == FMT_S || fmt == FMT_D || fmt == FMT_W) {
+                // Compares and the four arithmetic operations are the only ones reading ft
+                bool binary = (func >= FPU_ADD && func <= FPU_DIV) || func >= FPU_C_EQ;
+                sources[REGS_FPR] = binary ? fs | ft : fs;
+            }
+            break;
+        }
+        case OP_SWC1:
+            mask = rs;
+            sources[REGS_FPR] = rt;
+            break;
+        case OP_SDC1:
+            mask = rs;
+            sources[REGS_FPR] = 3u << ((instr >> 0x10) & 0x1F);
+            break;
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_SB:
+        case OP_SH:
+        case OP_SW:
+            mask = rs | rt;
+            break;
+        case OP_J:
+        case OP_JAL:
+        case OP_LUI:
+            mask = 0;
+            break;
+        default:
+            mask = rs;
+            break;
+    }
+
+    sources[REGS_GPR] = mask & ~(1u << $zero);
+}
+
+// Records the registers the instruction loads into, if it is a load
+static void loadDestination(Pipeline* pipeline, uint32_t instr) {
+    uint8_t op = instr >> 0x1A;
+    uint8_t rt = (instr >> 0x10) & 0x1F;
+
+    pipeline->loadFile = REGS_GPR;
+    pipeline->loadDest = 0;
+
+    if (op >= OP_LB && op <= OP_LHU) {
+        pipeline->loadDest = (1u << rt) & ~(1u << $zero);
+    } else if (op == OP_LWC1 || op == OP_LDC1) {
+        pipeline->loadFile = REGS_FPR;
+        pipeline->loadDest = (op == OP_LDC1 ? 3u : 1u) << rt;
+    } else if (op == OP_MSA && (instr & 0x3C) == MSA_LD) {
+        pipeline->loadFile = REGS_MSA;
+        pipeline->loadDest = 1u << ((instr >> 0x06) & 0x1F);
+    }
+}
+
+void pipelineRetire(Pipeline* pipeline, uint32_t ip, uint32_t instr, uint32_t nextIp) {
+    PipelineConfig* config = &pipeline->config;
+    uint8_t op = instr >> 0x1A;
+    uint8_t func = instr & 0x3F;
+    uint64_t stalls[STALL_CAUSES] = {0};
+
+    if (pipeline->loadDest != 0) {
+        uint32_t sources[REGISTER_FILES];
+        sourceRegisters(instr, sources);
+        if (sources[pipeline->loadFile] & pipeline->loadDest) stalls[STALL_LOAD_USE] = 1;
+    }
+
+    switch (op) {
+        case OP_SPECIAL: {
+            uint64_t issue = pipeline->cycles + stalls[STALL_LOAD_USE];
+            switch (func) {
+                case SPE_MFHI:
+                case SPE_MFLO:
+                case SPE_MTHI:
+                case SPE_MTLO:
+                    if (pipeline->hiloReady > issue) stalls[STALL_HILO] = pipeline->hiloReady - issue;
+                    break;
+                case SPE_MULT:
+                case SPE_MULTU:
+                case SPE_DIV:
+                case SPE_DIVU: {
+                    // The multiply/divide unit is not pipelined
+                    if (pipeline->hiloReady > issue) stalls[STALL_HILO] = pipeline->hiloReady - issue;
+                    uint8_t latency = func >= SPE_DIV ? config->divLatency : config->multLatency;
+                    pipeline->hiloReady = issue + stalls[STALL_HILO] + latency;
+                    break;
+                }
+                case SPE_JR:
+                case SPE_JALR:
+                    stalls[STALL_JUMP] = config->branchPenalty;
+                    break;
+            }
+            break;
+        }
+        case OP_J:
+        case OP_JAL:
+            stalls[STALL_JUMP] = config->jumpPenalty;
+            break;
+        case OP_COP1:
+            if (((instr >> 0x15) & 0x1F) != FMT_BC) break;
+            // bc1t and bc1f are predicted like any other branch
+            // fall through
+        case OP_SRI:
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_BLEZ:
+        case OP_BGTZ: {
+            pipeline->branches++;
+            if (!predictBranch(&pipeline->predictor, ip, instr, nextIp != ip + 4)) {
+                pipeline->mispredictions++;
+                stalls[STALL_BRANCH] = config->branchPenalty;
+            }
+            break;
+        }
+    }
+
+    loadDestination(pipeline, instr);
+
+    pipeline->instructions++;
+    pipeline->cycles++;
+    for (int cause = 0; cause < STALL_CAUSES; cause++) {
+        pipeline->stalls[cause] += stalls[cause];
+        pipeline->cycles += stalls[cause];
+        if (pipeline->stallSites != NULL && ip < MEMORY_SIZE) pipeline->stallSites[ip >> 2] += stalls[cause];
+    }
+}
+
+uint64_t pipelineCycles(Pipeline* pipeline) {
+    // Account for filling the pipeline before the first instruction completes
+    return pipeline->instructions == 0 ? 0 : pipeline->cycles + PIPELINE_DEPTH - 1;
+}
+
+void printPipelineReport(Pipeline* pipeline, FILE* out) {
+    uint64_t cycles = pipelineCycles(pipeline);
+
+    fprintf(out, "Pipeline timing report (%s predictor)\n", predictorNames[pipeline->predictor.kind]);
+    fprintf(out, "  Instructions : %llu\n", (unsigned long long)pipeline->instructions);
+    fprintf(out, "  Cycles       : %llu\n", (unsigned long long)cycles);
+    fprintf(out, "  CPI          : %.3f\n", pipeline->instructions == 0 ? 0.0 : (double)cycles / pipeline->instructions);
+    fprintf(out, "  Branches     : %llu (%llu mispredicted)\n",
+            (unsigned long long)pipeline->branches, (unsigned long long)pipeline->mispredictions);
+    fprintf(out, "Stall cycles\n");
+    for (int cause = 0; cause < STALL_CAUSES; cause++) {
+        fprintf(out, "  %-12s : %llu (%.2f%% of cycles)\n", stallNames[cause],
+                (unsigned long long)pipeline->stalls[cause],
+                cycles == 0 ? 0.0 : 100.0 * pipeline->stalls[cause] / cycles);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef LMIPS_PIPELINE
+#define LMIPS_PIPELINE
+
+#include <stdio.h>
+#include "common.h"
+
+typedef enum {
+    PREDICT_STATIC, // Backward taken, forward not taken
+    PREDICT_BIMODAL,
+    PREDICT_GSHARE
+} PredictorKind;
+
+typedef enum {
+    STALL_LOAD_USE,
+    STALL_BRANCH,
+    STALL_JUMP,
+    STALL_HILO,
+    STALL_CAUSES
+} StallCause;
+
+// Register files a load can write and a later instruction can read
+typedef enum {
+    REGS_GPR,
+    REGS_FPR,
+    REGS_MSA,
+    REGISTER_FILES
+} RegisterFile;
+
+typedef struct {
+    PredictorKind kind;
+    uint8_t* counters; // 2-bit saturating counters
+    uint32_t mask;
+    uint32_t history;
+} BranchPredictor;
+
+typedef struct {
+    uint8_t multLatency;
+    uint8_t divLatency;
+    uint8_t branchPenalty; // Branches and register jumps resolve in EX
+    uint8_t jumpPenalty; // Immediate jumps resolve in ID
+} PipelineConfig;
+
+// Trace-driven model of the classic IF/ID/EX/MEM/WB pipeline, fed with every retired instruction
+typedef struct {
+    PipelineConfig config;
+    BranchPredictor predictor;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t stalls[STALL_CAUSES];
+    uint64_t branches;
+    uint64_t mispredictions;
+    uint64_t hiloReady; // Cycle at which the pending mult/div result lands in HI/LO
+    RegisterFile loadFile;
+    uint32_t loadDest; // Registers of loadFile written by the previous instruction if it was a load, doubles take two
+    uint32_t* stallSites; // Stall cycles per instruction, indexed by ip >> 2, only kept once tracked
+} Pipeline;
+
+bool parsePredictorKind(const char* name, PredictorKind* kind);
+PipelineConfig defaultPipelineConfig();
+
+bool initPipeline(Pipeline* pipeline, PredictorKind kind, PipelineConfig config);
+void freePipeline(Pipeline* pipeline);
+bool trackStallSites(Pipeline* pipeline);
+void pipelineRetire(Pipeline* pipeline, uint32_t ip, uint32_t instr, uint32_t nextIp);
+uint64_t pipelineCycles(Pipeline* pipeline);
+void printPipelineReport(Pipeline* pipeline, FILE* out);
+
+#endif // LMIPS_PIPELINE
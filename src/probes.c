@@ -0,0 +1,40 @@
+#include <stddef.h>
+#include "probes.h"
+
+void probeFetch(Probes* probes, uint32_t ip) {
+    if (probes->cache != NULL) cacheFetch(probes->cache, ip);
+}
+
+// Vector and double accesses may straddle two lines, each of them is looked up
+static void dataAccess(CacheHierarchy* cache, uint32_t ip, uint32_t address, uint8_t size) {
+    uint32_t last = address + size - 1;
+
+    cacheData(cache, ip, address);
+    if ((last >> cache->l1d.lineBits) != (address >> cache->l1d.lineBits)) cacheData(cache, ip, last);
+}
+
+void probeLoad(Probes* probes, uint32_t ip, uint32_t address, uint8_t size) {
+    if (probes->cache != NULL) dataAccess(probes->cache, ip, address, size);
+    if (probes->heat != NULL) heatAccess(probes->heat, address, false);
+}
+
+void probeStore(Probes* probes, uint32_t ip, uint32_t address, uint8_t size) {
+    if (probes->cache != NULL) dataAccess(probes->cache, ip, address, size);
+    if (probes->heat != NULL) heatAccess(probes->heat, address, true);
+}
+
+bool probeRetire(Probes* probes, uint32_t ip, uint32_t instr, uint32_t nextIp) {
+    bool following = true;
+
+    if (probes->pipeline != NULL) pipelineRetire(probes->pipeline, ip, instr, nextIp);
+    if (probes->bbv != NULL) following = bbvRetire(probes->bbv, ip, nextIp);
+    if (probes->coverage != NULL) coverageRetire(probes->coverage, instr, nextIp);
+    if (probes->heat != NULL) heatRetire(probes->heat);
+    if (probes->profile != NULL) profileRetire(probes->profile, ip, nextIp);
+
+    return following;
+}
+
+void probeBreak(Probes* probes, uint32_t heap) {
+    if (probes->heat != NULL) heatBreak(probes->heat, heap);
+}
@@ -0,0 +1,49 @@
+#ifndef LMIPS_PROBES
+#define LMIPS_PROBES
+
+#include "common.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "simpoint.h"
+#include "coverage.h"
+#include "heatmap.h"
+#include "annotate.h"
+
+// Observers notified by the simulator when it is built with LMIPS_INSTRUMENT.
+// Without it every probe expands to nothing and the interpreter loop is left untouched.
+typedef struct {
+    CacheHierarchy* cache;
+    Pipeline* pipeline;
+    BlockVectors* bbv;
+    Coverage* coverage;
+    HeatMap* heat;
+    ExecProfile* profile;
+} Probes;
+
+void probeFetch(Probes* probes, uint32_t ip);
+void probeLoad(Probes* probes, uint32_t ip, uint32_t address, uint8_t size);
+void probeStore(Probes* probes, uint32_t ip, uint32_t address, uint8_t size);
+// Returns false once an observer can no longer follow the run
+bool probeRetire(Probes* probes, uint32_t ip, uint32_t instr, uint32_t nextIp);
+void probeBreak(Probes* probes, uint32_t heap);
+
+#ifdef LMIPS_INSTRUMENT
+#define PROBE(probes, call) \
+    do { \
+        if ((probes) != NULL) call; \
+    } while (false)
+#define PROBE_FETCH(mips, ip) PROBE(mips->probes, probeFetch(mips->probes, ip))
+#define PROBE_LOAD(mips, ip, address, size) PROBE(mips->probes, probeLoad(mips->probes, ip, address, size))
+#define PROBE_STORE(mips, ip, address, size) PROBE(mips->probes, probeStore(mips->probes, ip, address, size))
+#define PROBE_RETIRE(mips, ip, instr) \
+    PROBE(mips->probes, if (!probeRetire(mips->probes, ip, instr, mips->ip)) mips->stop = true)
+#define PROBE_BREAK(mips) PROBE(mips->probes, probeBreak(mips->probes, mips->heap))
+#else
+#define PROBE_FETCH(mips, ip)
+#define PROBE_LOAD(mips, ip, address, size)
+#define PROBE_STORE(mips, ip, address, size)
+#define PROBE_RETIRE(mips, ip, instr)
+#define PROBE_BREAK(mips)
+#endif
+
+#endif // LMIPS_PROBES
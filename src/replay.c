@@ -0,0 +1,81 @@
+#include "replay.h"
+
+static void writeWord(FILE* file, uint32_t word) {
+    uint8_t bytes[4] = {word >> 0x18, word >> 0x10, word >> 0x08, word};
+    fwrite(bytes, sizeof(uint8_t), 4, file);
+}
+
+static bool readWord(FILE* file, uint32_t* word) {
+    uint8_t bytes[4];
+    if (fread(bytes, sizeof(uint8_t), 4, file) != 4) return false;
+
+    *word = (bytes[0] << 0x18) | (bytes[1] << 0x10) | (bytes[2] << 0x08) | bytes[3];
+    return true;
+}
+
+static bool expectEntry(InputLog* log, LogEntryType type) {
+    int tag = fgetc(log->file);
+    if (tag == (int)type) return true;
+
+    if (tag == EOF) {
+        fprintf(stderr, "Replay log exhausted.\n");
+    } else {
+        fprintf(stderr, "Replay log diverged : expected entry '%c', found '%c'.\n", type, tag);
+    }
+    return false;
+}
+
+bool openInputLog(InputLog* log, const char* path, ReplayMode mode) {
+    log->mode = mode;
+    log->file = fopen(path, mode == REPLAY_RECORD ? "wb" : "rb");
+
+    return log->file != NULL;
+}
+
+void closeInputLog(InputLog* log) {
+    if (log->file != NULL) {
+        fclose(log->file);
+        log->file = NULL;
+    }
+}
+
+void recordInt(InputLog* log, uint32_t value) {
+    fputc(LOG_INT, log->file);
+    writeWord(log->file, value);
+}
+
+void recordString(InputLog* log, const uint8_t* string, uint32_t length) {
+    fputc(LOG_STRING, log->file);
+    writeWord(log->file, length);
+    fwrite(string, sizeof(uint8_t), length, log->file);
+}
+
+void recordHash(InputLog* log, uint64_t hash) {
+    fputc(LOG_HASH, log->file);
+    writeWord(log->file, hash >> 0x20);
+    writeWord(log->file, (uint32_t)hash);
+}
+
+bool replayInt(InputLog* log, uint32_t* value) {
+    return expectEntry(log, LOG_INT) && readWord(log->file, value);
+}
+
+bool replayString(InputLog* log, uint8_t* dest, uint32_t size) {
+    uint32_t length;
+    if (!expectEntry(log, LOG_STRING) || !readWord(log->file, &length)) return false;
+
+    if (length > size) {
+        fprintf(stderr, "Replay log diverged : recorded string exceeds guest buffer.\n");
+        return false;
+    }
+
+    return fread(dest, sizeof(uint8_t), length, log->file) == length;
+}
+
+bool replayHash(InputLog* log, uint64_t* hash) {
+    uint32_t high, low;
+    if (!expectEntry(log, LOG_HASH) || !readWord(log->file, &high) || !readWord(log->file, &low)) return false;
+
+    *hash = ((uint64_t)high << 0x20) | low;
+    return true;
+}
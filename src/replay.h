@@ -0,0 +1,35 @@
+#ifndef LMIPS_REPLAY
+#define LMIPS_REPLAY
+
+#include <stdio.h>
+#include "common.h"
+
+typedef enum {
+    REPLAY_RECORD,
+    REPLAY_PLAY
+} ReplayMode;
+
+typedef enum {
+    LOG_INT = 'I',
+    LOG_STRING = 'S',
+    LOG_HASH = 'H'
+} LogEntryType;
+
+// Input log used to record or replay every nondeterministic value handed to the guest.
+typedef struct {
+    FILE* file;
+    ReplayMode mode;
+} InputLog;
+
+bool openInputLog(InputLog* log, const char* path, ReplayMode mode);
+void closeInputLog(InputLog* log);
+
+void recordInt(InputLog* log, uint32_t value);
+void recordString(InputLog* log, const uint8_t* string, uint32_t length);
+void recordHash(InputLog* log, uint64_t hash);
+
+bool replayInt(InputLog* log, uint32_t* value);
+bool replayString(InputLog* log, uint8_t* dest, uint32_t size);
+bool replayHash(InputLog* log, uint64_t* hash);
+
+#endif // LMIPS_REPLAY
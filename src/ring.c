@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+
+#define RING_QUEUE_LIMIT (1 << 20) // Output queued past this waits for the worker to catch up
+
+static uint32_t forkGeneration;
+static pthread_once_t forkHandler = PTHREAD_ONCE_INIT;
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static Ring* rings; // Live rings, linked through next
+
+// Every ring is locked across a fork with its worker between two writes, so the child gets
+// consistent queues and an output stream nobody was in the middle of writing
+static void beforeFork() {
+    pthread_mutex_lock(&ringsLock);
+    for (Ring* ring = rings; ring != NULL; ring = ring->next) {
+        pthread_mutex_lock(&ring->lock);
+        while (ring->busy) pthread_cond_wait(&ring->idle, &ring->lock);
+    }
+}
+
+static void afterForkParent() {
+    for (Ring* ring = rings; ring != NULL; ring = ring->next) pthread_mutex_unlock(&ring->lock);
+    pthread_mutex_unlock(&ringsLock);
+}
+
+// The parent still writes the output it queued, the child drops its copy and starts a worker of its
+// own on its next enter
+static void afterForkChild() {
+    forkGeneration++;
+    for (Ring* ring = rings; ring != NULL; ring = ring->next) {
+        ring->queued.size = 0;
+        ring->writing.size = 0;
+        pthread_cond_init(&ring->wake, NULL);
+        pthread_cond_init(&ring->idle, NULL);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    pthread_mutex_unlock(&ringsLock);
+}
+
+static void registerForkHandler() {
+    pthread_atfork(beforeFork, afterForkParent, afterForkChild);
+}
+
+static void* ringWorker(void* argument) {
+    Ring* ring = argument;
+
+    pthread_mutex_lock(&ring->lock);
+    while (true) {
+        while (ring->queued.size == 0 && !ring->quit) pthread_cond_wait(&ring->wake, &ring->lock);
+        if (ring->queued.size == 0) break;
+
+        RingBuffer buffer = ring->writing;
+        ring->writing = ring->queued;
+        ring->queued = buffer;
+        FILE* output = ring->output;
+        ring->busy = true;
+        pthread_cond_broadcast(&ring->idle);
+        pthread_mutex_unlock(&ring->lock);
+
+        fwrite(ring->writing.data, sizeof(char), ring->writing.size, output);
+        fflush(output);
+        ring->writing.size = 0;
+
+        pthread_mutex_lock(&ring->lock);
+        ring->busy = false;
+        ring->stats.flushes++;
+        pthread_cond_broadcast(&ring->idle);
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    return NULL;
+}
+
+static bool startWorker(Ring* ring) {
+    ring->generation = forkGeneration;
+    return pthread_create(&ring->worker, NULL, ringWorker, ring) == 0;
+}
+
+static bool append(RingBuffer* buffer, const void* data, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+        while (capacity < buffer->size + size) capacity *= 2;
+
+        char* grown = realloc(buffer->data, capacity);
+        if (grown == NULL) return false;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(&buffer->data[buffer->size], data, size);
+    buffer->size += size;
+    return true;
+}
+
+bool initRing(Ring* ring) {
+    pthread_once(&forkHandler, registerForkHandler);
+    memset(ring, 0, sizeof(Ring));
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->wake, NULL);
+    pthread_cond_init(&ring->idle, NULL);
+
+    pthread_mutex_lock(&ringsLock);
+    bool started = startWorker(ring);
+    if (started) {
+        ring->next = rings;
+        rings = ring;
+    }
+    pthread_mutex_unlock(&ringsLock);
+
+    if (!started) {
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->wake);
+        pthread_cond_destroy(&ring->idle);
+    }
+    return started;
+}
+
+void freeRing(Ring* ring) {
+    pthread_mutex_lock(&ringsLock);
+    Ring** link = &rings;
+    while (*link != ring) link = &(*link)->next;
+    *link = ring->next;
+    pthread_mutex_unlock(&ringsLock);
+
+    // A forked child that never entered its ring has no worker to stop
+    if (ring->generation == forkGeneration) {
+        pthread_mutex_lock(&ring->lock);
+        ring->quit = true;
+        pthread_cond_signal(&ring->wake);
+        pthread_mutex_unlock(&ring->lock);
+        pthread_join(ring->worker, NULL);
+    }
+
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->wake);
+    pthread_cond_destroy(&ring->idle);
+    free(ring->queued.data);
+    free(ring->writing.data);
+}
+
+void drainRing(Ring* ring) {
+    if (ring->generation != forkGeneration) return;
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->queued.size != 0 || ring->busy) pthread_cond_wait(&ring->idle, &ring->lock);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void waitForRoom(Ring* ring) {
+    while (ring->queued.size >= RING_QUEUE_LIMIT) {
+        pthread_cond_signal(&ring->wake);
+        pthread_cond_wait(&ring->idle, &ring->lock);
+    }
+}
+
+// Carries out one submission, queuing its output for the worker
+static uint32_t submit(Ring* ring, Memory* memory, uint32_t op, uint32_t address, uint32_t length) {
+    switch (op) {
+        case RING_NOP:
+            return 0;
+        case RING_WRITE: {
+            if (address < DATA_ADDRESS || address >= MEMORY_SIZE || length > MEMORY_SIZE - address) return RING_FAILED;
+
+            waitForRoom(ring);
+            if (!append(&ring->queued, &memory->store[address], length)) return RING_FAILED;
+            ring->stats.bytes += length;
+            return length;
+        }
+        case RING_PRINT_INT: {
+            char text[12];
+            int size = snprintf(text, sizeof(text), "%d", (int32_t)address);
+
+            waitForRoom(ring);
+            if (!append(&ring->queued, text, size)) return RING_FAILED;
+            ring->stats.bytes += size;
+            return 0;
+        }
+        default:
+            return RING_FAILED;
+    }
+}
+
+bool enterRing(Ring* ring, Memory* memory, uint32_t address, FILE* output, uint32_t* submitted) {
+    if (address < DATA_ADDRESS || address >= MEMORY_SIZE - RING_HEADER_SIZE || address % 4 != 0) return false;
+
+    uint32_t entries = mem_read(memory, address);
+    if (entries == 0 || entries > RING_MAX_ENTRIES || (entries & (entries - 1)) != 0 ||
+        RING_SIZE(entries) > MEMORY_SIZE - address) {
+        return false;
+    }
+
+    if (ring->generation != forkGeneration && !startWorker(ring)) return false;
+    if (ring->output != output) {
+        drainRing(ring);
+        ring->output = output;
+    }
+
+    uint32_t mask = entries - 1;
+    uint32_t sqHead = mem_read(memory, address + 0x04);
+    uint32_t sqTail = mem_read(memory, address + 0x08);
+    uint32_t cqHead = mem_read(memory, address + 0x0C);
+    uint32_t cqTail = mem_read(memory, address + 0x10);
+    uint32_t submissions = address + RING_HEADER_SIZE;
+    uint32_t completions = submissions + entries * RING_SQE_SIZE;
+
+    // Submissions stop once the completion queue is full, the guest enters again after reaping it
+    uint32_t count = 0;
+    pthread_mutex_lock(&ring->lock);
+    while (sqHead != sqTail && cqTail - cqHead < entries) {
+        uint32_t sqe = submissions + (sqHead & mask) * RING_SQE_SIZE;
+        uint32_t result = submit(ring, memory, mem_read(memory, sqe), mem_read(memory, sqe + 0x04),
+                                 mem_read(memory, sqe + 0x08));
+
+        uint32_t cqe = completions + (cqTail & mask) * RING_CQE_SIZE;
+        mem_write(memory, cqe, mem_read(memory, sqe + 0x0C));
+        mem_write(memory, cqe + 0x04, result);
+        sqHead++;
+        cqTail++;
+        count++;
+    }
+    if (ring->queued.size != 0) pthread_cond_signal(&ring->wake);
+    pthread_mutex_unlock(&ring->lock);
+
+    mem_write(memory, address + 0x04, sqHead);
+    mem_write(memory, address + 0x10, cqTail);
+    ring->stats.enters++;
+    ring->stats.submissions += count;
+    *submitted = count;
+    return true;
+}
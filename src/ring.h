@@ -0,0 +1,68 @@
+#ifndef LMIPS_RING
+#define LMIPS_RING
+
+#include <stdio.h>
+#include <pthread.h>
+#include "common.h"
+#include "memory.h"
+
+// Ring layout in guest memory, words in the guest byte order :
+// - Header : entries, SQ head, SQ tail, CQ head, CQ tail, padded to RING_HEADER_SIZE
+// - Submission queue : entries x (op, address, length, data)
+// - Completion queue : entries x (data, result)
+// The guest fills submissions and moves the SQ tail and CQ head, SYS_RING_ENTER moves the other two.
+#define RING_HEADER_SIZE 0x20
+#define RING_SQE_SIZE 0x10
+#define RING_CQE_SIZE 0x08
+#define RING_MAX_ENTRIES 4096 // Power of two, like every ring size
+#define RING_SIZE(entries) (RING_HEADER_SIZE + (entries) * (RING_SQE_SIZE + RING_CQE_SIZE))
+#define RING_FAILED 0xFFFFFFFF // Completion result of a submission that could not be carried out
+
+typedef enum {
+    RING_NOP,
+    RING_WRITE, // Bytes at address to the output, completes with length
+    RING_PRINT_INT // Signed word in address to the output, completes with 0
+} RingOperation;
+
+typedef struct {
+    uint64_t enters;
+    uint64_t submissions;
+    uint64_t flushes; // Writes to the output made by the worker, each covering one or more batches
+    uint64_t bytes;
+} RingStats;
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} RingBuffer;
+
+// Host side of the rings : submissions are carried out by the interpreter when the guest enters,
+// so what the guest sees depends on nothing but its own execution, and their output is left to a
+// worker thread that writes it while the guest runs on. All the ring state the guest can observe
+// lives in its memory, snapshots and baselines need nothing from here.
+typedef struct rg {
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    RingBuffer queued; // Output waiting for the worker, guarded by lock
+    RingBuffer writing; // Output being written, owned by the worker
+    FILE* output; // Where queued output goes
+    bool busy;
+    bool quit;
+    uint32_t generation; // Fork generation the worker was started in, children start their own
+    RingStats stats;
+    struct rg* next; // Next live ring, fork handlers go through all of them
+} Ring;
+
+bool initRing(Ring* ring);
+// Waits for the worker to finish, then stops it
+void freeRing(Ring* ring);
+// Carries out the pending submissions of the ring at address, as many as the completion queue has
+// room for, and stores their count in submitted. False when the ring header is invalid.
+bool enterRing(Ring* ring, Memory* memory, uint32_t address, FILE* output, uint32_t* submitted);
+// Returns once everything submitted has been written, so that direct output stays in order
+void drainRing(Ring* ring);
+
+#endif // LMIPS_RING
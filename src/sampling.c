@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sampling.h"
+
+#ifdef LMIPS_INSTRUMENT
+
+typedef struct {
+    Checkpoint* checkpoints;
+    uint32_t count;
+    uint32_t next;
+    pthread_mutex_t lock;
+    SamplingConfig* config;
+    char* log;
+    size_t logSize;
+} SampleQueue;
+
+static FILE* openLog(SampleQueue* queue) {
+    // fmemopen refuses empty buffers, a run that never read input never looks at it anyway
+    static char empty[1];
+    return queue->logSize == 0 ? fmemopen(empty, 1, "rb") : fmemopen(queue->log, queue->logSize, "rb");
+}
+
+static void runDetailed(SampleQueue* queue, Checkpoint* checkpoint) {
+    Pipeline pipeline;
+    if (!initPipeline(&pipeline, queue->config->predictor, defaultPipelineConfig())) return;
+    Probes probes = {};
+    probes.pipeline = &pipeline;
+
+    Memory memory;
+    initMemory(&memory);
+    memcpy(memory.store, checkpoint->store, MEMORY_SIZE);
+    memory.littleEndian = checkpoint->state.memory->littleEndian;
+
+    InputLog input = {openLog(queue), REPLAY_PLAY};
+    fseek(input.file, checkpoint->inputOffset, SEEK_SET);
+
+    LMips mips = checkpoint->state;
+    mips.memory = &memory;
+    mips.program = &memory.store[PROGRAM_ADDRESS];
+    mips.input = &input;
+    mips.output = fopen("/dev/null", "w");
+    mips.probes = &probes;
+    mips.ring = NULL;
+    mips.snapshot = NULL;
+    mips.limit = mips.retired + queue->config->interval;
+
+    runSimulator(&mips);
+
+    checkpoint->instructions = pipeline.instructions;
+    checkpoint->cycles = pipelineCycles(&pipeline);
+    checkpoint->timed = true;
+
+    if (mips.ring != NULL) {
+        freeRing(mips.ring);
+        free(mips.ring);
+    }
+    fclose(mips.output);
+    free(mips.arena);
+    closeInputLog(&input);
+    freePipeline(&pipeline);
+    freeMemory(&memory);
+}
+
+static void* sampleWorker(void* argument) {
+    SampleQueue* queue = argument;
+
+    while (true) {
+        pthread_mutex_lock(&queue->lock);
+        uint32_t index = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (index >= queue->count) return NULL;
+        runDetailed(queue, &queue->checkpoints[index]);
+    }
+}
+
+ExecutionResult runSampled(LMips* mips, SamplingConfig* config, FILE* report) {
+    LMips initial = *mips;
+    initial.arena = copyArena(mips->arena);
+    uint8_t* initialStore = malloc(MEMORY_SIZE);
+    if (initialStore == NULL) {
+        free(initial.arena);
+        return EXEC_FAILURE;
+    }
+    memcpy(initialStore, mips->memory->store, MEMORY_SIZE);
+
+    // Functional pass : gather basic-block vectors and record every input so later passes see the same run
+    BlockVectors bbv;
+    if (!initBlockVectors(&bbv, config->interval)) {
+        free(initialStore);
+        free(initial.arena);
+        return EXEC_FAILURE;
+    }
+
+    SampleQueue queue = {};
+    queue.config = config;
+    InputLog record = {open_memstream(&queue.log, &queue.logSize), REPLAY_RECORD};
+    Probes probes = {};
+    probes.bbv = &bbv;
+    mips->probes = &probes;
+    mips->input = &record;
+
+    ExecutionResult result = runSimulator(mips);
+    // Vectors that could not grow stopped the run early, none of it can be sampled
+    if (!bbvFlush(&bbv)) {
+        fprintf(stderr, "Unable to allocate basic-block vectors.\n");
+        result = EXEC_FAILURE;
+    }
+    fclose(record.file);
+    mips->probes = NULL;
+    mips->input = NULL;
+
+    if (result != EXEC_SUCCESS) {
+        free(initialStore);
+        free(initial.arena);
+        freeBlockVectors(&bbv);
+        free(queue.log);
+        return result;
+    }
+
+    SimPoint points[MAX_SIMPOINTS];
+    uint32_t count = pickSimPoints(&bbv, config->maxClusters, points);
+    uint32_t intervals = bbv.intervals;
+    freeBlockVectors(&bbv);
+
+    // Checkpoint pass : replay the run silently, stopping at the start of every representative interval
+    Checkpoint* checkpoints = calloc(count, sizeof(Checkpoint));
+    if (count > 0 && checkpoints == NULL) {
+        free(initialStore);
+        free(initial.arena);
+        free(queue.log);
+        return EXEC_FAILURE;
+    }
+
+    LMips replay = initial;
+    memcpy(mips->memory->store, initialStore, MEMORY_SIZE);
+    InputLog input = {openLog(&queue), REPLAY_PLAY};
+    replay.input = &input;
+    replay.probes = NULL;
+    replay.ring = NULL;
+    replay.snapshot = NULL; // The functional pass already wrote the snapshots the program asked for
+    replay.output = fopen("/dev/null", "w");
+
+    uint32_t taken = 0;
+    for (; taken < count; taken++) {
+        replay.limit = points[taken].interval * config->interval;
+        runSimulator(&replay);
+
+        uint8_t* store = malloc(MEMORY_SIZE);
+        if (store == NULL) break;
+        memcpy(store, mips->memory->store, MEMORY_SIZE);
+
+        checkpoints[taken].point = points[taken];
+        checkpoints[taken].state = replay;
+        checkpoints[taken].state.arena = copyArena(replay.arena);
+        checkpoints[taken].state.ring = NULL;
+        checkpoints[taken].inputOffset = ftell(input.file);
+        checkpoints[taken].store = store;
+    }
+
+    if (replay.ring != NULL) {
+        freeRing(replay.ring);
+        free(replay.ring);
+    }
+    fclose(replay.output);
+    free(replay.arena);
+    closeInputLog(&input);
+    free(initialStore);
+
+    if (taken < count) {
+        for (uint32_t i = 0; i < taken; i++) {
+            free(checkpoints[i].state.arena);
+            free(checkpoints[i].store);
+        }
+        free(checkpoints);
+        free(queue.log);
+        return EXEC_FAILURE;
+    }
+
+    // Detailed pass : time every representative interval on its own core
+    queue.checkpoints = checkpoints;
+    queue.count = count;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    // Symbols are read on first use, which the workers must not race on
+    if (mips->debug != NULL) loadDebugInfo(mips->debug);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threads = cores < 1 ? 1 : (cores < count ? cores : count);
+    pthread_t workers[MAX_SIMPOINTS];
+    uint32_t started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, sampleWorker, &queue) == 0) started++;
+    // Without any worker the intervals are timed here, one after the other
+    if (started == 0) sampleWorker(&queue);
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+
+    fprintf(report, "Sampled simulation report (%u of %u intervals of %llu instructions)\n",
+            count, intervals, (unsigned long long)config->interval);
+
+    double cpi = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Checkpoint* checkpoint = &checkpoints[i];
+        if (!checkpoint->timed) {
+            fprintf(report, "  Interval %6u : unable to allocate timing model\n", checkpoint->point.interval);
+            result = EXEC_FAILURE;
+            free(checkpoint->store);
+            continue;
+        }
+
+        double intervalCpi = checkpoint->instructions == 0 ? 0 : (double)checkpoint->cycles / checkpoint->instructions;
+        cpi += checkpoint->point.weight * intervalCpi;
+
+        fprintf(report, "  Interval %6u : weight %6.2f%%, CPI %.3f\n",
+                checkpoint->point.interval, 100.0 * checkpoint->point.weight, intervalCpi);
+        free(checkpoint->store);
+    }
+    fprintf(report, "  Estimated CPI : %.3f\n", cpi);
+
+    free(checkpoints);
+    free(queue.log);
+    return result;
+}
+
+#endif // LMIPS_INSTRUMENT
@@ -0,0 +1,28 @@
+#ifndef LMIPS_SAMPLING
+#define LMIPS_SAMPLING
+
+#include <stdio.h>
+#include "lmips.h"
+#include "simpoint.h"
+#include "pipeline.h"
+
+typedef struct {
+    uint64_t interval;
+    uint32_t maxClusters;
+    PredictorKind predictor;
+} SamplingConfig;
+
+// Architectural state at the start of a representative interval
+typedef struct {
+    SimPoint point;
+    LMips state;
+    uint8_t* store;
+    long inputOffset;
+    uint64_t instructions;
+    uint64_t cycles;
+    bool timed; // False when the timing model of the interval could not be allocated
+} Checkpoint;
+
+ExecutionResult runSampled(LMips* mips, SamplingConfig* config, FILE* report);
+
+#endif // LMIPS_SAMPLING
@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "simpoint.h"
+
+#define KMEANS_ITERATIONS 100
+
+bool initBlockVectors(BlockVectors* bbv, uint64_t interval) {
+    memset(bbv, 0, sizeof(BlockVectors));
+    bbv->interval = interval;
+
+    return interval > 0;
+}
+
+void freeBlockVectors(BlockVectors* bbv) {
+    free(bbv->vectors);
+    free(bbv->lengths);
+    bbv->vectors = NULL;
+    bbv->lengths = NULL;
+}
+
+static void endBlock(BlockVectors* bbv) {
+    if (bbv->blockLength == 0) return;
+
+    uint32_t bucket = ((bbv->blockStart >> 2) * 2654435761u) >> (32 - BBV_DIM_BITS);
+    bbv->current[bucket] += bbv->blockLength;
+    bbv->blockLength = 0;
+}
+
+static bool endInterval(BlockVectors* bbv) {
+    if (bbv->intervals == bbv->capacity) {
+        uint32_t capacity = bbv->capacity < 8 ? 8 : bbv->capacity * 2;
+        uint64_t (*vectors)[BBV_DIMS] = realloc(bbv->vectors, capacity * sizeof(*bbv->vectors));
+        if (vectors == NULL) return false;
+        bbv->vectors = vectors;
+
+        uint64_t* lengths = realloc(bbv->lengths, capacity * sizeof(uint64_t));
+        if (lengths == NULL) return false;
+        bbv->lengths = lengths;
+        bbv->capacity = capacity;
+    }
+
+    memcpy(bbv->vectors[bbv->intervals], bbv->current, sizeof(bbv->current));
+    bbv->lengths[bbv->intervals++] = bbv->count;
+
+    memset(bbv->current, 0, sizeof(bbv->current));
+    bbv->count = 0;
+    return true;
+}
+
+bool bbvRetire(BlockVectors* bbv, uint32_t ip, uint32_t nextIp) {
+    if (bbv->failed) return false;
+    if (bbv->blockLength == 0) bbv->blockStart = ip;
+    bbv->blockLength++;
+    bbv->count++;
+
+    if (nextIp != ip + 4) endBlock(bbv);
+    if (bbv->count == bbv->interval) {
+        endBlock(bbv);
+        bbv->failed = !endInterval(bbv);
+    }
+
+    return !bbv->failed;
+}
+
+bool bbvFlush(BlockVectors* bbv) {
+    if (bbv->failed) return false;
+
+    endBlock(bbv);
+    if (bbv->count > 0) bbv->failed = !endInterval(bbv);
+
+    return !bbv->failed;
+}
+
+static double distance(const double* a, const double* b) {
+    double sum = 0;
+    for (int i = 0; i < BBV_DIMS; i++) {
+        sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+
+    return sum;
+}
+
+// Lloyd's algorithm seeded with farthest-first traversal, so results are reproducible. Returns the distortion.
+static double kmeans(double (*points)[BBV_DIMS], uint32_t count, uint32_t k, uint32_t* assignment, double (*centroids)[BBV_DIMS]) {
+    memcpy(centroids[0], points[0], sizeof(double) * BBV_DIMS);
+    for (uint32_t c = 1; c < k; c++) {
+        uint32_t farthest = 0;
+        double farthestDistance = -1;
+        for (uint32_t i = 0; i < count; i++) {
+            double nearest = DBL_MAX;
+            for (uint32_t j = 0; j < c; j++) {
+                double d = distance(points[i], centroids[j]);
+                if (d < nearest) nearest = d;
+            }
+            if (nearest > farthestDistance) {
+                farthestDistance = nearest;
+                farthest = i;
+            }
+        }
+        memcpy(centroids[c], points[farthest], sizeof(double) * BBV_DIMS);
+    }
+
+    double distortion = 0;
+    for (int iteration = 0; iteration < KMEANS_ITERATIONS; iteration++) {
+        bool changed = false;
+        distortion = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t best = 0;
+            double bestDistance = DBL_MAX;
+            for (uint32_t c = 0; c < k; c++) {
+                double d = distance(points[i], centroids[c]);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    best = c;
+                }
+            }
+            if (iteration == 0 || assignment[i] != best) changed = true;
+            assignment[i] = best;
+            distortion += bestDistance;
+        }
+
+        if (!changed) break;
+
+        for (uint32_t c = 0; c < k; c++) {
+            uint32_t members = 0;
+            double sum[BBV_DIMS] = {0};
+            for (uint32_t i = 0; i < count; i++) {
+                if (assignment[i] != c) continue;
+                members++;
+                for (int d = 0; d < BBV_DIMS; d++) sum[d] += points[i][d];
+            }
+            if (members == 0) continue;
+            for (int d = 0; d < BBV_DIMS; d++) centroids[c][d] = sum[d] / members;
+        }
+    }
+
+    return distortion;
+}
+
+static int compareSimPoints(const void* a, const void* b) {
+    return (int)((const SimPoint*)a)->interval - (int)((const SimPoint*)b)->interval;
+}
+
+uint32_t pickSimPoints(BlockVectors* bbv, uint32_t maxClusters, SimPoint* points) {
+    uint32_t count = bbv->intervals;
+    if (count == 0) return 0;
+
+    uint32_t maxK = maxClusters;
+    if (maxK > count) maxK = count;
+    if (maxK > MAX_SIMPOINTS) maxK = MAX_SIMPOINTS;
+    if (maxK == 0) maxK = 1;
+
+    // Cluster the vectors by their shape only, not by the length of the interval
+    double (*normalized)[BBV_DIMS] = malloc(count * sizeof(*normalized));
+    uint32_t* assignment = malloc(count * sizeof(uint32_t));
+    double centroids[MAX_SIMPOINTS][BBV_DIMS];
+    double distortions[MAX_SIMPOINTS + 1];
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (int d = 0; d < BBV_DIMS; d++) {
+            normalized[i][d] = (double)bbv->vectors[i][d] / bbv->lengths[i];
+        }
+        total += bbv->lengths[i];
+    }
+
+    for (uint32_t k = 1; k <= maxK; k++) {
+        distortions[k] = kmeans(normalized, count, k, assignment, centroids);
+    }
+
+    // Smallest k that captures 90% of the distortion reduction reachable with maxK clusters
+    uint32_t k = 1;
+    double threshold = distortions[maxK] + 0.1 * (distortions[1] - distortions[maxK]);
+    while (k < maxK && distortions[k] > threshold) k++;
+
+    kmeans(normalized, count, k, assignment, centroids);
+
+    uint32_t found = 0;
+    for (uint32_t c = 0; c < k; c++) {
+        uint64_t members = 0;
+        uint32_t representative = UINT32_MAX;
+        double nearest = DBL_MAX;
+        for (uint32_t i = 0; i < count; i++) {
+            if (assignment[i] != c) continue;
+            members += bbv->lengths[i];
+            double d = distance(normalized[i], centroids[c]);
+            if (d < nearest) {
+                nearest = d;
+                representative = i;
+            }
+        }
+
+        if (representative == UINT32_MAX) continue;
+        points[found].interval = representative;
+        points[found].weight = (double)members / total;
+        found++;
+    }
+
+    qsort(points, found, sizeof(SimPoint), compareSimPoints);
+
+    free(normalized);
+    free(assignment);
+    return found;
+}
@@ -0,0 +1,37 @@
+#ifndef LMIPS_SIMPOINT
+#define LMIPS_SIMPOINT
+
+#include "common.h"
+
+#define BBV_DIM_BITS 5
+#define BBV_DIMS (1 << BBV_DIM_BITS)
+#define MAX_SIMPOINTS 32
+
+// Basic-block vectors gathered over fixed-size instruction intervals.
+// Blocks are hashed into BBV_DIMS buckets, which also serves as the random projection step of SimPoint.
+typedef struct {
+    uint64_t interval;
+    uint64_t count;
+    uint32_t blockStart;
+    uint32_t blockLength;
+    uint64_t current[BBV_DIMS];
+    uint64_t (*vectors)[BBV_DIMS];
+    uint64_t* lengths;
+    uint32_t intervals;
+    uint32_t capacity;
+    bool failed; // An interval could not be stored, the vectors stop at the last one that was
+} BlockVectors;
+
+typedef struct {
+    uint32_t interval; // Index of the interval closest to its cluster centroid
+    double weight; // Share of all executed instructions that its cluster represents
+} SimPoint;
+
+bool initBlockVectors(BlockVectors* bbv, uint64_t interval);
+void freeBlockVectors(BlockVectors* bbv);
+// Both return false once an interval could not be stored
+bool bbvRetire(BlockVectors* bbv, uint32_t ip, uint32_t nextIp);
+bool bbvFlush(BlockVectors* bbv);
+uint32_t pickSimPoints(BlockVectors* bbv, uint32_t maxClusters, SimPoint* points);
+
+#endif // LMIPS_SIMPOINT
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+static const char magic[4] = {0x10, 'L', 'S', 'N'};
+
+static bool isZeroPage(const uint8_t* page) {
+    const uint64_t* words = (const uint64_t*)page;
+    for (size_t i = 0; i < MEMORY_PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (words[i] != 0) return false;
+    }
+
+    return true;
+}
+
+static long dataOffset(uint32_t pageCount, uint32_t flags) {
+    long offset = sizeof(SnapshotHeader) + pageCount * sizeof(uint32_t);
+    if (flags & SNAPSHOT_ARENA) offset += sizeof(Arena);
+    return (offset + MEMORY_PAGE_SIZE - 1) & ~(long)(MEMORY_PAGE_SIZE - 1);
+}
+
+bool saveSnapshot(LMips* mips, const char* path) {
+    // Written aside and renamed over the target, so that runs still mapping the previous snapshot keep their pages.
+    // Every writer gets its own file next to the target, threads snapshotting at once never share one.
+    char temporary[4096];
+    snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path);
+    int fd = mkstemp(temporary);
+    if (fd < 0) return false;
+    fchmod(fd, 0644);
+    FILE* file = fdopen(fd, "wb");
+    if (file == NULL) {
+        close(fd);
+        unlink(temporary);
+        return false;
+    }
+
+    uint32_t* pages = malloc(MEMORY_PAGES * sizeof(uint32_t));
+    if (pages == NULL) {
+        fclose(file);
+        unlink(temporary);
+        return false;
+    }
+
+    uint32_t pageCount = 0;
+    for (uint32_t page = 0; page < MEMORY_PAGES; page++) {
+        if (!isZeroPage(&mips->memory->store[page * MEMORY_PAGE_SIZE])) {
+            pages[pageCount++] = page;
+        }
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, magic, 4);
+    header.version = SNAPSHOT_VERSION;
+    memcpy(header.regs, mips->regs, sizeof(header.regs));
+    header.ip = mips->ip;
+    header.textSize = mips->textSize;
+    header.hi = mips->hi;
+    header.lo = mips->lo;
+    memcpy(header.fregs, mips->fregs, sizeof(header.fregs));
+    header.fcc = mips->fcc;
+    memcpy(header.vregs, mips->vregs, sizeof(header.vregs));
+    header.heap = mips->heap;
+    header.retired = mips->retired;
+    header.pageCount = pageCount;
+    header.flags = mips->memory->littleEndian ? SNAPSHOT_LITTLE_ENDIAN : 0;
+    if (mips->arena != NULL) header.flags |= SNAPSHOT_ARENA;
+
+    fwrite(&header, sizeof(SnapshotHeader), 1, file);
+    fwrite(pages, sizeof(uint32_t), pageCount, file);
+    if (mips->arena != NULL) fwrite(mips->arena, sizeof(Arena), 1, file);
+    fseek(file, dataOffset(pageCount, header.flags), SEEK_SET);
+    for (uint32_t i = 0; i < pageCount; i++) {
+        fwrite(&mips->memory->store[pages[i] * MEMORY_PAGE_SIZE], MEMORY_PAGE_SIZE, 1, file);
+    }
+
+    free(pages);
+    if (fclose(file) != 0 || rename(temporary, path) != 0) {
+        unlink(temporary);
+        return false;
+    }
+
+    return true;
+}
+
+// Maps runs of consecutive stored pages copy-on-write over the guest memory, so restoring only
+// costs one mapping per run and pages are read lazily on first access.
+static bool mapPages(Memory* memory, int fd, uint32_t* pages, uint32_t pageCount, long offset) {
+    bool canMap = sysconf(_SC_PAGESIZE) == MEMORY_PAGE_SIZE;
+
+    for (uint32_t i = 0; i < pageCount;) {
+        uint32_t run = 1;
+        while (i + run < pageCount && pages[i + run] == pages[i] + run) run++;
+
+        uint8_t* target = &memory->store[pages[i] * MEMORY_PAGE_SIZE];
+        size_t size = run * MEMORY_PAGE_SIZE;
+        off_t position = offset + (off_t)i * MEMORY_PAGE_SIZE;
+
+        if (canMap) {
+            void* mapped = mmap(target, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, position);
+            if (mapped == MAP_FAILED) return false;
+        } else if (pread(fd, target, size, position) != (ssize_t)size) {
+            return false;
+        }
+
+        i += run;
+    }
+
+    return true;
+}
+
+bool restoreSnapshot(LMips* mips, Memory* memory, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    SnapshotHeader header;
+    if (read(fd, &header, sizeof(SnapshotHeader)) != sizeof(SnapshotHeader) ||
+        memcmp(header.magic, magic, 4) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.pageCount > MEMORY_PAGES || (header.flags & ~(SNAPSHOT_LITTLE_ENDIAN | SNAPSHOT_ARENA)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    uint32_t* pages = malloc(header.pageCount * sizeof(uint32_t) + 1);
+    ssize_t indexSize = header.pageCount * sizeof(uint32_t);
+    bool restored = pages != NULL && read(fd, pages, indexSize) == indexSize;
+    for (uint32_t i = 0; restored && i < header.pageCount; i++) {
+        restored = pages[i] < MEMORY_PAGES && (i == 0 || pages[i] > pages[i - 1]);
+    }
+
+    Arena* arena = NULL;
+    if (restored && (header.flags & SNAPSHOT_ARENA)) {
+        arena = malloc(sizeof(Arena));
+        restored = arena != NULL && read(fd, arena, sizeof(Arena)) == sizeof(Arena) && validArena(arena, header.heap);
+    }
+
+    if (restored) {
+        initMemory(memory);
+        memory->littleEndian = (header.flags & SNAPSHOT_LITTLE_ENDIAN) != 0;
+        restored = mapPages(memory, fd, pages, header.pageCount, dataOffset(header.pageCount, header.flags));
+        if (!restored) freeMemory(memory);
+    }
+
+    free(pages);
+    close(fd);
+    if (!restored) {
+        free(arena);
+        return false;
+    }
+
+    initSimulator(mips, memory);
+    memcpy(mips->regs, header.regs, sizeof(header.regs));
+    mips->ip = header.ip;
+    mips->textSize = header.textSize;
+    mips->hi = header.hi;
+    mips->lo = header.lo;
+    memcpy(mips->fregs, header.fregs, sizeof(header.fregs));
+    mips->fcc = header.fcc != 0;
+    memcpy(mips->vregs, header.vregs, sizeof(header.vregs));
+    mips->heap = header.heap;
+    mips->arena = arena;
+    mips->retired = header.retired;
+
+    return true;
+}
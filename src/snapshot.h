@@ -0,0 +1,35 @@
+#ifndef LMIPS_SNAPSHOT
+#define LMIPS_SNAPSHOT
+
+#include "lmips.h"
+
+#define SNAPSHOT_VERSION 5
+#define SNAPSHOT_LITTLE_ENDIAN 0x01 // Guest memory holds little-endian halves and words
+#define SNAPSHOT_ARENA 0x02 // The heap allocator state follows the page index
+
+// Snapshot file layout, all fields in host byte order :
+// - SnapshotHeader
+// - Page number of every stored page (pageCount x 32-bit), in ascending order
+// - Arena, when the flags have SNAPSHOT_ARENA
+// - Padding up to the next page boundary
+// - Content of every stored page, pages that are entirely zero are left out
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t regs[REG_COUNT];
+    uint32_t ip;
+    uint32_t textSize; // Of the executable the snapshot was taken from, so restored runs decode the same text
+    uint32_t hi, lo;
+    uint32_t heap;
+    uint64_t retired;
+    uint32_t pageCount;
+    uint32_t flags; // SNAPSHOT_* bits, snapshots of another version are refused rather than converted
+    uint32_t fregs[FREG_COUNT];
+    uint32_t fcc;
+    uint32_t vregs[VREG_COUNT][VECTOR_SIZE / 4]; // Lanes as words, in host byte order like the other fields
+} SnapshotHeader;
+
+bool saveSnapshot(LMips* mips, const char* path);
+bool restoreSnapshot(LMips* mips, Memory* memory, const char* path);
+
+#endif // LMIPS_SNAPSHOT
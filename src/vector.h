@@ -0,0 +1,247 @@
+#ifndef LMIPS_VECTOR
+#define LMIPS_VECTOR
+
+#include <string.h>
+#include "common.h"
+#include "lmips_opcodes.h"
+
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define VECTOR_SIZE 16 // Bytes per MSA register
+#define VECTOR_HOST_LITTLE (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+// MSA register, lane i is the element ld.df reads at the i-th lowest address. Every operation
+// below maps onto SSE2 when the host has it and loops over the lanes otherwise, the min/max
+// lane sizes SSE2 lacks come from SSE4.1 when -march=native finds it. df is a constant
+// at each call site of the interpreter, so the lane size switches fold away once inlined.
+typedef union {
+    uint8_t b[VECTOR_SIZE];
+    uint16_t h[VECTOR_SIZE / 2];
+    uint32_t w[VECTOR_SIZE / 4];
+#ifdef __SSE2__
+    __m128i v;
+#endif
+} VectorReg;
+
+#define LANE_ADD(s, u, a, b) ((u)((a) + (b)))
+#define LANE_SUB(s, u, a, b) ((u)((a) - (b)))
+#define LANE_MAX_S(s, u, a, b) ((s)(a) > (s)(b) ? (a) : (b))
+#define LANE_MAX_U(s, u, a, b) ((a) > (b) ? (a) : (b))
+#define LANE_MIN_S(s, u, a, b) ((s)(a) < (s)(b) ? (a) : (b))
+#define LANE_MIN_U(s, u, a, b) ((a) < (b) ? (a) : (b))
+#define LANE_CEQ(s, u, a, b) ((a) == (b) ? (u)~0u : 0)
+#define LANE_CLT_S(s, u, a, b) ((s)(a) < (s)(b) ? (u)~0u : 0)
+#define LANE_CLT_U(s, u, a, b) ((a) < (b) ? (u)~0u : 0)
+
+// Scalar fallback, compares set every bit of the lanes they hold for
+#define LANEWISE(wd, ws, wt, df, op) \
+    do { \
+        VectorReg result; \
+        switch (df) { \
+            case DF_B: \
+                for (int i = 0; i < VECTOR_SIZE; i++) result.b[i] = op(int8_t, uint8_t, (ws)->b[i], (wt)->b[i]); \
+                break; \
+            case DF_H: \
+                for (int i = 0; i < VECTOR_SIZE / 2; i++) result.h[i] = op(int16_t, uint16_t, (ws)->h[i], (wt)->h[i]); \
+                break; \
+            default: \
+                for (int i = 0; i < VECTOR_SIZE / 4; i++) result.w[i] = op(int32_t, uint32_t, (ws)->w[i], (wt)->w[i]); \
+                break; \
+        } \
+        *(wd) = result; \
+    } while (false)
+
+#ifdef __SSE2__
+static inline __m128i vectorSelect(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i vectorGreater(__m128i a, __m128i b, uint8_t df) {
+    return df == DF_B ? _mm_cmpgt_epi8(a, b) : (df == DF_H ? _mm_cmpgt_epi16(a, b) : _mm_cmpgt_epi32(a, b));
+}
+
+// SSE2 only compares signed lanes, flipping their sign bit orders unsigned ones the same way
+static inline __m128i vectorGreaterUnsigned(__m128i a, __m128i b, uint8_t df) {
+    __m128i bias = df == DF_B ? _mm_set1_epi8((char)0x80) :
+                   (df == DF_H ? _mm_set1_epi16((short)0x8000) : _mm_set1_epi32((int)0x80000000));
+    return vectorGreater(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias), df);
+}
+#endif
+
+static inline void vectorAdd(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = df == DF_B ? _mm_add_epi8(ws->v, wt->v) :
+            (df == DF_H ? _mm_add_epi16(ws->v, wt->v) : _mm_add_epi32(ws->v, wt->v));
+#else
+    LANEWISE(wd, ws, wt, df, LANE_ADD);
+#endif
+}
+
+static inline void vectorSub(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = df == DF_B ? _mm_sub_epi8(ws->v, wt->v) :
+            (df == DF_H ? _mm_sub_epi16(ws->v, wt->v) : _mm_sub_epi32(ws->v, wt->v));
+#else
+    LANEWISE(wd, ws, wt, df, LANE_SUB);
+#endif
+}
+
+static inline void vectorMaxS(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE4_1__
+    wd->v = df == DF_B ? _mm_max_epi8(ws->v, wt->v) :
+            (df == DF_H ? _mm_max_epi16(ws->v, wt->v) : _mm_max_epi32(ws->v, wt->v));
+#elif defined(__SSE2__)
+    wd->v = df == DF_H ? _mm_max_epi16(ws->v, wt->v) : vectorSelect(vectorGreater(ws->v, wt->v, df), ws->v, wt->v);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_MAX_S);
+#endif
+}
+
+static inline void vectorMaxU(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE4_1__
+    wd->v = df == DF_B ? _mm_max_epu8(ws->v, wt->v) :
+            (df == DF_H ? _mm_max_epu16(ws->v, wt->v) : _mm_max_epu32(ws->v, wt->v));
+#elif defined(__SSE2__)
+    wd->v = df == DF_B ? _mm_max_epu8(ws->v, wt->v) :
+            vectorSelect(vectorGreaterUnsigned(ws->v, wt->v, df), ws->v, wt->v);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_MAX_U);
+#endif
+}
+
+static inline void vectorMinS(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE4_1__
+    wd->v = df == DF_B ? _mm_min_epi8(ws->v, wt->v) :
+            (df == DF_H ? _mm_min_epi16(ws->v, wt->v) : _mm_min_epi32(ws->v, wt->v));
+#elif defined(__SSE2__)
+    wd->v = df == DF_H ? _mm_min_epi16(ws->v, wt->v) : vectorSelect(vectorGreater(ws->v, wt->v, df), wt->v, ws->v);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_MIN_S);
+#endif
+}
+
+static inline void vectorMinU(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE4_1__
+    wd->v = df == DF_B ? _mm_min_epu8(ws->v, wt->v) :
+            (df == DF_H ? _mm_min_epu16(ws->v, wt->v) : _mm_min_epu32(ws->v, wt->v));
+#elif defined(__SSE2__)
+    wd->v = df == DF_B ? _mm_min_epu8(ws->v, wt->v) :
+            vectorSelect(vectorGreaterUnsigned(ws->v, wt->v, df), wt->v, ws->v);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_MIN_U);
+#endif
+}
+
+static inline void vectorCeq(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = df == DF_B ? _mm_cmpeq_epi8(ws->v, wt->v) :
+            (df == DF_H ? _mm_cmpeq_epi16(ws->v, wt->v) : _mm_cmpeq_epi32(ws->v, wt->v));
+#else
+    LANEWISE(wd, ws, wt, df, LANE_CEQ);
+#endif
+}
+
+static inline void vectorCltS(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = vectorGreater(wt->v, ws->v, df);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_CLT_S);
+#endif
+}
+
+static inline void vectorCltU(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = vectorGreaterUnsigned(wt->v, ws->v, df);
+#else
+    LANEWISE(wd, ws, wt, df, LANE_CLT_U);
+#endif
+}
+
+// Lane i of wd is the odd lane 2i + 1 of ws plus the even lane 2i of wt, both extended to the size
+// of wd. df is the size of the wd lanes, halves or words.
+static inline void vectorHadd(VectorReg* wd, const VectorReg* ws, const VectorReg* wt, uint8_t df, bool sign) {
+#ifdef __SSE2__
+    __m128i odd, even;
+    if (df == DF_H) {
+        odd = sign ? _mm_srai_epi16(ws->v, 8) : _mm_srli_epi16(ws->v, 8);
+        even = sign ? _mm_srai_epi16(_mm_slli_epi16(wt->v, 8), 8) : _mm_and_si128(wt->v, _mm_set1_epi16(0xFF));
+        wd->v = _mm_add_epi16(odd, even);
+    } else {
+        odd = sign ? _mm_srai_epi32(ws->v, 16) : _mm_srli_epi32(ws->v, 16);
+        even = sign ? _mm_srai_epi32(_mm_slli_epi32(wt->v, 16), 16) : _mm_and_si128(wt->v, _mm_set1_epi32(0xFFFF));
+        wd->v = _mm_add_epi32(odd, even);
+    }
+#else
+    VectorReg result;
+    if (df == DF_H) {
+        for (int i = 0; i < VECTOR_SIZE / 2; i++) {
+            result.h[i] = sign ? (uint16_t)((int8_t)ws->b[2 * i + 1] + (int8_t)wt->b[2 * i]) :
+                          (uint16_t)(ws->b[2 * i + 1] + wt->b[2 * i]);
+        }
+    } else {
+        for (int i = 0; i < VECTOR_SIZE / 4; i++) {
+            result.w[i] = sign ? (uint32_t)((int16_t)ws->h[2 * i + 1] + (int16_t)wt->h[2 * i]) :
+                          (uint32_t)(ws->h[2 * i + 1] + wt->h[2 * i]);
+        }
+    }
+    *wd = result;
+#endif
+}
+
+// Each group of four lanes is rearranged alike, two bits of the selectors per lane. The selectors
+// are only known at run time, which rules out the SSE2 shuffles.
+static inline void vectorShuffle(VectorReg* wd, const VectorReg* ws, uint8_t selectors, uint8_t df) {
+    VectorReg result;
+    switch (df) {
+        case DF_B:
+            for (int i = 0; i < VECTOR_SIZE; i++) result.b[i] = ws->b[(i & ~3) | ((selectors >> ((i & 3) * 2)) & 3)];
+            break;
+        case DF_H:
+            for (int i = 0; i < VECTOR_SIZE / 2; i++) result.h[i] = ws->h[(i & ~3) | ((selectors >> ((i & 3) * 2)) & 3)];
+            break;
+        default:
+            for (int i = 0; i < VECTOR_SIZE / 4; i++) result.w[i] = ws->w[(selectors >> (i * 2)) & 3];
+            break;
+    }
+    *wd = result;
+}
+
+static inline void vectorFill(VectorReg* wd, uint32_t value, uint8_t df) {
+#ifdef __SSE2__
+    wd->v = df == DF_B ? _mm_set1_epi8((char)value) : (df == DF_H ? _mm_set1_epi16((short)value) : _mm_set1_epi32((int)value));
+#else
+    for (int i = 0; i < VECTOR_SIZE / 4; i++) {
+        wd->w[i] = df == DF_B ? (value & 0xFF) * 0x01010101u : (df == DF_H ? (value & 0xFFFF) * 0x00010001u : value);
+    }
+#endif
+}
+
+// Reverses the bytes of every lane, registers are in host order and memory in the guest one
+static inline void vectorSwapLanes(VectorReg* w, uint8_t df) {
+    if (df == DF_B) return;
+#ifdef __SSE2__
+    __m128i v = w->v;
+    if (df == DF_W) v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+    w->v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+#else
+    for (int i = 0; i < VECTOR_SIZE / 2 && df == DF_H; i++) w->h[i] = __builtin_bswap16(w->h[i]);
+    for (int i = 0; i < VECTOR_SIZE / 4 && df == DF_W; i++) w->w[i] = __builtin_bswap32(w->w[i]);
+#endif
+}
+
+static inline void vectorLoad(VectorReg* wd, const uint8_t* bytes, uint8_t df, bool littleEndian) {
+    memcpy(wd, bytes, VECTOR_SIZE);
+    if (littleEndian != VECTOR_HOST_LITTLE) vectorSwapLanes(wd, df);
+}
+
+static inline void vectorStore(uint8_t* bytes, const VectorReg* ws, uint8_t df, bool littleEndian) {
+    VectorReg value = *ws;
+    if (littleEndian != VECTOR_HOST_LITTLE) vectorSwapLanes(&value, df);
+    memcpy(bytes, &value, VECTOR_SIZE);
+}
+
+#endif // LMIPS_VECTOR
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "arena.h"
+#include "baseline.h"
+#include "snapshot.h"
+
+#define LIMIT (STACK_ADDRESS & ~(MEMORY_PAGE_SIZE - 1))
+
+void testArenaSizeClasses(CuTest* test) {
+    Arena* arena = malloc(sizeof(Arena));
+    initArena(arena);
+    uint32_t heap = HEAP_ADDRESS;
+
+    // Each size class takes pages of its own, handed out lowest address first
+    uint32_t first = arenaMalloc(arena, 1, &heap, LIMIT);
+    uint32_t larger = arenaMalloc(arena, 17, &heap, LIMIT);
+    uint32_t second = arenaMalloc(arena, 16, &heap, LIMIT);
+    CuAssertIntEquals(test, HEAP_ADDRESS, first);
+    CuAssertIntEquals(test, HEAP_ADDRESS + MEMORY_PAGE_SIZE, larger);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 16, second);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 2 * MEMORY_PAGE_SIZE, heap);
+    CuAssertIntEquals(test, 32, arenaBlockSize(arena, larger));
+    CuAssertIntEquals(test, 160, arenaBlockSize(arena, arenaMalloc(arena, 129, &heap, LIMIT)));
+    CuAssertIntEquals(test, 2048, arenaBlockSize(arena, arenaMalloc(arena, 1793, &heap, LIMIT)));
+
+    CuAssertTrue(test, arenaFree(arena, first, &heap));
+    CuAssertIntEquals(test, first, arenaMalloc(arena, 10, &heap, LIMIT));
+
+    // Only the start of a live block can be freed
+    CuAssertTrue(test, !arenaFree(arena, second + 8, &heap));
+    CuAssertTrue(test, !arenaFree(arena, HEAP_ADDRESS + 32, &heap));
+    CuAssertTrue(test, arenaFree(arena, 0, &heap));
+    CuAssertIntEquals(test, 5, arena->stats.blocks);
+    CuAssertIntEquals(test, 6, arena->stats.allocations);
+    CuAssertIntEquals(test, 16 + 32 + 16 + 160 + 2048, arena->stats.inUse);
+    CuAssertTrue(test, validArena(arena, heap));
+
+    free(arena);
+}
+
+void testArenaRuns(CuTest* test) {
+    Arena* arena = malloc(sizeof(Arena));
+    initArena(arena);
+    uint32_t heap = HEAP_ADDRESS;
+
+    uint32_t first = arenaMalloc(arena, 5000, &heap, LIMIT);
+    uint32_t second = arenaMalloc(arena, 3 * MEMORY_PAGE_SIZE, &heap, LIMIT);
+    uint32_t last = arenaMalloc(arena, 2049, &heap, LIMIT);
+    CuAssertIntEquals(test, HEAP_ADDRESS, first);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 2 * MEMORY_PAGE_SIZE, second);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 5 * MEMORY_PAGE_SIZE, last);
+    CuAssertIntEquals(test, 6, arena->stats.pages);
+    CuAssertTrue(test, validArena(arena, heap));
+
+    // Freed runs merge, so the five pages serve one block again
+    CuAssertTrue(test, arenaFree(arena, second, &heap));
+    CuAssertTrue(test, arenaFree(arena, first, &heap));
+    CuAssertIntEquals(test, first, arenaMalloc(arena, 5 * MEMORY_PAGE_SIZE, &heap, LIMIT));
+    CuAssertTrue(test, validArena(arena, heap));
+
+    // Blocks at the top of the heap grow and shrink in place, and give their pages back when freed
+    bool valid;
+    CuAssertIntEquals(test, last, arenaRealloc(arena, NULL, last, 4 * MEMORY_PAGE_SIZE, &heap, LIMIT, &valid));
+    CuAssertTrue(test, valid);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 9 * MEMORY_PAGE_SIZE, heap);
+    CuAssertIntEquals(test, last, arenaRealloc(arena, NULL, last, 3000, &heap, LIMIT, &valid));
+    CuAssertIntEquals(test, HEAP_ADDRESS + 6 * MEMORY_PAGE_SIZE, heap);
+    CuAssertTrue(test, arenaFree(arena, last, &heap));
+    CuAssertTrue(test, arenaFree(arena, first, &heap));
+    CuAssertIntEquals(test, HEAP_ADDRESS, heap);
+    CuAssertIntEquals(test, 0, arena->stats.pages);
+    CuAssertIntEquals(test, 0, arena->stats.inUse);
+
+    // The heap stops short of the limit, failed allocations leave it where it was
+    CuAssertIntEquals(test, 0, arenaMalloc(arena, LIMIT - HEAP_ADDRESS + 1, &heap, LIMIT));
+    CuAssertIntEquals(test, 0, arenaMalloc(arena, UINT32_MAX, &heap, LIMIT));
+    CuAssertIntEquals(test, HEAP_ADDRESS, heap);
+    CuAssertIntEquals(test, 2, arena->stats.failures);
+
+    free(arena);
+}
+
+void testArenaValidation(CuTest* test) {
+    Arena* arena = malloc(sizeof(Arena));
+    Arena* corrupted = malloc(sizeof(Arena));
+    initArena(arena);
+    uint32_t heap = HEAP_ADDRESS;
+
+    uint32_t small = arenaMalloc(arena, 48, &heap, LIMIT);
+    uint32_t run = arenaMalloc(arena, 3 * MEMORY_PAGE_SIZE, &heap, LIMIT);
+    arenaMalloc(arena, 3000, &heap, LIMIT);
+    CuAssertTrue(test, arenaFree(arena, run, &heap));
+    CuAssertTrue(test, validArena(arena, heap));
+
+    // Pages past the break
+    CuAssertTrue(test, !validArena(arena, heap - MEMORY_PAGE_SIZE));
+    CuAssertTrue(test, !validArena(arena, MEMORY_SIZE + MEMORY_PAGE_SIZE));
+
+    // Page kind past the size classes
+    memcpy(corrupted, arena, sizeof(Arena));
+    corrupted->pageKind[0] = ARENA_CLASSES + 1;
+    CuAssertTrue(test, !validArena(corrupted, heap));
+
+    // Run longer than the pages marked as its tail
+    memcpy(corrupted, arena, sizeof(Arena));
+    corrupted->runPages[1] = 2;
+    CuAssertTrue(test, !validArena(corrupted, heap));
+
+    // Block starting between two slots of its page
+    memcpy(corrupted, arena, sizeof(Arena));
+    corrupted->used[0] |= 1ULL << 1;
+    CuAssertTrue(test, !validArena(corrupted, heap));
+
+    // Partial page of another class, and a partial bit past the last page
+    memcpy(corrupted, arena, sizeof(Arena));
+    corrupted->partial[0][0] |= 1;
+    CuAssertTrue(test, !validArena(corrupted, heap));
+    memcpy(corrupted, arena, sizeof(Arena));
+    corrupted->partial[2][ARENA_PAGE_WORDS - 1] |= 1ULL << 63;
+    CuAssertTrue(test, !validArena(corrupted, heap));
+
+    CuAssertIntEquals(test, 48, arenaBlockSize(arena, small));
+    free(corrupted);
+    free(arena);
+}
+
+void testArenaSyscalls(CuTest* test) {
+    LMips mips;
+    Memory memory;
+
+    uint8_t program[] = {
+        0x20, 0x04, 0x00, 0x18, // addi $a0, $zero, 24
+        0x20, 0x02, 0x00, 0x22, // addi $v0, $zero, 0x22
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x00, 0x40, 0x40, 0x20, // add $t0, $v0, $zero
+        0x20, 0x09, 0x12, 0x34, // addi $t1, $zero, 0x1234
+        0xA9, 0x09, 0x00, 0x00, // sw $t1, 0($t0)
+        0x01, 0x00, 0x20, 0x20, // add $a0, $t0, $zero
+        0x20, 0x05, 0x0F, 0xA0, // addi $a1, $zero, 4000
+        0x20, 0x02, 0x00, 0x24, // addi $v0, $zero, 0x24
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x00, 0x40, 0x50, 0x20, // add $t2, $v0, $zero
+        0x8D, 0x4B, 0x00, 0x00, // lw $t3, 0($t2)
+        0x01, 0x40, 0x20, 0x20, // add $a0, $t2, $zero
+        0x20, 0x02, 0x00, 0x23, // addi $v0, $zero, 0x23
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&memory);
+    memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(&mips, &memory);
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, HEAP_ADDRESS, mips.regs[$t0]);
+    CuAssertIntEquals(test, HEAP_ADDRESS + MEMORY_PAGE_SIZE, mips.regs[$t2]);
+    CuAssertIntEquals(test, 0x1234, mips.regs[$t3]);
+    CuAssertIntEquals(test, HEAP_ADDRESS, mips.heap);
+    CuAssertIntEquals(test, 1, mips.arena->stats.reallocs);
+    CuAssertIntEquals(test, 1, mips.arena->stats.frees);
+    CuAssertIntEquals(test, 0, mips.arena->stats.blocks);
+
+    // Freeing the block a second time is a guest error
+    mips.ip = 13 * 4;
+    mips.stop = false;
+    CuAssertIntEquals(test, EXEC_FAILURE, runSimulator(&mips));
+
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testArenaSavedState(CuTest* test) {
+    LMips mips, restored;
+    Memory memory, restoredMemory;
+    Baseline baseline;
+    char path[] = "/tmp/lmips_snapshot_XXXXXX";
+    close(mkstemp(path));
+
+    uint8_t program[] = {
+        0x20, 0x04, 0x00, 0x40, // addi $a0, $zero, 64
+        0x20, 0x02, 0x00, 0x22, // addi $v0, $zero, 0x22
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x00, 0x40, 0x40, 0x20, // add $t0, $v0, $zero
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&memory);
+    memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(&mips, &memory);
+
+    // Allocator state is part of the machine, so reruns from a baseline hand out the same blocks
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, HEAP_ADDRESS, mips.regs[$t0]);
+    CuAssertTrue(test, saveBaseline(&baseline, &mips));
+    mips.ip = 0;
+    mips.stop = false;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, HEAP_ADDRESS + 64, mips.regs[$t0]);
+    CuAssertTrue(test, resetToBaseline(&baseline, &mips));
+    CuAssertIntEquals(test, 1, mips.arena->stats.blocks);
+    mips.ip = 0;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, HEAP_ADDRESS + 64, mips.regs[$t0]);
+
+    CuAssertTrue(test, saveSnapshot(&mips, path));
+    CuAssertTrue(test, restoreSnapshot(&restored, &restoredMemory, path));
+    CuAssertIntEquals(test, 2, restored.arena->stats.blocks);
+    CuAssertIntEquals(test, 64, arenaBlockSize(restored.arena, HEAP_ADDRESS + 64));
+    restored.ip = 0;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&restored));
+    CuAssertIntEquals(test, HEAP_ADDRESS + 128, restored.regs[$t0]);
+    freeMemory(&restoredMemory);
+    freeSimulator(&restored);
+
+    // Allocator tables that do not hold together are refused
+    SnapshotHeader header;
+    FILE* file = fopen(path, "r+b");
+    CuAssertIntEquals(test, 1, fread(&header, sizeof(header), 1, file));
+    fseek(file, sizeof(header) + header.pageCount * sizeof(uint32_t), SEEK_SET);
+    fputc(ARENA_CLASSES + 1, file);
+    fclose(file);
+    CuAssertTrue(test, !restoreSnapshot(&restored, &restoredMemory, path));
+
+    unlink(path);
+    freeBaseline(&baseline);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+CuSuite* getLMipsArenaSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testArenaSizeClasses);
+    SUITE_ADD_TEST(suite, testArenaRuns);
+    SUITE_ADD_TEST(suite, testArenaValidation);
+    SUITE_ADD_TEST(suite, testArenaSyscalls);
+    SUITE_ADD_TEST(suite, testArenaSavedState);
+
+    return suite;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "baseline.h"
+
+static int dirtyPageCount(Memory* memory) {
+    int count = 0;
+    for (int i = 0; i < DIRTY_WORDS; i++) {
+        count += __builtin_popcountll(memory->dirty[i]);
+    }
+
+    return count;
+}
+
+void testDirtyPageTracking(CuTest* test) {
+    Memory memory;
+    initMemory(&memory);
+    CuAssertIntEquals(test, 0, dirtyPageCount(&memory));
+
+    mem_write_byte(&memory, DATA_ADDRESS, 1);
+    mem_write_half(&memory, DATA_ADDRESS + 2, 1);
+    CuAssertIntEquals(test, 1, dirtyPageCount(&memory));
+
+    // A word straddling two pages dirties both
+    mem_write(&memory, DATA_ADDRESS + 2 * MEMORY_PAGE_SIZE - 2, 1);
+    CuAssertIntEquals(test, 3, dirtyPageCount(&memory));
+
+    clearDirtyPages(&memory);
+    CuAssertIntEquals(test, 0, dirtyPageCount(&memory));
+
+    freeMemory(&memory);
+}
+
+void testResetToBaseline(CuTest* test) {
+    LMips mips;
+    Memory memory;
+    Baseline baseline;
+
+    uint8_t program[] = {
+        0x21, 0x08, 0x00, 0x01, // addi $t0, $t0, 1
+        0xAB, 0xA8, 0x00, 0x00, // sw $t0, ($sp)
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&memory);
+    memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(&mips, &memory);
+    mips.regs[$sp] = DATA_ADDRESS;
+    mem_write(&memory, DATA_ADDRESS, 41);
+
+    CuAssertTrue(test, saveBaseline(&baseline, &mips));
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, 1, mem_read(&memory, DATA_ADDRESS));
+    CuAssertIntEquals(test, 1, dirtyPageCount(&memory));
+
+    CuAssertTrue(test, resetToBaseline(&baseline, &mips));
+    CuAssertIntEquals(test, 0, dirtyPageCount(&memory));
+    CuAssertIntEquals(test, 41, mem_read(&memory, DATA_ADDRESS));
+    CuAssertIntEquals(test, 0, mips.ip);
+    CuAssertIntEquals(test, 0, mips.regs[$t0]);
+    CuAssertTrue(test, !mips.stop);
+
+    // The machine runs again exactly as the first time
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, 1, mem_read(&memory, DATA_ADDRESS));
+
+    freeBaseline(&baseline);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+CuSuite* getLMipsBaselineSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testDirtyPageTracking);
+    SUITE_ADD_TEST(suite, testResetToBaseline);
+
+    return suite;
+}
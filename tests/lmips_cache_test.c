@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+
+void testCacheConfigParsing(CuTest* test) {
+    CacheConfig config;
+
+    CuAssertTrue(test, parseCacheConfig("32k:4:64:fifo", &config));
+    CuAssertIntEquals(test, 32 * 1024, config.size);
+    CuAssertIntEquals(test, 4, config.assoc);
+    CuAssertIntEquals(test, 64, config.lineSize);
+    CuAssertIntEquals(test, REPLACE_FIFO, config.policy);
+
+    CuAssertTrue(test, parseCacheConfig("1024:2:32", &config));
+    CuAssertIntEquals(test, REPLACE_LRU, config.policy);
+
+    CuAssertTrue(test, !parseCacheConfig("1024:2", &config));
+    CuAssertTrue(test, !parseCacheConfig("1024:2:32:plru", &config));
+}
+
+void testCacheLruReplacement(CuTest* test) {
+    CacheLevel level;
+    CacheConfig config = {128, 2, 64, REPLACE_LRU}; // A single set of two ways
+
+    CuAssertTrue(test, initCacheLevel(&level, "L1D", config));
+    CuAssertTrue(test, !cacheAccess(&level, 0x000));
+    CuAssertTrue(test, !cacheAccess(&level, 0x040));
+    CuAssertTrue(test, cacheAccess(&level, 0x004));
+    CuAssertTrue(test, !cacheAccess(&level, 0x080)); // Evicts 0x040
+    CuAssertTrue(test, cacheAccess(&level, 0x000));
+    CuAssertTrue(test, !cacheAccess(&level, 0x040));
+
+    CuAssertIntEquals(test, 2, level.hits);
+    CuAssertIntEquals(test, 4, level.misses);
+
+    freeCacheLevel(&level);
+}
+
+void testCacheFifoReplacement(CuTest* test) {
+    CacheLevel level;
+    CacheConfig config = {128, 2, 64, REPLACE_FIFO};
+
+    CuAssertTrue(test, initCacheLevel(&level, "L1D", config));
+    cacheAccess(&level, 0x000);
+    cacheAccess(&level, 0x040);
+    cacheAccess(&level, 0x000);
+    CuAssertTrue(test, !cacheAccess(&level, 0x080)); // Evicts 0x000 despite its recent use
+    CuAssertTrue(test, !cacheAccess(&level, 0x000));
+
+    freeCacheLevel(&level);
+}
+
+void testCacheProbes(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x8F, 0xA8, 0x00, 0x00, // lw $t0, ($sp)
+        0x8F, 0xA9, 0x00, 0x00, // lw $t1, ($sp)
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.regs[$sp] = DATA_ADDRESS;
+
+    CacheHierarchy cache;
+    CuAssertTrue(test, initCacheHierarchy(&cache, defaultCacheConfig(1024), defaultCacheConfig(1024), NULL));
+    Probes probes = {};
+    probes.cache = &cache;
+    mips.probes = &probes;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 4, cache.l1i.hits + cache.l1i.misses);
+    CuAssertIntEquals(test, 1, cache.l1d.misses);
+    CuAssertIntEquals(test, 1, cache.l1d.hits);
+    CuAssertIntEquals(test, 2, cache.missSites[0]); // Both the fetch and the load of the first lw miss
+
+    // Accesses straddling two lines look both up
+    probeLoad(&probes, 0, DATA_ADDRESS + 60, 8);
+    CuAssertIntEquals(test, 2, cache.l1d.hits);
+    CuAssertIntEquals(test, 2, cache.l1d.misses);
+    probeStore(&probes, 0, DATA_ADDRESS + 56, 8);
+    CuAssertIntEquals(test, 3, cache.l1d.hits);
+
+    freeCacheHierarchy(&cache);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+CuSuite* getLMipsCacheSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testCacheConfigParsing);
+    SUITE_ADD_TEST(suite, testCacheLruReplacement);
+    SUITE_ADD_TEST(suite, testCacheFifoReplacement);
+    SUITE_ADD_TEST(suite, testCacheProbes);
+
+    return suite;
+}
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "channel.h"
+
+#define STREAM_SIZE 100000
+
+static uint8_t streamByte(uint32_t i) {
+    return (uint8_t)(i * 7 + (i >> 8));
+}
+
+static void* writeStream(void* argument) {
+    Channel* channel = argument;
+    uint8_t chunk[37];
+    uint32_t i = 0;
+
+    // Chunks smaller than the ring but not dividing it, so that copies wrap around its end
+    while (i < STREAM_SIZE) {
+        uint32_t count = STREAM_SIZE - i < sizeof(chunk) ? STREAM_SIZE - i : sizeof(chunk);
+        for (uint32_t j = 0; j < count; ++j) chunk[j] = streamByte(i + j);
+        if (channelSend(channel, chunk, count) != count) break;
+        i += count;
+    }
+    closeChannelWriter(channel);
+    return NULL;
+}
+
+void testChannelStream(CuTest* test) {
+    Channel channel;
+    pthread_t writer;
+    uint8_t buffer[50];
+
+    CuAssertTrue(test, initChannel(&channel, 64));
+    pthread_create(&writer, NULL, writeStream, &channel);
+
+    uint32_t received = 0;
+    bool intact = true;
+    uint32_t count;
+    while ((count = channelReceive(&channel, buffer, sizeof(buffer))) != 0) {
+        for (uint32_t j = 0; j < count; ++j) intact &= buffer[j] == streamByte(received + j);
+        received += count;
+    }
+    pthread_join(writer, NULL);
+
+    CuAssertIntEquals(test, STREAM_SIZE, received);
+    CuAssertTrue(test, intact);
+    CuAssertIntEquals(test, 0, channelReceive(&channel, buffer, sizeof(buffer)));
+    freeChannel(&channel);
+
+    // Nothing goes to a reader that is gone
+    CuAssertTrue(test, initChannel(&channel, 64));
+    closeChannelReader(&channel);
+    CuAssertIntEquals(test, 0, channelSend(&channel, buffer, sizeof(buffer)));
+    freeChannel(&channel);
+}
+
+typedef struct {
+    LMips mips;
+    ExecutionResult result;
+} Connected;
+
+static void* runConnected(void* argument) {
+    Connected* connected = argument;
+    LMips* mips = &connected->mips;
+    connected->result = runSimulator(mips);
+
+    if (mips->channelOut != NULL) closeChannelWriter(mips->channelOut);
+    if (mips->channelIn != NULL) closeChannelReader(mips->channelIn);
+    return NULL;
+}
+
+void testChannelSyscalls(CuTest* test) {
+    Connected producer, consumer;
+    Memory producerMemory, consumerMemory;
+    Channel channel;
+    pthread_t threads[2];
+
+    uint8_t send[] = {
+        0x20, 0x02, 0x00, 0x26, // addi $v0, $zero, 0x26
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x00, 0x40, 0x40, 0x20, // add $t0, $v0, $zero
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+    uint8_t recv[] = {
+        0x02, 0x00, 0x20, 0x20, // loop: add $a0, $s0, $zero
+        0x20, 0x05, 0x10, 0x00, // addi $a1, $zero, 0x1000
+        0x20, 0x02, 0x00, 0x27, // addi $v0, $zero, 0x27
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x02, 0x02, 0x80, 0x20, // add $s0, $s0, $v0
+        0x14, 0x40, 0xFF, 0xFB, // bne $v0, $zero, loop
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&producerMemory);
+    memcpy(&producerMemory.store[PROGRAM_ADDRESS], send, sizeof(send));
+    for (uint32_t i = 0; i < STREAM_SIZE; ++i) producerMemory.store[DATA_ADDRESS + i] = streamByte(i);
+    initSimulator(&producer.mips, &producerMemory);
+    producer.mips.regs[$a0] = DATA_ADDRESS;
+    producer.mips.regs[$a1] = STREAM_SIZE;
+
+    initMemory(&consumerMemory);
+    memcpy(&consumerMemory.store[PROGRAM_ADDRESS], recv, sizeof(recv));
+    initSimulator(&consumer.mips, &consumerMemory);
+    consumer.mips.regs[$s0] = DATA_ADDRESS + 0x100;
+
+    CuAssertTrue(test, initChannel(&channel, CHANNEL_CAPACITY));
+    producer.mips.channelOut = &channel;
+    consumer.mips.channelIn = &channel;
+    pthread_create(&threads[0], NULL, runConnected, &producer);
+    pthread_create(&threads[1], NULL, runConnected, &consumer);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, producer.result);
+    CuAssertIntEquals(test, EXEC_SUCCESS, consumer.result);
+    CuAssertIntEquals(test, STREAM_SIZE, producer.mips.regs[$t0]);
+    CuAssertIntEquals(test, DATA_ADDRESS + 0x100 + STREAM_SIZE, consumer.mips.regs[$s0]);
+    CuAssertTrue(test, memcmp(&producerMemory.store[DATA_ADDRESS], &consumerMemory.store[DATA_ADDRESS + 0x100],
+                              STREAM_SIZE) == 0);
+
+    freeChannel(&channel);
+    freeSimulator(&producer.mips);
+    freeSimulator(&consumer.mips);
+    freeMemory(&producerMemory);
+    freeMemory(&consumerMemory);
+}
+
+CuSuite* getLMipsChannelSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testChannelStream);
+    SUITE_ADD_TEST(suite, testChannelSyscalls);
+
+    return suite;
+}
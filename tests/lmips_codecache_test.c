@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "codecache.h"
+
+static uint8_t program[] = {
+    0x20, 0x08, 0x00, 0x03, // addi $t0, $zero, 3
+    0x21, 0x08, 0xFF, 0xFF, // loop: addi $t0, $t0, -1
+    0x1D, 0x00, 0xFF, 0xFF, // bgtz $t0, loop
+    OP_SPECIAL, 0, 0, SPE_SYSCALL
+};
+
+static void entryName(CodeCache* cache, const uint8_t* text, uint32_t size, char* path) {
+    sprintf(path, "%s/%016llx.ldc", cache->directory, (unsigned long long)codeCacheKey(text, size, false));
+}
+
+void testCodeCacheRoundTrip(CuTest* test) {
+    char directory[] = "/tmp/lmips_codecache_XXXXXX";
+    CuAssertPtrNotNull(test, mkdtemp(directory));
+    CodeCache cache = {directory, CODE_CACHE_DEFAULT_LIMIT};
+
+    DecodedText decoded, cached;
+    CuAssertTrue(test, decodeText(&decoded, program, sizeof(program), false));
+    CuAssertTrue(test, !lookupCodeCache(&cache, program, sizeof(program), false, &cached));
+    CuAssertTrue(test, storeCodeCache(&cache, program, sizeof(program), false, &decoded));
+
+    CuAssertTrue(test, lookupCodeCache(&cache, program, sizeof(program), false, &cached));
+    CuAssertPtrNotNull(test, cached.mapping);
+    CuAssertIntEquals(test, decoded.count, cached.count);
+    CuAssertIntEquals(test, 0, memcmp(decoded.instrs, cached.instrs, decoded.count * sizeof(DecodedInstr)));
+    freeDecodedText(&cached);
+
+    // Entries hold the records only, and the same words followed by a nop are another text
+    char path[256];
+    struct stat status;
+    entryName(&cache, program, sizeof(program), path);
+    CuAssertIntEquals(test, 0, stat(path, &status));
+    CuAssertIntEquals(test, sizeof(CodeCacheHeader) + decoded.count * sizeof(DecodedInstr), status.st_size);
+    uint8_t padded[sizeof(program) + 4] = {};
+    memcpy(padded, program, sizeof(program));
+    CuAssertTrue(test, !lookupCodeCache(&cache, padded, sizeof(padded), false, &cached));
+
+    // Other text misses, as does the same text read in the other byte order or an entry left by another
+    // decoder version
+    uint8_t other[sizeof(program)];
+    memcpy(other, program, sizeof(program));
+    other[3] = 0x04;
+    CuAssertTrue(test, !lookupCodeCache(&cache, other, sizeof(other), false, &cached));
+    CuAssertIntEquals(test, 0, cached.count);
+    CuAssertTrue(test, !lookupCodeCache(&cache, program, sizeof(program), true, &cached));
+
+    int file = open(path, O_WRONLY);
+    uint32_t version = DECODE_VERSION + 1;
+    CuAssertIntEquals(test, sizeof(version), pwrite(file, &version, sizeof(version), 4));
+    close(file);
+    CuAssertTrue(test, !lookupCodeCache(&cache, program, sizeof(program), false, &cached));
+
+    freeDecodedText(&decoded);
+    unlink(path);
+    rmdir(directory);
+}
+
+void testCodeCacheEviction(CuTest* test) {
+    char directory[] = "/tmp/lmips_codecache_XXXXXX";
+    CuAssertPtrNotNull(test, mkdtemp(directory));
+    CodeCache cache = {directory, CODE_CACHE_DEFAULT_LIMIT};
+
+    uint8_t other[sizeof(program)];
+    memcpy(other, program, sizeof(program));
+    other[3] = 0x04;
+
+    DecodedText decoded, cached;
+    CuAssertTrue(test, decodeText(&decoded, program, sizeof(program), false));
+    CuAssertTrue(test, storeCodeCache(&cache, program, sizeof(program), false, &decoded));
+    freeDecodedText(&decoded);
+
+    // Age the first entry so the order does not depend on the file system's timestamp granularity
+    char path[256], otherPath[256];
+    entryName(&cache, program, sizeof(program), path);
+    CuAssertIntEquals(test, 0, utimensat(AT_FDCWD, path, (struct timespec[2]){{1, 0}, {1, 0}}, 0));
+
+    struct stat status;
+    CuAssertIntEquals(test, 0, stat(path, &status));
+    cache.limit = status.st_size;
+
+    CuAssertTrue(test, decodeText(&decoded, other, sizeof(other), false));
+    CuAssertTrue(test, storeCodeCache(&cache, other, sizeof(other), false, &decoded));
+    freeDecodedText(&decoded);
+
+    CuAssertTrue(test, !lookupCodeCache(&cache, program, sizeof(program), false, &cached));
+    CuAssertTrue(test, lookupCodeCache(&cache, other, sizeof(other), false, &cached));
+    freeDecodedText(&cached);
+
+    entryName(&cache, other, sizeof(other), otherPath);
+    unlink(otherPath);
+    rmdir(directory);
+}
+
+CuSuite* getLMipsCodeCacheSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testCodeCacheRoundTrip);
+    SUITE_ADD_TEST(suite, testCodeCacheEviction);
+
+    return suite;
+}
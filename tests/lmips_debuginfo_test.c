@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "memory.h"
+#include "debuginfo.h"
+
+static void writeWord(FILE* file, uint32_t word) {
+    uint8_t bytes[4] = {word >> 0x18, word >> 0x10, word >> 0x08, word};
+    fwrite(bytes, sizeof(uint8_t), 4, file);
+}
+
+static void writeSymbol(FILE* file, uint32_t address, SymbolSegment segment, const char* name) {
+    writeWord(file, address);
+    fputc(segment, file);
+    fputc(strlen(name), file);
+    fputs(name, file);
+}
+
+// Writes a symbol section followed by a line section, as the assembler lays them out
+static void writeDebugSections(const char* path, DebugInfo* debug) {
+    FILE* file = fopen(path, "wb");
+    fputs("padding", file);
+
+    debug->symtabOffset = ftell(file);
+    writeSymbol(file, 0x20, SYMBOL_TEXT, "loop");
+    writeSymbol(file, 0x00, SYMBOL_TEXT, "main");
+    writeSymbol(file, 0x10, SYMBOL_DATA, "buffer");
+    debug->symtabSize = ftell(file) - debug->symtabOffset;
+
+    debug->linesOffset = ftell(file);
+    writeWord(file, 0x00);
+    writeWord(file, 3);
+    writeWord(file, 0x20);
+    writeWord(file, 7);
+    debug->linesSize = ftell(file) - debug->linesOffset;
+
+    fclose(file);
+}
+
+void testDebugInfoLookup(CuTest* test) {
+    char path[] = "/tmp/lmips_debuginfo_XXXXXX";
+    close(mkstemp(path));
+
+    DebugInfo debug;
+    initDebugInfo(&debug, path);
+    writeDebugSections(path, &debug);
+    CuAssertTrue(test, !debug.loaded);
+
+    const Symbol* symbol = findSymbol(&debug, SYMBOL_TEXT, 0x24);
+    CuAssertTrue(test, debug.loaded);
+    CuAssertPtrNotNull(test, symbol);
+    CuAssertStrEquals(test, "loop", symbol->name);
+    CuAssertStrEquals(test, "main", findSymbol(&debug, SYMBOL_TEXT, 0x1C)->name);
+
+    symbol = findSymbol(&debug, SYMBOL_DATA, DATA_ADDRESS + 0x14);
+    CuAssertStrEquals(test, "buffer", symbol->name);
+    CuAssertIntEquals(test, DATA_ADDRESS + 0x10, symbol->address);
+    CuAssertPtrEquals(test, NULL, (void*)findSymbol(&debug, SYMBOL_DATA, DATA_ADDRESS));
+
+    CuAssertIntEquals(test, 3, findLine(&debug, 0x1C));
+    CuAssertIntEquals(test, 7, findLine(&debug, 0x20));
+
+    char location[64];
+    formatLocation(&debug, 0x28, location, sizeof(location));
+    CuAssertStrEquals(test, "loop+0x8 (line 7)", location);
+
+    freeDebugInfo(&debug);
+    remove(path);
+}
+
+void testMissingDebugInfo(CuTest* test) {
+    char location[64];
+
+    formatLocation(NULL, 0x10, location, sizeof(location));
+    CuAssertStrEquals(test, "0x002010", location);
+
+    // Without a readable executable the reports fall back to bare addresses
+    DebugInfo debug;
+    initDebugInfo(&debug, "/nonexistent/lmips.lef");
+    debug.symtabOffset = 0x100;
+    debug.symtabSize = 0x10;
+    CuAssertPtrEquals(test, NULL, (void*)findSymbol(&debug, SYMBOL_TEXT, 0));
+    CuAssertIntEquals(test, 0, findLine(&debug, 0));
+
+    freeDebugInfo(&debug);
+}
+
+CuSuite* getLMipsDebugInfoSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testDebugInfoLookup);
+    SUITE_ADD_TEST(suite, testMissingDebugInfo);
+
+    return suite;
+}
@@ -0,0 +1,105 @@
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "decode.h"
+
+void testDecodeInstruction(CuTest* test) {
+    DecodedInstr decoded;
+
+    decodeInstruction(0, 0x2108FFFF, &decoded); // addi $t0, $t0, -1
+    CuAssertIntEquals(test, DOP_ADDI, decoded.op);
+    CuAssertIntEquals(test, $t0, decoded.rs);
+    CuAssertIntEquals(test, $t0, decoded.rt);
+    CuAssertIntEquals(test, -1, (int32_t)decoded.immed);
+
+    decodeInstruction(0, 0x3529FFFF, &decoded); // ori $t1, $t1, 0xffff
+    CuAssertIntEquals(test, DOP_ORI, decoded.op);
+    CuAssertIntEquals(test, 0xFFFF, decoded.immed);
+
+    decodeInstruction(0x10, 0x1509FFFE, &decoded); // bne $t0, $t1, -8
+    CuAssertIntEquals(test, DOP_BNE, decoded.op);
+    CuAssertIntEquals(test, 0x08, decoded.immed);
+
+    decodeInstruction(0x10, 0x0C000010, &decoded); // jal 0x40
+    CuAssertIntEquals(test, DOP_JAL, decoded.op);
+    CuAssertIntEquals(test, 0x40, decoded.immed);
+
+    decodeInstruction(0, 0x01000009, &decoded); // jalr $t0
+    CuAssertIntEquals(test, DOP_JALR, decoded.op);
+    CuAssertIntEquals(test, $ra, decoded.rd);
+
+    decodeInstruction(0, 0x8FA8FFFC, &decoded); // lw $t0, -4($sp)
+    CuAssertIntEquals(test, DOP_LW, decoded.op);
+    CuAssertIntEquals(test, $sp, decoded.rs);
+    CuAssertIntEquals(test, -4, (int32_t)decoded.immed);
+
+    decodeInstruction(0, 0x7D0A3900, &decoded); // ext $t2, $t0, 4, 8
+    CuAssertIntEquals(test, DOP_EXT, decoded.op);
+    CuAssertIntEquals(test, $t0, decoded.rs);
+    CuAssertIntEquals(test, $t2, decoded.rt);
+    CuAssertIntEquals(test, 4, decoded.rd);
+    CuAssertIntEquals(test, 0xFF, decoded.immed);
+
+    decodeInstruction(0, 0x7D0B5A04, &decoded); // ins $t3, $t0, 8, 4
+    CuAssertIntEquals(test, DOP_INS, decoded.op);
+    CuAssertIntEquals(test, 8, decoded.rd);
+    CuAssertIntEquals(test, 0xF00, decoded.immed);
+
+    decodeInstruction(0, 0x7D0B3A04, &decoded); // ins with its end before its start
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    CuAssertIntEquals(test, OP_SPECIAL3, decoded.immed);
+
+    decodeInstruction(0, 0xFC000000, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    CuAssertIntEquals(test, 0x3F, decoded.immed);
+
+    // Shift amounts only come from a 5-bit field, records claiming more are refused
+    DecodedInstr record = {DOP_SLL, $t0, 0, $t1, 31};
+    CuAssertTrue(test, validDecodedInstr(&record));
+    record.immed = 32;
+    CuAssertTrue(test, !validDecodedInstr(&record));
+}
+
+void testDecodedMatchesRaw(CuTest* test) {
+    uint8_t program[] = {
+        0x20, 0x08, 0x00, 0x03, // addi $t0, $zero, 3
+        0x21, 0x29, 0x00, 0x02, // loop: addi $t1, $t1, 2
+        0x21, 0x08, 0xFF, 0xFF, // addi $t0, $t0, -1
+        0x1D, 0x00, 0xFF, 0xFE, // bgtz $t0, loop
+        0x05, 0x21, 0x00, 0x02, // bgez $t1, done
+        0x20, 0x0A, 0x00, 0x01, // addi $t2, $zero, 1
+        0x20, 0x02, 0x00, 0x0A, // done: addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    DecodedText decoded;
+    CuAssertTrue(test, decodeText(&decoded, program, sizeof(program), false));
+    CuAssertIntEquals(test, 8, decoded.count);
+
+    LMips raw, fast;
+    initTestSimulator(&raw, program);
+    initTestSimulator(&fast, program);
+    fast.decoded = &decoded;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&raw));
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&fast));
+
+    CuAssertIntEquals(test, 6, fast.regs[$t1]);
+    CuAssertIntEquals(test, 0, fast.regs[$t2]);
+    CuAssertIntEquals(test, 32, fast.ip);
+    CuAssertIntEquals(test, 0, memcmp(raw.regs, fast.regs, sizeof(raw.regs)));
+    CuAssertIntEquals(test, raw.retired, fast.retired);
+
+    freeSimulator(&raw);
+    freeSimulator(&fast);
+    freeDecodedText(&decoded);
+}
+
+CuSuite* getLMipsDecodeSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testDecodeInstruction);
+    SUITE_ADD_TEST(suite, testDecodedMatchesRaw);
+
+    return suite;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "disasm.h"
+#include "annotate.h"
+
+static void assertDisassembly(CuTest* test, const char* expected, uint32_t ip, uint32_t instr) {
+    char text[64];
+    disassemble(ip, instr, text, sizeof(text));
+    CuAssertStrEquals(test, expected, text);
+}
+
+void testDisassemble(CuTest* test) {
+    assertDisassembly(test, "addi $t0, $t0, -1", 0, 0x2108FFFF);
+    assertDisassembly(test, "addu $v0, $a0, $a1", 0, 0x00851021);
+    assertDisassembly(test, "sll $t4, $t4, 2", 0, 0x000C6080);
+    assertDisassembly(test, "sw $t0, -4($sp)", 0, 0xABA8FFFC);
+    assertDisassembly(test, "lbu $t1, 3($s0)", 0, 0x92090003);
+    assertDisassembly(test, "ori $t1, $t1, 0xd40", 0, 0x35290D40);
+    assertDisassembly(test, "jr $ra", 0, 0x03E00008);
+    assertDisassembly(test, "syscall", 0, 0x0000000C);
+    assertDisassembly(test, "mflo $t6", 0, 0x00007012);
+    assertDisassembly(test, "bne $t0, $t1, 0x002008", 0x10, 0x1509FFFE);
+    assertDisassembly(test, "bgez $a0, 0x002018", 0x10, 0x04810002);
+    assertDisassembly(test, "j 0x002040", 0x10, 0x08000010);
+    assertDisassembly(test, "mul $t2, $t0, $t1", 0, 0x71095002);
+    assertDisassembly(test, "movn $t3, $t0, $t1", 0, 0x0109580B);
+    assertDisassembly(test, "clz $t2, $t0", 0, 0x710A5020);
+    assertDisassembly(test, "seh $t3, $t0", 0, 0x7C085E20);
+    assertDisassembly(test, "ext $t2, $t0, 4, 8", 0, 0x7D0A3900);
+    assertDisassembly(test, "ins $t3, $t0, 8, 4", 0, 0x7D0B5A04);
+    assertDisassembly(test, "div.s $f6, $f0, $f2", 0, 0x46020183);
+    assertDisassembly(test, "neg.s $f14, $f8", 0, 0x46004387);
+    assertDisassembly(test, "cvt.d.w $f2, $f2", 0, 0x468010A1);
+    assertDisassembly(test, "trunc.w.d $f10, $f4", 0, 0x4620228D);
+    assertDisassembly(test, "c.le.d $f4, $f0", 0, 0x4620203E);
+    assertDisassembly(test, "bc1t 0x002018", 0x10, 0x45010002);
+    assertDisassembly(test, "mfc1 $t2, $f10", 0, 0x440A5000);
+    assertDisassembly(test, "sdc1 $f4, 8($gp)", 0, 0xF7840008);
+    assertDisassembly(test, ".word 0x46220800", 0, 0x46220800); // add.d on an odd register
+    assertDisassembly(test, "clt_u.h $w10, $w6, $w7", 0, 0x79A7328F);
+    assertDisassembly(test, "hadd_u.w $w2, $w1, $w1", 0, 0x7AC10895);
+    assertDisassembly(test, "shf.b $w2, $w0, 27", 0, 0x781B0082);
+    assertDisassembly(test, "ld.w $w1, -8($gp)", 0, 0x7BFEE062);
+    assertDisassembly(test, "fill.w $w6, $t0", 0, 0x7B02419E);
+    assertDisassembly(test, "copy_s.h $t1, $w3[6]", 0, 0x78A61A59);
+    assertDisassembly(test, ".word 0x7861008e", 0, 0x7861008E); // addv.d
+    assertDisassembly(test, ".word 0xfc000000", 0, 0xFC000000);
+    assertDisassembly(test, ".word 0x7d0afd00", 0, 0x7D0AFD00); // ext running past bit 31
+}
+
+void testControlTransfers(CuTest* test) {
+    uint32_t target;
+
+    CuAssertTrue(test, isControlTransfer(0x03E00008)); // jr $ra
+    CuAssertTrue(test, isControlTransfer(0x1509FFFE)); // bne
+    CuAssertTrue(test, !isControlTransfer(0x0000000C)); // syscall
+    CuAssertTrue(test, isControlTransfer(0x45000002)); // bc1f
+    CuAssertTrue(test, !isControlTransfer(0x46220102)); // mul.d
+
+    CuAssertTrue(test, branchTarget(0x10, 0x1509FFFE, &target));
+    CuAssertIntEquals(test, 0x08, target);
+    CuAssertTrue(test, branchTarget(0x10, 0x0C000010, &target)); // jal
+    CuAssertIntEquals(test, 0x40, target);
+    CuAssertTrue(test, !branchTarget(0x10, 0x03E00008, &target));
+}
+
+void testAnnotation(CuTest* test) {
+    uint8_t program[DATA_ADDRESS - PROGRAM_ADDRESS] = {
+        0x20, 0x08, 0x00, 0x03, // addi $t0, $zero, 3
+        0x21, 0x08, 0xFF, 0xFF, // loop: addi $t0, $t0, -1
+        0x1D, 0x00, 0xFF, 0xFF, // bgtz $t0, loop
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x01, // addi $v0, $zero, 1
+        0x00, 0x00, 0x00, 0x00, // nop, still part of the text
+    };
+
+    ExecProfile profile;
+    CuAssertTrue(test, initExecProfile(&profile));
+    uint32_t trace[] = {0, 4, 8, 4, 8, 4, 8, 12, 16, 20};
+    for (size_t i = 0; i + 1 < sizeof(trace) / sizeof(uint32_t); i++) profileRetire(&profile, trace[i], trace[i + 1]);
+    CuAssertIntEquals(test, 9, profile.total);
+    CuAssertIntEquals(test, 3, profile.counts[1]);
+    CuAssertIntEquals(test, 2, profile.taken[2]);
+
+    char* report;
+    size_t size;
+    FILE* out = open_memstream(&report, &size);
+    printAnnotation(program, 28, false, &profile, NULL, NULL, NULL, out);
+    fclose(out);
+
+    CuAssertTrue(test, strstr(report, "0x002004: block of 2 instructions, entered 3 times, 66.67% of instructions [loop head] [hot]") != NULL);
+    CuAssertTrue(test, strstr(report, "bgtz $t0, 0x002004") != NULL);
+    CuAssertTrue(test, strstr(report, "<- loop back-edge to 0x002004") != NULL);
+    CuAssertTrue(test, strstr(report, "0x00200c: block of 4 instructions, entered 1 times") != NULL);
+    CuAssertTrue(test, strstr(report, "sll $zero, $zero, 0") != NULL);
+
+    free(report);
+
+    out = open_memstream(&report, &size);
+    CuAssertTrue(test, writeExecProfile(program, 28, &profile, out));
+    fclose(out);
+
+    CuAssertTrue(test, strstr(report, "\n4 3 0\n8 3 2\n12 1 0\n") != NULL);
+    CuAssertTrue(test, strstr(report, "\n20 ") == NULL);
+
+    free(report);
+    freeExecProfile(&profile);
+}
+
+CuSuite* getLMipsDisasmSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testDisassemble);
+    SUITE_ADD_TEST(suite, testControlTransfers);
+    SUITE_ADD_TEST(suite, testAnnotation);
+
+    return suite;
+}
@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "memory.h"
+#include "executable.h"
+#include "lmips_registers.h"
+
+#define V2_IMAGE_SIZE 0x2100
+
+static void putWord(uint8_t* bytes, uint32_t word) {
+    bytes[0] = word >> 0x18;
+    bytes[1] = word >> 0x10;
+    bytes[2] = word >> 0x08;
+    bytes[3] = word;
+}
+
+static void putHalf(uint8_t* bytes, uint16_t half) {
+    bytes[0] = half >> 0x08;
+    bytes[1] = half;
+}
+
+static void putSegment(uint8_t* bytes, uint32_t flags, uint32_t offset, uint32_t address,
+                       uint32_t fileSize, uint32_t memSize) {
+    putWord(bytes, PT_LOAD);
+    putWord(&bytes[4], flags);
+    putWord(&bytes[8], offset);
+    putWord(&bytes[12], address);
+    putWord(&bytes[16], fileSize);
+    putWord(&bytes[20], memSize);
+}
+
+// Text on the first page, data on the second, then the segment and section tables
+static void buildV2Image(uint8_t* image) {
+    memset(image, 0, V2_IMAGE_SIZE);
+    memcpy(image, "\x10LEF\x02\x00", 6);
+    putWord(&image[8], PROGRAM_ADDRESS + 4);
+    putWord(&image[12], 0x2010);
+    putHalf(&image[16], 2);
+    putHalf(&image[18], 1);
+    putWord(&image[20], 0x2040);
+
+    putWord(&image[0x1000], 0x24020001); // addiu $v0, $zero, 1
+    putWord(&image[0x1004], 0x0000000C); // syscall
+    memcpy(&image[0x2000], "data", 4);
+    memcpy(&image[0x2008], "main", 4);
+
+    putSegment(&image[0x2010], PF_R | PF_X, 0x1000, PROGRAM_ADDRESS, 8, 8);
+    putSegment(&image[0x2028], PF_R | PF_W, 0x2000, DATA_ADDRESS, 4, 0x400);
+
+    putHalf(&image[0x2042], SHT_SYMTAB);
+    putWord(&image[0x2044], 0x2008);
+    putWord(&image[0x2048], 4);
+
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+}
+
+void testLoadV1Image(CuTest* test) {
+    uint8_t image[] = {
+        0x10, 'L', 'E', 'F', 1, 0, 0, 0, 0, 19, 0, 0, 0, 29, 3,
+        0x24, 0x02, 0x00, 0x01, // addiu $v0, $zero, 1
+        'a', 'b', // Data
+        0, 0, 0, 0, 0, 0, 0, 0, // Never loaded
+        0, 0, SHT_EXEC, 0, 0, 0, 15, 0, 0, 0, 4,
+        0, 0, SHT_ZERO, 0, 0, 0, 0, 0, 0, 0, 8,
+        0, 0, SHT_ALLOC, 0, 0, 0, 19, 0, 0, 0, 2
+    };
+
+    Memory memory;
+    initMemory(&memory);
+    DebugInfo debug;
+    initDebugInfo(&debug, "unused");
+    memory.store[DATA_ADDRESS + 3] = 0xFF;
+
+    uint32_t entry, textSize;
+    CuAssertTrue(test, loadExecutableImage(image, sizeof(image), &memory, &debug, NULL, &entry, &textSize));
+    CuAssertIntEquals(test, 4, entry);
+    CuAssertIntEquals(test, 4, textSize);
+    CuAssertIntEquals(test, 0x24020001, mem_read(&memory, PROGRAM_ADDRESS));
+    CuAssertIntEquals(test, 'a', mem_read_byte(&memory, DATA_ADDRESS + 8));
+    CuAssertIntEquals(test, 'b', mem_read_byte(&memory, DATA_ADDRESS + 9));
+    CuAssertIntEquals(test, 0xFF, mem_read_byte(&memory, DATA_ADDRESS + 3));
+
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+}
+
+void testLoadV2Image(CuTest* test) {
+    static uint8_t image[V2_IMAGE_SIZE];
+    buildV2Image(image);
+
+    Memory memory;
+    initMemory(&memory);
+    DebugInfo debug;
+    initDebugInfo(&debug, "unused");
+
+    uint32_t entry, textSize;
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+    CuAssertIntEquals(test, 4, entry);
+    CuAssertIntEquals(test, 8, textSize);
+    CuAssertIntEquals(test, 0x24020001, mem_read(&memory, PROGRAM_ADDRESS));
+    CuAssertIntEquals(test, 0x0C, mem_read(&memory, PROGRAM_ADDRESS + 4));
+    CuAssertIntEquals(test, 0, memcmp(&memory.store[DATA_ADDRESS], "data", 4));
+    CuAssertIntEquals(test, 0, mem_read(&memory, DATA_ADDRESS + 4));
+    CuAssertIntEquals(test, 0x2008, debug.symtabOffset);
+    CuAssertIntEquals(test, 4, debug.symtabSize);
+    CuAssertIntEquals(test, 0, debug.linesSize);
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+
+    // Same image through the file loader
+    char path[] = "/tmp/lmips_image_XXXXXX";
+    int fd = mkstemp(path);
+    CuAssertIntEquals(test, V2_IMAGE_SIZE, write(fd, image, V2_IMAGE_SIZE));
+    close(fd);
+    initMemory(&memory);
+    initDebugInfo(&debug, path);
+    CuAssertTrue(test, loadExecutable(path, &memory, &debug, NULL, &entry, &textSize));
+    CuAssertIntEquals(test, 4, entry);
+    CuAssertIntEquals(test, 0, memcmp(&memory.store[DATA_ADDRESS], "data", 4));
+
+    unlink(path);
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+
+    // Text ending in a nop keeps it, the size comes from the segment and not from the words
+    putSegment(&image[0x2010], PF_R | PF_X, 0x1000, PROGRAM_ADDRESS, 12, 12);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    initMemory(&memory);
+    initDebugInfo(&debug, "unused");
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+    CuAssertIntEquals(test, 12, textSize);
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+}
+
+void testLoadLittleEndianImage(CuTest* test) {
+    static uint8_t image[V2_IMAGE_SIZE];
+    buildV2Image(image);
+    putHalf(&image[6], LEF_LITTLE_ENDIAN);
+    memcpy(&image[0x1000], "\x01\x00\x02\x24\x0C\x00\x00\x00", 8);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+
+    Memory memory;
+    initMemory(&memory);
+    DebugInfo debug;
+    initDebugInfo(&debug, "unused");
+
+    uint32_t entry, textSize;
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+    CuAssertTrue(test, memory.littleEndian);
+    CuAssertIntEquals(test, 0x24020001, mem_read(&memory, PROGRAM_ADDRESS));
+    CuAssertIntEquals(test, 0x0C, mem_read_instr(&memory.store[PROGRAM_ADDRESS], 4, true));
+
+    // Flags this VM does not know about are refused rather than ignored
+    putHalf(&image[6], 0x02);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+}
+
+// Appends an SHT_DECODED section describing the text of buildV2Image
+static void addDecodedSection(uint8_t* image) {
+    putHalf(&image[18], 2);
+    putHalf(&image[0x204E], SHT_DECODED);
+    putWord(&image[0x2050], 0x2060);
+    putWord(&image[0x2054], DECODED_HEADER_SIZE + 2 * DECODED_INSTR_SIZE);
+
+    putWord(&image[0x2060], 8);
+    putWord(&image[0x2064], textHash(&image[0x1000], 8));
+    uint8_t records[] = {
+        DOP_ADDIU, 0, $zero, $v0, 0, 0, 0, 1,
+        DOP_SYSCALL, 0, 0, 0, 0, 0, 0, 0
+    };
+    memcpy(&image[0x2068], records, sizeof(records));
+
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+}
+
+void testLoadDecodedSection(CuTest* test) {
+    static uint8_t image[V2_IMAGE_SIZE];
+    Memory memory;
+    initMemory(&memory);
+    DebugInfo debug;
+    initDebugInfo(&debug, "unused");
+    DecodedText decoded;
+    uint32_t entry, textSize;
+
+    buildV2Image(image);
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, &decoded, &entry, &textSize));
+    CuAssertIntEquals(test, 0, decoded.count);
+
+    addDecodedSection(image);
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, &decoded, &entry, &textSize));
+    CuAssertIntEquals(test, 2, decoded.count);
+    CuAssertIntEquals(test, DOP_ADDIU, decoded.instrs[0].op);
+    CuAssertIntEquals(test, $v0, decoded.instrs[0].rt);
+    CuAssertIntEquals(test, 1, decoded.instrs[0].immed);
+    CuAssertIntEquals(test, DOP_SYSCALL, decoded.instrs[1].op);
+    freeDecodedText(&decoded);
+
+    // Built for other text
+    putWord(&image[0x1000], 0x24020002);
+    addDecodedSection(image);
+    putWord(&image[0x1000], 0x24020001);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, &decoded, &entry, &textSize));
+    freeDecodedText(&decoded);
+
+    // Register out of range
+    addDecodedSection(image);
+    image[0x2069] = REG_COUNT;
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, &decoded, &entry, &textSize));
+    freeDecodedText(&decoded);
+
+    // Well-formed records are trusted once the size and hash match, they are not decoded again
+    addDecodedSection(image);
+    image[0x206F] = 2;
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, &decoded, &entry, &textSize));
+    CuAssertIntEquals(test, 2, decoded.instrs[0].immed);
+    freeDecodedText(&decoded);
+
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+}
+
+void testRejectInvalidV2Image(CuTest* test) {
+    static uint8_t image[V2_IMAGE_SIZE];
+    Memory memory;
+    initMemory(&memory);
+    DebugInfo debug;
+    initDebugInfo(&debug, "unused");
+    uint32_t entry, textSize;
+
+    // Corrupted byte
+    buildV2Image(image);
+    image[0x2001] ^= 0x01;
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    // Writable text
+    buildV2Image(image);
+    putSegment(&image[0x2010], PF_R | PF_W | PF_X, 0x1000, PROGRAM_ADDRESS, 8, 8);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    // Data over the text
+    buildV2Image(image);
+    putSegment(&image[0x2028], PF_R | PF_W, 0x2000, PROGRAM_ADDRESS, 4, 4);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    // File offset not congruent with the load address
+    buildV2Image(image);
+    putSegment(&image[0x2028], PF_R | PF_W, 0x2000, DATA_ADDRESS + 4, 4, 4);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    // Entry point outside the text
+    buildV2Image(image);
+    putWord(&image[8], DATA_ADDRESS);
+    putWord(&image[LEF_V2_CHECKSUM_OFFSET], lefChecksum(image, V2_IMAGE_SIZE));
+    CuAssertTrue(test, !loadExecutableImage(image, V2_IMAGE_SIZE, &memory, &debug, NULL, &entry, &textSize));
+
+    // Truncated file
+    buildV2Image(image);
+    CuAssertTrue(test, !loadExecutableImage(image, 0x1800, &memory, &debug, NULL, &entry, &textSize));
+
+    freeDebugInfo(&debug);
+    freeMemory(&memory);
+}
+
+CuSuite* getLMipsExecutableSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testLoadV1Image);
+    SUITE_ADD_TEST(suite, testLoadV2Image);
+    SUITE_ADD_TEST(suite, testLoadLittleEndianImage);
+    SUITE_ADD_TEST(suite, testRejectInvalidV2Image);
+    SUITE_ADD_TEST(suite, testLoadDecodedSection);
+
+    return suite;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "decode.h"
+
+void testSingleArithmetic(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x44, 0x88, 0x00, 0x00, // mtc1 $t0, $f0
+        0x44, 0x89, 0x10, 0x00, // mtc1 $t1, $f2
+        0x46, 0x80, 0x00, 0x20, // cvt.s.w $f0, $f0
+        0x46, 0x80, 0x10, 0xA0, // cvt.s.w $f2, $f2
+        0x46, 0x00, 0x01, 0x04, // sqrt.s $f4, $f0
+        0x46, 0x02, 0x01, 0x83, // div.s $f6, $f0, $f2
+        0x46, 0x02, 0x32, 0x02, // mul.s $f8, $f6, $f2
+        0x46, 0x06, 0x20, 0x3C, // c.lt.s $f4, $f6
+        0x45, 0x01, 0x00, 0x02, // bc1t skip
+        0x46, 0x08, 0x42, 0x00, // add.s $f8, $f8, $f8
+        0x46, 0x00, 0x32, 0x8D, // skip: trunc.w.s $f10, $f6
+        0x46, 0x00, 0x33, 0x24, // cvt.w.s $f12, $f6
+        0x44, 0x0A, 0x50, 0x00, // mfc1 $t2, $f10
+        0x44, 0x0B, 0x60, 0x00, // mfc1 $t3, $f12
+        0x46, 0x00, 0x43, 0x87, // neg.s $f14, $f8
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 9;
+    mips.regs[$t1] = 2;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 0x40400000, mips.fregs[$f4]); // 3.0
+    CuAssertIntEquals(test, 0x40900000, mips.fregs[$f6]); // 4.5
+    CuAssertIntEquals(test, 0x41100000, mips.fregs[$f8]); // 9.0, the add was branched over
+    CuAssertIntEquals(test, 0xC1100000, mips.fregs[$f14]);
+    CuAssertTrue(test, mips.fcc);
+    CuAssertIntEquals(test, 4, mips.regs[$t2]);
+    CuAssertIntEquals(test, 4, mips.regs[$t3]); // Ties round to even
+
+    freeSimulator(&mips);
+}
+
+void testDoubleLoadStore(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0xD7, 0x80, 0x00, 0x00, // ldc1 $f0, 0($gp)
+        0x44, 0x88, 0x10, 0x00, // mtc1 $t0, $f2
+        0x46, 0x80, 0x10, 0xA1, // cvt.d.w $f2, $f2
+        0x46, 0x22, 0x01, 0x02, // mul.d $f4, $f0, $f2
+        0xF7, 0x84, 0x00, 0x08, // sdc1 $f4, 8($gp)
+        0x46, 0x20, 0x20, 0x3E, // c.le.d $f4, $f0
+        0x45, 0x00, 0x00, 0x02, // bc1f skip
+        0x20, 0x0C, 0x00, 0x01, // addi $t4, $zero, 1
+        0x46, 0x20, 0x21, 0xA0, // skip: cvt.s.d $f6, $f4
+        0xE7, 0x86, 0x00, 0x10, // swc1 $f6, 16($gp)
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.regs[$t0] = 3;
+
+    // 1.5, the high word first on a big-endian guest
+    uint32_t address = mips.regs[$gp];
+    mem_write(&memory, address, 0x3FF80000);
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 0, mips.fregs[$f4]);
+    CuAssertIntEquals(test, 0x40120000, mips.fregs[$f5]); // 4.5
+    CuAssertIntEquals(test, 0x40120000, mem_read(&memory, address + 8));
+    CuAssertIntEquals(test, 0, mem_read(&memory, address + 12));
+    CuAssertIntEquals(test, 0x40900000, mem_read(&memory, address + 16));
+    CuAssertIntEquals(test, 0, mips.regs[$t4]);
+
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testFloatSyscalls(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x20, 0x02, 0x00, 0x02, // addi $v0, $zero, 2
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x03, // addi $v0, $zero, 3
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    char* output;
+    size_t size;
+    initTestSimulator(&mips, program);
+    mips.output = open_memstream(&output, &size);
+
+    // Printed as a single from $f12 first, then as the double in $f12/$f13
+    mips.fregs[$f12] = 0;
+    mips.fregs[$f13] = 0xC0040000; // -2.5
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    fclose(mips.output);
+    CuAssertStrEquals(test, "0-2.5", output);
+
+    free(output);
+    freeSimulator(&mips);
+}
+
+void testDecodeFloatRegisters(CuTest* test) {
+    DecodedInstr decoded;
+
+    decodeInstruction(0, 0x46220102, &decoded); // mul.d $f4, $f0, $f2
+    CuAssertIntEquals(test, DOP_MUL_D, decoded.op);
+    CuAssertIntEquals(test, 4, decoded.rd);
+    CuAssertIntEquals(test, 0, decoded.rs);
+    CuAssertIntEquals(test, 2, decoded.rt);
+
+    decodeInstruction(0x10, 0x45010002, &decoded); // bc1t
+    CuAssertIntEquals(test, DOP_BC1T, decoded.op);
+    CuAssertIntEquals(test, 0x18, decoded.immed);
+
+    // Odd registers holding doubles and compares on another condition code are unknown
+    decodeInstruction(0, 0x46220800, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    CuAssertIntEquals(test, OP_COP1, decoded.immed);
+    decodeInstruction(0, 0xD7810000, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    CuAssertIntEquals(test, OP_LDC1, decoded.immed);
+    decodeInstruction(0, 0x46020132, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+
+    DecodedInstr record = {DOP_ADD_D, 31, 0, 0, 0};
+    CuAssertTrue(test, !validDecodedInstr(&record));
+}
+
+CuSuite* getLMipsFpuSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testSingleArithmetic);
+    SUITE_ADD_TEST(suite, testDoubleLoadStore);
+    SUITE_ADD_TEST(suite, testFloatSyscalls);
+    SUITE_ADD_TEST(suite, testDecodeFloatRegisters);
+
+    return suite;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "fuzz.h"
+
+// Reads test cases into the data segment and faults when one starts with a zero byte
+static uint8_t program[] = {
+    0x3C, 0x10, 0x00, 0x08, // lui $s0, 8
+    0x02, 0x00, 0x20, 0x21, // loop: addu $a0, $s0, $zero
+    0x20, 0x05, 0x00, 0x40, // addi $a1, $zero, 64
+    0x20, 0x02, 0x00, SYS_FUZZ_INPUT, // addi $v0, $zero, SYS_FUZZ_INPUT
+    OP_SPECIAL, 0, 0, SPE_SYSCALL,
+    0x82, 0x08, 0x00, 0x00, // lb $t0, ($s0)
+    0x15, 0x00, 0xFF, 0xFB, // bne $t0, $zero, loop
+    0x8C, 0x08, 0x00, 0x00 // lw $t0, ($zero)
+};
+
+static void initFuzzedProgram(LMips* mips, Memory* memory) {
+    initMemory(memory);
+    memcpy(&memory->store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(mips, memory);
+}
+
+void testFuzzSession(CuTest* test) {
+    LMips mips;
+    Memory memory;
+    FuzzSession session;
+
+    initFuzzedProgram(&mips, &memory);
+    CuAssertTrue(test, startFuzzSession(&session, &mips, 1000));
+    CuAssertIntEquals(test, 16, mips.ip);
+
+    CuAssertIntEquals(test, FUZZ_OK, fuzzOne(&session, &mips, (const uint8_t*)"abc", 3));
+    CuAssertIntEquals(test, 'c', memory.store[DATA_ADDRESS + 2]);
+    CuAssertTrue(test, session.waiting);
+
+    CuAssertIntEquals(test, FUZZ_CRASH, fuzzOne(&session, &mips, (const uint8_t*)"\0", 1));
+
+    // Each test case starts from the state saved at the first request
+    CuAssertIntEquals(test, FUZZ_OK, fuzzOne(&session, &mips, (const uint8_t*)"z", 1));
+    CuAssertIntEquals(test, 'z', memory.store[DATA_ADDRESS]);
+    CuAssertIntEquals(test, 0, memory.store[DATA_ADDRESS + 1]);
+
+    session.limit = 2;
+    CuAssertIntEquals(test, FUZZ_TIMEOUT, fuzzOne(&session, &mips, (const uint8_t*)"a", 1));
+
+    freeFuzzSession(&session);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testEdgeCoverage(CuTest* test) {
+    LMips mips;
+    Memory memory;
+    FuzzSession session;
+    Probes probes = {};
+
+    initFuzzedProgram(&mips, &memory);
+    mips.probes = &probes;
+    CuAssertTrue(test, startFuzzSession(&session, &mips, 1000));
+    probes.coverage = &session.coverage;
+    CuAssertIntEquals(test, 0, coverageCount(&session.coverage));
+
+    fuzzOne(&session, &mips, (const uint8_t*)"a", 1);
+    uint32_t edges = coverageCount(&session.coverage);
+    CuAssertTrue(test, edges > 0);
+
+    // Same path, same edges : only the hit counts grow
+    fuzzOne(&session, &mips, (const uint8_t*)"b", 1);
+    CuAssertIntEquals(test, edges, coverageCount(&session.coverage));
+
+    // The not-taken branch leads to a new block
+    fuzzOne(&session, &mips, (const uint8_t*)"\0", 1);
+    CuAssertTrue(test, coverageCount(&session.coverage) > edges);
+
+    freeFuzzSession(&session);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testFloatBranchCoverage(CuTest* test) {
+    Coverage coverage;
+    CuAssertTrue(test, initCoverage(&coverage));
+
+    coverageRetire(&coverage, 0x46020800, 0x14); // add.s $f0, $f1, $f2
+    CuAssertIntEquals(test, 0, coverageCount(&coverage));
+
+    // Either outcome of an FP compare is an edge of its own
+    coverageRetire(&coverage, 0x45010002, 0x18); // bc1t, taken
+    CuAssertIntEquals(test, 1, coverageCount(&coverage));
+    coverage.previous = 0;
+    coverageRetire(&coverage, 0x45010002, 0x14); // bc1t, not taken
+    CuAssertIntEquals(test, 2, coverageCount(&coverage));
+
+    freeCoverage(&coverage);
+}
+
+CuSuite* getLMipsFuzzSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testFuzzSession);
+    SUITE_ADD_TEST(suite, testEdgeCoverage);
+    SUITE_ADD_TEST(suite, testFloatBranchCoverage);
+
+    return suite;
+}
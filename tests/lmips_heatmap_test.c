@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "heatmap.h"
+
+void testHeatMapCounts(CuTest* test) {
+    HeatMap heat;
+    CuAssertTrue(test, initHeatMap(&heat, 4, HEAP_ADDRESS));
+
+    heatAccess(&heat, DATA_ADDRESS, false);
+    heatAccess(&heat, DATA_ADDRESS + 4, true);
+    heatAccess(&heat, DATA_ADDRESS + 64, true);
+
+    uint32_t page = DATA_ADDRESS / MEMORY_PAGE_SIZE;
+    CuAssertIntEquals(test, 1, heat.pages[page].reads);
+    CuAssertIntEquals(test, 2, heat.pages[page].writes);
+    CuAssertIntEquals(test, 1, heat.lines[DATA_ADDRESS >> HEAT_LINE_BITS].reads);
+    CuAssertIntEquals(test, 1, heat.lines[DATA_ADDRESS >> HEAT_LINE_BITS].writes);
+    CuAssertIntEquals(test, 1, heat.lines[(DATA_ADDRESS + 64) >> HEAT_LINE_BITS].writes);
+
+    freeHeatMap(&heat);
+}
+
+void testHeatMapRegions(CuTest* test) {
+    HeatMap heat;
+    CuAssertTrue(test, initHeatMap(&heat, 4, HEAP_ADDRESS));
+
+    heatBreak(&heat, HEAP_ADDRESS + 0x100);
+    heatBreak(&heat, HEAP_ADDRESS + 0x10);
+    CuAssertIntEquals(test, HEAP_ADDRESS + 0x100, heat.heapPeak);
+
+    CuAssertIntEquals(test, REGION_DATA, heatRegion(&heat, DATA_ADDRESS));
+    CuAssertIntEquals(test, REGION_HEAP, heatRegion(&heat, HEAP_ADDRESS + 0x20));
+    CuAssertIntEquals(test, REGION_STACK, heatRegion(&heat, STACK_ADDRESS - 3));
+
+    heatAccess(&heat, HEAP_ADDRESS, true);
+    CuAssertIntEquals(test, STACK_ADDRESS + 1, heat.stackLow);
+    heatAccess(&heat, STACK_ADDRESS - 0x103, true);
+    heatAccess(&heat, STACK_ADDRESS - 3, true);
+    CuAssertIntEquals(test, STACK_ADDRESS - 0x103, heat.stackLow);
+
+    freeHeatMap(&heat);
+}
+
+void testWorkingSet(CuTest* test) {
+    HeatMap heat;
+    CuAssertTrue(test, initHeatMap(&heat, 2, HEAP_ADDRESS));
+
+    heatAccess(&heat, DATA_ADDRESS, false);
+    heatAccess(&heat, DATA_ADDRESS + MEMORY_PAGE_SIZE, false);
+    heatRetire(&heat);
+    heatAccess(&heat, DATA_ADDRESS + 8, true);
+    heatRetire(&heat);
+
+    heatAccess(&heat, DATA_ADDRESS, false);
+    heatRetire(&heat);
+    heatFlush(&heat);
+
+    CuAssertIntEquals(test, 2, heat.intervals);
+    CuAssertIntEquals(test, 2, heat.workingSet[0]);
+    CuAssertIntEquals(test, 1, heat.workingSet[1]);
+
+    freeHeatMap(&heat);
+}
+
+void testHeatMapProbes(CuTest* test) {
+    LMips mips;
+    Memory memory;
+    HeatMap heat;
+    Probes probes = {};
+
+    uint8_t program[] = {
+        0x20, 0x04, 0x00, 0x40, // addi $a0, $zero, 64
+        0x20, 0x02, 0x00, SYS_SBRK, // addi $v0, $zero, SYS_SBRK
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0xA8, 0x40, 0x00, 0x00, // sw $zero, ($v0)
+        0xAB, 0xA0, 0xFF, 0xFC, // sw $zero, -4($sp)
+        0x20, 0x02, 0x00, SYS_EXIT, // addi $v0, $zero, SYS_EXIT
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&memory);
+    memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(&mips, &memory);
+    mips.regs[$sp] = STACK_ADDRESS - 3;
+
+    CuAssertTrue(test, initHeatMap(&heat, 100, mips.heap));
+    probes.heat = &heat;
+    mips.probes = &probes;
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, HEAP_ADDRESS + 64, heat.heapPeak);
+    CuAssertIntEquals(test, STACK_ADDRESS - 7, heat.stackLow);
+    CuAssertIntEquals(test, 1, heat.pages[HEAP_ADDRESS / MEMORY_PAGE_SIZE].writes);
+
+    freeHeatMap(&heat);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+CuSuite* getLMipsHeatMapSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testHeatMapCounts);
+    SUITE_ADD_TEST(suite, testHeatMapRegions);
+    SUITE_ADD_TEST(suite, testWorkingSet);
+    SUITE_ADD_TEST(suite, testHeatMapProbes);
+
+    return suite;
+}
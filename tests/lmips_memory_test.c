@@ -133,6 +133,46 @@ void testSbInstruction(CuTest* test) {
     freeSimulator(&mips);
 }
 
+void testLittleEndianAccesses(CuTest* test) {
+    LMips mips;
+
+    uint32_t words[] = {
+        0x3C081234, // lui $t0, 0x1234
+        0x35085678, // ori $t0, $t0, 0x5678
+        0xAB880000, // sw $t0, 0($gp)
+        0x87890000, // lh $t1, 0($gp)
+        0x938A0000, // lbu $t2, 0($gp)
+        0x2002000A, // addi $v0, $zero, 10
+        0x0000000C  // syscall
+    };
+    uint8_t program[sizeof(words)];
+    for (size_t i = 0; i < sizeof(program); i++) {
+        program[i] = words[i >> 2] >> ((i & 0x03) << 3);
+    }
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    memory.littleEndian = true;
+    mips.memory = &memory;
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    uint32_t address = mips.regs[$gp];
+    CuAssertIntEquals(test, 0x78, memory.store[address]);
+    CuAssertIntEquals(test, 0x12, memory.store[address + 3]);
+    CuAssertIntEquals(test, 0x12345678, mem_read(&memory, address));
+    CuAssertIntEquals(test, 0x5678, mips.regs[$t1]);
+    CuAssertIntEquals(test, 0x78, mips.regs[$t2]);
+
+    mem_write_half(&memory, address, 0xABCD);
+    CuAssertIntEquals(test, 0xCD, memory.store[address]);
+    CuAssertIntEquals(test, 0x1234ABCD, mem_read(&memory, address));
+
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
 CuSuite* getLMipsMemoryInstructionsSuite() {
     CuSuite* suite = CuSuiteNew();
 
@@ -141,6 +181,7 @@ CuSuite* getLMipsMemoryInstructionsSuite() {
     SUITE_ADD_TEST(suite, testLbInstruction);
     SUITE_ADD_TEST(suite, testLhuInstruction);
     SUITE_ADD_TEST(suite, testSbInstruction);
+    SUITE_ADD_TEST(suite, testLittleEndianAccesses);
 
     return suite;
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+
+static void runTimed(CuTest* test, LMips* mips, Pipeline* pipeline, PredictorKind kind) {
+    Probes probes = {};
+    probes.pipeline = pipeline;
+
+    CuAssertTrue(test, initPipeline(pipeline, kind, defaultPipelineConfig()));
+    mips->probes = &probes;
+
+    ExecutionResult result = runSimulator(mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    mips->probes = NULL;
+}
+
+void testPipelineLoadUseStall(CuTest* test) {
+    LMips mips;
+    Pipeline pipeline;
+
+    uint8_t program[] = {
+        0x8F, 0xA8, 0x00, 0x00, // lw $t0, ($sp)
+        0x01, 0x08, 0x48, 0x21, // addu $t1, $t0, $t0
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.regs[$sp] = DATA_ADDRESS;
+
+    runTimed(test, &mips, &pipeline, PREDICT_STATIC);
+    CuAssertIntEquals(test, 4, pipeline.instructions);
+    CuAssertIntEquals(test, 1, pipeline.stalls[STALL_LOAD_USE]);
+    CuAssertIntEquals(test, 4 + 1 + 4, pipelineCycles(&pipeline));
+
+    freePipeline(&pipeline);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testPipelineCoprocessorLoadUse(CuTest* test) {
+    LMips mips;
+    Pipeline pipeline;
+
+    uint8_t program[] = {
+        0xC7, 0xA1, 0x00, 0x00, // lwc1 $f1, ($sp)
+        0x46, 0x02, 0x08, 0x00, // add.s $f0, $f1, $f2
+        0xD7, 0xA2, 0x00, 0x08, // ldc1 $f2, 8($sp)
+        0x46, 0x20, 0x11, 0x06, // mov.d $f4, $f2
+        0x78, 0x00, 0xE8, 0x62, // ld.w $w1, ($sp)
+        0x78, 0x41, 0x08, 0x8E, // addv.w $w2, $w1, $w1
+        0xC7, 0xA1, 0x00, 0x00, // lwc1 $f1, ($sp)
+        0x20, 0x22, 0x00, 0x0A, // addi $v0, $at, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.regs[$sp] = DATA_ADDRESS;
+
+    // $at shares its index with $f1 but not its register file
+    runTimed(test, &mips, &pipeline, PREDICT_STATIC);
+    CuAssertIntEquals(test, 9, pipeline.instructions);
+    CuAssertIntEquals(test, 3, pipeline.stalls[STALL_LOAD_USE]);
+
+    freePipeline(&pipeline);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testPipelineHiLoLatency(CuTest* test) {
+    LMips mips;
+    Pipeline pipeline;
+
+    uint8_t program[] = {
+        0x01, 0x09, 0x00, SPE_MULT, // mult $t0, $t1
+        0x00, 0x00, 0x50, SPE_MFLO, // mflo $t2
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    runTimed(test, &mips, &pipeline, PREDICT_STATIC);
+
+    CuAssertIntEquals(test, defaultPipelineConfig().multLatency - 1, pipeline.stalls[STALL_HILO]);
+
+    freePipeline(&pipeline);
+    freeSimulator(&mips);
+}
+
+void testPipelineBranchPrediction(CuTest* test) {
+    LMips mips;
+    Pipeline staticPipeline, bimodalPipeline;
+
+    uint8_t program[] = {
+        0x21, 0x08, 0xFF, 0xFF, // loop: addi $t0, $t0, -1
+        0x15, 0x00, 0xFF, 0xFF, // bne $t0, $zero, loop
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 10;
+    runTimed(test, &mips, &staticPipeline, PREDICT_STATIC);
+
+    // Backward branches are predicted taken, only the loop exit is missed
+    CuAssertIntEquals(test, 10, staticPipeline.branches);
+    CuAssertIntEquals(test, 1, staticPipeline.mispredictions);
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 10;
+    runTimed(test, &mips, &bimodalPipeline, PREDICT_BIMODAL);
+
+    // Counters start weakly not taken and need one taken outcome to flip
+    CuAssertIntEquals(test, 2, bimodalPipeline.mispredictions);
+    CuAssertIntEquals(test, 2 * defaultPipelineConfig().branchPenalty, bimodalPipeline.stalls[STALL_BRANCH]);
+
+    freePipeline(&staticPipeline);
+    freePipeline(&bimodalPipeline);
+    freeSimulator(&mips);
+}
+
+CuSuite* getLMipsPipelineSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testPipelineLoadUseStall);
+    SUITE_ADD_TEST(suite, testPipelineCoprocessorLoadUse);
+    SUITE_ADD_TEST(suite, testPipelineHiLoLatency);
+    SUITE_ADD_TEST(suite, testPipelineBranchPrediction);
+
+    return suite;
+}
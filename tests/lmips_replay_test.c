@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+
+void testReplayReadInt(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x20, 0x02, 0x00, 0x05, // addi $v0, $zero, 5
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x00, 0x40, 0x40, 0x20, // add $t0, $v0, $zero
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    InputLog log = {tmpfile(), REPLAY_RECORD};
+    recordInt(&log, 42);
+    rewind(log.file);
+    log.mode = REPLAY_PLAY;
+
+    initTestSimulator(&mips, program);
+    mips.input = &log;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 42, mips.regs[$t0]);
+
+    closeInputLog(&log);
+    freeSimulator(&mips);
+}
+
+void testReplayReadString(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x20, 0x02, 0x00, 0x06, // addi $v0, $zero, 6
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    InputLog log = {tmpfile(), REPLAY_RECORD};
+    recordString(&log, (const uint8_t*)"lmips", 6);
+    rewind(log.file);
+    log.mode = REPLAY_PLAY;
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.input = &log;
+    mips.regs[$a0] = DATA_ADDRESS;
+    mips.regs[$a1] = 16;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertStrEquals(test, "lmips", (const char*)&memory.store[DATA_ADDRESS]);
+
+    closeInputLog(&log);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testReplayExhaustedLog(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x20, 0x02, 0x00, 0x05, // addi $v0, $zero, 5
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    InputLog log = {tmpfile(), REPLAY_PLAY};
+
+    initTestSimulator(&mips, program);
+    mips.input = &log;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_FAILURE, result);
+
+    closeInputLog(&log);
+    freeSimulator(&mips);
+}
+
+// Raw reads from stdin go through the log like every other input, whichever syscall makes them
+void testReplayRawInput(CuTest* test) {
+    const uint8_t syscalls[] = {SYS_FUZZ_INPUT, SYS_RECV};
+    char path[] = "/tmp/lmips_input_XXXXXX";
+    int fd = mkstemp(path);
+    CuAssertIntEquals(test, 5, write(fd, "bytes", 5));
+    close(fd);
+
+    for (int i = 0; i < 2; i++) {
+        uint8_t program[] = {
+            0x20, 0x02, 0x00, syscalls[i], // addi $v0, $zero, syscall
+            OP_SPECIAL, 0, 0, SPE_SYSCALL,
+            0x00, 0x40, 0x40, 0x20, // add $t0, $v0, $zero
+            0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+            OP_SPECIAL, 0, 0, SPE_SYSCALL
+        };
+        InputLog log = {tmpfile(), REPLAY_RECORD};
+        LMips mips;
+        Memory memory;
+
+        CuAssertPtrNotNull(test, freopen(path, "r", stdin));
+        for (int run = 0; run < 2; run++) {
+            initMemory(&memory);
+            memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+            initSimulator(&mips, &memory);
+            mips.input = &log;
+            mips.regs[$a0] = DATA_ADDRESS;
+            mips.regs[$a1] = 16;
+
+            CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+            CuAssertIntEquals(test, 5, mips.regs[$t0]);
+            CuAssertTrue(test, memcmp(&memory.store[DATA_ADDRESS], "bytes", 5) == 0);
+            freeSimulator(&mips);
+            freeMemory(&memory);
+
+            // The second run reads the log, stdin is at its end by now
+            rewind(log.file);
+            log.mode = REPLAY_PLAY;
+        }
+        closeInputLog(&log);
+    }
+
+    unlink(path);
+}
+
+void testStateHash(CuTest* test) {
+    LMips first, second;
+
+    initTestSimulator(&first, NULL);
+    initTestSimulator(&second, NULL);
+    CuAssertTrue(test, hashSimulator(&first) == hashSimulator(&second));
+
+    second.regs[$t0] = 1;
+    CuAssertTrue(test, hashSimulator(&first) != hashSimulator(&second));
+
+    freeSimulator(&first);
+    freeSimulator(&second);
+}
+
+CuSuite* getLMipsReplaySuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testReplayReadInt);
+    SUITE_ADD_TEST(suite, testReplayReadString);
+    SUITE_ADD_TEST(suite, testReplayExhaustedLog);
+    SUITE_ADD_TEST(suite, testReplayRawInput);
+    SUITE_ADD_TEST(suite, testStateHash);
+
+    return suite;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "ring.h"
+
+#define RING_ADDRESS DATA_ADDRESS
+
+static void pushSubmission(Memory* memory, uint32_t op, uint32_t address, uint32_t length, uint32_t data) {
+    uint32_t entries = mem_read(memory, RING_ADDRESS);
+    uint32_t tail = mem_read(memory, RING_ADDRESS + 0x08);
+    uint32_t sqe = RING_ADDRESS + RING_HEADER_SIZE + (tail & (entries - 1)) * RING_SQE_SIZE;
+
+    mem_write(memory, sqe, op);
+    mem_write(memory, sqe + 0x04, address);
+    mem_write(memory, sqe + 0x08, length);
+    mem_write(memory, sqe + 0x0C, data);
+    mem_write(memory, RING_ADDRESS + 0x08, tail + 1);
+}
+
+static uint32_t completion(Memory* memory, uint32_t index, uint32_t word) {
+    uint32_t entries = mem_read(memory, RING_ADDRESS);
+    return mem_read(memory, RING_ADDRESS + RING_SIZE(entries) - entries * RING_CQE_SIZE + index * RING_CQE_SIZE + word);
+}
+
+void testRingSubmissions(CuTest* test) {
+    Memory memory;
+    Ring ring;
+    char* output;
+    size_t size;
+    FILE* out = open_memstream(&output, &size);
+
+    initMemory(&memory);
+    CuAssertTrue(test, initRing(&ring));
+    mem_write(&memory, RING_ADDRESS, 4);
+    strcpy((char*)&memory.store[DATA_ADDRESS + 0x1000], "hello ");
+
+    pushSubmission(&memory, RING_WRITE, DATA_ADDRESS + 0x1000, 6, 0x10);
+    pushSubmission(&memory, RING_PRINT_INT, -42, 0, 0x11);
+    pushSubmission(&memory, 7, 0, 0, 0x12);
+    pushSubmission(&memory, RING_WRITE, MEMORY_SIZE - 4, 8, 0x13);
+
+    uint32_t submitted;
+    CuAssertTrue(test, enterRing(&ring, &memory, RING_ADDRESS, out, &submitted));
+    CuAssertIntEquals(test, 4, submitted);
+    drainRing(&ring);
+    fflush(out);
+    CuAssertStrEquals(test, "hello -42", output);
+
+    CuAssertIntEquals(test, 0x10, completion(&memory, 0, 0));
+    CuAssertIntEquals(test, 6, completion(&memory, 0, 4));
+    CuAssertIntEquals(test, 0x11, completion(&memory, 1, 0));
+    CuAssertIntEquals(test, 0, completion(&memory, 1, 4));
+    CuAssertIntEquals(test, RING_FAILED, completion(&memory, 2, 4));
+    CuAssertIntEquals(test, RING_FAILED, completion(&memory, 3, 4));
+    CuAssertIntEquals(test, 4, mem_read(&memory, RING_ADDRESS + 0x04));
+    CuAssertIntEquals(test, 4, mem_read(&memory, RING_ADDRESS + 0x10));
+
+    // Nothing more is taken until the guest reaps completions
+    pushSubmission(&memory, RING_NOP, 0, 0, 0x20);
+    pushSubmission(&memory, RING_NOP, 0, 0, 0x21);
+    CuAssertTrue(test, enterRing(&ring, &memory, RING_ADDRESS, out, &submitted));
+    CuAssertIntEquals(test, 0, submitted);
+    mem_write(&memory, RING_ADDRESS + 0x0C, 3);
+    CuAssertTrue(test, enterRing(&ring, &memory, RING_ADDRESS, out, &submitted));
+    CuAssertIntEquals(test, 2, submitted);
+    CuAssertIntEquals(test, 0x20, completion(&memory, 0, 0));
+    CuAssertIntEquals(test, 0x21, completion(&memory, 1, 0));
+    CuAssertIntEquals(test, 3, ring.stats.enters);
+    CuAssertIntEquals(test, 6, ring.stats.submissions);
+
+    // Ring sizes are powers of two
+    mem_write(&memory, RING_ADDRESS, 3);
+    CuAssertTrue(test, !enterRing(&ring, &memory, RING_ADDRESS, out, &submitted));
+    CuAssertTrue(test, !enterRing(&ring, &memory, RING_ADDRESS + 2, out, &submitted));
+
+    freeRing(&ring);
+    fclose(out);
+    free(output);
+    freeMemory(&memory);
+}
+
+void testRingSyscall(CuTest* test) {
+    LMips mips;
+    Memory memory;
+    char* output;
+    size_t size;
+
+    uint8_t program[] = {
+        0x20, 0x02, 0x00, 0x25, // addi $v0, $zero, 0x25
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x01, 0x00, 0x20, 0x20, // add $a0, $t0, $zero
+        0x20, 0x02, 0x00, 0x04, // addi $v0, $zero, 4
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initMemory(&memory);
+    memcpy(&memory.store[PROGRAM_ADDRESS], program, sizeof(program));
+    initSimulator(&mips, &memory);
+    mips.output = open_memstream(&output, &size);
+
+    uint32_t text = DATA_ADDRESS + 0x1000;
+    strcpy((char*)&memory.store[text], "ring,direct");
+    mem_write(&memory, RING_ADDRESS, 8);
+    pushSubmission(&memory, RING_WRITE, text, 5, 0);
+    mips.regs[$a0] = RING_ADDRESS;
+    mips.regs[$t0] = text + 5;
+
+    // Direct output waits for the ring output submitted before it
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    fflush(mips.output);
+    CuAssertStrEquals(test, "ring,direct", output);
+    CuAssertIntEquals(test, 1, mem_read(&memory, RING_ADDRESS + 0x10));
+
+    mem_write(&memory, RING_ADDRESS, 0);
+    mips.regs[$a0] = RING_ADDRESS;
+    mips.ip = 0;
+    mips.stop = false;
+    CuAssertIntEquals(test, EXEC_FAILURE, runSimulator(&mips));
+
+    fclose(mips.output);
+    free(output);
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testRingFork(CuTest* test) {
+    Memory memory;
+    Ring ring;
+    char path[] = "/tmp/lmips_ring_XXXXXX";
+    close(mkstemp(path));
+    FILE* out = fopen(path, "a");
+
+    initMemory(&memory);
+    CuAssertTrue(test, initRing(&ring));
+    mem_write(&memory, RING_ADDRESS, 4);
+    strcpy((char*)&memory.store[DATA_ADDRESS + 0x1000], "parent,child");
+
+    // Output queued before the fork is written by the parent alone, the child writes with a worker of its own
+    uint32_t submitted;
+    pushSubmission(&memory, RING_WRITE, DATA_ADDRESS + 0x1000, 7, 0);
+    CuAssertTrue(test, enterRing(&ring, &memory, RING_ADDRESS, out, &submitted));
+    pid_t child = fork();
+    if (child == 0) {
+        pushSubmission(&memory, RING_WRITE, DATA_ADDRESS + 0x1007, 5, 0);
+        bool entered = enterRing(&ring, &memory, RING_ADDRESS, out, &submitted);
+        drainRing(&ring);
+        freeRing(&ring);
+        _exit(entered ? 0 : 1);
+    }
+
+    int status;
+    CuAssertIntEquals(test, child, waitpid(child, &status, 0));
+    CuAssertTrue(test, WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    drainRing(&ring);
+    freeRing(&ring);
+    fclose(out);
+
+    char written[32] = {};
+    FILE* in = fopen(path, "r");
+    size_t size = fread(written, sizeof(char), sizeof(written) - 1, in);
+    fclose(in);
+    CuAssertIntEquals(test, 12, size);
+    CuAssertTrue(test, strstr(written, "parent,") != NULL && strstr(written, "child") != NULL);
+
+    unlink(path);
+    freeMemory(&memory);
+}
+
+CuSuite* getLMipsRingSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testRingSubmissions);
+    SUITE_ADD_TEST(suite, testRingSyscall);
+    SUITE_ADD_TEST(suite, testRingFork);
+
+    return suite;
+}
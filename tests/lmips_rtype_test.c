@@ -236,6 +236,81 @@ void testJalrProgram(CuTest* test) {
     freeSimulator(&mips);
 }
 
+void testMulProgram(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x71, 0x09, 0x50, 0x02, // mul $t2, $t0, $t1
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = -7;
+    mips.regs[$t1] = 6;
+    mips.lo = 5;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, -42, mips.regs[$t2]);
+    CuAssertIntEquals(test, 5, mips.lo);
+
+    freeSimulator(&mips);
+}
+
+void testMovzMovnProgram(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x01, 0x09, 0x50, 0x0A, // movz $t2, $t0, $t1
+        0x01, 0x09, 0x58, 0x0B, // movn $t3, $t0, $t1
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 45;
+    mips.regs[$t3] = 7;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 45, mips.regs[$t2]);
+    CuAssertIntEquals(test, 7, mips.regs[$t3]);
+
+    freeSimulator(&mips);
+}
+
+void testBitFieldProgram(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x71, 0x0A, 0x50, 0x20, // clz $t2, $t0
+        0x71, 0x2B, 0x58, 0x21, // clo $t3, $t1
+        0x7C, 0x08, 0x64, 0x20, // seb $t4, $t0
+        0x7C, 0x08, 0x6E, 0x20, // seh $t5, $t0
+        0x7D, 0x0E, 0x39, 0x00, // ext $t6, $t0, 4, 8
+        0x7D, 0x0F, 0x5A, 0x04, // ins $t7, $t0, 8, 4
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 0x80F5;
+    mips.regs[$t1] = 0xF0000000;
+    mips.regs[$t7] = 0xFFFFFFFF;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 16, mips.regs[$t2]);
+    CuAssertIntEquals(test, 4, mips.regs[$t3]);
+    CuAssertIntEquals(test, 0xFFFFFFF5, mips.regs[$t4]);
+    CuAssertIntEquals(test, 0xFFFF80F5, mips.regs[$t5]);
+    CuAssertIntEquals(test, 0x0F, mips.regs[$t6]);
+    CuAssertIntEquals(test, 0xFFFFF5FF, mips.regs[$t7]);
+
+    freeSimulator(&mips);
+}
+
 CuSuite* getLMipsRTypeInstructionsSuite() {
     CuSuite* suite = CuSuiteNew();
 
@@ -251,6 +326,9 @@ CuSuite* getLMipsRTypeInstructionsSuite() {
     SUITE_ADD_TEST(suite, testSltProgram);
     SUITE_ADD_TEST(suite, testJrProgram);
     SUITE_ADD_TEST(suite, testJalrProgram);
+    SUITE_ADD_TEST(suite, testMulProgram);
+    SUITE_ADD_TEST(suite, testMovzMovnProgram);
+    SUITE_ADD_TEST(suite, testBitFieldProgram);
 
     return suite;
 }
\ No newline at end of file
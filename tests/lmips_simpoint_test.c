@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+
+static void runLoop(BlockVectors* bbv, uint32_t start, uint64_t instructions) {
+    // Two-instruction loop : start, start + 4, back to start
+    for (uint64_t i = 0; i < instructions; i += 2) {
+        bbvRetire(bbv, start, start + 4);
+        bbvRetire(bbv, start + 4, start);
+    }
+}
+
+void testBlockVectorIntervals(CuTest* test) {
+    BlockVectors bbv;
+    CuAssertTrue(test, initBlockVectors(&bbv, 100));
+
+    runLoop(&bbv, 0x00, 250);
+    CuAssertTrue(test, bbvFlush(&bbv));
+
+    CuAssertIntEquals(test, 3, bbv.intervals);
+    CuAssertIntEquals(test, 100, bbv.lengths[0]);
+    CuAssertIntEquals(test, 50, bbv.lengths[2]);
+
+    freeBlockVectors(&bbv);
+}
+
+void testPickSimPointsPerPhase(CuTest* test) {
+    BlockVectors bbv;
+    SimPoint points[MAX_SIMPOINTS];
+    initBlockVectors(&bbv, 100);
+
+    runLoop(&bbv, 0x00, 1000);
+    runLoop(&bbv, 0x40, 500);
+    bbvFlush(&bbv);
+
+    uint32_t count = pickSimPoints(&bbv, 8, points);
+    CuAssertIntEquals(test, 2, count);
+    CuAssertTrue(test, points[0].interval < 10);
+    CuAssertTrue(test, points[1].interval >= 10);
+    CuAssertDblEquals(test, 2.0 / 3, points[0].weight, 1e-9);
+    CuAssertDblEquals(test, 1.0 / 3, points[1].weight, 1e-9);
+
+    freeBlockVectors(&bbv);
+}
+
+CuSuite* getLMipsSimPointSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testBlockVectorIntervals);
+    SUITE_ADD_TEST(suite, testPickSimPointsPerPhase);
+
+    return suite;
+}
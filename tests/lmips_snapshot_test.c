@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glob.h>
+#include <pthread.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "snapshot.h"
+
+static void loadProgram(LMips* mips, Memory* memory, uint8_t* program, size_t size) {
+    initMemory(memory);
+    memcpy(&memory->store[PROGRAM_ADDRESS], program, size);
+    initSimulator(mips, memory);
+}
+
+void testSnapshotRestore(CuTest* test) {
+    LMips mips, restored;
+    Memory memory, restoredMemory;
+    char path[] = "/tmp/lmips_snapshot_XXXXXX";
+    close(mkstemp(path));
+
+    uint8_t program[] = {
+        0x21, 0x08, 0x00, 0x01, // loop: addi $t0, $t0, 1
+        0xAB, 0xA8, 0x00, 0x00, // sw $t0, ($sp)
+        0x15, 0x09, 0xFF, 0xFE, // bne $t0, $t1, loop
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    loadProgram(&mips, &memory, program, sizeof(program));
+    mips.regs[$sp] = DATA_ADDRESS;
+    mips.regs[$t1] = 100;
+    mips.fregs[$f3] = 0x3FC00000;
+    mips.fcc = true;
+    mips.vregs[$w7].w[2] = 0xCAFEF00D;
+    mips.limit = 30;
+
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, 10, mips.regs[$t0]);
+    CuAssertTrue(test, saveSnapshot(&mips, path));
+
+    CuAssertTrue(test, restoreSnapshot(&restored, &restoredMemory, path));
+    CuAssertIntEquals(test, 10, restored.regs[$t0]);
+    CuAssertIntEquals(test, 0x3FC00000, restored.fregs[$f3]);
+    CuAssertTrue(test, restored.fcc);
+    CuAssertIntEquals(test, 0xCAFEF00D, restored.vregs[$w7].w[2]);
+    CuAssertIntEquals(test, 10, mem_read(&restoredMemory, DATA_ADDRESS));
+    CuAssertIntEquals(test, 30, restored.retired);
+
+    // Both copies finish identically and writes after the restore stay private
+    mips.limit = UINT64_MAX;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&restored));
+    CuAssertIntEquals(test, 100, restored.regs[$t0]);
+    CuAssertTrue(test, hashSimulator(&mips) == hashSimulator(&restored));
+
+    CuAssertTrue(test, restoreSnapshot(&restored, &restoredMemory, path));
+    CuAssertIntEquals(test, 10, mem_read(&restoredMemory, DATA_ADDRESS));
+
+    unlink(path);
+    freeMemory(&memory);
+    freeMemory(&restoredMemory);
+    freeSimulator(&mips);
+    freeSimulator(&restored);
+}
+
+void testSnapshotSyscall(CuTest* test) {
+    LMips mips, restored;
+    Memory memory, restoredMemory;
+    char path[] = "/tmp/lmips_snapshot_XXXXXX";
+    close(mkstemp(path));
+
+    uint8_t program[] = {
+        0x20, 0x08, 0x00, 0x07, // addi $t0, $zero, 7
+        0x20, 0x02, 0x00, SYS_SNAPSHOT, // addi $v0, $zero, SYS_SNAPSHOT
+        OP_SPECIAL, 0, 0, SPE_SYSCALL,
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    loadProgram(&mips, &memory, program, sizeof(program));
+    mips.snapshot = path;
+    CuAssertIntEquals(test, EXEC_SUCCESS, runSimulator(&mips));
+
+    CuAssertTrue(test, restoreSnapshot(&restored, &restoredMemory, path));
+    CuAssertIntEquals(test, 12, restored.ip);
+    CuAssertIntEquals(test, 7, restored.regs[$t0]);
+
+    unlink(path);
+    freeMemory(&memory);
+    freeMemory(&restoredMemory);
+    freeSimulator(&mips);
+    freeSimulator(&restored);
+}
+
+typedef struct {
+    LMips mips;
+    Memory memory;
+    const char* path;
+    bool saved;
+} Writer;
+
+static void* writeSnapshots(void* argument) {
+    Writer* writer = argument;
+    writer->saved = true;
+    for (int i = 0; i < 20; i++) writer->saved &= saveSnapshot(&writer->mips, writer->path);
+    return NULL;
+}
+
+void testSnapshotConcurrentWriters(CuTest* test) {
+    Writer writers[2];
+    pthread_t threads[2];
+    LMips restored;
+    Memory restoredMemory;
+    char path[] = "/tmp/lmips_snapshot_XXXXXX";
+    close(mkstemp(path));
+
+    uint8_t program[] = {OP_SPECIAL, 0, 0, SPE_SYSCALL};
+    for (int i = 0; i < 2; i++) {
+        loadProgram(&writers[i].mips, &writers[i].memory, program, sizeof(program));
+        writers[i].mips.regs[$t0] = i + 1;
+        memset(&writers[i].memory.store[DATA_ADDRESS], i + 1, 3 * MEMORY_PAGE_SIZE);
+        writers[i].path = path;
+        pthread_create(&threads[i], NULL, writeSnapshots, &writers[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+        CuAssertTrue(test, writers[i].saved);
+    }
+
+    // Whichever writer renamed last, the snapshot is entirely its own
+    CuAssertTrue(test, restoreSnapshot(&restored, &restoredMemory, path));
+    uint8_t value = restored.regs[$t0];
+    CuAssertTrue(test, value == 1 || value == 2);
+    CuAssertIntEquals(test, value, restoredMemory.store[DATA_ADDRESS]);
+    CuAssertIntEquals(test, value, restoredMemory.store[DATA_ADDRESS + 3 * MEMORY_PAGE_SIZE - 1]);
+
+    char pattern[64];
+    glob_t leftovers;
+    snprintf(pattern, sizeof(pattern), "%s.*", path);
+    CuAssertIntEquals(test, GLOB_NOMATCH, glob(pattern, 0, NULL, &leftovers));
+
+    unlink(path);
+    freeMemory(&restoredMemory);
+    freeSimulator(&restored);
+    for (int i = 0; i < 2; i++) {
+        freeMemory(&writers[i].memory);
+        freeSimulator(&writers[i].mips);
+    }
+}
+
+CuSuite* getLMipsSnapshotSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testSnapshotRestore);
+    SUITE_ADD_TEST(suite, testSnapshotSyscall);
+    SUITE_ADD_TEST(suite, testSnapshotConcurrentWriters);
+
+    return suite;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lmips_opcodes.h>
+#include "CuTest.h"
+#include "lmips.h"
+#include "decode.h"
+
+void testVectorArithmetic(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x7B, 0x00, 0x40, 0x1E, // fill.b $w0, $t0
+        0x7B, 0x00, 0x48, 0x5E, // fill.b $w1, $t1
+        0x78, 0x01, 0x00, 0x8E, // addv.b $w2, $w0, $w1
+        0x79, 0x01, 0x00, 0xCE, // max_s.b $w3, $w0, $w1
+        0x79, 0x81, 0x01, 0x0E, // max_u.b $w4, $w0, $w1
+        0x78, 0xA1, 0x01, 0x4E, // subv.h $w5, $w0, $w1
+        0x7B, 0x02, 0x41, 0x9E, // fill.w $w6, $t0
+        0x7B, 0x02, 0x69, 0xDE, // fill.w $w7, $t5
+        0x7A, 0x47, 0x32, 0x0E, // min_s.w $w8, $w6, $w7
+        0x7A, 0xC7, 0x32, 0x4E, // min_u.w $w9, $w6, $w7
+        0x79, 0xC7, 0x32, 0x8F, // clt_u.w $w10, $w6, $w7
+        0x79, 0x47, 0x32, 0xCF, // clt_s.w $w11, $w6, $w7
+        0x78, 0x01, 0x1B, 0x0F, // ceq.b $w12, $w3, $w1
+        0x78, 0xC5, 0x12, 0x99, // copy_u.b $t2, $w2[5]
+        0x78, 0x8F, 0x22, 0xD9, // copy_s.b $t3, $w4[15]
+        0x78, 0xE7, 0x2B, 0x19, // copy_u.h $t4, $w5[7]
+        0x78, 0xB3, 0x43, 0x59, // copy_s.w $t5, $w8[3]
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+    mips.regs[$t0] = 0xF0;
+    mips.regs[$t1] = 0x20;
+    mips.regs[$t5] = 0xFFFFFFFF;
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    for (int i = 0; i < VECTOR_SIZE; i++) {
+        CuAssertIntEquals(test, 0x10, mips.vregs[$w2].b[i]); // Lanes wrap around
+        CuAssertIntEquals(test, 0x20, mips.vregs[$w3].b[i]);
+        CuAssertIntEquals(test, 0xF0, mips.vregs[$w4].b[i]);
+        CuAssertIntEquals(test, 0xFF, mips.vregs[$w12].b[i]);
+    }
+    for (int i = 0; i < VECTOR_SIZE / 4; i++) {
+        CuAssertIntEquals(test, 0xFFFFFFFF, mips.vregs[$w8].w[i]);
+        CuAssertIntEquals(test, 0xF0, mips.vregs[$w9].w[i]);
+        CuAssertIntEquals(test, 0xFFFFFFFF, mips.vregs[$w10].w[i]);
+        CuAssertIntEquals(test, 0, mips.vregs[$w11].w[i]);
+    }
+    CuAssertIntEquals(test, 0x10, mips.regs[$t2]);
+    CuAssertIntEquals(test, 0xFFFFFFF0, mips.regs[$t3]);
+    CuAssertIntEquals(test, 0xD0D0, mips.regs[$t4]);
+    CuAssertIntEquals(test, 0xFFFFFFFF, mips.regs[$t5]);
+
+    freeSimulator(&mips);
+}
+
+void testVectorLoadStore(CuTest* test) {
+    LMips mips;
+
+    uint8_t program[] = {
+        0x78, 0x00, 0xE0, 0x20, // ld.b $w0, 0($gp)
+        0x78, 0x00, 0xE0, 0x62, // ld.w $w1, 0($gp)
+        0x78, 0x08, 0xE0, 0x65, // st.h $w1, 16($gp)
+        0x78, 0x1B, 0x00, 0x82, // shf.b $w2, $w0, 0x1B
+        0x7B, 0xF0, 0xE0, 0xA4, // st.b $w2, -16($gp)
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+
+    uint32_t address = mips.regs[$gp];
+    for (int i = 0; i < VECTOR_SIZE; i++) {
+        mem_write_byte(&memory, address + i, i);
+    }
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 5, mips.vregs[$w0].b[5]);
+    CuAssertIntEquals(test, 0x00010203, mips.vregs[$w1].w[0]);
+    CuAssertIntEquals(test, 0x0C0D0E0F, mips.vregs[$w1].w[3]);
+    // Halves of the word lanes go back to memory high byte first
+    CuAssertIntEquals(test, 0x02030001, mem_read(&memory, address + 16));
+    CuAssertIntEquals(test, 0x03020100, mem_read(&memory, address - 16));
+    CuAssertIntEquals(test, 0x0F0E0D0C, mem_read(&memory, address - 4));
+
+    // Little-endian guests read lanes lowest byte first
+    VectorReg reg;
+    vectorLoad(&reg, &memory.store[address], DF_W, true);
+    CuAssertIntEquals(test, 0x03020100, reg.w[0]);
+    vectorLoad(&reg, &memory.store[address], DF_H, false);
+    CuAssertIntEquals(test, 0x0607, reg.h[3]);
+
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testVectorReduce(CuTest* test) {
+    LMips mips;
+
+    // Sums the sixteen bytes at $gp, widening pairs twice and folding the four words
+    uint8_t program[] = {
+        0x78, 0x00, 0xE0, 0x20, // ld.b $w0, 0($gp)
+        0x7A, 0xA0, 0x00, 0x55, // hadd_u.h $w1, $w0, $w0
+        0x7A, 0xC1, 0x08, 0x95, // hadd_u.w $w2, $w1, $w1
+        0x7A, 0xB1, 0x10, 0xC2, // shf.w $w3, $w2, 0xB1
+        0x78, 0x43, 0x10, 0x8E, // addv.w $w2, $w2, $w3
+        0x7A, 0x4E, 0x10, 0xC2, // shf.w $w3, $w2, 0x4E
+        0x78, 0x43, 0x10, 0x8E, // addv.w $w2, $w2, $w3
+        0x78, 0xB0, 0x12, 0x19, // copy_s.w $t0, $w2[0]
+        0x7B, 0x00, 0x49, 0x1E, // fill.b $w4, $t1
+        0x7A, 0x24, 0x21, 0x55, // hadd_s.h $w5, $w4, $w4
+        0x20, 0x02, 0x00, 0x0A, // addi $v0, $zero, 10
+        OP_SPECIAL, 0, 0, SPE_SYSCALL
+    };
+
+    initTestSimulator(&mips, program);
+
+    Memory memory;
+    initMemory(&memory);
+    mips.memory = &memory;
+    mips.regs[$t1] = 0xFF;
+
+    uint32_t address = mips.regs[$gp];
+    for (int i = 0; i < VECTOR_SIZE; i++) {
+        mem_write_byte(&memory, address + i, 0xF0 + i);
+    }
+
+    ExecutionResult result = runSimulator(&mips);
+    CuAssertIntEquals(test, EXEC_SUCCESS, result);
+    CuAssertIntEquals(test, 0x1E1, mips.vregs[$w1].h[0]);
+    CuAssertIntEquals(test, 16 * 0xF0 + 120, mips.regs[$t0]);
+    for (int i = 0; i < VECTOR_SIZE / 4; i++) {
+        CuAssertIntEquals(test, 16 * 0xF0 + 120, mips.vregs[$w2].w[i]);
+    }
+    CuAssertIntEquals(test, 0xFFFE, mips.vregs[$w5].h[4]);
+
+    freeMemory(&memory);
+    freeSimulator(&mips);
+}
+
+void testDecodeVector(CuTest* test) {
+    DecodedInstr decoded;
+
+    decodeInstruction(0, 0x79A7328F, &decoded); // clt_u.h $w10, $w6, $w7
+    CuAssertIntEquals(test, DOP_CLT_U_H, decoded.op);
+    CuAssertIntEquals(test, 10, decoded.rd);
+    CuAssertIntEquals(test, 6, decoded.rs);
+    CuAssertIntEquals(test, 7, decoded.rt);
+
+    decodeInstruction(0, 0x7BFEE062, &decoded); // ld.w $w1, -8($gp)
+    CuAssertIntEquals(test, DOP_LD_W, decoded.op);
+    CuAssertIntEquals(test, $gp, decoded.rs);
+    CuAssertIntEquals(test, -8, (int32_t)decoded.immed);
+
+    decodeInstruction(0, 0x78A61A59, &decoded); // copy_s.h $t1, $w3[6]
+    CuAssertIntEquals(test, DOP_COPY_S_H, decoded.op);
+    CuAssertIntEquals(test, $t1, decoded.rd);
+    CuAssertIntEquals(test, 6, decoded.immed);
+
+    // Doubleword lanes, byte lanes for a widening add and copy_u.w are left out
+    decodeInstruction(0, 0x7861008E, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    CuAssertIntEquals(test, OP_MSA, decoded.immed);
+    decodeInstruction(0, 0x7A010095, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+    decodeInstruction(0, 0x78F11219, &decoded);
+    CuAssertIntEquals(test, DOP_UNKNOWN, decoded.op);
+
+    DecodedInstr record = {DOP_COPY_S_W, $t0, 0, 0, 4};
+    CuAssertTrue(test, !validDecodedInstr(&record));
+}
+
+CuSuite* getLMipsVectorSuite() {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testVectorArithmetic);
+    SUITE_ADD_TEST(suite, testVectorLoadStore);
+    SUITE_ADD_TEST(suite, testVectorReduce);
+    SUITE_ADD_TEST(suite, testDecodeVector);
+
+    return suite;
+}
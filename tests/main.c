@@ -5,6 +5,24 @@ CuSuite* getLMipsRTypeInstructionsSuite();
 CuSuite* getLMipsITypeInstructionsSuite();
 CuSuite* getLMipsJTypeInstructionsSuite();
 CuSuite* getLMipsMemoryInstructionsSuite();
+CuSuite* getLMipsReplaySuite();
+CuSuite* getLMipsCacheSuite();
+CuSuite* getLMipsPipelineSuite();
+CuSuite* getLMipsSimPointSuite();
+CuSuite* getLMipsSnapshotSuite();
+CuSuite* getLMipsBaselineSuite();
+CuSuite* getLMipsFuzzSuite();
+CuSuite* getLMipsHeatMapSuite();
+CuSuite* getLMipsDisasmSuite();
+CuSuite* getLMipsDebugInfoSuite();
+CuSuite* getLMipsExecutableSuite();
+CuSuite* getLMipsDecodeSuite();
+CuSuite* getLMipsCodeCacheSuite();
+CuSuite* getLMipsFpuSuite();
+CuSuite* getLMipsVectorSuite();
+CuSuite* getLMipsArenaSuite();
+CuSuite* getLMipsRingSuite();
+CuSuite* getLMipsChannelSuite();
 
 int main(int argc, char const *argv[]) {
     printf("Welcome to Lite MIPS test suite.\n\n");
@@ -16,6 +34,24 @@ int main(int argc, char const *argv[]) {
     CuSuiteAddSuite(suite, getLMipsITypeInstructionsSuite());
     CuSuiteAddSuite(suite, getLMipsJTypeInstructionsSuite());
     CuSuiteAddSuite(suite, getLMipsMemoryInstructionsSuite());
+    CuSuiteAddSuite(suite, getLMipsReplaySuite());
+    CuSuiteAddSuite(suite, getLMipsCacheSuite());
+    CuSuiteAddSuite(suite, getLMipsPipelineSuite());
+    CuSuiteAddSuite(suite, getLMipsSimPointSuite());
+    CuSuiteAddSuite(suite, getLMipsSnapshotSuite());
+    CuSuiteAddSuite(suite, getLMipsBaselineSuite());
+    CuSuiteAddSuite(suite, getLMipsFuzzSuite());
+    CuSuiteAddSuite(suite, getLMipsHeatMapSuite());
+    CuSuiteAddSuite(suite, getLMipsDisasmSuite());
+    CuSuiteAddSuite(suite, getLMipsDebugInfoSuite());
+    CuSuiteAddSuite(suite, getLMipsExecutableSuite());
+    CuSuiteAddSuite(suite, getLMipsDecodeSuite());
+    CuSuiteAddSuite(suite, getLMipsCodeCacheSuite());
+    CuSuiteAddSuite(suite, getLMipsFpuSuite());
+    CuSuiteAddSuite(suite, getLMipsVectorSuite());
+    CuSuiteAddSuite(suite, getLMipsArenaSuite());
+    CuSuiteAddSuite(suite, getLMipsRingSuite());
+    CuSuiteAddSuite(suite, getLMipsChannelSuite());
 
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);